@@ -0,0 +1,414 @@
+/**
+ * @file bench.c
+ * @brief Csvee throughput benchmarks over synthetic data sets.
+ *
+ * Usage:
+ *
+ *   csvee_bench [--format text|csv|json] [--size MB] [--repeat N] [--dataset NAME]
+ *
+ * Every data set is generated from a fixed seed so runs are comparable
+ * across machines and releases. Each operation is run --repeat times and
+ * the fastest run is reported.
+ */
+
+#define CSVEE_IMPLEMENTATION
+#include "../csvee.h"
+
+#include <stdint.h>
+#include <time.h>
+
+typedef enum BenchFormat_t
+{
+	BENCH_TEXT,
+	BENCH_CSV,
+	BENCH_JSON,
+
+} BenchFormat_t;
+
+typedef struct BenchData_t
+{
+	const char *name;
+	void (*row)(CSVBuffer_t *out, uint64_t *state, size_t index);
+
+} BenchData_t;
+
+typedef struct BenchResult_t
+{
+	double seconds;
+	size_t bytes;
+	size_t rows;
+	size_t fields;
+
+} BenchResult_t;
+
+//-----------------------------------------------------------------------------
+// [SECTION] Generators
+//-----------------------------------------------------------------------------
+
+/* xorshift64*, deterministic across platforms */
+static uint64_t bench_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static const char *bench_words[] = {
+	"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+	"india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa"};
+
+static const char *bench_utf8[] = {
+	"日本語", "ñandú", "Ελληνικά", "русский", "한국어", "🙂🚀", "straße", "العربية"};
+
+static void bench_put(CSVBuffer_t *out, const char *s)
+{
+	csvee_buffer_append(out, s, strlen(s));
+}
+
+static void bench_printf(CSVBuffer_t *out, const char *format, ...)
+{
+	char tmp[128];
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(tmp, sizeof(tmp), format, args);
+	va_end(args);
+	csvee_buffer_append(out, tmp, (size_t)n);
+}
+
+static void gen_narrow_long(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	bench_printf(out, "%zu,%s,%u,%s\n", index, bench_words[bench_rand(state) % 16],
+				 (unsigned)(bench_rand(state) % 100000), bench_words[bench_rand(state) % 16]);
+}
+
+static void gen_wide_short(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	(void)index;
+	for (int c = 0; c < 200; ++c)
+	{
+		bench_put(out, bench_words[bench_rand(state) % 16]);
+		bench_put(out, c + 1 < 200 ? "," : "\n");
+	}
+}
+
+static void gen_quote_heavy(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	for (int c = 0; c < 6; ++c)
+	{
+		bench_printf(out, "\"%s, \"\"%s\"\" %zu\"", bench_words[bench_rand(state) % 16],
+					 bench_words[bench_rand(state) % 16], index);
+		bench_put(out, c + 1 < 6 ? "," : "\n");
+	}
+}
+
+static void gen_embedded_newlines(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	bench_printf(out, "%zu,\"%s\n%s\n%s\",%s,\"%s\r\n%s\"\r\n", index,
+				 bench_words[bench_rand(state) % 16], bench_words[bench_rand(state) % 16],
+				 bench_words[bench_rand(state) % 16], bench_words[bench_rand(state) % 16],
+				 bench_words[bench_rand(state) % 16], bench_words[bench_rand(state) % 16]);
+}
+
+static void gen_numeric_heavy(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	bench_printf(out, "%zu", index);
+	for (int c = 0; c < 11; ++c)
+	{
+		uint64_t r = bench_rand(state);
+		if (c % 2)
+			bench_printf(out, ",%.6f", (double)(r % 10000000) / 1000.0 - 5000.0);
+		else
+			bench_printf(out, ",%lld", (long long)(r % 2000000) - 1000000);
+	}
+	bench_put(out, "\n");
+}
+
+static void gen_utf8_heavy(CSVBuffer_t *out, uint64_t *state, size_t index)
+{
+	bench_printf(out, "%zu", index);
+	for (int c = 0; c < 5; ++c)
+	{
+		bench_put(out, ",");
+		bench_put(out, bench_utf8[bench_rand(state) % 8]);
+		bench_put(out, bench_utf8[bench_rand(state) % 8]);
+	}
+	bench_put(out, "\n");
+}
+
+static const BenchData_t bench_datasets[] = {
+	{"narrow_long", gen_narrow_long},
+	{"wide_short", gen_wide_short},
+	{"quote_heavy", gen_quote_heavy},
+	{"embedded_newlines", gen_embedded_newlines},
+	{"numeric_heavy", gen_numeric_heavy},
+	{"utf8_heavy", gen_utf8_heavy},
+};
+
+static bool bench_generate(const BenchData_t *data, size_t size, CSVBuffer_t *out)
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	out->size = 0;
+	for (size_t i = 0; out->size < size; ++i)
+		data->row(out, &state, i);
+	return csvee_buffer_append(out, "", 1);
+}
+
+//-----------------------------------------------------------------------------
+// [SECTION] Timing
+//-----------------------------------------------------------------------------
+
+static double bench_now(void)
+{
+	struct timespec ts;
+#if defined(CLOCK_MONOTONIC)
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+	timespec_get(&ts, TIME_UTC);
+#endif
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static size_t bench_fields(const Csvee_t *csvee)
+{
+	size_t fields = 0;
+	for (size_t r = 0; r < csvee->count; ++r)
+		fields += csvee->rows[r].count;
+	return fields;
+}
+
+static void bench_report(BenchFormat_t format, const char *dataset, const char *op, const BenchResult_t *res)
+{
+	double mbs = (double)res->bytes / (1024.0 * 1024.0) / res->seconds;
+	double rows = (double)res->rows / res->seconds;
+	double nsf = res->fields ? res->seconds * 1e9 / (double)res->fields : 0.0;
+
+	switch (format)
+	{
+	case BENCH_CSV:
+		printf("%s,%s,%zu,%zu,%zu,%.6f,%.2f,%.0f,%.2f\n", dataset, op, res->bytes, res->rows,
+			   res->fields, res->seconds, mbs, rows, nsf);
+		break;
+	case BENCH_JSON:
+		printf("{\"dataset\":\"%s\",\"op\":\"%s\",\"bytes\":%zu,\"rows\":%zu,\"fields\":%zu,"
+			   "\"seconds\":%.6f,\"mb_per_s\":%.2f,\"rows_per_s\":%.0f,\"ns_per_field\":%.2f}\n",
+			   dataset, op, res->bytes, res->rows, res->fields, res->seconds, mbs, rows, nsf);
+		break;
+	default:
+		printf("%-18s %-14s %10.2f MB/s %14.0f rows/s %10.2f ns/field\n", dataset, op, mbs, rows, nsf);
+		break;
+	}
+	fflush(stdout);
+}
+
+//-----------------------------------------------------------------------------
+// [SECTION] Benchmarks
+//-----------------------------------------------------------------------------
+
+static int bench_run(const BenchData_t *data, size_t size, int repeat, BenchFormat_t format)
+{
+	CSVBuffer_t text = {NULL, 0, 0};
+	if (!bench_generate(data, size, &text))
+		return 1;
+	size_t bytes = text.size - 1;
+
+	char in_path[256], out_path[256];
+	const char *tmp = getenv("TMPDIR");
+	snprintf(in_path, sizeof(in_path), "%s/csvee_bench_%s.csv", tmp ? tmp : "/tmp", data->name);
+	snprintf(out_path, sizeof(out_path), "%s/csvee_bench_%s.out.csv", tmp ? tmp : "/tmp", data->name);
+
+	FILE *file = fopen(in_path, "wb");
+	if (!file || fwrite(text.data, 1, bytes, file) != bytes)
+	{
+		fprintf(stderr, "cannot write %s\n", in_path);
+		if (file)
+			fclose(file);
+		csvee_buffer_free(&text);
+		return 1;
+	}
+	fclose(file);
+
+	BenchResult_t best[9];
+	const char *ops[9] = {"read_file", "read_string", "info", "iterate", "write_file", "write_string", "sort_file", "group_file", "join"};
+	for (int op = 0; op < 9; ++op)
+		best[op].seconds = 1e30;
+
+	for (int i = 0; i < repeat; ++i)
+	{
+		double t0 = bench_now();
+		Csvee_t *csvee = csvee_read_from_file(in_path);
+		double t1 = bench_now();
+		if (!csvee)
+		{
+			fprintf(stderr, "failed to read %s\n", in_path);
+			csvee_buffer_free(&text);
+			return 1;
+		}
+		size_t rows = csvee->count, fields = bench_fields(csvee);
+		BenchResult_t res = {t1 - t0, bytes, rows, fields};
+		if (res.seconds < best[0].seconds)
+			best[0] = res;
+
+		t0 = bench_now();
+		Csvee_t *parsed = csvee_read_from_string(text.data);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (res.seconds < best[1].seconds)
+			best[1] = res;
+		csvee_free(parsed);
+
+		CSVInfo_t info;
+		t0 = bench_now();
+		bool scanned = csvee_info(in_path, &info);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (scanned && info.rows == rows && res.seconds < best[2].seconds)
+			best[2] = res;
+		if (scanned)
+			csvee_info_free(&info);
+
+		/* touch every byte of every field */
+		size_t checksum = 0;
+		t0 = bench_now();
+		for (CSVRowSpan_t span = csvee_rows_span(csvee, 0, SIZE_MAX); span.count;
+			 span = csvee_rows_span(csvee, (size_t)(span.rows - csvee->rows) + span.count, SIZE_MAX))
+		{
+			for (size_t r = 0; r < span.count; ++r)
+			{
+				CSVFieldSpan_t row = csvee_fields_span(&span.rows[r]);
+				for (size_t c = 0; c < row.count; ++c)
+					checksum += strlen(row.fields[c].value._string);
+			}
+		}
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (res.seconds < best[3].seconds)
+			best[3] = res;
+		if (checksum == 0)
+			fprintf(stderr, "empty data set %s\n", data->name);
+
+		t0 = bench_now();
+		bool written = csvee_write_to_file(csvee, out_path);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (written && res.seconds < best[4].seconds)
+			best[4] = res;
+
+		char *out = NULL;
+		size_t count = 0;
+		t0 = bench_now();
+		csvee_write_to_string(csvee, &out, &count);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (out && res.seconds < best[5].seconds)
+			best[5] = res;
+		free(out);
+
+		/* external sort on the first column, small enough a limit to need runs */
+		CSVSortKey_t key = {0, CSVEE_SORT_TEXT, CSVEE_SORT_ASC};
+		t0 = bench_now();
+		bool sorted = csvee_sort_file(in_path, out_path, &key, 1, false, bytes / 4 + 1, 4);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (sorted && res.seconds < best[6].seconds)
+			best[6] = res;
+
+		/* group on the first column, counting records and distinct values of the second */
+		size_t by = 0;
+		CSVAggregate_t aggs[2] = {{0, CSVEE_AGG_COUNT}, {1, CSVEE_AGG_COUNT_DISTINCT}};
+		t0 = bench_now();
+		bool grouped = csvee_group_file(in_path, out_path, &by, 1, aggs, 2, false, 0, 4);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (grouped && res.seconds < best[7].seconds)
+			best[7] = res;
+
+		/* self join on the first column */
+		t0 = bench_now();
+		bool joined = csvee_join(in_path, in_path, 0, 0, CSVEE_JOIN_INNER, out_path, false, 0, 4);
+		t1 = bench_now();
+		res.seconds = t1 - t0;
+		if (joined && res.seconds < best[8].seconds)
+			best[8] = res;
+
+		csvee_free(csvee);
+	}
+
+	for (int op = 0; op < 9; ++op)
+		if (best[op].seconds < 1e30)
+			bench_report(format, data->name, ops[op], &best[op]);
+
+	remove(in_path);
+	remove(out_path);
+	csvee_buffer_free(&text);
+	return 0;
+}
+
+int main(int argc, char const *argv[])
+{
+	BenchFormat_t format = BENCH_TEXT;
+	size_t size = 16;
+	int repeat = 3;
+	const char *only = NULL;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			++i;
+			format = strcmp(argv[i], "csv") == 0 ? BENCH_CSV : strcmp(argv[i], "json") == 0 ? BENCH_JSON
+																							 : BENCH_TEXT;
+		}
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = (size_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--dataset") == 0 && i + 1 < argc)
+			only = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--format text|csv|json] [--size MB] [--repeat N] [--dataset NAME]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (repeat < 1)
+		repeat = 1;
+
+	if (format == BENCH_CSV)
+		printf("dataset,op,bytes,rows,fields,seconds,mb_per_s,rows_per_s,ns_per_field\n");
+
+	int rc = 0;
+	for (size_t d = 0; d < sizeof(bench_datasets) / sizeof(bench_datasets[0]); ++d)
+	{
+		if (only && strcmp(only, bench_datasets[d].name) != 0)
+			continue;
+		rc |= bench_run(&bench_datasets[d], size * 1024 * 1024, repeat, format);
+	}
+	return rc;
+}
+
+/**
+ * LICENSE: Public Domain (www.unlicense.org)
+ *
+ * Copyright (c) 2025 Sackey Ezekiel Etrue
+ *
+ * This is free and unencumbered software released into the public domain.
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+ * software, either in source code form or as a compiled binary, for any purpose,
+ * commercial or non-commercial, and by any means.
+ * In jurisdictions that recognize copyright laws, the author or authors of this
+ * software dedicate any and all copyright interest in the software to the public
+ * domain. We make this dedication for the benefit of the public at large and to
+ * the detriment of our heirs and successors. We intend this dedication to be an
+ * overt act of relinquishment in perpetuity of all present and future rights to
+ * this software under copyright law.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
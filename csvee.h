@@ -190,21 +190,37 @@
 // [SECTION] Header mess
 //-----------------------------------------------------------------------------
 
+/*
+ * clock_gettime, fseeko and friends are POSIX, which strict ISO modes
+ * (-std=c2x) hide. Define _DEFAULT_SOURCE yourself if system headers are
+ * included before the implementation.
+ */
+#if defined(CSVEE_IMPLEMENTATION) && !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #ifdef __cplusplus
 
+#include <array>
+#include <charconv>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #endif //__cplusplus
@@ -225,6 +241,134 @@
 #define MAX_LINE_LENGTH 1024
 #define MAX_FIELD_LENGTH 256
 
+/* Size of each chunk handed to the tokenizer when reading files */
+#ifndef CSVEE_READ_BUFFER_SIZE
+#define CSVEE_READ_BUFFER_SIZE (64 * 1024)
+#endif
+
+/* Number of buffers in flight between (de)compression and the calling thread */
+#ifndef CSVEE_RING_SIZE
+#define CSVEE_RING_SIZE 4
+#endif
+
+/* Bytes of formatted output collected before a block is compressed/written */
+#ifndef CSVEE_WRITE_BLOCK_SIZE
+#define CSVEE_WRITE_BLOCK_SIZE (128 * 1024)
+#endif
+
+/* Every N-th row is timed to estimate CSVStat_t::materialize_ns */
+#ifndef CSVEE_STAT_SAMPLE
+#define CSVEE_STAT_SAMPLE 64
+#endif
+
+/* Rows per block evicted to disk when a table exceeds its memory budget */
+#ifndef CSVEE_SPILL_BLOCK_ROWS
+#define CSVEE_SPILL_BLOCK_ROWS 4096
+#endif
+
+/* Memory used by csvee_sort_file() when no limit is given */
+#ifndef CSVEE_SORT_MEMORY
+#define CSVEE_SORT_MEMORY (64 * 1024 * 1024)
+#endif
+
+/* Most runs merged at once by csvee_sort_file(), more take several passes */
+#ifndef CSVEE_SORT_FANOUT
+#define CSVEE_SORT_FANOUT 128
+#endif
+
+/* Fewest rows per thread in csvee_sort(), smaller tables sort on the calling thread */
+#ifndef CSVEE_SORT_GRAIN
+#define CSVEE_SORT_GRAIN 32768
+#endif
+
+/* Hash table memory of csvee_group_file() before groups are partitioned to disk */
+#ifndef CSVEE_GROUP_MEMORY
+#define CSVEE_GROUP_MEMORY (64 * 1024 * 1024)
+#endif
+
+/* Partition files used once csvee_group_file() runs out of memory */
+#ifndef CSVEE_GROUP_PARTITIONS
+#define CSVEE_GROUP_PARTITIONS 32
+#endif
+
+/* Build side held in memory by csvee_join() before both inputs are partitioned */
+#ifndef CSVEE_JOIN_MEMORY
+#define CSVEE_JOIN_MEMORY (64 * 1024 * 1024)
+#endif
+
+/* Partition files per input once csvee_join() runs out of memory */
+#ifndef CSVEE_JOIN_PARTITIONS
+#define CSVEE_JOIN_PARTITIONS 32
+#endif
+
+/* Keys held in memory by csvee_dedup_file() before the input is partitioned */
+#ifndef CSVEE_DEDUP_MEMORY
+#define CSVEE_DEDUP_MEMORY (64 * 1024 * 1024)
+#endif
+
+/* Partition files used once csvee_dedup_file() runs out of memory */
+#ifndef CSVEE_DEDUP_PARTITIONS
+#define CSVEE_DEDUP_PARTITIONS 32
+#endif
+
+/* Frequent values csvee_profile() reports per column */
+#ifndef CSVEE_PROFILE_TOP_K
+#define CSVEE_PROFILE_TOP_K 10
+#endif
+
+/* t-digest compression of csvee_profile(): more centroids, better quantiles */
+#ifndef CSVEE_PROFILE_COMPRESSION
+#define CSVEE_PROFILE_COMPRESSION 100
+#endif
+
+/* HyperLogLog registers of csvee_profile() are 1 << CSVEE_PROFILE_HLL_BITS, about 1.6% error at 12 */
+#ifndef CSVEE_PROFILE_HLL_BITS
+#define CSVEE_PROFILE_HLL_BITS 12
+#endif
+
+/* Count-min sketch of csvee_profile(): counters per row (a power of two) and rows */
+#ifndef CSVEE_PROFILE_CMS_WIDTH
+#define CSVEE_PROFILE_CMS_WIDTH 1024
+#endif
+#ifndef CSVEE_PROFILE_CMS_DEPTH
+#define CSVEE_PROFILE_CMS_DEPTH 4
+#endif
+
+/* Records per row group of csvee_columnar_from_csv() */
+#ifndef CSVEE_COLUMNAR_GROUP_ROWS
+#define CSVEE_COLUMNAR_GROUP_ROWS 65536
+#endif
+
+/* Largest row group csvee_columnar_from_csv() writes and csvee_columnar_read() accepts */
+#ifndef CSVEE_COLUMNAR_MAX_GROUP_ROWS
+#define CSVEE_COLUMNAR_MAX_GROUP_ROWS (1 << 20)
+#endif
+
+/* Rows per block shared between versions of a table, see csvee_versions_edit() */
+#ifndef CSVEE_SHARE_BLOCK_ROWS
+#define CSVEE_SHARE_BLOCK_ROWS 4096
+#endif
+
+/* Snapshots that can be held at once across all readers, see csvee_versions_acquire() */
+#ifndef CSVEE_VERSION_READERS
+#define CSVEE_VERSION_READERS 64
+#endif
+
+/* Longest wait between checks of a followed file, see csvee_follow_run() */
+#ifndef CSVEE_FOLLOW_POLL_MS
+#define CSVEE_FOLLOW_POLL_MS 250
+#endif
+
+/**
+ * Optional features, define before including this file:
+ *
+ *   CSVEE_WITH_ZLIB   read/write gzip compressed files (link with -lz)
+ *   CSVEE_WITH_ZSTD   read/write zstd compressed files (link with -lzstd)
+ *   CSVEE_NO_THREADS  never spawn threads, (de)compress on the calling thread
+ *   CSVEE_NO_SIMD     use the portable scanner in csvee_info() even where
+ *                     SSE2/NEON is available
+ */
+
 /**
  * @brief Macro to convert an error value to its string representation.
  *
@@ -556,14 +700,38 @@ typedef enum CSVData_t
 
 } CSVData_t;
 
+/**
+ * @brief Parse, write and memory counters.
+ * @details Filled in by every read of a table, see csvee_get_stats().
+ * The same counters summed over all tables, writes included, are kept
+ * process wide, see csvee_get_global_stats(). Writes only count there:
+ * they leave the table untouched, so threads may write one out at once.
+ * Times are wall clock nanoseconds; materialize_ns is estimated from
+ * every CSVEE_STAT_SAMPLE-th row and subtracted from tokenize_ns.
+ */
 typedef struct CSVStat_t
 {
-} CSVStat_t;
-
-typedef struct CSVInfo_t
-{
+	uint64_t bytes_scanned;	 /**< Input bytes fed to the tokenizer */
+	uint64_t bytes_written;	 /**< Output bytes formatted */
+	uint64_t rows;			 /**< Rows parsed or written */
+	uint64_t fields;		 /**< Fields parsed or written */
+	uint64_t quoted_fields;	 /**< Fields that were (or had to be) quoted */
+	uint64_t escaped_quotes; /**< Doubled or backslash escaped quotes */
+	uint64_t allocations;	 /**< Heap allocations made for table storage */
+	uint64_t bytes_allocated;
+	uint64_t footprint;		 /**< Bytes currently owned by the table */
+	uint64_t peak_footprint; /**< Largest footprint seen */
+
+	uint64_t io_ns;			 /**< Reading, writing and (de)compression */
+	uint64_t tokenize_ns;	 /**< Splitting bytes into fields */
+	uint64_t materialize_ns; /**< Building rows and fields */
+	uint64_t convert_ns;	 /**< Turning values into text */
+
+	uint64_t spill_evictions; /**< Row blocks dropped from memory */
+	uint64_t spill_bytes;	  /**< Bytes written to the spill file */
+	uint64_t spill_loads;	  /**< Row blocks paged back in */
 
-} CSVInfo_t;
+} CSVStat_t;
 
 typedef struct CSVDialect_t
 {
@@ -604,6 +772,21 @@ typedef struct CSVRow_t
 
 } CSVRow_t;
 
+/** Row blocks of a table that went over its memory budget, see csvee_set_memory_budget(). */
+typedef struct CSVSpill_t CSVSpill_t;
+
+/** Input of a table read with CSVReadOptions_t.lazy, rows are built from it on first access. */
+typedef struct CSVLazy_t CSVLazy_t;
+
+/** Field and text blocks shared by the rows of a table read with CSVReadOptions_t.compact. */
+typedef struct CSVCompact_t CSVCompact_t;
+
+/** Row blocks a table shares with other versions of it, see csvee_versions_edit(). */
+typedef struct CSVShare_t CSVShare_t;
+
+/** The published version of a table and the snapshots readers hold, see csvee_versions_new(). */
+typedef struct CSVVersions_t CSVVersions_t;
+
 typedef struct Csvee_t
 {
 	CSVDialect_t *dialect;
@@ -611,18 +794,483 @@ typedef struct Csvee_t
 	size_t capacity;
 	size_t count;
 
+	CSVStat_t stats;
+
+	size_t memory_budget; /**< Bytes of rows kept in memory, 0 for no limit */
+	CSVSpill_t *spill;
+	CSVLazy_t *lazy; /**< Rows not built yet, NULL once every row has been accessed */
+	CSVCompact_t *compact; /**< Blocks the rows of a compact read point into */
+	CSVShare_t *share;	   /**< Row blocks held together with other versions */
+
+	uint64_t *tombstones;  /**< Bit per deleted row until the next csvee_purge(), NULL if none */
+	size_t tombstones_len; /**< Words in tombstones */
+	size_t deleted;		   /**< Rows deleted since the last csvee_purge() */
+
 } Csvee_t;
 
+typedef enum CSVCodec_t
+{
+	CSVEE_CODEC_NONE, /**< Plain text */
+	CSVEE_CODEC_GZIP, /**< gzip (RFC 1952) stream */
+	CSVEE_CODEC_ZSTD, /**< Zstandard stream */
+
+} CSVCodec_t;
+
+typedef struct CSVWriteOptions_t
+{
+	CSVCodec_t codec;  /**< Output compression */
+	int level;		   /**< Compression level, 0 selects the codec default */
+	size_t block_size; /**< Bytes per compressed block, 0 selects CSVEE_WRITE_BLOCK_SIZE */
+
+} CSVWriteOptions_t;
+
+typedef struct CSVReadOptions_t
+{
+	size_t memory_budget;  /**< Bytes of rows kept in memory, 0 for no limit */
+	const char *spill_dir; /**< Where evicted rows go, NULL for the system temp dir */
+	bool lazy;			   /**< Only find row boundaries; fields are built on first access, memory_budget is ignored */
+	bool compact;		   /**< All fields in one array and all text in one block, rows are views into them; not with lazy or memory_budget */
+
+} CSVReadOptions_t;
+
+typedef enum CSVSortType_t
+{
+	CSVEE_SORT_TEXT,	/**< Byte order */
+	CSVEE_SORT_INTEGER, /**< Whole numbers; empty fields first, other text last */
+	CSVEE_SORT_DOUBLE,	/**< Real numbers; empty fields first, other text last */
+
+} CSVSortType_t;
+
+typedef enum CSVSortOrder_t
+{
+	CSVEE_SORT_ASC,
+	CSVEE_SORT_DESC,
+
+} CSVSortOrder_t;
+
+typedef struct CSVSortKey_t
+{
+	size_t column; /**< 0-based field index, missing fields count as empty */
+	CSVSortType_t type;
+	CSVSortOrder_t order;
+
+} CSVSortKey_t;
+
+typedef enum CSVAggOp_t
+{
+	CSVEE_AGG_COUNT,		  /**< Records in the group, the column is not read */
+	CSVEE_AGG_SUM,			  /**< Sum of the fields that are numbers */
+	CSVEE_AGG_MIN,			  /**< Smallest number */
+	CSVEE_AGG_MAX,			  /**< Largest number */
+	CSVEE_AGG_MEAN,			  /**< Average of the numbers */
+	CSVEE_AGG_COUNT_DISTINCT, /**< Distinct non-empty values, compared as text */
+
+} CSVAggOp_t;
+
+typedef struct CSVAggregate_t
+{
+	size_t column; /**< 0-based field index */
+	CSVAggOp_t op;
+
+} CSVAggregate_t;
+
+typedef enum CSVJoinType_t
+{
+	CSVEE_JOIN_INNER, /**< Every pair of matching records */
+	CSVEE_JOIN_LEFT,  /**< Pairs, plus left records without a match, right fields left empty */
+	CSVEE_JOIN_SEMI,  /**< Left records that have a match, once each */
+	CSVEE_JOIN_ANTI,  /**< Left records without a match */
+
+} CSVJoinType_t;
+
+typedef enum CSVDedupKeep_t
+{
+	CSVEE_KEEP_FIRST, /**< The first record of each key, written as soon as it is read */
+	CSVEE_KEEP_LAST,  /**< The last record of each key, the input is read twice */
+
+} CSVDedupKeep_t;
+
+typedef enum CSVCompare_t
+{
+	CSVEE_CMP_EQ,
+	CSVEE_CMP_NE,
+	CSVEE_CMP_LT,
+	CSVEE_CMP_LE,
+	CSVEE_CMP_GT,
+	CSVEE_CMP_GE,
+
+} CSVCompare_t;
+
+/**
+ * @brief A condition on one column of a columnar file.
+ * @details Number columns compare as numbers (@p value must be one),
+ * text columns byte by byte. Empty fields never match.
+ */
+typedef struct CSVPredicate_t
+{
+	size_t column;
+	CSVCompare_t op;
+	const char *value;
+
+} CSVPredicate_t;
+
+/** @brief What csvee_columnar_read() returns, all zero for the whole file. */
+typedef struct CSVColumnarQuery_t
+{
+	const size_t *columns; /**< Columns to return, in this order; NULL for all */
+	size_t ncolumns;
+	const CSVPredicate_t *predicates; /**< Conditions a record has to meet, every one of them */
+	size_t npredicates;
+
+} CSVColumnarQuery_t;
+
+typedef enum CSVColumnType_t
+{
+	CSVEE_TYPE_INT64,
+	CSVEE_TYPE_DOUBLE, /**< Decimal notation; no inf, nan or hex */
+	CSVEE_TYPE_BOOL,   /**< true/false in any case, 1/0 */
+	CSVEE_TYPE_STRING,
+	CSVEE_TYPE_DATE,   /**< YYYY-MM-DD, stored as days since 1970-01-01 */
+	CSVEE_TYPE_SKIP,   /**< Declared but not loaded */
+
+} CSVColumnType_t;
+
+/** @brief One column of a CSVSchema_t, found by header @p name or, without one, by @p index. */
+typedef struct CSVSchemaColumn_t
+{
+	const char *name;
+	size_t index;
+	CSVColumnType_t type;
+
+} CSVSchemaColumn_t;
+
+/** @brief The columns csvee_read_typed() loads and the types they are converted to. */
+typedef struct CSVSchema_t
+{
+	const CSVSchemaColumn_t *columns;
+	size_t count;
+	const char *const *null_tokens; /**< Fields equal to one of these are null; NULL for just "" */
+	size_t null_count;
+	bool header;			   /**< The first record names the columns */
+	size_t rows_hint;		   /**< Rows to allocate up front, 0 for a guess from the file size */
+
+} CSVSchema_t;
+
+/** @brief A loaded column, laid out like an Arrow array. */
+typedef struct CSVTypedColumn_t
+{
+	char *name;
+	CSVColumnType_t type;
+	void *values;	  /**< int64_t, double, bool or int32_t (dates) per row; NULL for strings and skipped columns */
+	char *text;		  /**< Strings: row r is text[offsets[r] .. offsets[r + 1]) */
+	size_t *offsets;
+	uint8_t *valid; /**< Bit per row, least significant first, set unless null */
+	size_t nulls;
+
+} CSVTypedColumn_t;
+
+/** @brief Result of csvee_read_typed(), one column per column of the schema. */
+typedef struct CSVTypedTable_t
+{
+	CSVTypedColumn_t *columns;
+	size_t count;
+	size_t rows;
+	size_t capacity;
+
+	size_t error_row; /**< Record (from 1, the header included) and schema column of the first bad field */
+	size_t error_column;
+
+} CSVTypedTable_t;
+
+/** Reader that hands a file out a batch of rows at a time, see csvee_next_batch(). */
+typedef struct CSVStream_t CSVStream_t;
+
+/** @brief A column of a CSVBatch_t; every array has one entry per row of the batch. */
+typedef struct CSVBatchColumn_t
+{
+	const char *name;	  /**< From the schema or the header, owned by the stream */
+	CSVColumnType_t type;
+	void *values;		  /**< int64_t, double, bool or int32_t (dates) per row; NULL for strings and skipped columns */
+	const char **strings; /**< Strings: row r is lengths[r] bytes at strings[r], not NUL terminated */
+	size_t *lengths;
+	uint8_t *valid; /**< Bit per row, least significant first, set unless null */
+	size_t nulls;
+
+	char *text; /**< Bytes the strings point into */
+	size_t text_size;
+	size_t text_capacity;
+
+} CSVBatchColumn_t;
+
+/** @brief Up to max_rows records of a CSVStream_t laid out by column, reused from one csvee_next_batch() to the next. */
+typedef struct CSVBatch_t
+{
+	CSVBatchColumn_t *columns;
+	size_t count;
+	size_t rows;
+	size_t capacity;
+
+	size_t first_record; /**< Record (from 1, the header included) of row 0 */
+	size_t error_row;	 /**< Record and schema column of the first bad field */
+	size_t error_column;
+
+} CSVBatch_t;
+
+typedef enum CSVLineEnding_t
+{
+	CSVEE_EOL_NONE,	 /**< No line terminator seen */
+	CSVEE_EOL_LF,	 /**< "\n" */
+	CSVEE_EOL_CRLF,	 /**< "\r\n" */
+	CSVEE_EOL_CR,	 /**< "\r" */
+	CSVEE_EOL_MIXED, /**< More than one of the above */
+
+} CSVLineEnding_t;
+
+/**
+ * @brief Shape of a file, see csvee_info().
+ * @details Counts follow the same rules as csvee_read_from_file(): blank
+ * lines are not rows and the header is counted as a row. Release with
+ * csvee_info_free().
+ */
+typedef struct CSVInfo_t
+{
+	size_t rows;		/**< Records, header included */
+	size_t min_columns; /**< Fewest fields in a record */
+	size_t max_columns; /**< Most fields in a record */
+
+	char **header;		 /**< Fields of the first record */
+	size_t header_count; /**< Entries in header */
+
+	uint64_t bytes;		 /**< Size of the (decompressed) text */
+	uint64_t file_bytes; /**< Size on disk */
+	CSVCodec_t codec;
+	char delimiter;
+
+	CSVLineEnding_t line_ending;
+	bool quoted_newlines;	 /**< A quoted field spans lines */
+	bool unterminated_quote; /**< The file ends inside a quoted field */
+
+} CSVInfo_t;
+
+/** @brief Settings of csvee_profile(), all zero for the defaults. */
+typedef struct CSVProfileOptions_t
+{
+	bool header;		/**< The first record names the columns */
+	size_t nthreads;	/**< Threads folding records in, 0 for one */
+	size_t top_k;		/**< Frequent values kept per column, 0 for CSVEE_PROFILE_TOP_K */
+	double compression; /**< t-digest centroid budget, 0 for CSVEE_PROFILE_COMPRESSION */
+
+} CSVProfileOptions_t;
+
+typedef struct CSVTopValue_t
+{
+	char *value;
+	uint64_t count; /**< Count-min estimate, never below the true count */
+
+} CSVTopValue_t;
+
+/**
+ * @brief One column as seen by csvee_profile().
+ * @details Numbers are the fields that read as integers or doubles; min,
+ * max, mean, m2 and the quantiles are over them. Distinct and frequent
+ * values are over every non-empty field. Records too short to have the
+ * column count as nulls.
+ */
+typedef struct CSVColumnProfile_t
+{
+	char *name;		/**< Header field, NULL without a header */
+	CSVData_t type; /**< Narrowest type that holds every non-empty field, CSVEE_NULL if there is none */
+
+	uint64_t count; /**< Records */
+	uint64_t nulls; /**< Empty or missing fields */
+	uint64_t integers;
+	uint64_t doubles;
+	uint64_t bools; /**< "true" or "false", any case */
+	uint64_t strings;
+
+	double min;
+	double max;
+	double mean;
+	double m2; /**< Sum of squared differences from the mean, see csvee_profile_variance() */
+
+	CSVTopValue_t *top; /**< Most frequent values, most frequent first */
+	size_t top_count;
+
+	struct CSVSketch_t *sketch; /**< HyperLogLog, t-digest and count-min state */
+
+} CSVColumnProfile_t;
+
+/**
+ * @brief Per-column statistics of a file, see csvee_profile().
+ * @details Profiles of different chunks or files can be combined with
+ * csvee_profile_merge(). Release with csvee_profile_free().
+ */
+typedef struct CSVProfile_t
+{
+	CSVColumnProfile_t *columns;
+	size_t count;
+	uint64_t rows; /**< Records, the header excluded */
+
+	size_t top_k; /**< Settings the sketches were built with */
+	double compression;
+
+} CSVProfile_t;
+
+/*
+ * Arrow C data interface, as specified by Apache Arrow; the guard lets it
+ * coexist with arrow/c/abi.h and nanoarrow. See csvee_export_arrow().
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+	const char *format;
+	const char *name;
+	const char *metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema **children;
+	struct ArrowSchema *dictionary;
+
+	void (*release)(struct ArrowSchema *);
+	void *private_data;
+};
+
+struct ArrowArray
+{
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void **buffers;
+	struct ArrowArray **children;
+	struct ArrowArray *dictionary;
+
+	void (*release)(struct ArrowArray *);
+	void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+/**
+ * @brief Called by the tokenizer for every completed row.
+ * @details The callee takes ownership of @p row->fields. Returning false
+ * stops the parse.
+ */
+typedef bool (*CSVRowCallback_t)(void *user, CSVRow_t *row);
+
+/**
+ * @brief Called instead of CSVRowCallback_t when set, before the row is materialized.
+ * @details Field i is @p text[ends[i - 1] .. ends[i]) (from 0 for the
+ * first), unescaped but not NUL terminated, and only valid during the
+ * call. Returning false stops the parse.
+ */
+typedef bool (*CSVRecordCallback_t)(void *user, const char *text, const size_t *ends, size_t count);
+
+/**
+ * @brief Called by csvee_parse_cb() with the content of a field, unescaped.
+ * @details @p data points into the caller's buffer and is not NUL
+ * terminated. A field with escaped quotes comes in more than one call, all
+ * but the last with @p more set. Returning false stops the parse.
+ */
+typedef bool (*CSVFieldCallback_t)(void *user, const char *data, size_t size, bool more);
+
+/** @brief Called by csvee_parse_cb() after the last field of a row. Returning false stops the parse. */
+typedef bool (*CSVRowEndCallback_t)(void *user);
+
+/**
+ * @brief Incremental tokenizer state.
+ * @details Bytes may be fed in chunks of any size, rows and quoted fields
+ * are allowed to straddle chunk boundaries.
+ */
+typedef struct CSVParser_t
+{
+	const CSVDialect_t *dialect;
+	CSVRowCallback_t on_row;
+	CSVRecordCallback_t on_record; /**< Takes the place of on_row when set */
+	void *user;
+
+	char *text; /**< Unescaped bytes of the row being built */
+	size_t text_len;
+	size_t text_cap;
+
+	size_t *ends; /**< Offset in text where each completed field ends */
+	size_t ends_len;
+	size_t ends_cap;
+
+	int state;
+	bool quoted;	  /**< Current field started with a quote */
+	bool skip_lf;	  /**< Last byte was '\r', swallow a following '\n' */
+	uint64_t row_end; /**< Bytes fed up to the end of the last completed row */
+
+	CSVStat_t stats; /**< Counters for everything fed so far */
+	uint64_t sampled_ns;
+	uint64_t sampled_rows;
+
+} CSVParser_t;
+
+/**
+ * @brief Reader for a file that other processes keep appending to.
+ * @details Only bytes appended since the last csvee_follow_poll() are
+ * parsed; a partial last line or an open quote carries over to the next
+ * poll. Truncation and (on POSIX) replacement of the file restart from
+ * its beginning. The struct must not be moved while open.
+ */
+typedef struct CSVFollow_t
+{
+	char *filename;
+	FILE *file;
+	char *buffer;
+
+	CSVDialect_t dialect;
+	CSVParser_t parser;
+	CSVRowCallback_t on_row;
+	void *user;
+
+	uint64_t origin; /**< File offset the parser started at */
+	uint64_t offset; /**< Next byte to read */
+	unsigned poll_ms; /**< Longest wait in csvee_follow_run() */
+
+	int watch;	  /**< inotify descriptor, -1 when polling */
+	int watch_id; /**< inotify watch on the file */
+
+	bool stopped;			 /**< The callback returned false */
+	uint64_t stop_requested; /**< Set by csvee_follow_stop() */
+
+} CSVFollow_t;
+
 typedef struct CsvIterator_t
 {
 	const CSVRow_t *ptr;
+	Csvee_t *csvee; /**< Owner, pages spilled rows back in on peek */
 } CsvIterator_t;
 
 typedef struct RowIterator_t
 {
 	const CSVField_t *ptr;
+	const CSVField_t *end; /**< One past the last field */
 } RowIterator_t;
 
+/* A run of adjacent rows, see csvee_rows_span(). */
+typedef struct CSVRowSpan_t
+{
+	const CSVRow_t *rows;
+	size_t count;
+} CSVRowSpan_t;
+
+/* The fields of one row, see csvee_fields_span(). */
+typedef struct CSVFieldSpan_t
+{
+	const CSVField_t *fields;
+	size_t count;
+} CSVFieldSpan_t;
+
 /** @} */
 
 //-----------------------------------------------------------------------------
@@ -640,29 +1288,123 @@ extern "C"
 
 	// Csvee Methods
 	void csvee_init(Csvee_t *csvee, CSVDialect_t *dialect);
+	Csvee_t *csvee_new(char delimiter);
 	void csvee_free(Csvee_t *csvee);
 
 	// Reading Methods
 	Csvee_t *csvee_read_from_file(const char *filename);
+	Csvee_t *csvee_read_from_file_opts(const char *filename, const CSVReadOptions_t *options);
 	Csvee_t *csvee_read_from_string(const char *data);
 
+	// Sorting Methods
+	bool csvee_sort_file(const char *in, const char *out, const CSVSortKey_t *keys, size_t nkeys, bool header, size_t mem_limit, size_t nthreads);
+	bool csvee_sort(Csvee_t *csvee, const CSVSortKey_t *keys, size_t nkeys);
+
+	// Aggregation Methods
+	bool csvee_group_file(const char *in, const char *out, const size_t *columns, size_t ncolumns, const CSVAggregate_t *aggregates, size_t naggregates, bool header, size_t mem_limit, size_t nthreads);
+	bool csvee_join(const char *left, const char *right, size_t left_key, size_t right_key, CSVJoinType_t type, const char *out, bool header, size_t mem_limit, size_t nthreads);
+	bool csvee_dedup_file(const char *in, const char *out, const size_t *columns, size_t ncolumns, CSVDedupKeep_t keep, bool header, size_t mem_limit);
+
+	// Columnar Methods
+	bool csvee_columnar_from_csv(const char *in, const char *out, bool header, size_t group_rows);
+	Csvee_t *csvee_columnar_read(const char *path, const CSVColumnarQuery_t *query);
+
+	// Typed Methods
+	bool csvee_read_typed(const char *filename, const CSVSchema_t *schema, CSVTypedTable_t *table);
+	void csvee_typed_free(CSVTypedTable_t *table);
+
+	// Batch Methods
+	CSVStream_t *csvee_stream_open(const char *filename, const CSVSchema_t *schema);
+	bool csvee_next_batch(CSVStream_t *stream, CSVBatch_t *batch, size_t max_rows);
+	void csvee_stream_close(CSVStream_t *stream);
+	void csvee_batch_free(CSVBatch_t *batch);
+
+	// Memory Methods
+	bool csvee_set_memory_budget(Csvee_t *csvee, size_t bytes, const char *spill_dir);
+
+	// Mutation Methods
+	bool csvee_add_row(Csvee_t *csvee, size_t count, ...);
+	bool csvee_add_rows(Csvee_t *csvee, CSVRow_t *rows, size_t count);
+	bool csvee_update_row(Csvee_t *csvee, size_t row, size_t count, ...);
+	bool csvee_update_field(Csvee_t *csvee, size_t row, size_t col, const char *value);
+	bool csvee_delete_row(Csvee_t *csvee, size_t row);
+	bool csvee_row_deleted(const Csvee_t *csvee, size_t index);
+	bool csvee_purge(Csvee_t *csvee);
+
+	// Version Methods
+	CSVVersions_t *csvee_versions_new(Csvee_t *csvee);
+	const Csvee_t *csvee_versions_acquire(CSVVersions_t *versions);
+	void csvee_versions_release(CSVVersions_t *versions, const Csvee_t *snapshot);
+	Csvee_t *csvee_versions_edit(CSVVersions_t *versions);
+	CSVRow_t *csvee_versions_row(Csvee_t *draft, size_t index);
+	const CSVRow_t *csvee_versions_read(const Csvee_t *snapshot, size_t index);
+	bool csvee_versions_publish(CSVVersions_t *versions, Csvee_t *next);
+	void csvee_versions_free(CSVVersions_t *versions);
+
+	// Inspection Methods
+	bool csvee_info(const char *filename, CSVInfo_t *info);
+	void csvee_info_free(CSVInfo_t *info);
+
+	// Profiling Methods
+	bool csvee_profile(const char *path, const CSVProfileOptions_t *options, CSVProfile_t *profile);
+	bool csvee_profile_merge(CSVProfile_t *profile, const CSVProfile_t *other);
+	double csvee_profile_variance(const CSVColumnProfile_t *column);
+	double csvee_profile_distinct(const CSVColumnProfile_t *column);
+	double csvee_profile_quantile(const CSVColumnProfile_t *column, double q);
+	void csvee_profile_free(CSVProfile_t *profile);
+
+	// Arrow Methods
+	bool csvee_export_arrow(const Csvee_t *csvee, bool header, struct ArrowSchema *schema, struct ArrowArray *array);
+	bool csvee_read_arrow(const char *filename, bool header, struct ArrowSchema *schema, struct ArrowArray *array);
+
+	// Follow Methods
+	bool csvee_follow_open(CSVFollow_t *follow, const char *filename, uint64_t offset, CSVRowCallback_t on_row, void *user);
+	bool csvee_follow_poll(CSVFollow_t *follow);
+	bool csvee_follow_wait(CSVFollow_t *follow, unsigned timeout_ms);
+	bool csvee_follow_run(CSVFollow_t *follow);
+	void csvee_follow_stop(CSVFollow_t *follow);
+	bool csvee_follow_flush(CSVFollow_t *follow);
+	uint64_t csvee_follow_offset(const CSVFollow_t *follow);
+	void csvee_follow_close(CSVFollow_t *follow);
+
+	// Parser Methods
+	void csvee_parser_init(CSVParser_t *parser, const CSVDialect_t *dialect, CSVRowCallback_t on_row, void *user);
+	bool csvee_parser_feed(CSVParser_t *parser, const char *data, size_t size);
+	bool csvee_parser_finish(CSVParser_t *parser);
+	void csvee_parser_free(CSVParser_t *parser);
+	bool csvee_parse_cb(const char *buf, size_t len, const CSVDialect_t *dialect, CSVFieldCallback_t on_field, CSVRowEndCallback_t on_row_end, void *user);
+
+	// Compression Methods
+	CSVCodec_t csvee_detect_codec(const unsigned char *magic, size_t size);
+	bool csvee_codec_supported(CSVCodec_t codec);
+
+	// Statistics Methods
+	const CSVStat_t *csvee_get_stats(const Csvee_t *csvee);
+	void csvee_get_global_stats(CSVStat_t *stats);
+	void csvee_reset_global_stats(void);
+
 	// Writing Methods
 	bool csvee_write_to_file(const Csvee_t *csvee, const char *filename);
+	bool csvee_write_to_file_opts(const Csvee_t *csvee, const char *filename, const CSVWriteOptions_t *options);
 	void csvee_write_to_string(const Csvee_t *csvee, char **buffer, size_t *count);
 
 	// Csvee Iterator Methods
-	CsvIterator_t *csvee_csvee_iter_begin(const Csvee_t *csvee);
-	CsvIterator_t *csvee_csvee_iter_end(const Csvee_t *csvee);
+	CsvIterator_t csvee_csvee_iter_begin(Csvee_t *csvee);
+	CsvIterator_t csvee_csvee_iter_end(Csvee_t *csvee);
 	void csvee_csvee_iter_next(CsvIterator_t *csvee_iter);
-	const CSVRow_t *csvee_csvee_iter_peek(CsvIterator_t *csvee_iter);
-	bool csvee_csvee_iter_equal(CsvIterator_t *begin_iter, CsvIterator_t *end_iter);
+	const CSVRow_t *csvee_csvee_iter_peek(const CsvIterator_t *csvee_iter);
+	bool csvee_csvee_iter_equal(const CsvIterator_t *begin_iter, const CsvIterator_t *end_iter);
 
 	// Row Iterator Methods
-	RowIterator_t *csvee_row_iter_begin(const CSVRow_t *row);
-	RowIterator_t *csvee_row_iter_end(const CSVRow_t *row);
+	RowIterator_t csvee_row_iter_begin(const CSVRow_t *row);
+	RowIterator_t csvee_row_iter_end(const CSVRow_t *row);
 	void csvee_row_iter_next(RowIterator_t *row_iter);
-	const CSVField_t *csvee_row_iter_peek(RowIterator_t *row_iter);
-	bool csvee_row_iter_equal(RowIterator_t *begin_iter, RowIterator_t *end_iter);
+	const CSVField_t *csvee_row_iter_peek(const RowIterator_t *row_iter);
+	bool csvee_row_iter_equal(const RowIterator_t *begin_iter, const RowIterator_t *end_iter);
+
+	// Span Methods
+	CSVRowSpan_t csvee_rows_span(Csvee_t *csvee, size_t first, size_t n);
+	CSVFieldSpan_t csvee_fields_span(const CSVRow_t *row);
 
 	// String Methods
 	char *csvee_row_to_string(CSVRow_t *row);
@@ -678,6 +1420,10 @@ extern "C"
 	void csvee_error(CsvError_t error, const char *format, ...);
 	const char *csvee_error_name(CsvError_t error);
 
+	// Internal Methods, for the C++ classes below; not part of the API
+	CSVRow_t *csvee_row_at(Csvee_t *csvee, size_t index);
+	bool csvee_lazy_attach(Csvee_t *csvee, char *text, size_t size);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -690,31 +1436,84 @@ extern "C"
 
 namespace csvee
 {
-	class CSVDialect
+	/**
+	 * @brief CsveeError class for Csvee-related errors.
+	 */
+	class CsveeError : public std::exception
 	{
 	public:
-		CSVDialect(CSVDialect *dialect);
-		CSVDialect(CSVDialect &dialect);
-		CSVDialect(CSVDialect_t dialect);
-		CSVDialect(CSVDialect_t *dialect);
-		CSVDialect(char *name, char delimiter, char quotechar, char lineterminator, bool doublequote, bool skipwhitespace, CSVQuote_t quoting);
-		CSVDialect(std::string name, char delimiter, char quotechar, char lineterminator, bool doublequote, bool skipwhitespace, CSVQuote_t quoting);
-
-	private:
-		CSVDialect_t m_Dialect;
-	};
+		/**
+		 * @brief Default constructor.
+		 */
+		CsveeError();
 
-	class Excel : public CSVDialect
-	{
-	public:
-		Excel()
-			: CSVDialect("excel", ',', '"', '\n', true, false, CSVEE_QUOTE_MINIMAL) {};
-	};
+		/**
+		 * @brief Constructs an exception with a specific error type.
+		 * @param type The type of the error.
+		 */
+		CsveeError(CsvError_t type);
 
-	class ExcelTab : public CSVDialect
-	{
-	public:
-		ExcelTab()
+		/**
+		 * @brief Constructs an exception with a specific message and error type.
+		 * @param message The error message.
+		 * @param type The type of the error.
+		 */
+		CsveeError(const std::string &message, CsvError_t type);
+
+		/**
+		 * @brief Gets the error message.
+		 * @return The error message.
+		 */
+		const char *what() const noexcept override;
+
+		/**
+		 * @brief Gets the error type.
+		 * @return The error type.
+		 */
+		CsvError_t GetErrType() const noexcept;
+
+		/**
+		 * @brief Gets the name of the error type.
+		 * @param error The error type.
+		 * @return The name of the error type.
+		 */
+		std::string GetErrName(CsvError_t error) const noexcept;
+
+	private:
+		mutable std::string m_Msg; //!< The error message.
+		CsvError_t m_ErrType;	   //!< The error type.
+	};
+
+	class CSVDialect
+	{
+	public:
+		CSVDialect(CSVDialect *dialect);
+		CSVDialect(CSVDialect &dialect);
+		CSVDialect(CSVDialect_t dialect);
+		CSVDialect(CSVDialect_t *dialect);
+		CSVDialect(char *name, char delimiter, char quotechar, char lineterminator, bool doublequote, bool skipwhitespace, CSVQuote_t quoting);
+		CSVDialect(std::string name, char delimiter, char quotechar, char lineterminator, bool doublequote, bool skipwhitespace, CSVQuote_t quoting);
+
+		const CSVDialect_t &Get() const noexcept
+		{
+			return m_Dialect;
+		};
+
+	private:
+		CSVDialect_t m_Dialect;
+	};
+
+	class Excel : public CSVDialect
+	{
+	public:
+		Excel()
+			: CSVDialect("excel", ',', '"', '\n', true, false, CSVEE_QUOTE_MINIMAL) {};
+	};
+
+	class ExcelTab : public CSVDialect
+	{
+	public:
+		ExcelTab()
 			: CSVDialect("excel-tab", '\t', '"', '\n', true, false, CSVEE_QUOTE_MINIMAL) {};
 	};
 
@@ -835,6 +1634,11 @@ namespace csvee
 		public:
 			using ValueType = CSVField;
 			using DifferenceType = size_t;
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = CSVField;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::shared_ptr<CSVField>;
+			using reference = CSVField &;
 			using PointerType = std::shared_ptr<ValueType>;
 			using ConstPointerType = const std::shared_ptr<ValueType>;
 			using ReferenceType = ValueType &;
@@ -1035,6 +1839,254 @@ namespace csvee
 		CSVRow_t m_Row;
 	};
 
+	/**
+	 * @brief How the fields of a record map onto the members of @p T.
+	 * @details Specialize with a `members` tuple of member pointers, one
+	 * per column in order, most easily through CSVEE_BIND().
+	 */
+	template <class T>
+	struct Binding;
+
+#define CSVEE_BIND(Type, ...)                                         \
+	template <>                                                       \
+	struct csvee::Binding<Type>                                       \
+	{                                                                 \
+		static constexpr auto members = std::make_tuple(__VA_ARGS__); \
+	}
+
+	/**
+	 * @brief Converts the text of one field into a @p T.
+	 * @details Picked at compile time from the member type: integers,
+	 * floating point, bool (true/false in any case, 1/0), std::string
+	 * (assigned in place, reusing its capacity), std::string_view (into
+	 * the tokenizer's buffer, valid during the callback only) and
+	 * std::optional of those, empty for an empty field. Specialize it for
+	 * other types.
+	 */
+	template <class T, class Enable = void>
+	struct FieldParser;
+
+	template <class T>
+	struct FieldParser<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+	{
+		static bool Parse(const char *text, size_t size, T &value)
+		{
+			if (size > 1 && text[0] == '+' && text[1] != '-')
+			{
+				++text;
+				--size;
+			}
+			auto result = std::from_chars(text, text + size, value);
+			return size && result.ec == std::errc() && result.ptr == text + size;
+		}
+	};
+
+	template <class T>
+	struct FieldParser<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		static bool Parse(const char *text, size_t size, T &value)
+		{
+#if defined(__cpp_lib_to_chars)
+			if (size > 1 && text[0] == '+' && text[1] != '-')
+			{
+				++text;
+				--size;
+			}
+			auto result = std::from_chars(text, text + size, value);
+			return size && result.ec == std::errc() && result.ptr == text + size;
+#else
+			char scratch[64];
+			if (!size || size >= sizeof(scratch))
+				return false;
+			memcpy(scratch, text, size);
+			scratch[size] = '\0';
+			char *end = nullptr;
+			value = (T)strtod(scratch, &end);
+			return end == scratch + size;
+#endif
+		}
+	};
+
+	template <>
+	struct FieldParser<bool>
+	{
+		static bool Parse(const char *text, size_t size, bool &value)
+		{
+			auto is = [&](const char *word, size_t length)
+			{
+				if (size != length)
+					return false;
+				for (size_t i = 0; i < size; ++i)
+					if ((text[i] | 0x20) != word[i])
+						return false;
+				return true;
+			};
+			if (is("true", 4) || (size == 1 && text[0] == '1'))
+				value = true;
+			else if (is("false", 5) || (size == 1 && text[0] == '0'))
+				value = false;
+			else
+				return false;
+			return true;
+		}
+	};
+
+	template <>
+	struct FieldParser<std::string>
+	{
+		static bool Parse(const char *text, size_t size, std::string &value)
+		{
+			value.assign(text, size);
+			return true;
+		}
+	};
+
+	template <>
+	struct FieldParser<std::string_view>
+	{
+		static bool Parse(const char *text, size_t size, std::string_view &value)
+		{
+			value = std::string_view(text, size);
+			return true;
+		}
+	};
+
+	template <class T>
+	struct FieldParser<std::optional<T>>
+	{
+		static bool Parse(const char *text, size_t size, std::optional<T> &value)
+		{
+			if (!size)
+			{
+				value.reset();
+				return true;
+			}
+			if (!value)
+				value.emplace();
+			return FieldParser<T>::Parse(text, size, *value);
+		}
+	};
+
+	/**
+	 * @brief Appends one field of type @p T to a row being written.
+	 * @details Picked at compile time like FieldParser: numbers go through
+	 * std::to_chars and are never scanned for quoting, strings are quoted
+	 * when they hold the delimiter, the quote or a line break, and an
+	 * empty std::optional writes an empty field.
+	 */
+	template <class T, class Enable = void>
+	struct FieldWriter;
+
+	namespace detail
+	{
+		inline void AppendText(std::string &out, std::string_view text, const CSVDialect_t &dialect)
+		{
+			const char special[] = {dialect.delimiter, dialect.quotechar, '\n', '\r'};
+			if (text.find_first_of(std::string_view(special, sizeof(special))) == std::string_view::npos)
+			{
+				out.append(text);
+				return;
+			}
+			out.push_back(dialect.quotechar);
+			for (size_t start = 0;;)
+			{
+				size_t quote = dialect.doublequote ? text.find(dialect.quotechar, start) : std::string_view::npos;
+				if (quote == std::string_view::npos)
+				{
+					out.append(text.substr(start));
+					break;
+				}
+				out.append(text.substr(start, quote + 1 - start));
+				out.push_back(dialect.quotechar);
+				start = quote + 1;
+			}
+			out.push_back(dialect.quotechar);
+		}
+	} // namespace detail
+
+	template <class T>
+	struct FieldWriter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>>
+	{
+		static void Write(std::string &out, T value, const CSVDialect_t &)
+		{
+			char digits[24];
+			auto result = std::to_chars(digits, digits + sizeof(digits), value);
+			out.append(digits, (size_t)(result.ptr - digits));
+		}
+	};
+
+	template <class T>
+	struct FieldWriter<T, std::enable_if_t<std::is_floating_point_v<T>>>
+	{
+		static void Write(std::string &out, T value, const CSVDialect_t &)
+		{
+			char digits[64];
+#if defined(__cpp_lib_to_chars)
+			auto result = std::to_chars(digits, digits + sizeof(digits), value);
+			out.append(digits, (size_t)(result.ptr - digits));
+#else
+			int n = snprintf(digits, sizeof(digits), "%.17g", (double)value);
+			out.append(digits, n > 0 ? (size_t)n : 0);
+#endif
+		}
+	};
+
+	template <>
+	struct FieldWriter<bool>
+	{
+		static void Write(std::string &out, bool value, const CSVDialect_t &)
+		{
+			out.append(value ? "true" : "false");
+		}
+	};
+
+	template <>
+	struct FieldWriter<char>
+	{
+		static void Write(std::string &out, char value, const CSVDialect_t &dialect)
+		{
+			detail::AppendText(out, std::string_view(&value, 1), dialect);
+		}
+	};
+
+	template <class T>
+	struct FieldWriter<T, std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>>
+	{
+		static void Write(std::string &out, const T &value, const CSVDialect_t &dialect)
+		{
+			detail::AppendText(out, std::string_view(value), dialect);
+		}
+	};
+
+	template <class T>
+	struct FieldWriter<std::optional<T>>
+	{
+		static void Write(std::string &out, const std::optional<T> &value, const CSVDialect_t &dialect)
+		{
+			if (value)
+				FieldWriter<T>::Write(out, *value, dialect);
+		}
+	};
+
+	namespace detail
+	{
+		/* Field @p index of a record, empty when the record is shorter. */
+		template <class V>
+		inline bool BindField(V &member, size_t index, const char *text, const size_t *ends, size_t count)
+		{
+			if (index >= count)
+				return FieldParser<V>::Parse("", 0, member);
+			size_t start = index ? ends[index - 1] : 0;
+			return FieldParser<V>::Parse(text + start, ends[index] - start, member);
+		}
+
+		template <class T, class Members, size_t... I>
+		inline bool BindRecord(T &object, const Members &members, const char *text, const size_t *ends, size_t count, size_t &column, std::index_sequence<I...>)
+		{
+			return ((column = I, BindField(object.*std::get<I>(members), I, text, ends, count)) && ...);
+		}
+	} // namespace detail
+
 	template <class InputStream, class CSVDiaect>
 	class CsveeReader
 	{
@@ -1043,6 +2095,11 @@ namespace csvee
 		public:
 			using ValueType = CSVRow;
 			using DifferenceType = size_t;
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = CSVRow;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::shared_ptr<CSVRow>;
+			using reference = CSVRow &;
 			using PointerType = std::shared_ptr<ValueType>;
 			using ConstPointerType = const std::shared_ptr<ValueType>;
 			using ReferenceType = ValueType &;
@@ -1078,7 +2135,7 @@ namespace csvee
 
 			ReferenceType operator*() const
 			{
-				return &(this->m_Row);
+				return *(this->m_Row);
 			};
 
 			Iterator &operator++()
@@ -1146,7 +2203,8 @@ namespace csvee
 		using reverse_iterator = std::reverse_iterator<iterator>;
 
 	public:
-		CsveeReader(InputStream &stream, CSVDialect &dialect);
+		CsveeReader(InputStream &stream, const CSVDialect &dialect = CSVDiaect())
+			: m_Input(stream), m_Dialect(dialect.Get()) {};
 
 		CsveeReader(const CsveeReader &) = delete;
 		CsveeReader &operator=(const CsveeReader &) = delete;
@@ -1174,24 +2232,155 @@ namespace csvee
 			return reverse_iterator(this->end());
 		};
 
+		/** @brief Records in the input; the first call reads all of it and finds the rows, see csvee_lazy_attach(). */
+		size_t Size() const
+		{
+			Load();
+			return m_Csvee->count;
+		};
+
 		CSVRow operator[](size_t n) const
 		{
-			if (n < -1 && n > m_Csvee.count)
-				return CSVRow(m_Csvee.fields[n]);
+			Load();
+			if (n < m_Csvee->count)
+				return CSVRow(*csvee_row_at(m_Csvee.get(), n));
 			else
 				return CSVRow();
 		};
 
+		/**
+		 * @brief Bind each remaining record into a @p T and pass it to @p callback.
+		 * @details Fields go from the tokenizer's buffer straight into the
+		 * members named by Binding<T>, converted by FieldParser: no CSVRow,
+		 * CSVField or intermediate string is made and everything resolves at
+		 * compile time. The same object is reused for every record, so
+		 * @p callback may move from it. A field that does not convert throws
+		 * a CsveeError naming its record and column.
+		 */
+		template <class T, class Callback>
+		void ForEach(Callback &&callback, bool header = false)
+		{
+			BindState<T, Callback> state{callback, header, 0, 0, false, nullptr, T()};
+			bool ok = Parse(nullptr, &CsveeReader::OnRecord<T, Callback>, &state);
+			if (state.error)
+				std::rethrow_exception(state.error);
+			if (state.failed)
+				throw CsveeError("record " + std::to_string(state.record) + ", column " + std::to_string(state.column + 1) + " does not convert", WRONG_CAST);
+			if (!ok)
+				throw CsveeError("could not parse the input", PARSE_ERROR);
+		};
+
+		/** @brief Every remaining record bound into a @p T, see ForEach(). */
+		template <class T>
+		std::vector<T> ReadAll(bool header = false)
+		{
+			std::vector<T> out;
+			ForEach<T>([&](T &object)
+					   { out.push_back(std::move(object)); }, header);
+			return out;
+		};
+
 	private:
+		template <class T, class Callback>
+		struct BindState
+		{
+			Callback &callback;
+			bool header;
+			size_t record; /* from 1, the header included */
+			size_t column; /* from 0, reported from 1 like the record */
+			bool failed;
+			std::exception_ptr error;
+			T object;
+		};
+
+		template <class T, class Callback>
+		static bool OnRecord(void *user, const char *text, const size_t *ends, size_t count)
+		{
+			auto *state = static_cast<BindState<T, Callback> *>(user);
+			if (++state->record == 1 && state->header)
+				return true;
+			constexpr auto &members = Binding<T>::members;
+			constexpr size_t size = std::tuple_size_v<std::decay_t<decltype(members)>>;
+			if (!detail::BindRecord(state->object, members, text, ends, count, state->column, std::make_index_sequence<size>()))
+			{
+				state->failed = true;
+				return false;
+			}
+			try
+			{
+				state->callback(state->object);
+			}
+			catch (...)
+			{
+				state->error = std::current_exception();
+				return false;
+			}
+			return true;
+		};
+
+		/* Feed what is left of the input through a tokenizer calling @p on_row or @p on_record. */
+		bool Parse(CSVRowCallback_t on_row, CSVRecordCallback_t on_record, void *user) const
+		{
+			CSVParser_t parser;
+			csvee_parser_init(&parser, &m_Dialect, on_row, user);
+			parser.on_record = on_record;
+			std::vector<char> buffer(CSVEE_READ_BUFFER_SIZE);
+			bool ok = true;
+			while (ok && m_Input)
+			{
+				m_Input.read(buffer.data(), (std::streamsize)buffer.size());
+				size_t got = (size_t)m_Input.gcount();
+				ok = !got || csvee_parser_feed(&parser, buffer.data(), got);
+			}
+			ok = ok && csvee_parser_finish(&parser);
+			csvee_parser_free(&parser);
+			return ok;
+		};
+
+		/* Keep the input as is; operator[] tokenizes only the rows it is asked for. */
+		void Load() const
+		{
+			if (m_Csvee)
+				return;
+			m_Csvee.reset(csvee_new(m_Dialect.delimiter));
+			if (!m_Csvee)
+				throw CsveeError("could not allocate the table", OUT_OF_MEMORY);
+			char *name = m_Csvee->dialect->name;
+			*m_Csvee->dialect = m_Dialect;
+			m_Csvee->dialect->name = name;
+
+			char *text = nullptr;
+			size_t size = 0;
+			while (m_Input)
+			{
+				char *grown = (char *)realloc(text, size + CSVEE_READ_BUFFER_SIZE);
+				if (!grown)
+				{
+					free(text);
+					throw CsveeError("could not allocate the input", OUT_OF_MEMORY);
+				}
+				text = grown;
+				m_Input.read(text + size, CSVEE_READ_BUFFER_SIZE);
+				size += (size_t)m_Input.gcount();
+			}
+			if (!csvee_lazy_attach(m_Csvee.get(), text, size))
+				throw CsveeError("could not index the input", PARSE_ERROR);
+		};
+
 		InputStream &m_Input;
-		Csvee_t m_Csvee;
+		CSVDialect_t m_Dialect;
+		mutable std::unique_ptr<Csvee_t, void (*)(Csvee_t *)> m_Csvee{nullptr, csvee_free};
 	};
 
 	template <class OutputStream, class CSVDiaect>
 	class CsveeWriter
 	{
 	public:
-		CsveeWriter(OutputStream &stream, CSVDialect &dialect);
+		CsveeWriter(OutputStream &stream, const CSVDialect &dialect = CSVDiaect())
+			: m_Output(stream), m_Dialect(dialect.Get())
+		{
+			m_Buffer.reserve(CSVEE_WRITE_BLOCK_SIZE);
+		};
 
 		CsveeWriter(const CsveeWriter &) = delete;
 		CsveeWriter &operator=(const CsveeWriter &) = delete;
@@ -1200,27 +2389,117 @@ namespace csvee
 		CsveeWriter &operator=(CsveeWriter &&other) = default;
 
 		template <typename T>
-		CsveeWriter &WriteHead(const std::vector<T> &record);
+		CsveeWriter &WriteHead(const std::vector<T> &record)
+		{
+			return WriteRow(record);
+		};
 
 		template <typename T, size_t Size>
-		CsveeWriter &WriteHead(const std::array<T, Size> &record);
+		CsveeWriter &WriteHead(const std::array<T, Size> &record)
+		{
+			return WriteRow(record);
+		};
 
 		template <typename T>
-		CsveeWriter &WriteRow(const std::vector<T> &record);
+		CsveeWriter &WriteRow(const std::vector<T> &record)
+		{
+			for (size_t i = 0; i < record.size(); ++i)
+				AppendField(i, record[i]);
+			return EndRow();
+		};
 
 		template <typename T, size_t Size>
-		CsveeWriter &WriteRow(const std::array<T, Size> &record);
+		CsveeWriter &WriteRow(const std::array<T, Size> &record)
+		{
+			for (size_t i = 0; i < Size; ++i)
+				AppendField(i, record[i]);
+			return EndRow();
+		};
+
+		template <typename... T>
+		CsveeWriter &WriteRow(const std::tuple<T...> &record)
+		{
+			std::apply([this](const auto &...fields)
+					   { WriteFields(fields...); }, record);
+			return *this;
+		};
+
+		/** @brief Write @p object as a row, one field per member listed in Binding<T>. */
+		template <typename T, typename = decltype(Binding<T>::members)>
+		CsveeWriter &WriteRow(const T &object)
+		{
+			std::apply([&](const auto &...members)
+					   { WriteFields(object.*members...); }, Binding<T>::members);
+			return *this;
+		};
+
+		/** @brief Write one row of @p fields, each formatted by the FieldWriter of its type. */
+		template <typename... T>
+		CsveeWriter &WriteFields(const T &...fields)
+		{
+			size_t column = 0;
+			(AppendField(column++, fields), ...);
+			return EndRow();
+		};
 
 		template <typename T>
-		CsveeWriter &operator<<(const std::vector<T> &record);
+		CsveeWriter &operator<<(const std::vector<T> &record)
+		{
+			return WriteRow(record);
+		};
 
 		template <typename T, size_t Size>
-		CsveeWriter &operator<<(const std::array<T, Size> &record);
+		CsveeWriter &operator<<(const std::array<T, Size> &record)
+		{
+			return WriteRow(record);
+		};
+
+		template <typename... T>
+		CsveeWriter &operator<<(const std::tuple<T...> &record)
+		{
+			return WriteRow(record);
+		};
+
+		template <typename T, typename = decltype(Binding<T>::members)>
+		CsveeWriter &operator<<(const T &object)
+		{
+			return WriteRow(object);
+		};
 
-		~CsveeWriter();
+		/** @brief Hand the buffered rows to the stream. */
+		CsveeWriter &Flush()
+		{
+			if (!m_Buffer.empty())
+				m_Output.write(m_Buffer.data(), (std::streamsize)m_Buffer.size());
+			m_Buffer.clear();
+			return *this;
+		};
+
+		~CsveeWriter()
+		{
+			Flush();
+		};
 
 	private:
+		template <typename T>
+		void AppendField(size_t column, const T &value)
+		{
+			if (column)
+				m_Buffer.push_back(m_Dialect.delimiter);
+			FieldWriter<std::decay_t<const T>>::Write(m_Buffer, value, m_Dialect);
+		};
+
+		CsveeWriter &EndRow()
+		{
+			m_Buffer.push_back(m_Dialect.lineterminator);
+			if (m_Buffer.size() >= CSVEE_WRITE_BLOCK_SIZE)
+				Flush();
+			return *this;
+		};
+
 		OutputStream &m_Output;
+		CSVDialect_t m_Dialect;
+		std::string m_Buffer; /* rows not handed to the stream yet */
 	};
 
 	template <class CSVDialect>
@@ -1236,7 +2515,7 @@ namespace csvee
 		using Reader = CsveeReader<InputStream, Dialect>;
 
 	public:
-		using Iterator = CsveeIterator<Csvee<Dialect>>;
+		using Iterator = const CSVRow_t *;
 		using ConstIterator = const Iterator;
 		using ReverseIterator = std::reverse_iterator<Iterator>;
 		using ConstReverseIterator = const ReverseIterator;
@@ -1246,16 +2525,16 @@ namespace csvee
 
 		Dialect dialect();
 
-		template <typename... T>
-		CsveeWriter &WriteHead(const std::vector<T> &record);
+		template <typename T>
+		Csvee<Dialect> *WriteHead(const std::vector<T> &record);
 
-		template <typename... T, size_t Size>
-		CsveeWriter &WriteHead(const std::array<T, Size> &record);
+		template <typename T, size_t Size>
+		Csvee<Dialect> *WriteHead(const std::array<T, Size> &record);
 
-		template <typename... T>
+		template <typename T>
 		Csvee<Dialect> *WriteRow(const std::vector<T> &record);
 
-		template <typename... T, size_t Size>
+		template <typename T, size_t Size>
 		Csvee<Dialect> *WriteRow(const std::array<T, Size> &record);
 
 		Csvee<Dialect> *operator<<(const Csvee<CSVDialect> &csvee);
@@ -1271,54 +2550,6 @@ namespace csvee
 		Csvee_t m_Csvee;
 	};
 
-	/**
-	 * @brief CsveeError class for Csvee-related errors.
-	 */
-	class CsveeError : public std::exception
-	{
-	public:
-		/**
-		 * @brief Default constructor.
-		 */
-		CsveeError();
-
-		/**
-		 * @brief Constructs an exception with a specific error type.
-		 * @param type The type of the error.
-		 */
-		CsveeError(CsvError_t type);
-
-		/**
-		 * @brief Constructs an exception with a specific message and error type.
-		 * @param message The error message.
-		 * @param type The type of the error.
-		 */
-		CsveeError(const std::string &message, CsvError_t type);
-
-		/**
-		 * @brief Gets the error message.
-		 * @return The error message.
-		 */
-		const char *what() const noexcept override;
-
-		/**
-		 * @brief Gets the error type.
-		 * @return The error type.
-		 */
-		CsvError_t GetErrType() const noexcept;
-
-		/**
-		 * @brief Gets the name of the error type.
-		 * @param error The error type.
-		 * @return The name of the error type.
-		 */
-		std::string GetErrName(CsvError_t error) const noexcept;
-
-	private:
-		mutable std::string m_Msg; //!< The error message.
-		CsvError_t m_ErrType;	   //!< The error type.
-	};
-
 	using csv = Csvee<Excel>;
 
 	using tsv = Csvee<ExcelTab>;
@@ -1360,10 +2591,838 @@ namespace csvee
 // [SECTION] Defines
 //-----------------------------------------------------------------------------
 
+#ifndef CSVEE_NO_THREADS
+#if CSVEE_PLATFORM_IS(WINDOWS)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif // CSVEE_NO_THREADS
+
+#ifdef CSVEE_WITH_ZLIB
+#include <zlib.h>
+#endif // CSVEE_WITH_ZLIB
+
+#ifdef CSVEE_WITH_ZSTD
+#include <zstd.h>
+#endif // CSVEE_WITH_ZSTD
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CSVEE_ATOMIC_ADD(ptr, value) _InterlockedExchangeAdd64((volatile __int64 *)(ptr), (__int64)(value))
+#define CSVEE_ATOMIC_LOAD(ptr) ((uint64_t)_InterlockedOr64((volatile __int64 *)(ptr), 0))
+#define CSVEE_ATOMIC_STORE(ptr, value) _InterlockedExchange64((volatile __int64 *)(ptr), (__int64)(value))
+#define CSVEE_ATOMIC_OR(ptr, value) _InterlockedOr64((volatile __int64 *)(ptr), (__int64)(value))
+#define CSVEE_ATOMIC_CAS(ptr, expected, desired) \
+	(_InterlockedCompareExchange64((volatile __int64 *)(ptr), (__int64)(desired), (__int64)(expected)) == (__int64)(expected))
+/* pointer operations are sequentially consistent, hazard pointers depend on it */
+#define CSVEE_ATOMIC_LOAD_PTR(ptr) _InterlockedCompareExchangePointer((void *volatile *)(ptr), NULL, NULL)
+#define CSVEE_ATOMIC_STORE_PTR(ptr, value) ((void)_InterlockedExchangePointer((void *volatile *)(ptr), (void *)(value)))
+#define CSVEE_ATOMIC_SWAP_PTR(ptr, value) _InterlockedExchangePointer((void *volatile *)(ptr), (void *)(value))
+#define CSVEE_ATOMIC_CAS_PTR(ptr, expected, desired) \
+	(_InterlockedCompareExchangePointer((void *volatile *)(ptr), (void *)(desired), (void *)(expected)) == (void *)(expected))
+#else
+#define CSVEE_ATOMIC_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+#define CSVEE_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define CSVEE_ATOMIC_STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+#define CSVEE_ATOMIC_OR(ptr, value) __atomic_fetch_or((ptr), (value), __ATOMIC_RELAXED)
+#define CSVEE_ATOMIC_CAS(ptr, expected, desired) \
+	__atomic_compare_exchange_n((ptr), &(expected), (desired), false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+/* pointer operations are sequentially consistent, hazard pointers depend on it */
+#define CSVEE_ATOMIC_LOAD_PTR(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define CSVEE_ATOMIC_STORE_PTR(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define CSVEE_ATOMIC_SWAP_PTR(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define CSVEE_ATOMIC_CAS_PTR(ptr, expected, desired) \
+	__atomic_compare_exchange_n((ptr), &(expected), (desired), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#endif
+
+#if !CSVEE_PLATFORM_IS(WINDOWS)
+#include <strings.h> /* strcasecmp, strncasecmp */
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <sys/stat.h>
+#if CSVEE_PLATFORM_IS(WINDOWS)
+typedef struct _stat64 csvee_stat_t;
+#define CSVEE_STAT(path, st) _stat64((path), (st))
+#define CSVEE_FSTAT(file, st) _fstat64(_fileno(file), (st))
+#else
+typedef struct stat csvee_stat_t;
+#define CSVEE_STAT(path, st) stat((path), (st))
+#define CSVEE_FSTAT(file, st) fstat(fileno(file), (st))
+#endif
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#if CSVEE_PLATFORM_IS(WINDOWS)
+#define CSVEE_FSEEK64(file, offset) _fseeki64((file), (__int64)(offset), SEEK_SET)
+#else
+#include <sys/types.h> /* off_t */
+#define CSVEE_FSEEK64(file, offset) fseeko((file), (off_t)(offset), SEEK_SET)
+#endif
+
+#if !defined(CSVEE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CSVEE_SIMD_SSE2
+#elif !defined(CSVEE_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define CSVEE_SIMD_NEON
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static __forceinline unsigned csvee_ctz32(unsigned long value)
+{
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (unsigned)index;
+}
+#define CSVEE_CTZ(value) csvee_ctz32(value)
+#else
+#define CSVEE_CTZ(value) ((unsigned)__builtin_ctz(value))
+#endif
+
+/* Tokenizer states, see csvee_parser_feed() */
+#define CSVEE_PARSE_FIELD_START 0
+#define CSVEE_PARSE_UNQUOTED 1
+#define CSVEE_PARSE_QUOTED 2
+#define CSVEE_PARSE_QUOTE_IN_QUOTED 3
+#define CSVEE_PARSE_ESCAPE 4
+
 //-----------------------------------------------------------------------------
 // [SECTION] Data Structures
 //-----------------------------------------------------------------------------
 
+#ifndef CSVEE_NO_THREADS
+#if CSVEE_PLATFORM_IS(WINDOWS)
+typedef HANDLE csvee_thread_t;
+typedef SRWLOCK csvee_mutex_t;
+typedef CONDITION_VARIABLE csvee_cond_t;
+#else
+typedef pthread_t csvee_thread_t;
+typedef pthread_mutex_t csvee_mutex_t;
+typedef pthread_cond_t csvee_cond_t;
+#endif
+
+typedef struct CSVThreadStart_t
+{
+	void (*fn)(void *arg);
+	void *arg;
+
+} CSVThreadStart_t;
+#endif // CSVEE_NO_THREADS
+
+/* Streaming decompressor over an open FILE. */
+typedef struct CSVInflate_t
+{
+	CSVCodec_t codec;
+	FILE *file;
+	unsigned char *input;
+	bool input_eof;
+	bool member_open; /* inside a gzip member / zstd frame */
+	bool failed;
+
+#ifdef CSVEE_WITH_ZLIB
+	z_stream zs;
+#endif
+#ifdef CSVEE_WITH_ZSTD
+	ZSTD_DCtx *zd;
+	ZSTD_inBuffer zin;
+#endif
+
+} CSVInflate_t;
+
+/* Streaming compressor writing to an open FILE. */
+typedef struct CSVDeflate_t
+{
+	CSVCodec_t codec;
+	FILE *file;
+	unsigned char *output;
+	bool failed;
+
+#ifdef CSVEE_WITH_ZLIB
+	z_stream zs;
+#endif
+#ifdef CSVEE_WITH_ZSTD
+	ZSTD_CCtx *zc;
+#endif
+
+} CSVDeflate_t;
+
+/* Structural scan used by csvee_info(): looks only at delimiters, quotes and line ends. */
+typedef struct CSVScan_t
+{
+	char delimiter;
+	char quotechar;
+	bool doublequote;
+	bool skipwhitespace;
+
+	uint64_t offset;	  /* absolute position of the chunk being scanned */
+	uint64_t row_start;	  /* first byte of the current row */
+	uint64_t field_start; /* first byte of the current field */
+	uint64_t close_at;	  /* byte after the last closing quote */
+	uint64_t escape_at;	  /* byte escaped by a backslash */
+	uint64_t cr_at;		  /* byte after the last unquoted '\r' */
+	uint64_t ws_from;	  /* bytes from here to offset are skippable whitespace */
+	bool in_quotes;
+	bool row_quoted;
+	size_t columns; /* fields so far in the current row */
+
+	size_t rows;
+	size_t min_columns;
+	size_t max_columns;
+	size_t lf;
+	size_t crlf;
+	size_t cr;
+	bool quoted_newlines;
+
+	struct CSVBuffer_t *spans; /* when set, gets the first and end byte of every row as two uint64_t */
+	bool failed;			   /* appending to spans ran out of memory */
+
+} CSVScan_t;
+
+/* Growable byte buffer. */
+typedef struct CSVBuffer_t
+{
+	char *data;
+	size_t size;
+	size_t capacity;
+
+} CSVBuffer_t;
+
+/* CSVEE_SPILL_BLOCK_ROWS rows of a table, resident or in the spill file. */
+typedef struct CSVSpillBlock_t
+{
+	uint64_t offset; /* position in the spill file, UINT64_MAX until first evicted */
+	uint64_t size;	 /* encoded bytes in the spill file */
+	size_t bytes;	 /* heap bytes while resident */
+	bool resident;
+	size_t prev; /* least recently used neighbours, SIZE_MAX at the ends */
+	size_t next;
+
+} CSVSpillBlock_t;
+
+struct CSVSpill_t
+{
+	FILE *file;
+	uint64_t file_size;
+
+	CSVSpillBlock_t *blocks;
+	size_t block_count;
+	size_t block_cap;
+	size_t lru_head; /* evicted first */
+	size_t lru_tail;
+	size_t hot; /* block of the last csvee_row_at(), skips relinking */
+
+	size_t resident_bytes;
+	size_t peak_bytes;
+	CSVBuffer_t scratch; /* one encoded block */
+};
+
+struct CSVLazy_t
+{
+	char *text; /* the whole input, decompressed */
+	size_t size;
+	uint64_t *spans; /* row r is text[spans[2 * r], spans[2 * r + 1]) */
+	size_t count;	 /* rows with a span, the first count rows of the table */
+	size_t pending;	 /* of those, not built yet */
+
+	CSVParser_t parser; /* shared by every row so its buffers are reused */
+};
+
+struct CSVCompact_t
+{
+	CSVField_t *fields; /* every field of the table, row after row */
+	size_t count;
+	size_t capacity;
+	CSVBuffer_t text;	/* every field's text, NUL terminated */
+	CSVBuffer_t starts; /* size_t offset of each field's text while reading, the block still moves */
+};
+
+/* Reference count of CSVEE_SHARE_BLOCK_ROWS rows held by several versions; only the writer touches it. */
+typedef struct CSVShareBlock_t
+{
+	size_t refs;
+
+} CSVShareBlock_t;
+
+struct CSVShare_t
+{
+	CSVShareBlock_t **blocks; /* NULL for a block only this table holds */
+	size_t count;
+};
+
+struct CSVVersions_t
+{
+	Csvee_t *current;						  /* swapped atomically by csvee_versions_publish() */
+	Csvee_t *hazards[CSVEE_VERSION_READERS]; /* snapshot each reader slot protects, NULL when free */
+	Csvee_t **retired;						  /* replaced versions a reader may still hold */
+	size_t retired_count;
+	size_t retired_cap;
+};
+
+/* Fixed ring of buffers handed between a worker thread and the calling thread. */
+typedef struct CSVRing_t
+{
+	CSVBuffer_t slots[CSVEE_RING_SIZE];
+	size_t head;
+	size_t tail;
+	size_t filled;
+	bool done;
+	bool cancelled;
+	uint64_t busy_ns; /* time the worker spent (de)compressing */
+
+#ifndef CSVEE_NO_THREADS
+	csvee_mutex_t lock;
+	csvee_cond_t not_empty;
+	csvee_cond_t not_full;
+#endif
+
+	CSVInflate_t *decoder; /* reading: worker decompresses into slots */
+	CSVDeflate_t *encoder; /* writing: worker compresses slots out */
+
+} CSVRing_t;
+
+/* Output file fed in blocks, compressed on a worker thread when a codec is set. */
+typedef struct CSVSink_t
+{
+	FILE *file;
+	CSVDeflate_t encoder;
+	CSVRing_t ring;
+	CSVBuffer_t block; /* append here, csvee_sink_flush() once block_size is reached */
+	size_t block_size;
+	bool threaded;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t consumer;
+#endif
+	uint64_t waited_ns; /* blocked on a full ring */
+	CSVStat_t *stats;
+
+} CSVSink_t;
+
+/* One record being sorted: its normalized key, then its formatted line, at offset in the batch data. */
+typedef struct CSVSortItem_t
+{
+	uint64_t prefix; /* first 8 key bytes, big endian, settles most compares */
+	size_t offset;
+	uint32_t key_len;
+	uint32_t line_len;
+	size_t row; /* csvee_sort(): index of the row in the table */
+
+} CSVSortItem_t;
+
+/* Records collected for one sorted run. */
+typedef struct CSVSortBatch_t
+{
+	CSVBuffer_t data;
+	CSVSortItem_t *items;
+	size_t count;
+	size_t capacity;
+
+	FILE *run; /* the sorted run, once written */
+	size_t run_index;
+	bool ok;
+	bool busy;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t thread;
+#endif
+
+} CSVSortBatch_t;
+
+/* Cursor over a run file during a merge. */
+typedef struct CSVSortReader_t
+{
+	FILE *file;
+	CSVBuffer_t record; /* key bytes then line bytes */
+	size_t key_len;
+	size_t line_len;
+	bool done;
+
+} CSVSortReader_t;
+
+/* A slice of the rows handled by one thread of csvee_sort(). */
+typedef struct CSVSortPart_t
+{
+	const CSVRow_t *rows;
+	const CSVSortKey_t *keys;
+	size_t nkeys;
+	size_t first; /* slice of rows and items */
+	size_t mid;	  /* merges: start of the second sorted half */
+	size_t end;
+
+	CSVBuffer_t data; /* keys of the slice while they are built */
+	const char *ref;  /* key of the first row, to find the bytes all keys share */
+	size_t ref_len;
+	size_t shared;
+
+	CSVSortItem_t *items; /* whole table */
+	CSVSortItem_t *tmp;
+	const char *keys_data; /* all keys, once gathered */
+	size_t base;		   /* offset of this part's keys in keys_data */
+	bool ok;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t thread;
+#endif
+
+} CSVSortPart_t;
+
+/* Slot of a CSVHashTable_t. */
+typedef struct CSVHashSlot_t
+{
+	uint64_t hash;
+	size_t entry; /* index + 1, 0 when the slot is free */
+
+} CSVHashSlot_t;
+
+/* Open addressing (linear probing) set of byte strings, entries numbered in insertion order. */
+typedef struct CSVHashTable_t
+{
+	CSVHashSlot_t *slots;
+	size_t capacity; /* slots, a power of two */
+	size_t count;	 /* entries */
+	CSVBuffer_t keys;
+	size_t *offsets; /* count + 1: entry i is keys.data[offsets[i] .. offsets[i + 1]) */
+	size_t offsets_cap;
+
+} CSVHashTable_t;
+
+/* Running value of one aggregate of one group. */
+typedef struct CSVAggState_t
+{
+	uint64_t count; /* rows (COUNT), numbers (SUM, MIN, MAX, MEAN) or distinct values */
+	double sum;
+	double min;
+	double max;
+
+} CSVAggState_t;
+
+/* Groups seen by one thread of csvee_group_file(). */
+typedef struct CSVGroupTable_t
+{
+	CSVHashTable_t groups;	 /* keys: the group columns, NUL terminated */
+	CSVHashTable_t distinct; /* keys: varint group, aggregate index, value */
+	CSVAggState_t *states;	 /* naggregates per group */
+	size_t states_cap;		 /* groups */
+	size_t naggregates;
+	CSVBuffer_t scratch; /* distinct key being looked up */
+
+} CSVGroupTable_t;
+
+struct CSVGroupJob_t;
+
+/* Aggregation thread fed batches of row records through its ring. */
+typedef struct CSVGroupWorker_t
+{
+	struct CSVGroupJob_t *job;
+	CSVGroupTable_t table;
+	CSVRing_t ring;
+	bool ok;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t thread;
+	bool threaded;
+#endif
+
+} CSVGroupWorker_t;
+
+/* State of csvee_group_file() while the input is parsed. */
+typedef struct CSVGroupJob_t
+{
+	const CSVAggregate_t *aggregates;
+	size_t naggregates;
+	CSVSortKey_t *keys; /* the group columns, as text */
+	size_t nkeys;
+	bool header;
+	bool have_names;
+	CSVRow_t names;	 /* header record */
+	CSVBuffer_t key; /* group key of the current record */
+
+	CSVGroupWorker_t *workers;
+	size_t nworkers;
+	size_t next;	   /* worker the next batch goes to */
+	CSVBuffer_t batch; /* row records being collected */
+	size_t table_limit;
+
+	FILE *partitions[CSVEE_GROUP_PARTITIONS];
+	CSVBuffer_t spill;
+	bool spilled;
+	bool failed;
+#ifndef CSVEE_NO_THREADS
+	csvee_mutex_t lock; /* partitions */
+#endif
+
+} CSVGroupJob_t;
+
+/* Build side of csvee_join(): records chained by interned key, kept as parallel arrays. */
+typedef struct CSVJoinTable_t
+{
+	CSVHashTable_t keys; /* distinct keys, the entry is the key id */
+	size_t *first;		 /* per key id: first and last record, in input order */
+	size_t *last;
+	size_t key_cap;
+
+	size_t count;	  /* records */
+	size_t *next;	  /* per record: next one with the same key, SIZE_MAX at the end */
+	size_t *offsets;  /* count + 1: record r is fields.data[offsets[r] .. offsets[r + 1]) */
+	uint64_t *matched; /* bit per record, when the left input is the build side */
+	size_t record_cap;
+	CSVBuffer_t fields; /* formatted fields, no line terminator */
+
+} CSVJoinTable_t;
+
+struct CSVJoinJob_t;
+
+/* Probe thread: batches of probe records come in, joined lines go out in the same order. */
+typedef struct CSVJoinWorker_t
+{
+	struct CSVJoinJob_t *job;
+	CSVRing_t input;
+	CSVRing_t output;
+	CSVBuffer_t batch;
+	CSVBuffer_t lines;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t thread;
+	bool threaded;
+#endif
+
+} CSVJoinWorker_t;
+
+/* State of csvee_join() while the build side is loaded and the probe side streamed. */
+typedef struct CSVJoinJob_t
+{
+	CSVJoinType_t type;
+	bool build_left; /* the left input is the (smaller) build side */
+	size_t key_columns[2];		 /* left, right */
+	const CSVDialect_t *dialect; /* of the output */
+	bool header;
+	bool have_names[2]; /* left, right */
+	CSVBuffer_t names[2];
+	bool header_written;
+	size_t right_columns; /* fields of the widest right record */
+	CSVBuffer_t padding;  /* empty right fields for unmatched LEFT rows */
+
+	CSVJoinTable_t table;
+	size_t mem_limit;
+	bool partitioned;
+	FILE *partitions[2][CSVEE_JOIN_PARTITIONS]; /* build, probe */
+	CSVBuffer_t record;
+	CSVBuffer_t key;  /* of the current record */
+	CSVBuffer_t line; /* its formatted fields */
+
+	CSVJoinWorker_t *workers;
+	size_t nworkers;
+	CSVBuffer_t batch;	/* probe records being collected */
+	size_t dispatched;	/* batches handed out */
+	size_t written;		/* batches whose lines reached the sink */
+	CSVBuffer_t drained;
+	CSVSink_t *sink;
+
+} CSVJoinJob_t;
+
+/* State of csvee_dedup_file() while the input streams through. */
+typedef struct CSVDedupJob_t
+{
+	const size_t *columns;
+	size_t ncolumns;
+	CSVDedupKeep_t keep;
+	const CSVDialect_t *dialect; /* of the output */
+	bool header;
+	bool writing;	  /* this pass writes records: always for KEEP_FIRST, the second pass for KEEP_LAST */
+	bool before_head; /* the header of this pass is still to come */
+	size_t seq;		  /* records read so far in this pass */
+
+	CSVHashTable_t seen; /* keys, each with its 64-bit hash */
+	size_t *last;		 /* KEEP_LAST: per key, the number of its last record */
+	size_t last_cap;
+	size_t mem_limit;
+	bool partitioned;
+	FILE *partitions[CSVEE_DEDUP_PARTITIONS];
+	CSVBuffer_t key;
+	CSVBuffer_t line;
+	CSVBuffer_t record;
+	CSVSink_t *sink;
+
+} CSVDedupJob_t;
+
+typedef struct CSVCentroid_t
+{
+	double mean;
+	double weight;
+
+} CSVCentroid_t;
+
+/* Sketches behind a CSVColumnProfile_t, merged the same way they are built. */
+typedef struct CSVSketch_t
+{
+	uint8_t hll[1 << CSVEE_PROFILE_HLL_BITS];
+	uint64_t cms[CSVEE_PROFILE_CMS_DEPTH][CSVEE_PROFILE_CMS_WIDTH];
+
+	CSVCentroid_t *centroids; /* t-digest: [0, merged) compressed and sorted, then values not yet merged */
+	size_t centroid_count;
+	size_t centroid_cap;
+	size_t merged;
+	double compression;
+
+	size_t top_k;
+	size_t top_cap;
+	uint64_t top_min; /* smallest estimate among the top values once there are top_k */
+
+} CSVSketch_t;
+
+/* Profiling thread: folds the batches published to its ring into its own profile. */
+typedef struct CSVProfileWorker_t
+{
+	CSVProfile_t profile;
+	CSVRing_t ring;
+	CSVBuffer_t batch;
+	bool ok;
+#ifndef CSVEE_NO_THREADS
+	csvee_thread_t thread;
+	bool threaded;
+#endif
+
+} CSVProfileWorker_t;
+
+/* State of csvee_profile() while the input is parsed. */
+typedef struct CSVProfileJob_t
+{
+	bool header;
+	bool have_names;
+	CSVRow_t names;
+
+	CSVProfileWorker_t *workers;
+	size_t nworkers;
+	size_t next;	   /* worker the next batch goes to */
+	CSVBuffer_t batch; /* records being collected: field count, then length and text of each field */
+
+} CSVProfileJob_t;
+
+/* One column gathered for Arrow: the text of every field, given its type once all are seen. */
+typedef struct CSVArrowColumn_t
+{
+	CSVBuffer_t data;	  /* field text, back to back */
+	CSVBuffer_t offsets;  /* int32_t per field, plus the end */
+	CSVBuffer_t validity; /* bit per field, set unless it is empty */
+	size_t nulls;
+	uint64_t integers;
+	uint64_t doubles;
+	uint64_t bools;
+	uint64_t strings;
+
+} CSVArrowColumn_t;
+
+/* Records of csvee_export_arrow() and csvee_read_arrow() on their way to Arrow arrays. */
+typedef struct CSVArrowBuilder_t
+{
+	CSVArrowColumn_t *columns;
+	size_t count;
+	size_t length; /* records */
+	bool header;
+	char **names; /* header fields, names_count of them */
+	size_t names_count;
+
+} CSVArrowBuilder_t;
+
+/* Allocations behind an exported ArrowArray, freed by its release callback. */
+typedef struct CSVArrowArrayData_t
+{
+	void *buffers[3];
+	struct ArrowArray *children;
+	struct ArrowArray **pointers;
+
+} CSVArrowArrayData_t;
+
+typedef struct CSVArrowSchemaData_t
+{
+	char *name;
+	struct ArrowSchema *children;
+	struct ArrowSchema **pointers;
+
+} CSVArrowSchemaData_t;
+
+/* Encodings of a column chunk in a columnar file. */
+typedef enum CSVEncoding_t
+{
+	CSVEE_ENC_PLAIN,   /* text: varint length and bytes per value */
+	CSVEE_ENC_DICT,	   /* text: the distinct values once, then bit-packed indices into them */
+	CSVEE_ENC_RLE,	   /* numbers: zigzag value and run length pairs */
+	CSVEE_ENC_BITPACK, /* numbers: the minimum, then bit-packed differences from it */
+	CSVEE_ENC_DELTA,   /* numbers: the first value, then bit-packed deltas above the smallest delta */
+
+} CSVEncoding_t;
+
+/* Values of one column of the row group being written; numbers are unscaled decimals. */
+typedef struct CSVColumnChunk_t
+{
+	CSVBuffer_t numbers; /* int64_t per present value */
+	CSVBuffer_t text;	 /* text values back to back */
+	CSVBuffer_t ends;	 /* size_t per present value: where it ends in text */
+	CSVBuffer_t present; /* bit per record */
+	size_t rows;
+	size_t nulls;
+
+} CSVColumnChunk_t;
+
+/* Where a column chunk is and its zone map, from the footer. */
+typedef struct CSVChunkMeta_t
+{
+	uint64_t offset;
+	uint64_t size;
+	uint64_t nulls;
+	bool has_range; /* some value is present, min and max are set */
+	int64_t min;	/* number columns */
+	int64_t max;
+	const char *min_text; /* text columns, into the footer */
+	size_t min_len;
+	const char *max_text;
+	size_t max_len;
+
+} CSVChunkMeta_t;
+
+typedef struct CSVSlice_t
+{
+	const char *data;
+	size_t size;
+
+} CSVSlice_t;
+
+/* A column chunk read back. */
+typedef struct CSVChunkView_t
+{
+	CSVBuffer_t raw;			  /* as stored; text slices point into it */
+	const unsigned char *present; /* bit per record, NULL without nulls */
+	CSVBuffer_t numbers;		  /* int64_t per present value */
+	CSVBuffer_t slices;			  /* CSVSlice_t per present value */
+	size_t next;				  /* present values passed so far */
+
+} CSVChunkView_t;
+
+/* An open columnar file: its footer, parsed. */
+typedef struct CSVColumnarFile_t
+{
+	FILE *file;
+	CSVBuffer_t footer;
+	bool header;
+	size_t ncolumns;
+	int *scales;	   /* decimal places of a number column, -1 for text */
+	CSVBuffer_t names; /* NUL terminated, one after the other */
+	const char **names_at;
+	size_t names_count;
+	size_t ngroups;
+	uint64_t *group_rows;
+	CSVChunkMeta_t *chunks; /* ncolumns + 1 per group, the last holding the record widths */
+
+} CSVColumnarFile_t;
+
+/* State of csvee_columnar_from_csv() over its two passes. */
+typedef struct CSVColumnarWriter_t
+{
+	bool header;
+	bool before_head; /* the header of this pass is still to come */
+	bool writing;	  /* second pass */
+	CSVBuffer_t names;
+	size_t names_count;
+	size_t ncolumns;
+	int *scales; /* first pass: -2 until a column has a value */
+
+	FILE *out;
+	uint64_t offset; /* bytes written so far */
+	size_t group_rows;
+	CSVColumnChunk_t *chunks; /* ncolumns, then the record widths */
+	size_t rows;			  /* in the current group */
+	size_t ngroups;
+	CSVBuffer_t groups; /* footer entries of the groups written */
+	CSVHashTable_t dictionary;
+	CSVBuffer_t payload[3]; /* candidate encodings of a chunk */
+	CSVBuffer_t chunk;
+
+} CSVColumnarWriter_t;
+
+	/* A predicate ready to test: its value as an unscaled decimal of the column, or its text. */
+	typedef struct CSVColumnarTest_t
+	{
+		const CSVPredicate_t *predicate;
+		bool number;
+		int bound;		  /* number beyond every int64: -1 below, 1 above */
+		int64_t unscaled; /* number rounded down to the places of the column */
+		bool fraction;	  /* and the part rounded off was not zero */
+		size_t size;	  /* text */
+
+	} CSVColumnarTest_t;
+
+/* Field of csvee_parse_cb() being scanned. */
+typedef struct CSVPiece_t
+{
+	CSVFieldCallback_t on_field;
+	void *user;
+	const char *data; /* content not handed out yet, a run of the input */
+	size_t size;
+	bool split;	 /* part of the field was handed out already */
+	size_t fields; /* fields of the row so far */
+
+} CSVPiece_t;
+
+/* State of csvee_read_typed() while the records stream by. */
+typedef struct CSVTypedJob_t
+{
+	const CSVSchema_t *schema;
+	CSVTypedTable_t *table;
+	size_t *sources;   /* field of the record each schema column reads */
+	CSVBuffer_t *text; /* bytes of each string column */
+	size_t record;	   /* records seen, the header included */
+
+} CSVTypedJob_t;
+
+/* Pull state of csvee_next_batch(): the parser is fed a chunk at a time until the batch is full. */
+struct CSVStream_t
+{
+	FILE *file;
+	CSVCodec_t codec;
+	CSVInflate_t decoder;
+	char *chunk; /* CSVEE_READ_BUFFER_SIZE bytes read from the file */
+	bool eof;
+	bool failed;
+
+	CSVDialect_t dialect;
+	CSVParser_t parser;
+	const CSVSchema_t *schema;
+	size_t *sources; /* field of the record each schema column reads */
+	char **names;	 /* header names of the columns declared by index */
+	size_t record;	 /* records seen, the header included */
+
+	CSVBatch_t *batch; /* being filled */
+	size_t max_rows;
+
+	/* records parsed past a full batch, handed out first next time */
+	CSVBuffer_t carry_text;
+	CSVBuffer_t carry_ends; /* per record: text offset, field count, then the field ends */
+	size_t carry_at;
+};
+
+/* State of csvee_sort_file() while the input is parsed into batches. */
+typedef struct CSVSortJob_t
+{
+	const CSVSortKey_t *keys;
+	size_t nkeys;
+	const CSVDialect_t *dialect; /* of the output */
+	bool header;
+	bool have_header;
+	CSVBuffer_t header_line;
+
+	CSVSortBatch_t *batches;
+	size_t nbatches;
+	size_t current;		/* batch being filled */
+	size_t batch_limit; /* bytes per batch */
+
+	FILE **runs;
+	size_t run_count;
+	size_t run_cap;
+	bool failed;
+
+} CSVSortJob_t;
+
 //-----------------------------------------------------------------------------
 // [SECTION] C Only Functions
 //-----------------------------------------------------------------------------
@@ -1377,7 +3436,7 @@ extern "C"
 	// [SECTION] Declarations
 	//-----------------------------------------------------------------------------
 
-	CSVRow_t *csvee_row_first(const Csvee_t *csvee);
+	CSVRow_t *csvee_row_first(Csvee_t *csvee);
 	CSVField_t *csvee_field_first(const CSVRow_t *row);
 
 	CSVField_t csvee_create_field(const char *value);
@@ -1387,21 +3446,135 @@ extern "C"
 	CSVRow_t csvee_create_row(size_t field_count);
 	CSVRow_t csvee_get_row(Csvee_t *csvee, size_t row);
 	void csvee_row_free(CSVRow_t *row);
+	static bool csvee_row_copy(CSVRow_t *to, const CSVRow_t *from);
 
 	void csvee_field_str(const CSVField_t *field, char **buffer, size_t *count);
 	void csvee_row_str(const CSVRow_t *row, char sep, char **buffer, size_t *count);
 	void csvee_csvee_str(const Csvee_t *csvee, char **buffer, size_t *count);
 
+	static CSVField_t csvee_create_field_n(const char *value, size_t size);
+	static bool csvee_row_push_field(CSVRow_t *row, CSVField_t field);
+	static bool csvee_push_row(Csvee_t *csvee, CSVRow_t *row);
+	static bool csvee_append_row_cb(void *user, CSVRow_t *row);
+
+#ifndef CSVEE_NO_THREADS
+	static bool csvee_thread_create(csvee_thread_t *thread, void (*fn)(void *arg), void *arg);
+	static void csvee_thread_join(csvee_thread_t thread);
+	static void csvee_mutex_init(csvee_mutex_t *mutex);
+	static void csvee_mutex_lock(csvee_mutex_t *mutex);
+	static void csvee_mutex_unlock(csvee_mutex_t *mutex);
+	static void csvee_mutex_destroy(csvee_mutex_t *mutex);
+	static void csvee_cond_init(csvee_cond_t *cond);
+	static void csvee_cond_wait(csvee_cond_t *cond, csvee_mutex_t *mutex);
+	static void csvee_cond_signal(csvee_cond_t *cond);
+	static void csvee_cond_broadcast(csvee_cond_t *cond);
+	static void csvee_cond_destroy(csvee_cond_t *cond);
+	static size_t csvee_cpu_count(void);
+#endif // CSVEE_NO_THREADS
+
+	static bool csvee_inflate_init(CSVInflate_t *decoder, FILE *file, CSVCodec_t codec);
+	static size_t csvee_inflate_read(CSVInflate_t *decoder, char *out, size_t capacity);
+	static void csvee_inflate_end(CSVInflate_t *decoder);
+
+	static bool csvee_read_plain(FILE *file, CSVParser_t *parser);
+	static bool csvee_read_compressed(FILE *file, CSVCodec_t codec, CSVParser_t *parser);
+
+	static void csvee_scan_init(CSVScan_t *scan, const CSVDialect_t *dialect);
+	static void csvee_scan_feed(CSVScan_t *scan, const char *data, size_t size);
+	static void csvee_scan_finish(CSVScan_t *scan);
+
+	static bool csvee_deflate_init(CSVDeflate_t *encoder, FILE *file, CSVCodec_t codec, int level);
+	static bool csvee_deflate_write(CSVDeflate_t *encoder, const char *data, size_t size, bool finish);
+	static void csvee_deflate_end(CSVDeflate_t *encoder);
+
+	static CSVWriteOptions_t csvee_write_options_for(const char *filename);
+	static bool csvee_sink_open(CSVSink_t *sink, const char *filename, const CSVWriteOptions_t *options, CSVStat_t *stats);
+	static bool csvee_sink_flush(CSVSink_t *sink);
+	static bool csvee_sink_close(CSVSink_t *sink, bool ok);
+
+	static bool csvee_buffer_reserve(CSVBuffer_t *buffer, size_t extra);
+	static bool csvee_buffer_append(CSVBuffer_t *buffer, const char *data, size_t size);
+	static void csvee_buffer_free(CSVBuffer_t *buffer);
+
+	static const char *csvee_field_text(const CSVField_t *field, char *scratch, size_t size);
+	static bool csvee_format_row(CSVBuffer_t *buffer, const CSVRow_t *row, const CSVDialect_t *dialect, char lineterm, CSVStat_t *stats);
+
+	static uint64_t csvee_now_ns(void);
+	static void csvee_stats_merge(CSVStat_t *into, const CSVStat_t *from);
+	static void csvee_stats_publish(const CSVStat_t *stats);
+
+	static size_t csvee_row_bytes(const CSVRow_t *row);
+	static FILE *csvee_spill_open(const char *dir);
+	static bool csvee_spill_track(Csvee_t *csvee);
+	static bool csvee_spill_enforce(Csvee_t *csvee, size_t keep);
+	static bool csvee_spill_evict(Csvee_t *csvee, size_t block);
+	static bool csvee_spill_load(Csvee_t *csvee, size_t block);
+	static void csvee_spill_free(CSVSpill_t *spill);
+
+	static bool csvee_share_init(Csvee_t *csvee);
+	static bool csvee_share_unshare(Csvee_t *csvee, size_t block);
+	static bool csvee_share_detach(Csvee_t *csvee);
+	static bool csvee_share_owns(const Csvee_t *csvee, size_t index);
+	static void csvee_share_free(Csvee_t *csvee);
+
+	static bool csvee_sort_key(CSVBuffer_t *out, const CSVSortKey_t *keys, size_t nkeys, const CSVRow_t *row);
+	static uint64_t csvee_sort_prefix(const char *key, size_t size);
+	static void csvee_sort_items(CSVSortItem_t *items, CSVSortItem_t *tmp, size_t count, const char *data);
+	static void csvee_sort_radix(CSVSortItem_t *items, CSVSortItem_t *tmp, size_t count, const char *data);
+	static bool csvee_sort_merge(FILE **runs, size_t k, FILE *out, CSVSink_t *sink);
+
+	static uint64_t csvee_hash(const char *data, size_t size);
+	static bool csvee_hash_insert(CSVHashTable_t *table, const char *key, size_t size, uint64_t hash, size_t *entry, bool *added);
+	static void csvee_hash_clear(CSVHashTable_t *table);
+	static void csvee_hash_free(CSVHashTable_t *table);
+	static size_t csvee_hash_bytes(const CSVHashTable_t *table);
+	static bool csvee_hash_find(const CSVHashTable_t *table, const char *key, size_t size, uint64_t hash, size_t *entry);
+
+	static bool csvee_group_find(CSVGroupTable_t *table, const char *key, size_t size, size_t *group);
+	static bool csvee_group_distinct(CSVGroupTable_t *table, size_t group, size_t aggregate, const char *value, size_t size);
+	static bool csvee_group_absorb(CSVGroupTable_t *into, const CSVGroupTable_t *from, const CSVAggregate_t *aggregates);
+	static bool csvee_group_consume(CSVGroupTable_t *table, const CSVAggregate_t *aggregates, const char *data, size_t size);
+	static bool csvee_group_spill(CSVGroupJob_t *job, CSVGroupTable_t *table);
+	static bool csvee_group_load(CSVGroupTable_t *table, const CSVAggregate_t *aggregates, FILE *file);
+	static bool csvee_group_emit(const CSVGroupTable_t *table, const CSVAggregate_t *aggregates, size_t ncolumns, CSVSink_t *sink, const CSVDialect_t *dialect);
+	static size_t csvee_group_bytes(const CSVGroupTable_t *table);
+	static void csvee_group_clear(CSVGroupTable_t *table);
+	static void csvee_group_free(CSVGroupTable_t *table);
+
+	static bool csvee_join_add(CSVJoinTable_t *table, const char *key, size_t key_len, const char *fields, size_t size);
+	static size_t csvee_join_bytes(const CSVJoinTable_t *table);
+	static void csvee_join_clear(CSVJoinTable_t *table);
+	static void csvee_join_free(CSVJoinTable_t *table);
+	static bool csvee_join_probe(CSVJoinJob_t *job, const char *data, size_t size, CSVBuffer_t *lines);
+	static bool csvee_join_leftovers(CSVJoinJob_t *job);
+	static bool csvee_digest_add(CSVSketch_t *sketch, double value, double weight);
+	static void csvee_digest_compress(CSVSketch_t *sketch);
+	static void csvee_profile_init(CSVProfile_t *profile, size_t top_k, double compression);
+	static bool csvee_profile_widen(CSVProfile_t *profile, size_t count);
+	static bool csvee_profile_consume(CSVProfile_t *profile, const char *data, size_t size);
+	static void csvee_profile_finish(CSVProfile_t *profile);
+	static bool csvee_arrow_names(CSVArrowBuilder_t *builder, const CSVRow_t *row);
+	static bool csvee_arrow_add(CSVArrowBuilder_t *builder, const CSVRow_t *row);
+	static bool csvee_arrow_finish(CSVArrowBuilder_t *builder, struct ArrowSchema *schema, struct ArrowArray *array);
+	static void csvee_arrow_builder_free(CSVArrowBuilder_t *builder);
+	static bool csvee_columnar_add(CSVColumnarWriter_t *writer, const CSVRow_t *row);
+	static bool csvee_columnar_flush(CSVColumnarWriter_t *writer);
+	static bool csvee_columnar_finish(CSVColumnarWriter_t *writer);
+	static void csvee_columnar_writer_free(CSVColumnarWriter_t *writer);
+	static bool csvee_columnar_open(CSVColumnarFile_t *file, const char *path);
+	static bool csvee_columnar_decode(const CSVColumnarFile_t *file, size_t group, size_t column, CSVChunkView_t *view);
+	static void csvee_columnar_close(CSVColumnarFile_t *file);
+
 	//-----------------------------------------------------------------------------
 	// [SECTION] Definations
 	//-----------------------------------------------------------------------------
 
 	/* Return first row (non-advancing helper). */
-	CSVRow_t *csvee_row_first(const Csvee_t *csvee)
+	CSVRow_t *csvee_row_first(Csvee_t *csvee)
 	{
 		if (csvee == NULL || csvee->count == 0)
 			return NULL;
-		return &csvee->rows[0];
+		return csvee_row_at(csvee, 0);
 	}
 
 	/* Return first field of a row (non-advancing helper). */
@@ -1416,20 +3589,27 @@ extern "C"
 	{
 		CSVRow_t row;
 		row.fields = (CSVField_t *)malloc(field_count * sizeof(CSVField_t));
+		row.capacity = field_count;
 		row.count = field_count;
 		return row;
 	}
 
+	/* Copy of row @p row (from 1), to free with csvee_row_free(); it stays valid whatever the table pages out. */
 	CSVRow_t csvee_get_row(Csvee_t *csvee, size_t row)
 	{
 		CSVRow_t nrow = csvee_create_row(0);
 
-		if (csvee->count < row)
+		if (row == 0 || csvee->count < row)
 		{
 			return nrow;
 		}
 
-		nrow = csvee->rows[row - 1];
+		CSVRow_t *found = csvee_row_at(csvee, row - 1);
+		if (found)
+		{
+			free(nrow.fields);
+			csvee_row_copy(&nrow, found);
+		}
 		return nrow;
 	};
 
@@ -1444,6 +3624,29 @@ extern "C"
 		free(row->fields);
 	}
 
+	/* Deep copy of @p from into @p to, with exactly sized fields; @p to is left empty on failure. */
+	static bool csvee_row_copy(CSVRow_t *to, const CSVRow_t *from)
+	{
+		to->fields = (CSVField_t *)malloc(from->count * sizeof(CSVField_t) + 1);
+		to->capacity = from->count;
+		to->count = 0;
+		bool ok = to->fields != NULL;
+		for (size_t f = 0; ok && f < from->count; ++f)
+		{
+			to->fields[f] = from->fields[f];
+			if (from->fields[f].type == CSVEE_STRING && from->fields[f].value._string)
+				ok = (to->fields[f].value._string = strdup(from->fields[f].value._string)) != NULL;
+			to->count += ok;
+		}
+		if (!ok)
+		{
+			csvee_row_free(to);
+			to->fields = NULL;
+			to->capacity = 0;
+		}
+		return ok;
+	}
+
 	CSVField_t csvee_create_field(const char *value)
 	{
 		CSVField_t field;
@@ -1471,316 +3674,8711 @@ extern "C"
 		field->type = CSVEE_NULL;
 	}
 
-#ifdef __cplusplus
-};
-#endif // __cplusplus
-
-//-----------------------------------------------------------------------------
-// [SECTION] C++ Only Classes
+	/* Like csvee_create_field() but copies exactly @p size bytes. */
+	static CSVField_t csvee_create_field_n(const char *value, size_t size)
+	{
+		CSVField_t field;
+		field.type = CSVEE_STRING;
+		field.value._string = (char *)malloc(size + 1);
+		if (field.value._string)
+		{
+			if (size)
+				memcpy(field.value._string, value, size);
+			field.value._string[size] = '\0';
+		}
+		return field;
+	}
+
+	static bool csvee_row_push_field(CSVRow_t *row, CSVField_t field)
+	{
+		if (row->count >= row->capacity || row->fields == NULL)
+		{
+			size_t capacity = row->capacity ? row->capacity * 2 : 8;
+			CSVField_t *fields = (CSVField_t *)realloc(row->fields, capacity * sizeof(CSVField_t));
+			if (!fields)
+				return false;
+			row->fields = fields;
+			row->capacity = capacity;
+		}
+		row->fields[row->count++] = field;
+		return true;
+	}
+
+	/* Append @p row to the table, taking ownership of its fields. */
+	static bool csvee_push_row(Csvee_t *csvee, CSVRow_t *row)
+	{
+		if (csvee->share && !csvee_share_unshare(csvee, csvee->count / CSVEE_SHARE_BLOCK_ROWS))
+			return false;
+		if (csvee->rows == NULL || csvee->count >= csvee->capacity)
+		{
+			size_t capacity = csvee->rows ? csvee->capacity * 2 : 16;
+			CSVRow_t *rows = (CSVRow_t *)realloc(csvee->rows, capacity * sizeof(CSVRow_t));
+			if (!rows)
+				return false;
+			csvee->stats.allocations++;
+			csvee->stats.bytes_allocated += (capacity - (csvee->rows ? csvee->capacity : 0)) * sizeof(CSVRow_t);
+			csvee->rows = rows;
+			csvee->capacity = capacity;
+		}
+		csvee->rows[csvee->count++] = *row;
+
+		/* the table owns the fields from here on, even if spilling fails */
+		row->fields = NULL;
+		row->count = 0;
+		return !csvee->spill || csvee_spill_track(csvee);
+	}
+
+	/* CSVRowCallback_t that appends into the Csvee_t passed as @p user. */
+	static bool csvee_append_row_cb(void *user, CSVRow_t *row)
+	{
+		if (csvee_push_row((Csvee_t *)user, row))
+			return true;
+		csvee_row_free(row);
+		return false;
+	}
+
+	/* Allocate an empty table with the default "excel" dialect. */
+	Csvee_t *csvee_new(char delimiter)
+	{
+		Csvee_t *csvee = (Csvee_t *)malloc(sizeof(Csvee_t));
+		if (!csvee)
+			return NULL;
+
+		CSVDialect_t *dialect = (CSVDialect_t *)malloc(sizeof(CSVDialect_t));
+		if (!dialect)
+		{
+			free(csvee);
+			return NULL;
+		}
+
+		csvee_dialect_init(dialect, (char *)"excel", delimiter, '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+		csvee_init(csvee, dialect);
+		return csvee;
+	}
+
+#ifndef CSVEE_NO_THREADS
+
+#if CSVEE_PLATFORM_IS(WINDOWS)
+	static DWORD WINAPI csvee_thread_trampoline(LPVOID param)
+#else
+	static void *csvee_thread_trampoline(void *param)
+#endif
+	{
+		CSVThreadStart_t start = *(CSVThreadStart_t *)param;
+		free(param);
+		start.fn(start.arg);
+		return 0;
+	}
+
+	static bool csvee_thread_create(csvee_thread_t *thread, void (*fn)(void *arg), void *arg)
+	{
+		CSVThreadStart_t *start = (CSVThreadStart_t *)malloc(sizeof(CSVThreadStart_t));
+		if (!start)
+			return false;
+		start->fn = fn;
+		start->arg = arg;
+#if CSVEE_PLATFORM_IS(WINDOWS)
+		*thread = CreateThread(NULL, 0, csvee_thread_trampoline, start, 0, NULL);
+		if (*thread == NULL)
+#else
+		if (pthread_create(thread, NULL, csvee_thread_trampoline, start) != 0)
+#endif
+		{
+			free(start);
+			return false;
+		}
+		return true;
+	}
+
+#if CSVEE_PLATFORM_IS(WINDOWS)
+	static void csvee_thread_join(csvee_thread_t thread)
+	{
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+	static void csvee_mutex_init(csvee_mutex_t *mutex) { InitializeSRWLock(mutex); }
+	static void csvee_mutex_lock(csvee_mutex_t *mutex) { AcquireSRWLockExclusive(mutex); }
+	static void csvee_mutex_unlock(csvee_mutex_t *mutex) { ReleaseSRWLockExclusive(mutex); }
+	static void csvee_mutex_destroy(csvee_mutex_t *mutex) { (void)mutex; }
+	static void csvee_cond_init(csvee_cond_t *cond) { InitializeConditionVariable(cond); }
+	static void csvee_cond_wait(csvee_cond_t *cond, csvee_mutex_t *mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+	static void csvee_cond_signal(csvee_cond_t *cond) { WakeConditionVariable(cond); }
+	static void csvee_cond_broadcast(csvee_cond_t *cond) { WakeAllConditionVariable(cond); }
+	static void csvee_cond_destroy(csvee_cond_t *cond) { (void)cond; }
+#else
+	static void csvee_thread_join(csvee_thread_t thread) { pthread_join(thread, NULL); }
+	static void csvee_mutex_init(csvee_mutex_t *mutex) { pthread_mutex_init(mutex, NULL); }
+	static void csvee_mutex_lock(csvee_mutex_t *mutex) { pthread_mutex_lock(mutex); }
+	static void csvee_mutex_unlock(csvee_mutex_t *mutex) { pthread_mutex_unlock(mutex); }
+	static void csvee_mutex_destroy(csvee_mutex_t *mutex) { pthread_mutex_destroy(mutex); }
+	static void csvee_cond_init(csvee_cond_t *cond) { pthread_cond_init(cond, NULL); }
+	static void csvee_cond_wait(csvee_cond_t *cond, csvee_mutex_t *mutex) { pthread_cond_wait(cond, mutex); }
+	static void csvee_cond_signal(csvee_cond_t *cond) { pthread_cond_signal(cond); }
+	static void csvee_cond_broadcast(csvee_cond_t *cond) { pthread_cond_broadcast(cond); }
+	static void csvee_cond_destroy(csvee_cond_t *cond) { pthread_cond_destroy(cond); }
+#endif
+
+	static size_t csvee_cpu_count(void)
+	{
+#if CSVEE_PLATFORM_IS(WINDOWS)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		return count > 0 ? (size_t)count : 1;
+#endif
+	}
+
+#endif // CSVEE_NO_THREADS
+
+	static bool csvee_inflate_init(CSVInflate_t *decoder, FILE *file, CSVCodec_t codec)
+	{
+		memset(decoder, 0, sizeof(*decoder));
+		decoder->codec = codec;
+		decoder->file = file;
+		decoder->input = (unsigned char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		if (!decoder->input)
+			return false;
+
+		switch (codec)
+		{
+#ifdef CSVEE_WITH_ZLIB
+		case CSVEE_CODEC_GZIP:
+			/* 15 + 32: maximum window, detect gzip or zlib header */
+			if (inflateInit2(&decoder->zs, 15 + 32) == Z_OK)
+				return true;
+			break;
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		case CSVEE_CODEC_ZSTD:
+			decoder->zd = ZSTD_createDCtx();
+			if (decoder->zd)
+				return true;
+			break;
+#endif
+		default:
+			break;
+		}
+
+		free(decoder->input);
+		decoder->input = NULL;
+		return false;
+	}
+
+	/* Fill @p out with decompressed bytes; returns 0 at end of input or on error (see ->failed). */
+	static size_t csvee_inflate_read(CSVInflate_t *decoder, char *out, size_t capacity)
+	{
+		if (decoder->failed)
+			return 0;
+
+		switch (decoder->codec)
+		{
+#ifdef CSVEE_WITH_ZLIB
+		case CSVEE_CODEC_GZIP:
+		{
+			z_stream *zs = &decoder->zs;
+			zs->next_out = (Bytef *)out;
+			zs->avail_out = (uInt)capacity;
+			while (zs->avail_out > 0)
+			{
+				if (zs->avail_in == 0)
+				{
+					size_t n = decoder->input_eof ? 0 : fread(decoder->input, 1, CSVEE_READ_BUFFER_SIZE, decoder->file);
+					if (n == 0)
+					{
+						decoder->input_eof = true;
+						decoder->failed = decoder->member_open || ferror(decoder->file);
+						break;
+					}
+					zs->next_in = decoder->input;
+					zs->avail_in = (uInt)n;
+				}
+
+				decoder->member_open = true;
+				int rc = inflate(zs, Z_NO_FLUSH);
+				if (rc == Z_STREAM_END)
+				{
+					/* concatenated gzip members decode as one stream */
+					decoder->member_open = false;
+					inflateReset(zs);
+				}
+				else if (rc != Z_OK && !(rc == Z_BUF_ERROR && zs->avail_in == 0))
+				{
+					decoder->failed = true;
+					break;
+				}
+			}
+			return capacity - zs->avail_out;
+		}
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		case CSVEE_CODEC_ZSTD:
+		{
+			ZSTD_outBuffer zout = {out, capacity, 0};
+			while (zout.pos < zout.size)
+			{
+				if (decoder->zin.pos == decoder->zin.size)
+				{
+					size_t n = decoder->input_eof ? 0 : fread(decoder->input, 1, CSVEE_READ_BUFFER_SIZE, decoder->file);
+					if (n == 0)
+					{
+						decoder->input_eof = true;
+						decoder->failed = decoder->member_open || ferror(decoder->file);
+						break;
+					}
+					decoder->zin.src = decoder->input;
+					decoder->zin.size = n;
+					decoder->zin.pos = 0;
+				}
+
+				size_t rc = ZSTD_decompressStream(decoder->zd, &zout, &decoder->zin);
+				if (ZSTD_isError(rc))
+				{
+					decoder->failed = true;
+					break;
+				}
+				decoder->member_open = rc != 0;
+			}
+			return zout.pos;
+		}
+#endif
+		default:
+			(void)out;
+			(void)capacity;
+			decoder->failed = true;
+			return 0;
+		}
+	}
+
+	static void csvee_inflate_end(CSVInflate_t *decoder)
+	{
+#ifdef CSVEE_WITH_ZLIB
+		if (decoder->codec == CSVEE_CODEC_GZIP && decoder->input)
+			inflateEnd(&decoder->zs);
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		if (decoder->zd)
+			ZSTD_freeDCtx(decoder->zd);
+		decoder->zd = NULL;
+#endif
+		free(decoder->input);
+		decoder->input = NULL;
+	}
+
+	/* Feed an uncompressed file to the tokenizer in CSVEE_READ_BUFFER_SIZE chunks. */
+	static bool csvee_read_plain(FILE *file, CSVParser_t *parser)
+	{
+		char *buffer = (char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		if (!buffer)
+			return false;
+
+		bool ok = true;
+		for (;;)
+		{
+			uint64_t start_ns = csvee_now_ns();
+			size_t n = fread(buffer, 1, CSVEE_READ_BUFFER_SIZE, file);
+			parser->stats.io_ns += csvee_now_ns() - start_ns;
+			if (n == 0 || !(ok = csvee_parser_feed(parser, buffer, n)))
+				break;
+		}
+
+		if (ferror(file))
+			ok = false;
+
+		free(buffer);
+		return ok;
+	}
+
+#ifndef CSVEE_NO_THREADS
+	/* Decompression thread: fills free ring slots until the input is exhausted. */
+	static void csvee_ring_producer(void *arg)
+	{
+		CSVRing_t *ring = (CSVRing_t *)arg;
+		for (;;)
+		{
+			csvee_mutex_lock(&ring->lock);
+			while (ring->filled == CSVEE_RING_SIZE && !ring->cancelled)
+				csvee_cond_wait(&ring->not_full, &ring->lock);
+			if (ring->cancelled)
+			{
+				csvee_mutex_unlock(&ring->lock);
+				return;
+			}
+			size_t slot = ring->tail;
+			csvee_mutex_unlock(&ring->lock);
+
+			/* the slot belongs to this thread until it is published */
+			uint64_t start_ns = csvee_now_ns();
+			size_t n = csvee_inflate_read(ring->decoder, ring->slots[slot].data, CSVEE_READ_BUFFER_SIZE);
+			uint64_t spent_ns = csvee_now_ns() - start_ns;
+
+			csvee_mutex_lock(&ring->lock);
+			ring->busy_ns += spent_ns;
+			if (n > 0)
+			{
+				ring->slots[slot].size = n;
+				ring->tail = (ring->tail + 1) % CSVEE_RING_SIZE;
+				ring->filled++;
+			}
+			if (n == 0 || ring->decoder->failed)
+				ring->done = true;
+			csvee_cond_signal(&ring->not_empty);
+			csvee_mutex_unlock(&ring->lock);
+
+			if (ring->done)
+				return;
+		}
+	}
+#endif // CSVEE_NO_THREADS
+
+	/* Decompress on a worker thread into a ring of buffers while this thread tokenizes. */
+	static bool csvee_read_compressed(FILE *file, CSVCodec_t codec, CSVParser_t *parser)
+	{
+		CSVInflate_t decoder;
+		if (!csvee_inflate_init(&decoder, file, codec))
+			return false;
+
+		CSVRing_t ring;
+		memset(&ring, 0, sizeof(ring));
+		ring.decoder = &decoder;
+
+		bool ok = true;
+		for (size_t i = 0; i < CSVEE_RING_SIZE && ok; ++i)
+			ok = (ring.slots[i].data = (char *)malloc(CSVEE_READ_BUFFER_SIZE)) != NULL;
+
+#ifndef CSVEE_NO_THREADS
+		csvee_thread_t producer;
+		bool threaded = false;
+		if (ok)
+		{
+			csvee_mutex_init(&ring.lock);
+			csvee_cond_init(&ring.not_empty);
+			csvee_cond_init(&ring.not_full);
+			threaded = csvee_thread_create(&producer, csvee_ring_producer, &ring);
+		}
+
+		if (threaded)
+		{
+			for (;;)
+			{
+				csvee_mutex_lock(&ring.lock);
+				while (ring.filled == 0 && !ring.done)
+					csvee_cond_wait(&ring.not_empty, &ring.lock);
+				if (ring.filled == 0 || !ok)
+				{
+					ring.cancelled = true;
+					csvee_cond_signal(&ring.not_full);
+					csvee_mutex_unlock(&ring.lock);
+					break;
+				}
+				size_t slot = ring.head;
+				csvee_mutex_unlock(&ring.lock);
+
+				ok = csvee_parser_feed(parser, ring.slots[slot].data, ring.slots[slot].size);
+
+				csvee_mutex_lock(&ring.lock);
+				ring.head = (ring.head + 1) % CSVEE_RING_SIZE;
+				ring.filled--;
+				csvee_cond_signal(&ring.not_full);
+				csvee_mutex_unlock(&ring.lock);
+			}
+			csvee_thread_join(producer);
+			parser->stats.io_ns += ring.busy_ns;
+		}
+		else
+#endif // CSVEE_NO_THREADS
+		{
+			/* single threaded fallback: decompress and tokenize in turn */
+			while (ok)
+			{
+				uint64_t start_ns = csvee_now_ns();
+				size_t n = csvee_inflate_read(&decoder, ring.slots[0].data, CSVEE_READ_BUFFER_SIZE);
+				parser->stats.io_ns += csvee_now_ns() - start_ns;
+				if (n == 0)
+					break;
+				ok = csvee_parser_feed(parser, ring.slots[0].data, n);
+			}
+		}
+
+#ifndef CSVEE_NO_THREADS
+		if (ring.slots[CSVEE_RING_SIZE - 1].data)
+		{
+			csvee_cond_destroy(&ring.not_full);
+			csvee_cond_destroy(&ring.not_empty);
+			csvee_mutex_destroy(&ring.lock);
+		}
+#endif // CSVEE_NO_THREADS
+
+		if (decoder.failed)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(IO_ERROR, "Corrupt or truncated compressed input\n");
+#endif // CSVEE_DEBUG
+			ok = false;
+		}
+
+		for (size_t i = 0; i < CSVEE_RING_SIZE; ++i)
+			free(ring.slots[i].data);
+		csvee_inflate_end(&decoder);
+		return ok;
+	}
+
+	static void csvee_scan_init(CSVScan_t *scan, const CSVDialect_t *dialect)
+	{
+		memset(scan, 0, sizeof(*scan));
+		scan->delimiter = dialect->delimiter;
+		scan->quotechar = dialect->quotechar;
+		scan->doublequote = dialect->doublequote;
+		scan->skipwhitespace = dialect->skipwhitespace;
+		scan->close_at = UINT64_MAX;
+		scan->escape_at = UINT64_MAX;
+		scan->cr_at = UINT64_MAX;
+		scan->columns = 1;
+		scan->min_columns = SIZE_MAX;
+	}
+
+	/* True if [from, to) is empty, or only whitespace the tokenizer would skip. */
+	static bool csvee_scan_gap(const CSVScan_t *scan, const char *data, uint64_t from, uint64_t to)
+	{
+		if (from == to)
+			return true;
+		if (!scan->skipwhitespace)
+			return false;
+		if (from < scan->offset)
+		{
+			/* the gap starts in an earlier chunk */
+			if (from < scan->ws_from)
+				return false;
+			from = scan->offset;
+		}
+		for (uint64_t at = from; at < to; ++at)
+		{
+			char ch = data[at - scan->offset];
+			if ((ch != ' ' && ch != '\t') || ch == scan->delimiter)
+				return false;
+		}
+		return true;
+	}
+
+	static void csvee_scan_end_row(CSVScan_t *scan, const char *data, uint64_t at)
+	{
+		/* blank lines produce no row, as in csvee_parser_end_row() */
+		if (scan->columns > 1 || scan->row_quoted || !csvee_scan_gap(scan, data, scan->row_start, at))
+		{
+			scan->rows++;
+			if (scan->spans)
+			{
+				uint64_t span[2] = {scan->row_start, at};
+				scan->failed |= !csvee_buffer_append(scan->spans, (const char *)span, sizeof(span));
+			}
+			if (scan->columns < scan->min_columns)
+				scan->min_columns = scan->columns;
+			if (scan->columns > scan->max_columns)
+				scan->max_columns = scan->columns;
+		}
+		scan->columns = 1;
+		scan->row_quoted = false;
+		scan->row_start = scan->field_start = at + 1;
+	}
+
+	/* Step the quote state machine of csvee_parser_scan() over one structural byte. */
+	static void csvee_scan_hit(CSVScan_t *scan, const char *data, size_t i)
+	{
+		uint64_t at = scan->offset + i;
+		char ch = data[i];
+
+		if (scan->in_quotes)
+		{
+			if (at == scan->escape_at)
+				return;
+			if (ch == scan->quotechar)
+			{
+				scan->in_quotes = false;
+				scan->close_at = at + 1;
+			}
+			else if (ch == '\\' && !scan->doublequote)
+				scan->escape_at = at + 1;
+			else if (ch == '\n' || ch == '\r')
+				scan->quoted_newlines = true;
+			return;
+		}
+
+		if (ch == scan->quotechar)
+		{
+			/* opens a field, or is the second half of a doubled quote; elsewhere it is literal */
+			if ((at == scan->close_at && scan->doublequote) || csvee_scan_gap(scan, data, scan->field_start, at))
+			{
+				scan->in_quotes = true;
+				scan->row_quoted = true;
+			}
+		}
+		else if (ch == scan->delimiter)
+		{
+			scan->columns++;
+			scan->field_start = at + 1;
+		}
+		else if (ch == '\n' && at == scan->cr_at)
+		{
+			scan->cr--;
+			scan->crlf++;
+			scan->row_start = scan->field_start = at + 1;
+		}
+		else if (ch == '\n' || ch == '\r')
+		{
+			if (ch == '\r')
+			{
+				scan->cr++;
+				scan->cr_at = at + 1;
+			}
+			else
+				scan->lf++;
+			csvee_scan_end_row(scan, data, at);
+		}
+	}
+
+#if defined(CSVEE_SIMD_SSE2)
+	/* Bit i is set when p[i] is a delimiter, quote, escape or line end. */
+	static inline uint32_t csvee_scan_mask(const char *p, char delim, char quote, char escape)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)p);
+		__m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(delim)), _mm_cmpeq_epi8(block, _mm_set1_epi8(quote)));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(escape)));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')));
+		return (uint32_t)_mm_movemask_epi8(hits);
+	}
+#elif defined(CSVEE_SIMD_NEON)
+	static inline uint32_t csvee_scan_mask(const char *p, char delim, char quote, char escape)
+	{
+		static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+		uint8x16_t block = vld1q_u8((const uint8_t *)p);
+		uint8x16_t hits = vorrq_u8(vceqq_u8(block, vdupq_n_u8((uint8_t)delim)), vceqq_u8(block, vdupq_n_u8((uint8_t)quote)));
+		hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8((uint8_t)escape)));
+		hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8('\n')));
+		hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8('\r')));
+		hits = vandq_u8(hits, vld1q_u8(weights));
+		return (uint32_t)vaddv_u8(vget_low_u8(hits)) | ((uint32_t)vaddv_u8(vget_high_u8(hits)) << 8);
+	}
+#endif
+
+	static void csvee_scan_feed(CSVScan_t *scan, const char *data, size_t size)
+	{
+		const char delim = scan->delimiter;
+		const char quote = scan->quotechar;
+		const char escape = scan->doublequote ? quote : '\\';
+		size_t i = 0;
+
+#if defined(CSVEE_SIMD_SSE2) || defined(CSVEE_SIMD_NEON)
+		/* most bytes are field content: only visit the structural ones */
+		for (; i + 32 <= size; i += 32)
+		{
+			uint32_t mask = csvee_scan_mask(data + i, delim, quote, escape) |
+							(csvee_scan_mask(data + i + 16, delim, quote, escape) << 16);
+			while (mask)
+			{
+				csvee_scan_hit(scan, data, i + CSVEE_CTZ(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+		for (; i < size; ++i)
+		{
+			char ch = data[i];
+			if (ch == delim || ch == quote || ch == escape || ch == '\n' || ch == '\r')
+				csvee_scan_hit(scan, data, i);
+		}
+
+		if (scan->skipwhitespace)
+		{
+			size_t run = size;
+			while (run > 0 && (data[run - 1] == ' ' || data[run - 1] == '\t') && data[run - 1] != delim)
+				--run;
+			if (run > 0)
+				scan->ws_from = scan->offset + run;
+		}
+		scan->offset += size;
+	}
+
+	/* Count a final row that was not terminated by a newline. */
+	static void csvee_scan_finish(CSVScan_t *scan)
+	{
+		if (scan->offset > scan->row_start || scan->row_quoted)
+			csvee_scan_end_row(scan, NULL, scan->offset);
+		if (scan->min_columns == SIZE_MAX)
+			scan->min_columns = 0;
+	}
+
+	static bool csvee_deflate_init(CSVDeflate_t *encoder, FILE *file, CSVCodec_t codec, int level)
+	{
+		memset(encoder, 0, sizeof(*encoder));
+		encoder->codec = codec;
+		encoder->file = file;
+		if (codec == CSVEE_CODEC_NONE)
+			return true;
+
+		encoder->output = (unsigned char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		if (!encoder->output)
+			return false;
+
+		switch (codec)
+		{
+#ifdef CSVEE_WITH_ZLIB
+		case CSVEE_CODEC_GZIP:
+			/* 15 + 16: maximum window, gzip wrapper */
+			if (deflateInit2(&encoder->zs, level ? level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+				return true;
+			break;
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		case CSVEE_CODEC_ZSTD:
+			encoder->zc = ZSTD_createCCtx();
+			if (encoder->zc && !ZSTD_isError(ZSTD_CCtx_setParameter(encoder->zc, ZSTD_c_compressionLevel, level)))
+				return true;
+			break;
+#endif
+		default:
+			(void)level;
+			break;
+		}
+
+		free(encoder->output);
+		encoder->output = NULL;
+		return false;
+	}
+
+	/* Compress @p data to the file; @p finish terminates the stream. */
+	static bool csvee_deflate_write(CSVDeflate_t *encoder, const char *data, size_t size, bool finish)
+	{
+		if (encoder->failed)
+			return false;
+
+		switch (encoder->codec)
+		{
+		case CSVEE_CODEC_NONE:
+			(void)finish;
+			encoder->failed = size && fwrite(data, 1, size, encoder->file) != size;
+			break;
+#ifdef CSVEE_WITH_ZLIB
+		case CSVEE_CODEC_GZIP:
+		{
+			z_stream *zs = &encoder->zs;
+			zs->next_in = (Bytef *)data;
+			zs->avail_in = (uInt)size;
+			for (;;)
+			{
+				zs->next_out = encoder->output;
+				zs->avail_out = CSVEE_READ_BUFFER_SIZE;
+				int rc = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+				if (rc == Z_STREAM_ERROR)
+				{
+					encoder->failed = true;
+					break;
+				}
+				size_t have = CSVEE_READ_BUFFER_SIZE - zs->avail_out;
+				if (have && fwrite(encoder->output, 1, have, encoder->file) != have)
+				{
+					encoder->failed = true;
+					break;
+				}
+				if (finish ? rc == Z_STREAM_END : zs->avail_out != 0)
+					break;
+			}
+			break;
+		}
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		case CSVEE_CODEC_ZSTD:
+		{
+			ZSTD_inBuffer zin = {data, size, 0};
+			for (;;)
+			{
+				ZSTD_outBuffer zout = {encoder->output, CSVEE_READ_BUFFER_SIZE, 0};
+				size_t remaining = ZSTD_compressStream2(encoder->zc, &zout, &zin, finish ? ZSTD_e_end : ZSTD_e_continue);
+				if (ZSTD_isError(remaining) ||
+					(zout.pos && fwrite(encoder->output, 1, zout.pos, encoder->file) != zout.pos))
+				{
+					encoder->failed = true;
+					break;
+				}
+				if (finish ? remaining == 0 : zin.pos == zin.size)
+					break;
+			}
+			break;
+		}
+#endif
+		default:
+			encoder->failed = true;
+			break;
+		}
+		return !encoder->failed;
+	}
+
+	static void csvee_deflate_end(CSVDeflate_t *encoder)
+	{
+#ifdef CSVEE_WITH_ZLIB
+		if (encoder->codec == CSVEE_CODEC_GZIP && encoder->output)
+			deflateEnd(&encoder->zs);
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		if (encoder->zc)
+			ZSTD_freeCCtx(encoder->zc);
+		encoder->zc = NULL;
+#endif
+		free(encoder->output);
+		encoder->output = NULL;
+	}
+
+#ifndef CSVEE_NO_THREADS
+	/* Compression thread: drains published blocks into the encoder, finishing the stream once done. */
+	static void csvee_ring_consumer(void *arg)
+	{
+		CSVRing_t *ring = (CSVRing_t *)arg;
+		for (;;)
+		{
+			csvee_mutex_lock(&ring->lock);
+			while (ring->filled == 0 && !ring->done)
+				csvee_cond_wait(&ring->not_empty, &ring->lock);
+			if (ring->filled == 0)
+			{
+				csvee_mutex_unlock(&ring->lock);
+				uint64_t start_ns = csvee_now_ns();
+				csvee_deflate_write(ring->encoder, NULL, 0, true);
+				ring->busy_ns += csvee_now_ns() - start_ns;
+				return;
+			}
+			size_t slot = ring->head;
+			csvee_mutex_unlock(&ring->lock);
+
+			uint64_t start_ns = csvee_now_ns();
+			bool ok = csvee_deflate_write(ring->encoder, ring->slots[slot].data, ring->slots[slot].size, false);
+			uint64_t spent_ns = csvee_now_ns() - start_ns;
+
+			csvee_mutex_lock(&ring->lock);
+			ring->busy_ns += spent_ns;
+			ring->slots[slot].size = 0;
+			ring->head = (ring->head + 1) % CSVEE_RING_SIZE;
+			ring->filled--;
+			if (!ok)
+				ring->cancelled = true;
+			csvee_cond_signal(&ring->not_full);
+			csvee_mutex_unlock(&ring->lock);
+
+			if (!ok)
+				return;
+		}
+	}
+
+	/* Hand @p block to the compression thread, receiving an empty buffer in exchange. */
+	static bool csvee_ring_publish(CSVRing_t *ring, CSVBuffer_t *block)
+	{
+		csvee_mutex_lock(&ring->lock);
+		while (ring->filled == CSVEE_RING_SIZE && !ring->cancelled)
+			csvee_cond_wait(&ring->not_full, &ring->lock);
+		bool ok = !ring->cancelled;
+		if (ok)
+		{
+			CSVBuffer_t empty = ring->slots[ring->tail];
+			ring->slots[ring->tail] = *block;
+			*block = empty;
+			block->size = 0;
+			ring->tail = (ring->tail + 1) % CSVEE_RING_SIZE;
+			ring->filled++;
+			csvee_cond_signal(&ring->not_empty);
+		}
+		csvee_mutex_unlock(&ring->lock);
+		return ok;
+	}
+
+	/* Take the oldest published buffer, leaving @p block's storage in its slot; false once the ring is finished or cancelled. */
+	static bool csvee_ring_take(CSVRing_t *ring, CSVBuffer_t *block)
+	{
+		csvee_mutex_lock(&ring->lock);
+		while (ring->filled == 0 && !ring->done && !ring->cancelled)
+			csvee_cond_wait(&ring->not_empty, &ring->lock);
+		bool ok = ring->filled > 0 && !ring->cancelled;
+		if (ok)
+		{
+			CSVBuffer_t full = ring->slots[ring->head];
+			ring->slots[ring->head] = *block;
+			ring->slots[ring->head].size = 0;
+			*block = full;
+			ring->head = (ring->head + 1) % CSVEE_RING_SIZE;
+			ring->filled--;
+			csvee_cond_signal(&ring->not_full);
+		}
+		csvee_mutex_unlock(&ring->lock);
+		return ok;
+	}
+#endif // CSVEE_NO_THREADS
+
+	/* Output options implied by the extension of @p filename. */
+	static CSVWriteOptions_t csvee_write_options_for(const char *filename)
+	{
+		CSVWriteOptions_t options = {CSVEE_CODEC_NONE, 0, 0};
+		size_t fnlen = strlen(filename);
+		if (fnlen >= 3 && strcasecmp(filename + fnlen - 3, ".gz") == 0)
+			options.codec = CSVEE_CODEC_GZIP;
+		else if (fnlen >= 4 && strcasecmp(filename + fnlen - 4, ".zst") == 0)
+			options.codec = CSVEE_CODEC_ZSTD;
+		return options;
+	}
+
+	static bool csvee_sink_open(CSVSink_t *sink, const char *filename, const CSVWriteOptions_t *options, CSVStat_t *stats)
+	{
+		memset(sink, 0, sizeof(*sink));
+		sink->stats = stats;
+		sink->block_size = options && options->block_size ? options->block_size : CSVEE_WRITE_BLOCK_SIZE;
+
+		CSVCodec_t codec = options ? options->codec : CSVEE_CODEC_NONE;
+		if (!csvee_codec_supported(codec))
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FILE, "csvee was built without support for the codec requested for %s\n", filename);
+#endif // CSVEE_DEBUG
+			return false;
+		}
+
+		sink->file = fopen(filename, "wb");
+		if (!sink->file)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(NULL_FILE, "Could not open file %s for writing\n", filename);
+#endif // CSVEE_DEBUG
+			return false;
+		}
+
+		if (!csvee_deflate_init(&sink->encoder, sink->file, codec, options ? options->level : 0))
+		{
+			fclose(sink->file);
+			sink->file = NULL;
+			return false;
+		}
+		sink->ring.encoder = &sink->encoder;
+
+#ifndef CSVEE_NO_THREADS
+		/* the caller formats while a worker compresses the previous blocks */
+		if (codec != CSVEE_CODEC_NONE)
+		{
+			csvee_mutex_init(&sink->ring.lock);
+			csvee_cond_init(&sink->ring.not_empty);
+			csvee_cond_init(&sink->ring.not_full);
+			sink->threaded = csvee_thread_create(&sink->consumer, csvee_ring_consumer, &sink->ring);
+			if (!sink->threaded)
+			{
+				csvee_cond_destroy(&sink->ring.not_full);
+				csvee_cond_destroy(&sink->ring.not_empty);
+				csvee_mutex_destroy(&sink->ring.lock);
+			}
+		}
+#endif // CSVEE_NO_THREADS
+		return true;
+	}
+
+	/* Hand sink->block over to be compressed and written. */
+	static bool csvee_sink_flush(CSVSink_t *sink)
+	{
+		uint64_t flush_ns = csvee_now_ns();
+		sink->stats->bytes_written += sink->block.size;
+#ifndef CSVEE_NO_THREADS
+		if (sink->threaded)
+		{
+			bool ok = csvee_ring_publish(&sink->ring, &sink->block);
+			sink->waited_ns += csvee_now_ns() - flush_ns;
+			return ok;
+		}
+#endif // CSVEE_NO_THREADS
+		bool ok = csvee_deflate_write(&sink->encoder, sink->block.data, sink->block.size, false);
+		sink->block.size = 0;
+		sink->stats->io_ns += csvee_now_ns() - flush_ns;
+		return ok;
+	}
+
+	/* Write what is left, finish the stream and close the file. @p ok false abandons the output. */
+	static bool csvee_sink_close(CSVSink_t *sink, bool ok)
+	{
+		if (!sink->file)
+			return false;
+		sink->stats->bytes_written += sink->block.size;
+
+#ifndef CSVEE_NO_THREADS
+		if (sink->threaded)
+		{
+			if (ok && sink->block.size)
+				ok = csvee_ring_publish(&sink->ring, &sink->block);
+
+			csvee_mutex_lock(&sink->ring.lock);
+			sink->ring.done = true;
+			csvee_cond_signal(&sink->ring.not_empty);
+			csvee_mutex_unlock(&sink->ring.lock);
+			csvee_thread_join(sink->consumer);
+			sink->stats->io_ns += sink->ring.busy_ns;
+
+			csvee_cond_destroy(&sink->ring.not_full);
+			csvee_cond_destroy(&sink->ring.not_empty);
+			csvee_mutex_destroy(&sink->ring.lock);
+		}
+		else
+#endif // CSVEE_NO_THREADS
+		{
+			uint64_t flush_ns = csvee_now_ns();
+			if (ok)
+				ok = csvee_deflate_write(&sink->encoder, sink->block.data, sink->block.size, true);
+			sink->stats->io_ns += csvee_now_ns() - flush_ns;
+		}
+
+		ok = ok && !sink->encoder.failed;
+		csvee_buffer_free(&sink->block);
+		for (size_t i = 0; i < CSVEE_RING_SIZE; ++i)
+			csvee_buffer_free(&sink->ring.slots[i]);
+		csvee_deflate_end(&sink->encoder);
+		if (fclose(sink->file) != 0)
+			ok = false;
+		sink->file = NULL;
+		return ok;
+	}
+
+	static bool csvee_buffer_reserve(CSVBuffer_t *buffer, size_t extra)
+	{
+		if (buffer->size + extra <= buffer->capacity)
+			return true;
+		size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+		while (capacity < buffer->size + extra)
+			capacity *= 2;
+		char *data = (char *)realloc(buffer->data, capacity);
+		if (!data)
+			return false;
+		buffer->data = data;
+		buffer->capacity = capacity;
+		return true;
+	}
+
+	static bool csvee_buffer_append(CSVBuffer_t *buffer, const char *data, size_t size)
+	{
+		if (!csvee_buffer_reserve(buffer, size))
+			return false;
+		if (size)
+			memcpy(buffer->data + buffer->size, data, size);
+		buffer->size += size;
+		return true;
+	}
+
+	static void csvee_buffer_free(CSVBuffer_t *buffer)
+	{
+		free(buffer->data);
+		buffer->data = NULL;
+		buffer->size = 0;
+		buffer->capacity = 0;
+	}
+
+	/* Text of a field without allocating; non-string values are printed into @p scratch. */
+	static const char *csvee_field_text(const CSVField_t *field, char *scratch, size_t size)
+	{
+		switch (field->type)
+		{
+		case CSVEE_STRING:
+			return field->value._string ? field->value._string : "";
+		case CSVEE_INTEGER:
+			snprintf(scratch, size, "%d", field->value._integer);
+			return scratch;
+		case CSVEE_DOUBLE:
+			snprintf(scratch, size, "%g", field->value._double);
+			return scratch;
+		case CSVEE_BOOL:
+			return field->value._boolean ? "true" : "false";
+		default:
+			return "";
+		}
+	}
+
+	/* Append one formatted row, quoting fields that contain the delimiter, quote or a line break. */
+	static bool csvee_format_row(CSVBuffer_t *buffer, const CSVRow_t *row, const CSVDialect_t *dialect, char lineterm, CSVStat_t *stats)
+	{
+		char delim = dialect ? dialect->delimiter : CSVEE_SEPERATOR;
+		char quote = dialect ? dialect->quotechar : '"';
+		bool doublequote = dialect ? dialect->doublequote : true;
+		char scratch[128];
+
+		for (size_t c = 0; c < row->count; ++c)
+		{
+			const char *s = csvee_field_text(&row->fields[c], scratch, sizeof(scratch));
+			size_t len = strlen(s);
+
+			size_t quotes = 0;
+			bool need_quote = false;
+			for (size_t i = 0; i < len; ++i)
+			{
+				char ch = s[i];
+				if (ch == quote)
+					quotes++;
+				if (ch == delim || ch == quote || ch == '\n' || ch == '\r')
+					need_quote = true;
+			}
+
+			/* field, two quotes, doubled quotes and the separator */
+			if (!csvee_buffer_reserve(buffer, len + quotes + 3))
+				return false;
+
+			char *out = buffer->data + buffer->size;
+			if (need_quote)
+				*out++ = quote;
+			if (need_quote && doublequote && quotes)
+			{
+				for (size_t i = 0; i < len; ++i)
+				{
+					if (s[i] == quote)
+						*out++ = quote;
+					*out++ = s[i];
+				}
+			}
+			else
+			{
+				memcpy(out, s, len);
+				out += len;
+			}
+			if (need_quote)
+				*out++ = quote;
+			*out++ = c + 1 < row->count ? delim : lineterm;
+			buffer->size = (size_t)(out - buffer->data);
+
+			if (stats && need_quote)
+			{
+				stats->quoted_fields++;
+				stats->escaped_quotes += doublequote ? quotes : 0;
+			}
+		}
+
+		if (stats)
+		{
+			stats->rows++;
+			stats->fields += row->count;
+		}
+
+		if (row->count == 0)
+			return csvee_buffer_append(buffer, &lineterm, 1);
+		return true;
+	}
+
+	static uint64_t csvee_now_ns(void)
+	{
+#if CSVEE_PLATFORM_IS(WINDOWS)
+		LARGE_INTEGER counter, frequency;
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+	}
+
+	static void csvee_stats_merge(CSVStat_t *into, const CSVStat_t *from)
+	{
+		into->bytes_scanned += from->bytes_scanned;
+		into->bytes_written += from->bytes_written;
+		into->rows += from->rows;
+		into->fields += from->fields;
+		into->quoted_fields += from->quoted_fields;
+		into->escaped_quotes += from->escaped_quotes;
+		into->allocations += from->allocations;
+		into->bytes_allocated += from->bytes_allocated;
+		if (from->peak_footprint > into->peak_footprint)
+			into->peak_footprint = from->peak_footprint;
+		into->io_ns += from->io_ns;
+		into->tokenize_ns += from->tokenize_ns;
+		into->materialize_ns += from->materialize_ns;
+		into->convert_ns += from->convert_ns;
+		into->spill_evictions += from->spill_evictions;
+		into->spill_bytes += from->spill_bytes;
+		into->spill_loads += from->spill_loads;
+	}
+
+	static CSVStat_t csvee_global_stat;
+
+	/* Add one operation's counters to the process wide totals, one atomic add per counter. */
+	static void csvee_stats_publish(const CSVStat_t *stats)
+	{
+		CSVStat_t *g = &csvee_global_stat;
+		CSVEE_ATOMIC_ADD(&g->bytes_scanned, stats->bytes_scanned);
+		CSVEE_ATOMIC_ADD(&g->bytes_written, stats->bytes_written);
+		CSVEE_ATOMIC_ADD(&g->rows, stats->rows);
+		CSVEE_ATOMIC_ADD(&g->fields, stats->fields);
+		CSVEE_ATOMIC_ADD(&g->quoted_fields, stats->quoted_fields);
+		CSVEE_ATOMIC_ADD(&g->escaped_quotes, stats->escaped_quotes);
+		CSVEE_ATOMIC_ADD(&g->allocations, stats->allocations);
+		CSVEE_ATOMIC_ADD(&g->bytes_allocated, stats->bytes_allocated);
+		CSVEE_ATOMIC_ADD(&g->io_ns, stats->io_ns);
+		CSVEE_ATOMIC_ADD(&g->tokenize_ns, stats->tokenize_ns);
+		CSVEE_ATOMIC_ADD(&g->materialize_ns, stats->materialize_ns);
+		CSVEE_ATOMIC_ADD(&g->convert_ns, stats->convert_ns);
+		CSVEE_ATOMIC_ADD(&g->spill_evictions, stats->spill_evictions);
+		CSVEE_ATOMIC_ADD(&g->spill_bytes, stats->spill_bytes);
+		CSVEE_ATOMIC_ADD(&g->spill_loads, stats->spill_loads);
+
+		uint64_t peak = CSVEE_ATOMIC_LOAD(&g->peak_footprint);
+		while (stats->peak_footprint > peak && !CSVEE_ATOMIC_CAS(&g->peak_footprint, peak, stats->peak_footprint))
+			peak = CSVEE_ATOMIC_LOAD(&g->peak_footprint);
+	}
+
+	static void csvee_spill_link(CSVSpill_t *spill, size_t b)
+	{
+		CSVSpillBlock_t *block = &spill->blocks[b];
+		block->prev = spill->lru_tail;
+		block->next = SIZE_MAX;
+		if (spill->lru_tail != SIZE_MAX)
+			spill->blocks[spill->lru_tail].next = b;
+		else
+			spill->lru_head = b;
+		spill->lru_tail = b;
+	}
+
+	static void csvee_spill_unlink(CSVSpill_t *spill, size_t b)
+	{
+		CSVSpillBlock_t *block = &spill->blocks[b];
+		if (block->prev != SIZE_MAX)
+			spill->blocks[block->prev].next = block->next;
+		else
+			spill->lru_head = block->next;
+		if (block->next != SIZE_MAX)
+			spill->blocks[block->next].prev = block->prev;
+		else
+			spill->lru_tail = block->prev;
+		block->prev = block->next = SIZE_MAX;
+	}
+
+	static void csvee_lazy_free(CSVLazy_t *lazy)
+	{
+		if (!lazy)
+			return;
+		free(lazy->text);
+		free(lazy->spans);
+		csvee_parser_free(&lazy->parser);
+		free(lazy);
+	}
+
+	/* Take the one row a span tokenizes to; a second one means the spans are off. */
+	static bool csvee_lazy_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVRow_t *slot = (CSVRow_t *)user;
+		if (slot->fields)
+		{
+			csvee_row_free(row);
+			return false;
+		}
+		*slot = *row;
+		return true;
+	}
+
+	/* Tokenize row @p index of a lazy table from its span. The input goes once the last row is built. */
+	static bool csvee_lazy_load(Csvee_t *csvee, size_t index)
+	{
+		CSVLazy_t *lazy = csvee->lazy;
+		uint64_t first = lazy->spans[2 * index], end = lazy->spans[2 * index + 1];
+
+		/* a finished parse leaves the tokenizer ready for the next row */
+		CSVRow_t row = {NULL, 0, 0};
+		CSVParser_t *parser = &lazy->parser;
+		parser->user = &row;
+		bool ok = csvee_parser_feed(parser, lazy->text + first, (size_t)(end - first)) && csvee_parser_finish(parser);
+		csvee->stats.materialize_ns += parser->stats.tokenize_ns + parser->stats.materialize_ns;
+		csvee->stats.allocations += parser->stats.allocations;
+		csvee->stats.bytes_allocated += parser->stats.bytes_allocated;
+		memset(&parser->stats, 0, sizeof(parser->stats));
+
+		if (!ok || !row.fields)
+		{
+			csvee_parser_free(parser);
+			csvee_parser_init(parser, csvee->dialect, csvee_lazy_row_cb, NULL);
+#ifdef CSVEE_DEBUG
+			csvee_error(PARSE_ERROR, "Could not build row %zu from bytes %llu to %llu\n", index, (unsigned long long)first, (unsigned long long)end);
+#endif // CSVEE_DEBUG
+			csvee_row_free(&row);
+			return false;
+		}
+
+		csvee->rows[index] = row;
+		if (--lazy->pending == 0)
+		{
+			csvee_lazy_free(lazy);
+			csvee->lazy = NULL;
+		}
+		return true;
+	}
+
+	/* Build every row a lazy table still holds back, leaving an ordinary table. */
+	static bool csvee_lazy_settle(Csvee_t *csvee)
+	{
+		for (size_t r = 0; csvee->lazy && r < csvee->lazy->count; ++r)
+			if (!csvee->rows[r].fields && !csvee_row_deleted(csvee, r) && !csvee_lazy_load(csvee, r))
+				return false;
+		return true;
+	}
+
+	static void csvee_compact_free(CSVCompact_t *compact)
+	{
+		if (!compact)
+			return;
+		free(compact->fields);
+		csvee_buffer_free(&compact->text);
+		csvee_buffer_free(&compact->starts);
+		free(compact);
+	}
+
+	/* True if @p row is a view into the blocks of a compact table rather than owning its fields. */
+	static bool csvee_compact_owns(const Csvee_t *csvee, const CSVRow_t *row)
+	{
+		const CSVCompact_t *compact = csvee->compact;
+		return compact && row->fields && (uintptr_t)row->fields >= (uintptr_t)compact->fields &&
+			   (uintptr_t)row->fields < (uintptr_t)(compact->fields + compact->count);
+	}
+
+	/*
+	 * CSVRecordCallback_t of a compact read. The fields and their text are
+	 * added to the shared blocks; until csvee_compact_finish() the row keeps
+	 * the index of its first field in capacity.
+	 */
+	static bool csvee_compact_record(void *user, const char *text, const size_t *ends, size_t count)
+	{
+		Csvee_t *csvee = (Csvee_t *)user;
+		CSVCompact_t *compact = csvee->compact;
+
+		if (compact->count + count > compact->capacity)
+		{
+			size_t capacity = compact->capacity ? compact->capacity * 2 : 1024;
+			while (capacity < compact->count + count)
+				capacity *= 2;
+			CSVField_t *fields = (CSVField_t *)realloc(compact->fields, capacity * sizeof(CSVField_t));
+			if (!fields)
+				return false;
+			csvee->stats.allocations++;
+			csvee->stats.bytes_allocated += (capacity - compact->capacity) * sizeof(CSVField_t);
+			compact->fields = fields;
+			compact->capacity = capacity;
+		}
+
+		size_t size = ends[count - 1];
+		size_t text_cap = compact->text.capacity;
+		if (!csvee_buffer_reserve(&compact->text, size + count) ||
+			!csvee_buffer_reserve(&compact->starts, count * sizeof(size_t)))
+			return false;
+		if (compact->text.capacity != text_cap)
+		{
+			csvee->stats.allocations++;
+			csvee->stats.bytes_allocated += compact->text.capacity - text_cap;
+		}
+
+		size_t *starts = (size_t *)(compact->starts.data + compact->starts.size);
+		size_t start = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			starts[i] = compact->text.size;
+			compact->fields[compact->count + i].type = CSVEE_STRING;
+			memcpy(compact->text.data + compact->text.size, text + start, ends[i] - start);
+			compact->text.size += ends[i] - start;
+			compact->text.data[compact->text.size++] = '\0';
+			start = ends[i];
+		}
+		compact->starts.size += count * sizeof(size_t);
+
+		CSVRow_t row = {NULL, compact->count, count};
+		compact->count += count;
+		return csvee_push_row(csvee, &row);
+	}
+
+	/* The blocks are done growing: trim them and turn the offsets into pointers. */
+	static void csvee_compact_finish(Csvee_t *csvee)
+	{
+		CSVCompact_t *compact = csvee->compact;
+		if (compact->count && compact->count < compact->capacity)
+		{
+			CSVField_t *fields = (CSVField_t *)realloc(compact->fields, compact->count * sizeof(CSVField_t));
+			if (fields)
+			{
+				compact->fields = fields;
+				compact->capacity = compact->count;
+			}
+		}
+		if (compact->text.size && compact->text.size < compact->text.capacity)
+		{
+			char *text = (char *)realloc(compact->text.data, compact->text.size);
+			if (text)
+			{
+				compact->text.data = text;
+				compact->text.capacity = compact->text.size;
+			}
+		}
+
+		const size_t *starts = (const size_t *)compact->starts.data;
+		for (size_t i = 0; i < compact->count; ++i)
+			compact->fields[i].value._string = compact->text.data + starts[i];
+		for (size_t r = 0; r < csvee->count; ++r)
+		{
+			CSVRow_t *row = &csvee->rows[r];
+			if (row->fields)
+				continue;
+			row->fields = compact->fields + row->capacity;
+			row->capacity = row->count;
+		}
+		csvee_buffer_free(&compact->starts);
+	}
+
+	/* Give every row block of @p csvee a reference count so another version can hold it too. */
+	static bool csvee_share_init(Csvee_t *csvee)
+	{
+		CSVShare_t *share = csvee->share;
+		if (!share && !(share = csvee->share = (CSVShare_t *)calloc(1, sizeof(CSVShare_t))))
+			return false;
+
+		size_t count = (csvee->count + CSVEE_SHARE_BLOCK_ROWS - 1) / CSVEE_SHARE_BLOCK_ROWS;
+		if (count > share->count)
+		{
+			CSVShareBlock_t **blocks = (CSVShareBlock_t **)realloc(share->blocks, count * sizeof(CSVShareBlock_t *));
+			if (!blocks)
+				return false;
+			memset(blocks + share->count, 0, (count - share->count) * sizeof(CSVShareBlock_t *));
+			share->blocks = blocks;
+			share->count = count;
+		}
+		for (size_t b = 0; b < share->count; ++b)
+		{
+			if (share->blocks[b])
+				continue;
+			if (!(share->blocks[b] = (CSVShareBlock_t *)malloc(sizeof(CSVShareBlock_t))))
+				return false;
+			share->blocks[b]->refs = 1;
+		}
+		return true;
+	}
+
+	/* Take a private copy of row block @p block before it is changed, when other versions hold it too. */
+	static bool csvee_share_unshare(Csvee_t *csvee, size_t block)
+	{
+		CSVShare_t *share = csvee->share;
+		if (!share || block >= share->count || !share->blocks[block])
+			return true;
+
+		CSVShareBlock_t *shared = share->blocks[block];
+		if (shared->refs > 1)
+		{
+			size_t first = block * CSVEE_SHARE_BLOCK_ROWS;
+			size_t end = first + CSVEE_SHARE_BLOCK_ROWS < csvee->count ? first + CSVEE_SHARE_BLOCK_ROWS : csvee->count;
+
+			/* copy aside first so a failure leaves the shared rows in place */
+			CSVRow_t *copies = (CSVRow_t *)calloc(end - first + 1, sizeof(CSVRow_t));
+			bool ok = copies != NULL;
+			for (size_t r = first; ok && r < end; ++r)
+				ok = csvee_row_copy(&copies[r - first], &csvee->rows[r]);
+			if (!ok)
+			{
+				for (size_t r = first; copies && r < end; ++r)
+					csvee_row_free(&copies[r - first]);
+				free(copies);
+				return false;
+			}
+			memcpy(csvee->rows + first, copies, (end - first) * sizeof(CSVRow_t));
+			free(copies);
+			shared->refs--;
+		}
+		else
+			free(shared);
+		share->blocks[block] = NULL;
+		return true;
+	}
+
+	/* Take private copies of every shared block and stop sharing, before rows move between blocks. */
+	static bool csvee_share_detach(Csvee_t *csvee)
+	{
+		for (size_t b = 0; csvee->share && b < csvee->share->count; ++b)
+			if (!csvee_share_unshare(csvee, b))
+				return false;
+		csvee_share_free(csvee);
+		return true;
+	}
+
+	/* True if freeing @p csvee should free the fields of row @p index: no other version holds them. */
+	static bool csvee_share_owns(const Csvee_t *csvee, size_t index)
+	{
+		const CSVShare_t *share = csvee->share;
+		size_t block = index / CSVEE_SHARE_BLOCK_ROWS;
+		return !share || block >= share->count || !share->blocks[block] || share->blocks[block]->refs == 1;
+	}
+
+	/* Drop this table's hold on its blocks, after the rows it owned were freed. */
+	static void csvee_share_free(Csvee_t *csvee)
+	{
+		CSVShare_t *share = csvee->share;
+		if (!share)
+			return;
+		for (size_t b = 0; b < share->count; ++b)
+			if (share->blocks[b] && --share->blocks[b]->refs == 0)
+				free(share->blocks[b]);
+		free(share->blocks);
+		free(share);
+		csvee->share = NULL;
+	}
+
+	/* Pointer to row @p index (0-based), paging its block back in when it was spilled or building it when read lazily. */
+	CSVRow_t *csvee_row_at(Csvee_t *csvee, size_t index)
+	{
+		if (!csvee || index >= csvee->count)
+			return NULL;
+
+		CSVSpill_t *spill = csvee->spill;
+		size_t b = index / CSVEE_SPILL_BLOCK_ROWS;
+		if (spill && b != spill->hot && b < spill->block_count)
+		{
+			CSVSpillBlock_t *block = &spill->blocks[b];
+			if (!block->resident)
+			{
+				if (!csvee_spill_load(csvee, b))
+					return NULL;
+			}
+			else if (block->prev != SIZE_MAX || spill->lru_head == b)
+			{
+				/* most recently used goes to the tail; the block being filled is not listed */
+				csvee_spill_unlink(spill, b);
+				csvee_spill_link(spill, b);
+			}
+			spill->hot = b;
+		}
+		if (csvee->lazy && index < csvee->lazy->count && !csvee->rows[index].fields && !csvee_row_deleted(csvee, index) &&
+			!csvee_lazy_load(csvee, index))
+			return NULL;
+		return &csvee->rows[index];
+	}
+
+	/* Heap bytes owned by @p row. */
+	static size_t csvee_row_bytes(const CSVRow_t *row)
+	{
+		size_t bytes = row->count * sizeof(CSVField_t);
+		for (size_t c = 0; c < row->count; ++c)
+			if (row->fields[c].type == CSVEE_STRING && row->fields[c].value._string)
+				bytes += strlen(row->fields[c].value._string) + 1;
+		return bytes;
+	}
+
+	/* An anonymous file in @p dir (or the system temp dir) that is removed when closed. */
+	static FILE *csvee_spill_open(const char *dir)
+	{
+		if (!dir)
+			return tmpfile();
+
+#if CSVEE_PLATFORM_IS(WINDOWS)
+		char *path = _tempnam(dir, "csvee");
+		if (!path)
+			return NULL;
+		FILE *file = fopen(path, "w+bD"); /* D: delete on close */
+		free(path);
+		return file;
+#else
+		size_t size = strlen(dir) + sizeof("/csvee-spill-XXXXXX");
+		char *path = (char *)malloc(size);
+		if (!path)
+			return NULL;
+		snprintf(path, size, "%s/csvee-spill-XXXXXX", dir);
+
+		FILE *file = NULL;
+		int fd = mkstemp(path);
+		if (fd >= 0)
+		{
+			unlink(path);
+			file = fdopen(fd, "w+b");
+			if (!file)
+				close(fd);
+		}
+		free(path);
+		return file;
+#endif
+	}
+
+	/* Memory the budget is compared against: resident rows plus the row and block tables. */
+	static size_t csvee_spill_usage(const Csvee_t *csvee)
+	{
+		return csvee->spill->resident_bytes + csvee->capacity * sizeof(CSVRow_t) +
+			   csvee->spill->block_cap * sizeof(CSVSpillBlock_t);
+	}
+
+	static void csvee_spill_count(Csvee_t *csvee, uint64_t evictions, uint64_t bytes, uint64_t loads)
+	{
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		op.spill_evictions = evictions;
+		op.spill_bytes = bytes;
+		op.spill_loads = loads;
+		csvee_stats_merge(&csvee->stats, &op);
+		csvee_stats_publish(&op);
+	}
+
+	/* Account for the row just pushed; evict once it completes a block. */
+	static bool csvee_spill_track(Csvee_t *csvee)
+	{
+		CSVSpill_t *spill = csvee->spill;
+		size_t index = csvee->count - 1;
+		size_t b = index / CSVEE_SPILL_BLOCK_ROWS;
+
+		if (b >= spill->block_cap)
+		{
+			size_t capacity = spill->block_cap ? spill->block_cap * 2 : 16;
+			CSVSpillBlock_t *blocks = (CSVSpillBlock_t *)realloc(spill->blocks, capacity * sizeof(CSVSpillBlock_t));
+			if (!blocks)
+				return false;
+			spill->blocks = blocks;
+			spill->block_cap = capacity;
+		}
+		while (spill->block_count <= b)
+		{
+			CSVSpillBlock_t *block = &spill->blocks[spill->block_count++];
+			block->offset = UINT64_MAX;
+			block->size = 0;
+			block->bytes = 0;
+			block->resident = true;
+			block->prev = block->next = SIZE_MAX;
+		}
+
+		size_t bytes = csvee_row_bytes(&csvee->rows[index]);
+		spill->blocks[b].bytes += bytes;
+		spill->resident_bytes += bytes;
+
+		size_t usage = csvee_spill_usage(csvee);
+		if (usage > spill->peak_bytes)
+			spill->peak_bytes = usage;
+
+		/* only whole blocks are evicted, the one being filled stays put */
+		if ((index + 1) % CSVEE_SPILL_BLOCK_ROWS != 0)
+			return true;
+		csvee_spill_link(spill, b);
+		return csvee_spill_enforce(csvee, b);
+	}
+
+	/* Evict least recently used blocks, never @p keep, until the table fits its budget. */
+	static bool csvee_spill_enforce(Csvee_t *csvee, size_t keep)
+	{
+		CSVSpill_t *spill = csvee->spill;
+		if (!spill || csvee->memory_budget == 0)
+			return true;
+
+		size_t b = spill->lru_head;
+		while (b != SIZE_MAX && csvee_spill_usage(csvee) > csvee->memory_budget)
+		{
+			size_t next = spill->blocks[b].next;
+			if (b != keep && !csvee_spill_evict(csvee, b))
+				return false;
+			b = next;
+		}
+		return true;
+	}
+
+	/* LEB128: seven bits per byte, low bits first, high bit set on all but the last. */
+	static size_t csvee_varint_encode(unsigned char *bytes, uint64_t value)
+	{
+		size_t n = 0;
+		do
+		{
+			bytes[n++] = (unsigned char)((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+			value >>= 7;
+		} while (value);
+		return n;
+	}
+
+	static bool csvee_buffer_put_varint(CSVBuffer_t *buffer, uint64_t value)
+	{
+		unsigned char bytes[10];
+		return csvee_buffer_append(buffer, (const char *)bytes, csvee_varint_encode(bytes, value));
+	}
+
+	static bool csvee_get_varint(const unsigned char **cursor, const unsigned char *end, uint64_t *value)
+	{
+		*value = 0;
+		for (unsigned shift = 0; *cursor < end && shift < 64; shift += 7)
+		{
+			unsigned char byte = *(*cursor)++;
+			*value |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	/*
+	 * Spilled rows are a varint field count followed by each field as a type
+	 * byte and its value: varint length and bytes for strings, the raw
+	 * in-memory representation for the other types.
+	 */
+	static bool csvee_spill_encode(CSVBuffer_t *out, const CSVRow_t *row)
+	{
+		if (!csvee_buffer_put_varint(out, row->count))
+			return false;
+		for (size_t c = 0; c < row->count; ++c)
+		{
+			const CSVField_t *field = &row->fields[c];
+			char type = (char)field->type;
+			bool ok = csvee_buffer_append(out, &type, 1);
+			switch (field->type)
+			{
+			case CSVEE_STRING:
+			{
+				const char *text = field->value._string ? field->value._string : "";
+				size_t len = strlen(text);
+				ok = ok && csvee_buffer_put_varint(out, len) && csvee_buffer_append(out, text, len);
+				break;
+			}
+			case CSVEE_INTEGER:
+				ok = ok && csvee_buffer_append(out, (const char *)&field->value._integer, sizeof(int));
+				break;
+			case CSVEE_DOUBLE:
+				ok = ok && csvee_buffer_append(out, (const char *)&field->value._double, sizeof(double));
+				break;
+			case CSVEE_BOOL:
+				ok = ok && csvee_buffer_append(out, (const char *)&field->value._boolean, sizeof(bool));
+				break;
+			default:
+				break;
+			}
+			if (!ok)
+				return false;
+		}
+		return true;
+	}
+
+	static bool csvee_spill_decode(const unsigned char **cursor, const unsigned char *end, CSVRow_t *row)
+	{
+		uint64_t count;
+		if (!csvee_get_varint(cursor, end, &count) || count > (uint64_t)(end - *cursor))
+			return false;
+
+		row->fields = (CSVField_t *)malloc((size_t)count * sizeof(CSVField_t));
+		row->capacity = (size_t)count;
+		row->count = 0;
+		if (!row->fields && count)
+			return false;
+
+		while (row->count < count)
+		{
+			if (*cursor >= end)
+				return false;
+			CSVField_t field;
+			field.type = (CSVData_t)(*(*cursor)++);
+			field.value._string = NULL;
+
+			size_t size = 0;
+			uint64_t len = 0;
+			switch (field.type)
+			{
+			case CSVEE_STRING:
+				if (!csvee_get_varint(cursor, end, &len) || len > (uint64_t)(end - *cursor))
+					return false;
+				field = csvee_create_field_n((const char *)*cursor, (size_t)len);
+				if (!field.value._string)
+					return false;
+				*cursor += len;
+				break;
+			case CSVEE_INTEGER:
+				size = sizeof(int);
+				break;
+			case CSVEE_DOUBLE:
+				size = sizeof(double);
+				break;
+			case CSVEE_BOOL:
+				size = sizeof(bool);
+				break;
+			default:
+				break;
+			}
+			if (size)
+			{
+				if (size > (size_t)(end - *cursor))
+					return false;
+				memcpy(&field.value, *cursor, size);
+				*cursor += size;
+			}
+			row->fields[row->count++] = field;
+		}
+		return true;
+	}
+
+	/* Write a block out (once; it does not change afterwards) and free its rows. */
+	static bool csvee_spill_evict(Csvee_t *csvee, size_t b)
+	{
+		CSVSpill_t *spill = csvee->spill;
+		CSVSpillBlock_t *block = &spill->blocks[b];
+		size_t first = b * CSVEE_SPILL_BLOCK_ROWS;
+		size_t last = first + CSVEE_SPILL_BLOCK_ROWS;
+		uint64_t written = 0;
+
+		if (block->offset == UINT64_MAX)
+		{
+			spill->scratch.size = 0;
+			for (size_t r = first; r < last; ++r)
+				if (!csvee_spill_encode(&spill->scratch, &csvee->rows[r]))
+					return false;
+
+			if (CSVEE_FSEEK64(spill->file, spill->file_size) != 0 ||
+				fwrite(spill->scratch.data, 1, spill->scratch.size, spill->file) != spill->scratch.size)
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(IO_ERROR, "Could not write to the spill file\n");
+#endif // CSVEE_DEBUG
+				return false;
+			}
+			block->offset = spill->file_size;
+			block->size = spill->scratch.size;
+			spill->file_size += spill->scratch.size;
+			written = spill->scratch.size;
+		}
+
+		for (size_t r = first; r < last; ++r)
+		{
+			csvee_row_free(&csvee->rows[r]);
+			csvee->rows[r].fields = NULL;
+			csvee->rows[r].capacity = 0;
+		}
+		spill->resident_bytes -= block->bytes;
+		block->resident = false;
+		csvee_spill_unlink(spill, b);
+		if (spill->hot == b)
+			spill->hot = SIZE_MAX;
+
+		csvee_spill_count(csvee, 1, written, 0);
+		return true;
+	}
+
+	/* Read a spilled block back, then make room for it by evicting others. */
+	static bool csvee_spill_load(Csvee_t *csvee, size_t b)
+	{
+		CSVSpill_t *spill = csvee->spill;
+		CSVSpillBlock_t *block = &spill->blocks[b];
+
+		spill->scratch.size = 0;
+		if (!csvee_buffer_reserve(&spill->scratch, (size_t)block->size))
+			return false;
+		if (CSVEE_FSEEK64(spill->file, block->offset) != 0 ||
+			fread(spill->scratch.data, 1, (size_t)block->size, spill->file) != block->size)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(IO_ERROR, "Could not read back from the spill file\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+
+		const unsigned char *cursor = (const unsigned char *)spill->scratch.data;
+		const unsigned char *end = cursor + block->size;
+		size_t first = b * CSVEE_SPILL_BLOCK_ROWS;
+		for (size_t r = first; r < first + CSVEE_SPILL_BLOCK_ROWS; ++r)
+		{
+			if (!csvee_spill_decode(&cursor, end, &csvee->rows[r]))
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(IO_ERROR, "Corrupt spill file\n");
+#endif // CSVEE_DEBUG
+				for (size_t k = first; k <= r; ++k)
+				{
+					csvee_row_free(&csvee->rows[k]);
+					csvee->rows[k].fields = NULL;
+					csvee->rows[k].capacity = 0;
+				}
+				return false;
+			}
+		}
+
+		block->resident = true;
+		spill->resident_bytes += block->bytes;
+		csvee_spill_link(spill, b);
+		csvee_spill_count(csvee, 0, 0, 1);
+		return csvee_spill_enforce(csvee, b);
+	}
+
+	static void csvee_spill_free(CSVSpill_t *spill)
+	{
+		if (!spill)
+			return;
+		if (spill->file)
+			fclose(spill->file);
+		free(spill->blocks);
+		csvee_buffer_free(&spill->scratch);
+		free(spill);
+	}
+
+	static bool csvee_sort_key_integer(CSVBuffer_t *out, long long value)
+	{
+		/* flipping the sign bit makes two's complement sort as unsigned */
+		uint64_t bits = (uint64_t)value ^ ((uint64_t)1 << 63);
+		unsigned char bytes[9];
+		bytes[0] = 1;
+		for (int i = 0; i < 8; ++i)
+			bytes[1 + i] = (unsigned char)(bits >> (56 - 8 * i));
+		return csvee_buffer_append(out, (const char *)bytes, sizeof(bytes));
+	}
+
+	static bool csvee_sort_key_double(CSVBuffer_t *out, double value)
+	{
+		if (value == 0.0)
+			value = 0.0; /* -0.0 ties with 0.0 */
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		/* negative numbers: reverse all bits, positive numbers: set the sign bit */
+		bits = (bits >> 63) ? ~bits : bits | ((uint64_t)1 << 63);
+		unsigned char bytes[9];
+		bytes[0] = 1;
+		for (int i = 0; i < 8; ++i)
+			bytes[1 + i] = (unsigned char)(bits >> (56 - 8 * i));
+		return csvee_buffer_append(out, (const char *)bytes, sizeof(bytes));
+	}
+
+	/* Empty fields sort before numbers, text that is not a number after them. */
+	static bool csvee_sort_key_number(CSVBuffer_t *out, const char *text, CSVSortType_t type)
+	{
+		const char *start = text;
+		while (*start == ' ' || *start == '\t')
+			++start;
+		if (!*start)
+			return csvee_buffer_append(out, "\0", 1);
+
+		char *end = NULL;
+		long long whole = 0;
+		double real = 0.0;
+		if (type == CSVEE_SORT_INTEGER)
+			whole = strtoll(start, &end, 10);
+		else
+			real = strtod(start, &end);
+		bool number = end != start && (type == CSVEE_SORT_INTEGER || real == real);
+		while (number && (*end == ' ' || *end == '\t'))
+			++end;
+
+		if (number && !*end)
+			return type == CSVEE_SORT_INTEGER ? csvee_sort_key_integer(out, whole) : csvee_sort_key_double(out, real);
+		return csvee_buffer_append(out, "\2", 1) && csvee_buffer_append(out, text, strlen(text) + 1);
+	}
+
+	/*
+	 * Append the normalized key of @p row to @p out: memcmp() order on the
+	 * result is the order asked for by @p keys. Each column is encoded so
+	 * that no encoding is a prefix of another, which lets columns simply be
+	 * concatenated; descending columns have their bytes inverted.
+	 */
+	static bool csvee_sort_key(CSVBuffer_t *out, const CSVSortKey_t *keys, size_t nkeys, const CSVRow_t *row)
+	{
+		char scratch[64];
+		for (size_t k = 0; k < nkeys; ++k)
+		{
+			size_t start = out->size;
+			const CSVField_t *field = keys[k].column < row->count ? &row->fields[keys[k].column] : NULL;
+			bool ok;
+
+			if (keys[k].type == CSVEE_SORT_TEXT)
+			{
+				const char *text = field ? csvee_field_text(field, scratch, sizeof(scratch)) : "";
+				ok = csvee_buffer_append(out, text, strlen(text) + 1);
+			}
+			else if (field && field->type == CSVEE_INTEGER)
+				ok = keys[k].type == CSVEE_SORT_INTEGER ? csvee_sort_key_integer(out, field->value._integer)
+														: csvee_sort_key_double(out, (double)field->value._integer);
+			else if (field && field->type == CSVEE_DOUBLE && keys[k].type == CSVEE_SORT_DOUBLE)
+				ok = csvee_sort_key_double(out, field->value._double);
+			else
+				ok = csvee_sort_key_number(out, field ? csvee_field_text(field, scratch, sizeof(scratch)) : "", keys[k].type);
+
+			if (!ok)
+				return false;
+			if (keys[k].order == CSVEE_SORT_DESC)
+				for (size_t i = start; i < out->size; ++i)
+					out->data[i] = (char)~out->data[i];
+		}
+		return true;
+	}
+
+	/* First eight key bytes as a big endian integer, zero padded. */
+	static uint64_t csvee_sort_prefix(const char *key, size_t size)
+	{
+		uint64_t prefix = 0;
+		for (size_t i = 0; i < 8; ++i)
+			prefix = (prefix << 8) | (i < size ? (unsigned char)key[i] : 0);
+		return prefix;
+	}
+
+	static int csvee_sort_item_cmp(const CSVSortItem_t *a, const CSVSortItem_t *b, const char *data)
+	{
+		if (a->prefix != b->prefix)
+			return a->prefix < b->prefix ? -1 : 1;
+		if (a->key_len > 8 && b->key_len > 8)
+		{
+			size_t n = (a->key_len < b->key_len ? a->key_len : b->key_len) - 8;
+			int c = memcmp(data + a->offset + 8, data + b->offset + 8, n);
+			if (c)
+				return c;
+		}
+		return (a->key_len > b->key_len) - (a->key_len < b->key_len);
+	}
+
+	/* Stable merge sort of @p items by key, @p tmp holds as many items. */
+	static void csvee_sort_items(CSVSortItem_t *items, CSVSortItem_t *tmp, size_t count, const char *data)
+	{
+		const size_t small = 16;
+		for (size_t lo = 0; lo < count; lo += small)
+		{
+			size_t hi = lo + small < count ? lo + small : count;
+			for (size_t i = lo + 1; i < hi; ++i)
+			{
+				CSVSortItem_t item = items[i];
+				size_t j = i;
+				while (j > lo && csvee_sort_item_cmp(&item, &items[j - 1], data) < 0)
+				{
+					items[j] = items[j - 1];
+					--j;
+				}
+				items[j] = item;
+			}
+		}
+
+		CSVSortItem_t *src = items, *dst = tmp;
+		for (size_t width = small; width < count; width *= 2)
+		{
+			for (size_t lo = 0; lo < count; lo += 2 * width)
+			{
+				size_t mid = lo + width < count ? lo + width : count;
+				size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+				size_t i = lo, j = mid, o = lo;
+				while (i < mid && j < hi)
+					dst[o++] = csvee_sort_item_cmp(&src[j], &src[i], data) < 0 ? src[j++] : src[i++];
+				while (i < mid)
+					dst[o++] = src[i++];
+				while (j < hi)
+					dst[o++] = src[j++];
+			}
+			CSVSortItem_t *swap = src;
+			src = dst;
+			dst = swap;
+		}
+		if (src != items)
+			memcpy(items, src, count * sizeof(CSVSortItem_t));
+	}
+
+	/*
+	 * Stable LSD radix sort of @p items by prefix, a byte per pass; passes
+	 * where every item has the same byte are skipped. Items whose prefixes
+	 * tie but whose keys are longer are then ordered by csvee_sort_items().
+	 */
+	static void csvee_sort_radix(CSVSortItem_t *items, CSVSortItem_t *tmp, size_t count, const char *data)
+	{
+		if (count < 64)
+		{
+			csvee_sort_items(items, tmp, count, data);
+			return;
+		}
+
+		size_t counts[8][256];
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < count; ++i)
+			for (unsigned b = 0; b < 8; ++b)
+				counts[b][(items[i].prefix >> (8 * b)) & 0xff]++;
+
+		CSVSortItem_t *src = items, *dst = tmp;
+		for (unsigned b = 0; b < 8; ++b)
+		{
+			size_t *bucket = counts[b];
+			if (bucket[(src[0].prefix >> (8 * b)) & 0xff] == count)
+				continue;
+			size_t sum = 0;
+			for (unsigned d = 0; d < 256; ++d)
+			{
+				size_t n = bucket[d];
+				bucket[d] = sum;
+				sum += n;
+			}
+			for (size_t i = 0; i < count; ++i)
+				dst[bucket[(src[i].prefix >> (8 * b)) & 0xff]++] = src[i];
+			CSVSortItem_t *swap = src;
+			src = dst;
+			dst = swap;
+		}
+		if (src != items)
+			memcpy(items, src, count * sizeof(CSVSortItem_t));
+
+		for (size_t i = 0; i < count;)
+		{
+			size_t j = i + 1;
+			bool longer = items[i].key_len > 8;
+			for (; j < count && items[j].prefix == items[i].prefix; ++j)
+				longer = longer || items[j].key_len > 8;
+			if (longer && j - i > 1)
+				csvee_sort_items(items + i, tmp, j - i, data);
+			i = j;
+		}
+	}
+
+	static bool csvee_sort_run_put(FILE *file, const char *key, size_t key_len, const char *line, size_t line_len)
+	{
+		unsigned char bytes[10];
+		size_t n = csvee_varint_encode(bytes, key_len);
+		bool ok = fwrite(bytes, 1, n, file) == n && fwrite(key, 1, key_len, file) == key_len;
+		n = csvee_varint_encode(bytes, line_len);
+		return ok && fwrite(bytes, 1, n, file) == n && fwrite(line, 1, line_len, file) == line_len;
+	}
+
+	/* Worker: sort one batch and write it to a run file. */
+	static void csvee_sort_batch_run(void *arg)
+	{
+		CSVSortBatch_t *batch = (CSVSortBatch_t *)arg;
+		CSVSortItem_t *tmp = (CSVSortItem_t *)malloc(batch->count * sizeof(CSVSortItem_t) + 1);
+		batch->run = tmp ? csvee_spill_open(NULL) : NULL;
+		batch->ok = batch->run != NULL;
+		if (batch->ok)
+		{
+			csvee_sort_items(batch->items, tmp, batch->count, batch->data.data);
+			for (size_t i = 0; i < batch->count && batch->ok; ++i)
+			{
+				const CSVSortItem_t *item = &batch->items[i];
+				const char *key = batch->data.data + item->offset;
+				batch->ok = csvee_sort_run_put(batch->run, key, item->key_len, key + item->key_len, item->line_len);
+			}
+			batch->ok = batch->ok && fflush(batch->run) == 0 && fseek(batch->run, 0, SEEK_SET) == 0;
+		}
+		free(tmp);
+	}
+
+	/* A varint from @p file; false at end of file or on a malformed value. */
+	static bool csvee_sort_read_varint(FILE *file, uint64_t *value)
+	{
+		*value = 0;
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			int c = getc(file);
+			if (c == EOF)
+				return false;
+			*value |= (uint64_t)(c & 0x7f) << shift;
+			if (!(c & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	/* Load the next record of a run; done is set at its end. */
+	static bool csvee_sort_reader_next(CSVSortReader_t *reader)
+	{
+		int c = getc(reader->file);
+		if (c == EOF)
+			return reader->done = !ferror(reader->file);
+		ungetc(c, reader->file);
+
+		uint64_t key_len, line_len;
+		reader->record.size = 0;
+		if (!csvee_sort_read_varint(reader->file, &key_len) || !csvee_buffer_reserve(&reader->record, (size_t)key_len) ||
+			fread(reader->record.data, 1, (size_t)key_len, reader->file) != key_len)
+			return false;
+		reader->record.size = (size_t)key_len;
+		if (!csvee_sort_read_varint(reader->file, &line_len) || !csvee_buffer_reserve(&reader->record, (size_t)line_len) ||
+			fread(reader->record.data + key_len, 1, (size_t)line_len, reader->file) != line_len)
+			return false;
+		reader->record.size += (size_t)line_len;
+		reader->key_len = (size_t)key_len;
+		reader->line_len = (size_t)line_len;
+		return true;
+	}
+
+	static bool csvee_sort_reader_less(const CSVSortReader_t *readers, size_t a, size_t b)
+	{
+		const CSVSortReader_t *x = &readers[a], *y = &readers[b];
+		if (x->done || y->done)
+			return !x->done;
+		size_t n = x->key_len < y->key_len ? x->key_len : y->key_len;
+		int c = memcmp(x->record.data, y->record.data, n);
+		if (c)
+			return c < 0;
+		if (x->key_len != y->key_len)
+			return x->key_len < y->key_len;
+		return a < b; /* earlier runs first keeps the sort stable */
+	}
+
+	/* Play the subtree under @p node, leaving losers in @p tree; returns its winner. */
+	static size_t csvee_loser_build(const CSVSortReader_t *readers, size_t *tree, size_t k, size_t node)
+	{
+		if (node >= k)
+			return node - k;
+		size_t left = csvee_loser_build(readers, tree, k, 2 * node);
+		size_t right = csvee_loser_build(readers, tree, k, 2 * node + 1);
+		if (csvee_sort_reader_less(readers, right, left))
+		{
+			tree[node] = left;
+			return right;
+		}
+		tree[node] = right;
+		return left;
+	}
+
+	/*
+	 * k-way merge of @p runs with a loser tree: leaves are the runs, inner
+	 * node i (1 <= i < k) keeps the loser of the match played there and
+	 * tree[0] the overall winner, so each record costs log2(k) compares.
+	 * Records go to @p out as run records, or as plain lines to @p sink.
+	 */
+	static bool csvee_sort_merge(FILE **runs, size_t k, FILE *out, CSVSink_t *sink)
+	{
+		CSVSortReader_t *readers = (CSVSortReader_t *)calloc(k, sizeof(CSVSortReader_t));
+		size_t *tree = (size_t *)malloc(k * sizeof(size_t));
+		bool ok = readers && tree;
+
+		for (size_t i = 0; ok && i < k; ++i)
+		{
+			readers[i].file = runs[i];
+			ok = csvee_sort_reader_next(&readers[i]);
+		}
+
+		if (ok)
+		{
+			tree[0] = csvee_loser_build(readers, tree, k, 1);
+			for (;;)
+			{
+				size_t winner = tree[0];
+				CSVSortReader_t *reader = &readers[winner];
+				if (reader->done)
+					break;
+
+				const char *line = reader->record.data + reader->key_len;
+				if (sink)
+				{
+					ok = csvee_buffer_append(&sink->block, line, reader->line_len);
+					if (ok && sink->block.size >= sink->block_size)
+						ok = csvee_sink_flush(sink);
+				}
+				else
+					ok = csvee_sort_run_put(out, reader->record.data, reader->key_len, line, reader->line_len);
+				if (!ok || !csvee_sort_reader_next(reader))
+				{
+					ok = false;
+					break;
+				}
+
+				for (size_t node = (winner + k) / 2; node > 0; node /= 2)
+				{
+					if (csvee_sort_reader_less(readers, tree[node], winner))
+					{
+						size_t loser = winner;
+						winner = tree[node];
+						tree[node] = loser;
+					}
+				}
+				tree[0] = winner;
+			}
+		}
+
+		for (size_t i = 0; readers && i < k; ++i)
+			csvee_buffer_free(&readers[i].record);
+		free(readers);
+		free(tree);
+		return ok;
+	}
+
+	/* 64-bit hash of @p size bytes, a word at a time. */
+	static uint64_t csvee_hash(const char *data, size_t size)
+	{
+		const uint64_t mul = 0x9E3779B97F4A7C15ull;
+		uint64_t hash = (uint64_t)size * mul;
+		for (; size >= 8; data += 8, size -= 8)
+		{
+			uint64_t word;
+			memcpy(&word, data, 8);
+			hash = (hash ^ word) * mul;
+			hash ^= hash >> 32;
+		}
+		if (size)
+		{
+			uint64_t word = 0;
+			memcpy(&word, data, size);
+			hash = (hash ^ word) * mul;
+		}
+		/* splitmix64 finalizer */
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+		return hash ^ (hash >> 31);
+	}
+
+	static bool csvee_hash_grow(CSVHashTable_t *table)
+	{
+		size_t capacity = table->capacity ? table->capacity * 2 : 64;
+		CSVHashSlot_t *slots = (CSVHashSlot_t *)calloc(capacity, sizeof(CSVHashSlot_t));
+		if (!slots)
+			return false;
+		for (size_t i = 0; i < table->capacity; ++i)
+		{
+			if (!table->slots[i].entry)
+				continue;
+			size_t j = table->slots[i].hash & (capacity - 1);
+			while (slots[j].entry)
+				j = (j + 1) & (capacity - 1);
+			slots[j] = table->slots[i];
+		}
+		free(table->slots);
+		table->slots = slots;
+		table->capacity = capacity;
+		return true;
+	}
+
+	/* Look @p key up without adding it. */
+	static bool csvee_hash_find(const CSVHashTable_t *table, const char *key, size_t size, uint64_t hash, size_t *entry)
+	{
+		if (!table->count)
+			return false;
+		size_t mask = table->capacity - 1;
+		for (size_t i = hash & mask; table->slots[i].entry; i = (i + 1) & mask)
+		{
+			size_t e = table->slots[i].entry - 1;
+			if (table->slots[i].hash == hash && table->offsets[e + 1] - table->offsets[e] == size &&
+				memcmp(table->keys.data + table->offsets[e], key, size) == 0)
+			{
+				*entry = e;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* Find @p key, adding it when missing; @p entry receives its number either way. */
+	static bool csvee_hash_insert(CSVHashTable_t *table, const char *key, size_t size, uint64_t hash, size_t *entry, bool *added)
+	{
+		if ((table->count + 1) * 4 > table->capacity * 3 && !csvee_hash_grow(table))
+			return false;
+
+		size_t mask = table->capacity - 1, i = hash & mask;
+		for (; table->slots[i].entry; i = (i + 1) & mask)
+		{
+			size_t e = table->slots[i].entry - 1;
+			if (table->slots[i].hash == hash && table->offsets[e + 1] - table->offsets[e] == size &&
+				memcmp(table->keys.data + table->offsets[e], key, size) == 0)
+			{
+				*entry = e;
+				*added = false;
+				return true;
+			}
+		}
+
+		if (table->count + 2 > table->offsets_cap)
+		{
+			size_t capacity = table->offsets_cap ? table->offsets_cap * 2 : 64;
+			size_t *offsets = (size_t *)realloc(table->offsets, capacity * sizeof(size_t));
+			if (!offsets)
+				return false;
+			offsets[0] = 0;
+			table->offsets = offsets;
+			table->offsets_cap = capacity;
+		}
+		if (!csvee_buffer_append(&table->keys, key, size))
+			return false;
+		table->offsets[table->count + 1] = table->keys.size;
+		table->slots[i].hash = hash;
+		table->slots[i].entry = ++table->count;
+		*entry = table->count - 1;
+		*added = true;
+		return true;
+	}
+
+	/* Forget every entry but keep the memory. */
+	static void csvee_hash_clear(CSVHashTable_t *table)
+	{
+		if (table->slots)
+			memset(table->slots, 0, table->capacity * sizeof(CSVHashSlot_t));
+		table->count = 0;
+		table->keys.size = 0;
+	}
+
+	static void csvee_hash_free(CSVHashTable_t *table)
+	{
+		free(table->slots);
+		free(table->offsets);
+		csvee_buffer_free(&table->keys);
+		memset(table, 0, sizeof(*table));
+	}
+
+	/* Memory the entries take, counting slots at the highest load factor; cleared tables keep their allocations for reuse. */
+	static size_t csvee_hash_bytes(const CSVHashTable_t *table)
+	{
+		return table->count * (sizeof(CSVHashSlot_t) * 4 / 3 + sizeof(size_t)) + table->keys.size;
+	}
+
+	/* A whole field that is a number, spaces around it allowed. */
+	static bool csvee_group_number(const char *text, size_t size, double *value)
+	{
+		char scratch[64];
+		while (size && (*text == ' ' || *text == '\t'))
+		{
+			++text;
+			--size;
+		}
+		while (size && (text[size - 1] == ' ' || text[size - 1] == '\t'))
+			--size;
+		if (!size || size >= sizeof(scratch))
+			return false;
+		memcpy(scratch, text, size);
+		scratch[size] = '\0';
+		char *end = NULL;
+		*value = strtod(scratch, &end);
+		return end == scratch + size && *value == *value;
+	}
+
+	/* csvee_group_number() limited to decimal notation: strtod would take "inf", "nan" and hex too. */
+	static bool csvee_decimal_number(const char *text, size_t size, double *value)
+	{
+		bool digits = false;
+		for (size_t j = 0; j < size && !digits; ++j)
+			digits = text[j] >= '0' && text[j] <= '9';
+		size_t i = 0;
+		while (i < size && (text[i] == ' ' || text[i] == '\t'))
+			++i;
+		if (i < size && (text[i] == '-' || text[i] == '+'))
+			++i;
+		if (size > i + 1 && text[i] == '0' && (text[i + 1] == 'x' || text[i + 1] == 'X'))
+			return false;
+		return digits && csvee_group_number(text, size, value);
+	}
+
+	static bool csvee_agg_numeric(CSVAggOp_t op)
+	{
+		return op != CSVEE_AGG_COUNT && op != CSVEE_AGG_COUNT_DISTINCT;
+	}
+
+	static void csvee_agg_add(CSVAggState_t *state, double value)
+	{
+		if (!state->count || value < state->min)
+			state->min = value;
+		if (!state->count || value > state->max)
+			state->max = value;
+		state->sum += value;
+		state->count++;
+	}
+
+	static void csvee_agg_combine(CSVAggState_t *into, const CSVAggState_t *from, CSVAggOp_t op)
+	{
+		if (op == CSVEE_AGG_COUNT_DISTINCT || !from->count)
+			return; /* distinct values are counted again as they are merged */
+		if (!into->count || from->min < into->min)
+			into->min = from->min;
+		if (!into->count || from->max > into->max)
+			into->max = from->max;
+		into->sum += from->sum;
+		into->count += from->count;
+	}
+
+	/* Find or add the group with @p key, zeroing the aggregates of a new one. */
+	static bool csvee_group_find(CSVGroupTable_t *table, const char *key, size_t size, size_t *group)
+	{
+		bool added;
+		if (!csvee_hash_insert(&table->groups, key, size, csvee_hash(key, size), group, &added))
+			return false;
+		if (!added)
+			return true;
+
+		if (table->groups.count > table->states_cap)
+		{
+			size_t capacity = table->states_cap ? table->states_cap * 2 : 64;
+			CSVAggState_t *states = (CSVAggState_t *)realloc(table->states, capacity * table->naggregates * sizeof(CSVAggState_t) + 1);
+			if (!states)
+				return false;
+			table->states = states;
+			table->states_cap = capacity;
+		}
+		memset(&table->states[*group * table->naggregates], 0, table->naggregates * sizeof(CSVAggState_t));
+		return true;
+	}
+
+	/* Record @p value for a COUNT_DISTINCT aggregate of @p group. */
+	static bool csvee_group_distinct(CSVGroupTable_t *table, size_t group, size_t aggregate, const char *value, size_t size)
+	{
+		CSVBuffer_t *key = &table->scratch;
+		key->size = 0;
+		if (!csvee_buffer_put_varint(key, group) || !csvee_buffer_put_varint(key, aggregate) ||
+			!csvee_buffer_append(key, value, size))
+			return false;
+
+		size_t entry;
+		bool added;
+		if (!csvee_hash_insert(&table->distinct, key->data, key->size, csvee_hash(key->data, key->size), &entry, &added))
+			return false;
+		if (added)
+			table->states[group * table->naggregates + aggregate].count++;
+		return true;
+	}
+
+	/* Fold the groups of @p from into @p into. */
+	static bool csvee_group_absorb(CSVGroupTable_t *into, const CSVGroupTable_t *from, const CSVAggregate_t *aggregates)
+	{
+		const CSVHashTable_t *groups = &from->groups;
+		size_t *map = (size_t *)malloc(groups->count * sizeof(size_t) + 1);
+		if (!map)
+			return false;
+
+		bool ok = true;
+		for (size_t g = 0; ok && g < groups->count; ++g)
+		{
+			ok = csvee_group_find(into, groups->keys.data + groups->offsets[g], groups->offsets[g + 1] - groups->offsets[g], &map[g]);
+			for (size_t a = 0; ok && a < into->naggregates; ++a)
+				csvee_agg_combine(&into->states[map[g] * into->naggregates + a], &from->states[g * from->naggregates + a], aggregates[a].op);
+		}
+
+		const CSVHashTable_t *distinct = &from->distinct;
+		for (size_t d = 0; ok && d < distinct->count; ++d)
+		{
+			const unsigned char *cursor = (const unsigned char *)distinct->keys.data + distinct->offsets[d];
+			const unsigned char *end = (const unsigned char *)distinct->keys.data + distinct->offsets[d + 1];
+			uint64_t group, aggregate;
+			ok = csvee_get_varint(&cursor, end, &group) && csvee_get_varint(&cursor, end, &aggregate) &&
+				 csvee_group_distinct(into, map[group], (size_t)aggregate, (const char *)cursor, (size_t)(end - cursor));
+		}
+		free(map);
+		return ok;
+	}
+
+	/*
+	 * Aggregate a batch of row records: each is a varint length and the
+	 * group key, then a varint length and the field for every aggregate
+	 * other than COUNT.
+	 */
+	static bool csvee_group_consume(CSVGroupTable_t *table, const CSVAggregate_t *aggregates, const char *data, size_t size)
+	{
+		const unsigned char *cursor = (const unsigned char *)data, *end = cursor + size;
+		double numbers[16]; /* parsed once when several aggregates read a column */
+		bool parsed[16];
+		while (cursor < end)
+		{
+			uint64_t len;
+			size_t group;
+			if (!csvee_get_varint(&cursor, end, &len) || len > (uint64_t)(end - cursor) ||
+				!csvee_group_find(table, (const char *)cursor, (size_t)len, &group))
+				return false;
+			cursor += len;
+
+			for (size_t a = 0; a < table->naggregates; ++a)
+			{
+				CSVAggState_t *state = &table->states[group * table->naggregates + a];
+				if (aggregates[a].op == CSVEE_AGG_COUNT)
+				{
+					state->count++;
+					continue;
+				}
+				if (!csvee_get_varint(&cursor, end, &len) || len > (uint64_t)(end - cursor))
+					return false;
+				const char *value = (const char *)cursor;
+				cursor += len;
+
+				if (aggregates[a].op == CSVEE_AGG_COUNT_DISTINCT)
+				{
+					if (len && !csvee_group_distinct(table, group, a, value, (size_t)len))
+						return false;
+					continue;
+				}
+
+				/* the first numeric aggregate of this column parsed it already */
+				size_t b = 0;
+				while (b < a && (aggregates[b].column != aggregates[a].column || !csvee_agg_numeric(aggregates[b].op)))
+					++b;
+				double number = 0.0;
+				bool ok;
+				if (b < a && b < 16)
+				{
+					number = numbers[b];
+					ok = parsed[b];
+				}
+				else
+					ok = csvee_group_number(value, (size_t)len, &number);
+				if (a < 16)
+				{
+					numbers[a] = number;
+					parsed[a] = ok;
+				}
+				if (ok)
+					csvee_agg_add(state, number);
+			}
+		}
+		return true;
+	}
+
+	/* Append to the partition file of @p key, opening it on first use. */
+	static bool csvee_group_spill_put(CSVGroupJob_t *job, const char *key, size_t size)
+	{
+		size_t p = (size_t)(csvee_hash(key, size) % CSVEE_GROUP_PARTITIONS);
+		if (!job->partitions[p] && !(job->partitions[p] = csvee_spill_open(NULL)))
+			return false;
+		return fwrite(job->spill.data, 1, job->spill.size, job->partitions[p]) == job->spill.size;
+	}
+
+	/*
+	 * Move the groups of @p table to the partition files, by hash of the
+	 * group key, and empty it. Records are 'G', the key and the state of
+	 * every aggregate, or 'D', the key, an aggregate index and one of its
+	 * distinct values.
+	 */
+	static bool csvee_group_spill(CSVGroupJob_t *job, CSVGroupTable_t *table)
+	{
+		const CSVHashTable_t *groups = &table->groups;
+		CSVBuffer_t *record = &job->spill;
+		bool ok = true;
+
+#ifndef CSVEE_NO_THREADS
+		csvee_mutex_lock(&job->lock);
+#endif
+		job->spilled = true;
+		for (size_t g = 0; ok && g < groups->count; ++g)
+		{
+			const char *key = groups->keys.data + groups->offsets[g];
+			size_t size = groups->offsets[g + 1] - groups->offsets[g];
+			record->size = 0;
+			ok = csvee_buffer_append(record, "G", 1) && csvee_buffer_put_varint(record, size) &&
+				 csvee_buffer_append(record, key, size);
+			for (size_t a = 0; ok && a < table->naggregates; ++a)
+			{
+				const CSVAggState_t *state = &table->states[g * table->naggregates + a];
+				ok = csvee_buffer_put_varint(record, state->count) && csvee_buffer_append(record, (const char *)&state->sum, sizeof(double)) &&
+					 csvee_buffer_append(record, (const char *)&state->min, sizeof(double)) &&
+					 csvee_buffer_append(record, (const char *)&state->max, sizeof(double));
+			}
+			ok = ok && csvee_group_spill_put(job, key, size);
+		}
+
+		const CSVHashTable_t *distinct = &table->distinct;
+		for (size_t d = 0; ok && d < distinct->count; ++d)
+		{
+			const unsigned char *cursor = (const unsigned char *)distinct->keys.data + distinct->offsets[d];
+			const unsigned char *end = (const unsigned char *)distinct->keys.data + distinct->offsets[d + 1];
+			uint64_t group, aggregate;
+			ok = csvee_get_varint(&cursor, end, &group) && csvee_get_varint(&cursor, end, &aggregate);
+			if (!ok)
+				break;
+			const char *key = groups->keys.data + groups->offsets[group];
+			size_t size = groups->offsets[group + 1] - groups->offsets[group];
+			record->size = 0;
+			ok = csvee_buffer_append(record, "D", 1) && csvee_buffer_put_varint(record, size) &&
+				 csvee_buffer_append(record, key, size) && csvee_buffer_put_varint(record, aggregate) &&
+				 csvee_buffer_put_varint(record, (uint64_t)(end - cursor)) &&
+				 csvee_buffer_append(record, (const char *)cursor, (size_t)(end - cursor)) &&
+				 csvee_group_spill_put(job, key, size);
+		}
+#ifndef CSVEE_NO_THREADS
+		csvee_mutex_unlock(&job->lock);
+#endif
+
+		csvee_group_clear(table);
+		return ok;
+	}
+
+	/* Read a partition file written by csvee_group_spill() back into @p table. */
+	static bool csvee_group_load(CSVGroupTable_t *table, const CSVAggregate_t *aggregates, FILE *file)
+	{
+		CSVBuffer_t record = {NULL, 0, 0};
+		bool ok = true;
+		int type;
+		while (ok && (type = getc(file)) != EOF)
+		{
+			uint64_t size;
+			size_t group;
+			record.size = 0;
+			ok = (type == 'G' || type == 'D') && csvee_sort_read_varint(file, &size) &&
+				 csvee_buffer_reserve(&record, (size_t)size) && fread(record.data, 1, (size_t)size, file) == size &&
+				 csvee_group_find(table, record.data, (size_t)size, &group);
+
+			for (size_t a = 0; ok && type == 'G' && a < table->naggregates; ++a)
+			{
+				CSVAggState_t state;
+				ok = csvee_sort_read_varint(file, &state.count) && fread(&state.sum, sizeof(double), 1, file) == 1 &&
+					 fread(&state.min, sizeof(double), 1, file) == 1 && fread(&state.max, sizeof(double), 1, file) == 1;
+				if (ok)
+					csvee_agg_combine(&table->states[group * table->naggregates + a], &state, aggregates[a].op);
+			}
+
+			uint64_t aggregate, len;
+			if (ok && type == 'D')
+			{
+				ok = csvee_sort_read_varint(file, &aggregate) && aggregate < table->naggregates &&
+					 csvee_sort_read_varint(file, &len) && csvee_buffer_reserve(&record, (size_t)len) &&
+					 fread(record.data, 1, (size_t)len, file) == len &&
+					 csvee_group_distinct(table, group, (size_t)aggregate, record.data, (size_t)len);
+			}
+		}
+		csvee_buffer_free(&record);
+		return ok && !ferror(file);
+	}
+
+	/* Write the groups of @p table to @p sink, ordered by key: the group columns, then the aggregates. */
+	static bool csvee_group_emit(const CSVGroupTable_t *table, const CSVAggregate_t *aggregates, size_t ncolumns, CSVSink_t *sink, const CSVDialect_t *dialect)
+	{
+		const CSVHashTable_t *groups = &table->groups;
+		size_t count = groups->count, naggregates = table->naggregates;
+		CSVSortItem_t *items = (CSVSortItem_t *)malloc(count * sizeof(CSVSortItem_t) + 1);
+		CSVSortItem_t *tmp = (CSVSortItem_t *)malloc(count * sizeof(CSVSortItem_t) + 1);
+		CSVField_t *fields = (CSVField_t *)malloc((ncolumns + naggregates) * sizeof(CSVField_t) + 1);
+		char *numbers = (char *)malloc(naggregates * 32 + 1);
+		bool ok = items && tmp && fields && numbers;
+
+		for (size_t g = 0; ok && g < count; ++g)
+		{
+			items[g].offset = groups->offsets[g];
+			items[g].key_len = (uint32_t)(groups->offsets[g + 1] - groups->offsets[g]);
+			items[g].prefix = csvee_sort_prefix(groups->keys.data + items[g].offset, items[g].key_len);
+			items[g].row = g;
+		}
+		if (ok)
+			csvee_sort_radix(items, tmp, count, groups->keys.data);
+
+		CSVRow_t row = {fields, ncolumns + naggregates, ncolumns + naggregates};
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			const char *key = groups->keys.data + items[i].offset;
+			for (size_t c = 0; c < ncolumns; ++c)
+			{
+				fields[c].type = CSVEE_STRING;
+				fields[c].value._string = (char *)key;
+				key += strlen(key) + 1;
+			}
+			for (size_t a = 0; a < naggregates; ++a)
+			{
+				const CSVAggState_t *state = &table->states[items[i].row * naggregates + a];
+				char *text = numbers + a * 32;
+				if (aggregates[a].op == CSVEE_AGG_COUNT || aggregates[a].op == CSVEE_AGG_COUNT_DISTINCT)
+					snprintf(text, 32, "%llu", (unsigned long long)state->count);
+				else if (!state->count)
+					text[0] = '\0'; /* no numbers in the group */
+				else
+				{
+					double value = aggregates[a].op == CSVEE_AGG_SUM   ? state->sum
+								   : aggregates[a].op == CSVEE_AGG_MIN ? state->min
+								   : aggregates[a].op == CSVEE_AGG_MAX ? state->max
+																	   : state->sum / (double)state->count;
+					snprintf(text, 32, "%.15g", value);
+				}
+				fields[ncolumns + a].type = CSVEE_STRING;
+				fields[ncolumns + a].value._string = text;
+			}
+			ok = csvee_format_row(&sink->block, &row, dialect, dialect->lineterminator, NULL);
+			if (ok && sink->block.size >= sink->block_size)
+				ok = csvee_sink_flush(sink);
+		}
+
+		free(numbers);
+		free(fields);
+		free(tmp);
+		free(items);
+		return ok;
+	}
+
+	static size_t csvee_group_bytes(const CSVGroupTable_t *table)
+	{
+		return csvee_hash_bytes(&table->groups) + csvee_hash_bytes(&table->distinct) +
+			   table->groups.count * table->naggregates * sizeof(CSVAggState_t);
+	}
+
+	static void csvee_group_clear(CSVGroupTable_t *table)
+	{
+		csvee_hash_clear(&table->groups);
+		csvee_hash_clear(&table->distinct);
+	}
+
+	static void csvee_group_free(CSVGroupTable_t *table)
+	{
+		csvee_hash_free(&table->groups);
+		csvee_hash_free(&table->distinct);
+		free(table->states);
+		table->states = NULL;
+		table->states_cap = 0;
+		csvee_buffer_free(&table->scratch);
+	}
+
+	/* Room for one more record and its key. */
+	static bool csvee_join_grow(CSVJoinTable_t *table)
+	{
+		if (table->keys.count > table->key_cap)
+		{
+			size_t capacity = table->key_cap ? table->key_cap * 2 : 64;
+			size_t *first = (size_t *)realloc(table->first, capacity * sizeof(size_t));
+			if (first)
+				table->first = first;
+			size_t *last = (size_t *)realloc(table->last, capacity * sizeof(size_t));
+			if (last)
+				table->last = last;
+			if (!first || !last)
+				return false;
+			table->key_cap = capacity;
+		}
+		if (table->count + 2 > table->record_cap)
+		{
+			size_t capacity = table->record_cap ? table->record_cap * 2 : 64;
+			size_t *next = (size_t *)realloc(table->next, capacity * sizeof(size_t));
+			if (next)
+				table->next = next;
+			size_t *offsets = (size_t *)realloc(table->offsets, capacity * sizeof(size_t));
+			if (offsets)
+				table->offsets = offsets;
+			uint64_t *matched = (uint64_t *)realloc(table->matched, (capacity / 64 + 1) * sizeof(uint64_t));
+			if (matched)
+				table->matched = matched;
+			if (!next || !offsets || !matched)
+				return false;
+			if (!table->record_cap)
+				table->offsets[0] = 0;
+			memset(table->matched + table->record_cap / 64, 0, (capacity / 64 + 1 - table->record_cap / 64) * sizeof(uint64_t));
+			table->record_cap = capacity;
+		}
+		return true;
+	}
+
+	/* Add a build record: its key is interned, its formatted fields appended. */
+	static bool csvee_join_add(CSVJoinTable_t *table, const char *key, size_t key_len, const char *fields, size_t size)
+	{
+		size_t id;
+		bool added;
+		if (!csvee_hash_insert(&table->keys, key, key_len, csvee_hash(key, key_len), &id, &added) ||
+			!csvee_join_grow(table) || !csvee_buffer_append(&table->fields, fields, size))
+			return false;
+
+		size_t r = table->count++;
+		table->offsets[r + 1] = table->fields.size;
+		table->next[r] = SIZE_MAX;
+		if (added)
+			table->first[id] = r;
+		else
+			table->next[table->last[id]] = r;
+		table->last[id] = r;
+		return true;
+	}
+
+	static size_t csvee_join_bytes(const CSVJoinTable_t *table)
+	{
+		return csvee_hash_bytes(&table->keys) + table->keys.count * 2 * sizeof(size_t) +
+			   table->count * (2 * sizeof(size_t) + 1) + table->fields.size;
+	}
+
+	static void csvee_join_clear(CSVJoinTable_t *table)
+	{
+		csvee_hash_clear(&table->keys);
+		if (table->matched)
+			memset(table->matched, 0, (table->record_cap / 64 + 1) * sizeof(uint64_t));
+		table->count = 0;
+		table->fields.size = 0;
+	}
+
+	static void csvee_join_free(CSVJoinTable_t *table)
+	{
+		csvee_hash_free(&table->keys);
+		free(table->first);
+		free(table->last);
+		free(table->next);
+		free(table->offsets);
+		free(table->matched);
+		csvee_buffer_free(&table->fields);
+		memset(table, 0, sizeof(*table));
+	}
+
+	/* Append one output line: @p a, the right side after a delimiter unless SEMI/ANTI, the terminator. */
+	static bool csvee_join_line(CSVJoinJob_t *job, CSVBuffer_t *lines, const char *a, size_t a_len, const char *b, size_t b_len, bool pair)
+	{
+		char delim = job->dialect->delimiter, term = job->dialect->lineterminator;
+		return csvee_buffer_reserve(lines, a_len + b_len + 2) && csvee_buffer_append(lines, a, a_len) &&
+			   (!pair || (csvee_buffer_append(lines, &delim, 1) && csvee_buffer_append(lines, b, b_len))) &&
+			   csvee_buffer_append(lines, &term, 1);
+	}
+
+	/*
+	 * Join a batch of probe records (varint length and key, varint length
+	 * and formatted fields) against the build table, appending the output
+	 * lines to @p lines. Records of a left build side that find a match
+	 * are flagged for csvee_join_leftovers().
+	 */
+	static bool csvee_join_probe(CSVJoinJob_t *job, const char *data, size_t size, CSVBuffer_t *lines)
+	{
+		const CSVJoinTable_t *table = &job->table;
+		const unsigned char *cursor = (const unsigned char *)data, *end = cursor + size;
+		bool pairs = job->type == CSVEE_JOIN_INNER || job->type == CSVEE_JOIN_LEFT;
+		bool ok = true;
+		while (ok && cursor < end)
+		{
+			uint64_t key_len, len;
+			if (!csvee_get_varint(&cursor, end, &key_len) || key_len > (uint64_t)(end - cursor))
+				return false;
+			const char *key = (const char *)cursor;
+			cursor += key_len;
+			if (!csvee_get_varint(&cursor, end, &len) || len > (uint64_t)(end - cursor))
+				return false;
+			const char *fields = (const char *)cursor;
+			cursor += len;
+
+			size_t id;
+			bool found = csvee_hash_find(&table->keys, key, (size_t)key_len, csvee_hash(key, (size_t)key_len), &id);
+			if (job->build_left)
+			{
+				for (size_t r = found ? table->first[id] : SIZE_MAX; ok && r != SIZE_MAX; r = table->next[r])
+				{
+					CSVEE_ATOMIC_OR(&table->matched[r / 64], (uint64_t)1 << (r % 64));
+					if (pairs)
+						ok = csvee_join_line(job, lines, table->fields.data + table->offsets[r], table->offsets[r + 1] - table->offsets[r],
+											 fields, (size_t)len, true);
+				}
+			}
+			else if (!pairs)
+			{
+				if (found == (job->type == CSVEE_JOIN_SEMI))
+					ok = csvee_join_line(job, lines, fields, (size_t)len, NULL, 0, false);
+			}
+			else if (!found)
+			{
+				if (job->type == CSVEE_JOIN_LEFT)
+					ok = csvee_join_line(job, lines, fields, (size_t)len, job->padding.data, job->padding.size, true);
+			}
+			else
+			{
+				for (size_t r = table->first[id]; ok && r != SIZE_MAX; r = table->next[r])
+					ok = csvee_join_line(job, lines, fields, (size_t)len, table->fields.data + table->offsets[r],
+										 table->offsets[r + 1] - table->offsets[r], true);
+			}
+		}
+		return ok;
+	}
+
+	/* Once the probe side is done: the left build records LEFT, SEMI or ANTI still owes the output. */
+	static bool csvee_join_leftovers(CSVJoinJob_t *job)
+	{
+		const CSVJoinTable_t *table = &job->table;
+		CSVSink_t *sink = job->sink;
+		if (!job->build_left || job->type == CSVEE_JOIN_INNER)
+			return true;
+
+		bool ok = true;
+		for (size_t r = 0; ok && r < table->count; ++r)
+		{
+			bool matched = (table->matched[r / 64] >> (r % 64)) & 1;
+			if (matched != (job->type == CSVEE_JOIN_SEMI))
+				continue;
+			ok = csvee_join_line(job, &sink->block, table->fields.data + table->offsets[r], table->offsets[r + 1] - table->offsets[r],
+								 job->padding.data, job->padding.size, job->type == CSVEE_JOIN_LEFT);
+			if (ok && sink->block.size >= sink->block_size)
+				ok = csvee_sink_flush(sink);
+		}
+		return ok;
+	}
+
+	/* Natural logarithm for x >= 1, so the header does not need libm. */
+	static double csvee_log(double x)
+	{
+		int exponent = 0;
+		for (; x >= 2.0; x /= 2.0)
+			exponent++;
+		double y = (x - 1.0) / (x + 1.0), y2 = y * y, term = y, sum = 0.0;
+		for (int k = 1; k < 40; k += 2, term *= y2)
+			sum += term / k;
+		return 2.0 * sum + exponent * 0.69314718055994530942;
+	}
+
+	/* Order centroids by mean; a quicksort of its own is several times faster than qsort() here. */
+	static void csvee_centroid_sort(CSVCentroid_t *c, size_t n)
+	{
+		while (n > 16)
+		{
+			CSVCentroid_t swap;
+			double a = c[0].mean, b = c[n / 2].mean, z = c[n - 1].mean;
+			double pivot = a < b ? (b < z ? b : (a < z ? z : a)) : (a < z ? a : (b < z ? z : b));
+			size_t i = 0, j = n - 1;
+			for (;;)
+			{
+				while (c[i].mean < pivot)
+					++i;
+				while (c[j].mean > pivot)
+					--j;
+				if (i >= j)
+					break;
+				swap = c[i];
+				c[i++] = c[j];
+				c[j--] = swap;
+			}
+			/* recurse on the smaller side, loop on the larger */
+			if (j + 1 < n - j - 1)
+			{
+				csvee_centroid_sort(c, j + 1);
+				c += j + 1;
+				n -= j + 1;
+			}
+			else
+			{
+				csvee_centroid_sort(c + j + 1, n - j - 1);
+				n = j + 1;
+			}
+		}
+		for (size_t i = 1; i < n; ++i)
+		{
+			CSVCentroid_t item = c[i];
+			size_t j = i;
+			for (; j > 0 && c[j - 1].mean > item.mean; --j)
+				c[j] = c[j - 1];
+			c[j] = item;
+		}
+	}
+
+	/*
+	 * Merge the unmerged values into the centroids: a centroid around
+	 * quantile q may grow to 4 * n * q * (1 - q) / compression, so the
+	 * tails stay exact and the middle is summarised the most.
+	 */
+	static void csvee_digest_compress(CSVSketch_t *sketch)
+	{
+		CSVCentroid_t *c = sketch->centroids;
+		size_t n = sketch->centroid_count;
+		if (sketch->merged == n)
+			return;
+		csvee_centroid_sort(c, n);
+
+		double total = 0.0, below = 0.0;
+		for (size_t i = 0; i < n; ++i)
+			total += c[i].weight;
+		size_t o = 0;
+		for (size_t i = 1; i < n; ++i)
+		{
+			double weight = c[o].weight + c[i].weight;
+			double q = (below + weight / 2.0) / total;
+			if (weight <= 4.0 * total * q * (1.0 - q) / sketch->compression)
+			{
+				c[o].mean += (c[i].mean - c[o].mean) * c[i].weight / weight;
+				c[o].weight = weight;
+			}
+			else
+			{
+				below += c[o].weight;
+				c[++o] = c[i];
+			}
+		}
+		sketch->centroid_count = sketch->merged = o + 1;
+	}
+
+	static bool csvee_digest_add(CSVSketch_t *sketch, double value, double weight)
+	{
+		if (sketch->centroid_count == sketch->centroid_cap)
+		{
+			csvee_digest_compress(sketch);
+			/* keep several times the compressed size free, or compressing would run too often */
+			if (sketch->centroid_count * 2 >= sketch->centroid_cap)
+			{
+				size_t capacity = sketch->centroid_cap ? sketch->centroid_cap * 2 : (size_t)(sketch->compression * 10) + 64;
+				CSVCentroid_t *centroids = (CSVCentroid_t *)realloc(sketch->centroids, capacity * sizeof(CSVCentroid_t));
+				if (!centroids)
+					return false;
+				sketch->centroids = centroids;
+				sketch->centroid_cap = capacity;
+			}
+		}
+		sketch->centroids[sketch->centroid_count].mean = value;
+		sketch->centroids[sketch->centroid_count].weight = weight;
+		sketch->centroid_count++;
+		return true;
+	}
+
+	static void csvee_hll_add(uint8_t *registers, uint64_t hash)
+	{
+		size_t index = (size_t)(hash >> (64 - CSVEE_PROFILE_HLL_BITS));
+		uint64_t rest = hash << CSVEE_PROFILE_HLL_BITS;
+		uint8_t rank = 1;
+		for (; rank <= 64 - CSVEE_PROFILE_HLL_BITS && !(rest & 0x8000000000000000ull); ++rank)
+			rest <<= 1;
+		if (rank > registers[index])
+			registers[index] = rank;
+	}
+
+	/* Add one occurrence of @p hash and return its estimated count. */
+	static uint64_t csvee_cms_add(CSVSketch_t *sketch, uint64_t hash)
+	{
+		uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32);
+		uint64_t estimate = UINT64_MAX;
+		for (uint32_t d = 0; d < CSVEE_PROFILE_CMS_DEPTH; ++d)
+		{
+			uint64_t *counter = &sketch->cms[d][(h1 + d * h2) & (CSVEE_PROFILE_CMS_WIDTH - 1)];
+			if (++*counter < estimate)
+				estimate = *counter;
+		}
+		return estimate;
+	}
+
+	static uint64_t csvee_cms_estimate(const CSVSketch_t *sketch, uint64_t hash)
+	{
+		uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32);
+		uint64_t estimate = UINT64_MAX;
+		for (uint32_t d = 0; d < CSVEE_PROFILE_CMS_DEPTH; ++d)
+		{
+			uint64_t counter = sketch->cms[d][(h1 + d * h2) & (CSVEE_PROFILE_CMS_WIDTH - 1)];
+			if (counter < estimate)
+				estimate = counter;
+		}
+		return estimate;
+	}
+
+	/* Index of @p text among the top values, SIZE_MAX if it is not one. */
+	static size_t csvee_profile_top_find(const CSVColumnProfile_t *column, const char *text, size_t size)
+	{
+		for (size_t i = 0; i < column->top_count; ++i)
+			if (strncmp(column->top[i].value, text, size) == 0 && column->top[i].value[size] == '\0')
+				return i;
+		return SIZE_MAX;
+	}
+
+	static bool csvee_profile_top_append(CSVColumnProfile_t *column, const char *text, size_t size, uint64_t count)
+	{
+		CSVSketch_t *sketch = column->sketch;
+		if (column->top_count == sketch->top_cap)
+		{
+			size_t capacity = sketch->top_cap ? sketch->top_cap * 2 : sketch->top_k;
+			CSVTopValue_t *top = (CSVTopValue_t *)realloc(column->top, capacity * sizeof(CSVTopValue_t));
+			if (!top)
+				return false;
+			column->top = top;
+			sketch->top_cap = capacity;
+		}
+		char *value = (char *)malloc(size + 1);
+		if (!value)
+			return false;
+		memcpy(value, text, size);
+		value[size] = '\0';
+		column->top[column->top_count].value = value;
+		column->top[column->top_count].count = count;
+		column->top_count++;
+		return true;
+	}
+
+	/* Keep @p text among the top values if its estimate beats the smallest one there. */
+	static bool csvee_profile_top(CSVColumnProfile_t *column, const char *text, size_t size, uint64_t estimate)
+	{
+		CSVSketch_t *sketch = column->sketch;
+		bool full = column->top_count >= sketch->top_k;
+		if (full && estimate <= sketch->top_min)
+			return true;
+
+		size_t found = csvee_profile_top_find(column, text, size);
+		if (found != SIZE_MAX)
+			column->top[found].count = estimate;
+		else if (!full)
+		{
+			if (!csvee_profile_top_append(column, text, size, estimate))
+				return false;
+		}
+		else
+		{
+			size_t smallest = 0;
+			for (size_t i = 1; i < column->top_count; ++i)
+				if (column->top[i].count < column->top[smallest].count)
+					smallest = i;
+			char *value = (char *)malloc(size + 1);
+			if (!value)
+				return false;
+			memcpy(value, text, size);
+			value[size] = '\0';
+			free(column->top[smallest].value);
+			column->top[smallest].value = value;
+			column->top[smallest].count = estimate;
+		}
+
+		if (column->top_count >= sketch->top_k)
+		{
+			sketch->top_min = UINT64_MAX;
+			for (size_t i = 0; i < column->top_count; ++i)
+				if (column->top[i].count < sketch->top_min)
+					sketch->top_min = column->top[i].count;
+		}
+		return true;
+	}
+
+	/* What a non-empty field holds: CSVEE_BOOL, CSVEE_INTEGER, CSVEE_DOUBLE (with @p number) or CSVEE_STRING. */
+	static CSVData_t csvee_profile_kind(const char *text, size_t size, double *number)
+	{
+		if ((size == 4 && strncasecmp(text, "true", 4) == 0) || (size == 5 && strncasecmp(text, "false", 5) == 0))
+			return CSVEE_BOOL;
+
+		size_t i = text[0] == '-' || text[0] == '+';
+		if (i < size && size - i <= 18)
+		{
+			int64_t value = 0;
+			size_t j = i;
+			for (; j < size && text[j] >= '0' && text[j] <= '9'; ++j)
+				value = value * 10 + (text[j] - '0');
+			if (j == size)
+			{
+				*number = (double)(text[0] == '-' ? -value : value);
+				return CSVEE_INTEGER;
+			}
+		}
+		if (csvee_decimal_number(text, size, number))
+			return CSVEE_DOUBLE;
+		return CSVEE_STRING;
+	}
+
+	static bool csvee_profile_number(CSVColumnProfile_t *column, double number)
+	{
+		uint64_t n = column->integers + column->doubles;
+		if (n == 1 || number < column->min)
+			column->min = number;
+		if (n == 1 || number > column->max)
+			column->max = number;
+		double delta = number - column->mean;
+		column->mean += delta / (double)n;
+		column->m2 += delta * (number - column->mean);
+		return csvee_digest_add(column->sketch, number, 1.0);
+	}
+
+	static bool csvee_profile_value(CSVColumnProfile_t *column, const char *text, size_t size)
+	{
+		CSVSketch_t *sketch = column->sketch;
+		column->count++;
+		if (!size)
+		{
+			column->nulls++;
+			return true;
+		}
+
+		uint64_t hash = csvee_hash(text, size);
+		csvee_hll_add(sketch->hll, hash);
+		if (!csvee_profile_top(column, text, size, csvee_cms_add(sketch, hash)))
+			return false;
+
+		double number = 0.0;
+		switch (csvee_profile_kind(text, size, &number))
+		{
+		case CSVEE_BOOL:
+			column->bools++;
+			return true;
+		case CSVEE_INTEGER:
+			column->integers++;
+			return csvee_profile_number(column, number);
+		case CSVEE_DOUBLE:
+			column->doubles++;
+			return csvee_profile_number(column, number);
+		default:
+			column->strings++;
+			return true;
+		}
+	}
+
+	static void csvee_profile_init(CSVProfile_t *profile, size_t top_k, double compression)
+	{
+		memset(profile, 0, sizeof(*profile));
+		profile->top_k = top_k ? top_k : CSVEE_PROFILE_TOP_K;
+		profile->compression = compression > 0.0 ? compression : CSVEE_PROFILE_COMPRESSION;
+	}
+
+	/* Columns up to @p count; earlier records did not have the new ones, so those count as nulls. */
+	static bool csvee_profile_widen(CSVProfile_t *profile, size_t count)
+	{
+		if (count <= profile->count)
+			return true;
+		CSVColumnProfile_t *columns = (CSVColumnProfile_t *)realloc(profile->columns, count * sizeof(CSVColumnProfile_t));
+		if (!columns)
+			return false;
+		profile->columns = columns;
+		for (; profile->count < count; ++profile->count)
+		{
+			CSVColumnProfile_t *column = &columns[profile->count];
+			memset(column, 0, sizeof(*column));
+			column->count = column->nulls = profile->rows;
+			column->type = CSVEE_NULL;
+			column->sketch = (CSVSketch_t *)calloc(1, sizeof(CSVSketch_t));
+			if (!column->sketch)
+				return false;
+			column->sketch->compression = profile->compression;
+			column->sketch->top_k = profile->top_k;
+		}
+		return true;
+	}
+
+	/* Fold a batch of records in: each a varint field count, then a varint length and the text of every field. */
+	static bool csvee_profile_consume(CSVProfile_t *profile, const char *data, size_t size)
+	{
+		const unsigned char *cursor = (const unsigned char *)data, *end = cursor + size;
+		while (cursor < end)
+		{
+			uint64_t count, len;
+			if (!csvee_get_varint(&cursor, end, &count) || !csvee_profile_widen(profile, (size_t)count))
+				return false;
+			for (size_t c = 0; c < profile->count; ++c)
+			{
+				CSVColumnProfile_t *column = &profile->columns[c];
+				if (c >= count)
+				{
+					column->count++;
+					column->nulls++;
+					continue;
+				}
+				if (!csvee_get_varint(&cursor, end, &len) || len > (uint64_t)(end - cursor) ||
+					!csvee_profile_value(column, (const char *)cursor, (size_t)len))
+					return false;
+				cursor += len;
+			}
+			profile->rows++;
+		}
+		return true;
+	}
+
+	static int csvee_top_compare(const void *a, const void *b)
+	{
+		const CSVTopValue_t *x = (const CSVTopValue_t *)a, *y = (const CSVTopValue_t *)b;
+		if (x->count != y->count)
+			return x->count < y->count ? 1 : -1;
+		return strcmp(x->value, y->value);
+	}
+
+	/* Settle what was built or merged: the digest compressed, the top values re-estimated and ordered, the type decided. */
+	static void csvee_profile_finish(CSVProfile_t *profile)
+	{
+		for (size_t c = 0; c < profile->count; ++c)
+		{
+			CSVColumnProfile_t *column = &profile->columns[c];
+			CSVSketch_t *sketch = column->sketch;
+			csvee_digest_compress(sketch);
+
+			for (size_t i = 0; i < column->top_count; ++i)
+			{
+				const char *value = column->top[i].value;
+				column->top[i].count = csvee_cms_estimate(sketch, csvee_hash(value, strlen(value)));
+			}
+			if (column->top_count)
+				qsort(column->top, column->top_count, sizeof(CSVTopValue_t), csvee_top_compare);
+			for (; column->top_count > sketch->top_k; --column->top_count)
+				free(column->top[column->top_count - 1].value);
+			sketch->top_min = 0;
+			if (column->top_count >= sketch->top_k)
+				sketch->top_min = column->top[column->top_count - 1].count;
+
+			uint64_t numbers = column->integers + column->doubles;
+			if (column->strings || (column->bools && numbers))
+				column->type = CSVEE_STRING;
+			else if (column->bools)
+				column->type = CSVEE_BOOL;
+			else if (column->doubles)
+				column->type = CSVEE_DOUBLE;
+			else if (column->integers)
+				column->type = CSVEE_INTEGER;
+			else
+				column->type = CSVEE_NULL;
+		}
+	}
+
+	/* Take the column names from the header @p row. */
+	static bool csvee_arrow_names(CSVArrowBuilder_t *builder, const CSVRow_t *row)
+	{
+		char scratch[64];
+		builder->names = (char **)calloc(row->count + 1, sizeof(char *));
+		if (!builder->names)
+			return false;
+		builder->names_count = row->count;
+		for (size_t c = 0; c < row->count; ++c)
+			if (!(builder->names[c] = strdup(csvee_field_text(&row->fields[c], scratch, sizeof(scratch)))))
+				return false;
+		return true;
+	}
+
+	/* Append a field to @p column; @p text NULL or empty is a null. */
+	static bool csvee_arrow_push(CSVArrowColumn_t *column, size_t index, const char *text, size_t size)
+	{
+		if (index / 8 >= column->validity.size)
+		{
+			if (!csvee_buffer_reserve(&column->validity, 1))
+				return false;
+			column->validity.data[column->validity.size++] = 0;
+		}
+		if (!size)
+			column->nulls++;
+		else
+		{
+			column->validity.data[index / 8] |= (char)(1 << (index % 8));
+			double number;
+			switch (csvee_profile_kind(text, size, &number))
+			{
+			case CSVEE_BOOL:
+				column->bools++;
+				break;
+			case CSVEE_INTEGER:
+				column->integers++;
+				break;
+			case CSVEE_DOUBLE:
+				column->doubles++;
+				break;
+			default:
+				column->strings++;
+				break;
+			}
+		}
+		if (column->data.size + size > INT32_MAX)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FIELD, "Column text is over the 2GB an Arrow string array can address\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		int32_t end = (int32_t)(column->data.size + size);
+		return csvee_buffer_append(&column->data, text, size) && csvee_buffer_append(&column->offsets, (const char *)&end, sizeof(end));
+	}
+
+	/* Columns up to @p count; earlier records did not have the new ones, so they start with nulls. */
+	static bool csvee_arrow_widen(CSVArrowBuilder_t *builder, size_t count)
+	{
+		if (count <= builder->count)
+			return true;
+		CSVArrowColumn_t *columns = (CSVArrowColumn_t *)realloc(builder->columns, count * sizeof(CSVArrowColumn_t));
+		if (!columns)
+			return false;
+		builder->columns = columns;
+		for (; builder->count < count; ++builder->count)
+		{
+			CSVArrowColumn_t *column = &columns[builder->count];
+			memset(column, 0, sizeof(*column));
+			int32_t start = 0;
+			if (!csvee_buffer_append(&column->offsets, (const char *)&start, sizeof(start)))
+				return false;
+			for (size_t r = 0; r < builder->length; ++r)
+				if (!csvee_arrow_push(column, r, NULL, 0))
+					return false;
+		}
+		return true;
+	}
+
+	static bool csvee_arrow_add(CSVArrowBuilder_t *builder, const CSVRow_t *row)
+	{
+		if (!csvee_arrow_widen(builder, row->count))
+			return false;
+		char scratch[64];
+		for (size_t c = 0; c < builder->count; ++c)
+		{
+			const char *text = c < row->count ? csvee_field_text(&row->fields[c], scratch, sizeof(scratch)) : NULL;
+			if (!csvee_arrow_push(&builder->columns[c], builder->length, text, text ? strlen(text) : 0))
+				return false;
+		}
+		builder->length++;
+		return true;
+	}
+
+	static void csvee_arrow_release_array(struct ArrowArray *array)
+	{
+		CSVArrowArrayData_t *data = (CSVArrowArrayData_t *)array->private_data;
+		for (int64_t c = 0; c < array->n_children; ++c)
+			if (array->children[c]->release)
+				array->children[c]->release(array->children[c]);
+		for (int i = 0; i < 3; ++i)
+			free(data->buffers[i]);
+		free(data->children);
+		free(data->pointers);
+		free(data);
+		array->release = NULL;
+	}
+
+	static void csvee_arrow_release_schema(struct ArrowSchema *schema)
+	{
+		CSVArrowSchemaData_t *data = (CSVArrowSchemaData_t *)schema->private_data;
+		for (int64_t c = 0; c < schema->n_children; ++c)
+			if (schema->children[c]->release)
+				schema->children[c]->release(schema->children[c]);
+		free(data->name);
+		free(data->children);
+		free(data->pointers);
+		free(data);
+		schema->release = NULL;
+	}
+
+	/* Value of a field that passed as CSVEE_INTEGER: a sign and at most 18 digits. */
+	static int64_t csvee_arrow_integer(const char *text, size_t size)
+	{
+		size_t i = text[0] == '-' || text[0] == '+';
+		int64_t value = 0;
+		for (; i < size; ++i)
+			value = value * 10 + (text[i] - '0');
+		return text[0] == '-' ? -value : value;
+	}
+
+	/*
+	 * Turn @p column into the Arrow array @p array and its field
+	 * @p schema: int64 if every value is an integer, double if they are
+	 * all numbers, boolean for true/false, utf8 otherwise. A utf8 array
+	 * takes the gathered text and offsets as they are.
+	 */
+	static bool csvee_arrow_column(CSVArrowColumn_t *column, size_t length, const char *name, struct ArrowSchema *schema, struct ArrowArray *array)
+	{
+		CSVArrowSchemaData_t *schema_data = (CSVArrowSchemaData_t *)calloc(1, sizeof(CSVArrowSchemaData_t));
+		CSVArrowArrayData_t *array_data = (CSVArrowArrayData_t *)calloc(1, sizeof(CSVArrowArrayData_t));
+		if (!schema_data || !array_data || !(schema_data->name = strdup(name)))
+		{
+			if (schema_data)
+				free(schema_data->name);
+			free(schema_data);
+			free(array_data);
+			return false;
+		}
+
+		uint64_t numbers = column->integers + column->doubles;
+		const char *format = "u";
+		if (!column->strings && !(column->bools && numbers))
+			format = column->bools ? "b" : column->doubles ? "g" : column->integers ? "l" : "u";
+
+		const int32_t *offsets = (const int32_t *)column->offsets.data;
+		bool ok = true;
+		if (format[0] == 'u')
+		{
+			array_data->buffers[1] = column->offsets.data;
+			array_data->buffers[2] = column->data.data;
+			memset(&column->offsets, 0, sizeof(CSVBuffer_t));
+			memset(&column->data, 0, sizeof(CSVBuffer_t));
+		}
+		else if (format[0] == 'b')
+		{
+			unsigned char *bits = (unsigned char *)calloc(length / 8 + 1, 1);
+			ok = bits != NULL;
+			for (size_t r = 0; ok && r < length; ++r)
+				if (offsets[r + 1] > offsets[r] && (column->data.data[offsets[r]] == 't' || column->data.data[offsets[r]] == 'T'))
+					bits[r / 8] |= (unsigned char)(1 << (r % 8));
+			array_data->buffers[1] = bits;
+		}
+		else
+		{
+			/* nulls keep a zero in the value buffer */
+			void *values = calloc(length + 1, 8);
+			ok = values != NULL;
+			for (size_t r = 0; ok && r < length; ++r)
+			{
+				const char *text = column->data.data + offsets[r];
+				size_t size = (size_t)(offsets[r + 1] - offsets[r]);
+				if (!size)
+					continue;
+				double number = 0.0;
+				if (format[0] == 'l')
+					((int64_t *)values)[r] = csvee_arrow_integer(text, size);
+				else if (csvee_profile_kind(text, size, &number) != CSVEE_BOOL)
+					((double *)values)[r] = number;
+			}
+			array_data->buffers[1] = values;
+		}
+		if (column->nulls)
+		{
+			array_data->buffers[0] = column->validity.data;
+			memset(&column->validity, 0, sizeof(CSVBuffer_t));
+		}
+
+		memset(schema, 0, sizeof(*schema));
+		schema->format = format;
+		schema->name = schema_data->name;
+		schema->flags = ARROW_FLAG_NULLABLE;
+		schema->release = csvee_arrow_release_schema;
+		schema->private_data = schema_data;
+
+		memset(array, 0, sizeof(*array));
+		array->length = (int64_t)length;
+		array->null_count = (int64_t)column->nulls;
+		array->n_buffers = format[0] == 'u' ? 3 : 2;
+		array->buffers = (const void **)array_data->buffers;
+		array->release = csvee_arrow_release_array;
+		array->private_data = array_data;
+		return ok;
+	}
+
+	/* Hand the gathered columns over as a struct array with one child per column, the layout of a record batch. */
+	static bool csvee_arrow_finish(CSVArrowBuilder_t *builder, struct ArrowSchema *schema, struct ArrowArray *array)
+	{
+		if (!csvee_arrow_widen(builder, builder->names_count))
+			return false;
+		size_t count = builder->count;
+		CSVArrowSchemaData_t *schema_data = (CSVArrowSchemaData_t *)calloc(1, sizeof(CSVArrowSchemaData_t));
+		CSVArrowArrayData_t *array_data = (CSVArrowArrayData_t *)calloc(1, sizeof(CSVArrowArrayData_t));
+		bool ok = schema_data && array_data;
+		if (ok)
+		{
+			schema_data->children = (struct ArrowSchema *)calloc(count + 1, sizeof(struct ArrowSchema));
+			schema_data->pointers = (struct ArrowSchema **)calloc(count + 1, sizeof(struct ArrowSchema *));
+			array_data->children = (struct ArrowArray *)calloc(count + 1, sizeof(struct ArrowArray));
+			array_data->pointers = (struct ArrowArray **)calloc(count + 1, sizeof(struct ArrowArray *));
+			ok = schema_data->children && schema_data->pointers && array_data->children && array_data->pointers;
+		}
+
+		memset(schema, 0, sizeof(*schema));
+		memset(array, 0, sizeof(*array));
+		if (schema_data)
+		{
+			schema->format = "+s";
+			schema->name = "";
+			schema->n_children = (int64_t)count;
+			schema->children = schema_data->pointers;
+			schema->release = csvee_arrow_release_schema;
+			schema->private_data = schema_data;
+		}
+		if (array_data)
+		{
+			array->length = (int64_t)builder->length;
+			array->n_buffers = 1;
+			array->n_children = (int64_t)count;
+			array->buffers = (const void **)array_data->buffers;
+			array->children = array_data->pointers;
+			array->release = csvee_arrow_release_array;
+			array->private_data = array_data;
+		}
+
+		char generated[32];
+		size_t built = 0;
+		for (; ok && built < count; ++built)
+		{
+			size_t c = built;
+			const char *name = c < builder->names_count ? builder->names[c] : NULL;
+			if (!name)
+			{
+				snprintf(generated, sizeof(generated), "f%zu", c);
+				name = generated;
+			}
+			schema_data->pointers[c] = &schema_data->children[c];
+			array_data->pointers[c] = &array_data->children[c];
+			ok = csvee_arrow_column(&builder->columns[c], builder->length, name, &schema_data->children[c], &array_data->children[c]);
+		}
+
+		if (!ok)
+		{
+			/* a child that failed early has no release callback, the others go with their parent */
+			schema->n_children = array->n_children = (int64_t)built;
+			if (schema->release)
+				schema->release(schema);
+			if (array->release)
+				array->release(array);
+		}
+		return ok;
+	}
+
+	static void csvee_arrow_builder_free(CSVArrowBuilder_t *builder)
+	{
+		for (size_t c = 0; c < builder->count; ++c)
+		{
+			csvee_buffer_free(&builder->columns[c].data);
+			csvee_buffer_free(&builder->columns[c].offsets);
+			csvee_buffer_free(&builder->columns[c].validity);
+		}
+		free(builder->columns);
+		for (size_t c = 0; builder->names && c < builder->names_count; ++c)
+			free(builder->names[c]);
+		free(builder->names);
+		memset(builder, 0, sizeof(*builder));
+	}
+
+	static uint64_t csvee_zigzag(int64_t value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	static int64_t csvee_unzigzag(uint64_t value)
+	{
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	static unsigned csvee_bit_width(uint64_t value)
+	{
+		unsigned width = 0;
+		for (; value; value >>= 1)
+			++width;
+		return width;
+	}
+
+	/* OR @p width bits of @p value into @p base from bit @p bit on, least significant bit first. */
+	static void csvee_bits_put(unsigned char *base, size_t bit, unsigned width, uint64_t value)
+	{
+		for (unsigned done = 0; done < width;)
+		{
+			unsigned shift = (unsigned)((bit + done) & 7);
+			unsigned take = 8 - shift < width - done ? 8 - shift : width - done;
+			base[(bit + done) >> 3] |= (unsigned char)(((value >> done) & ((1u << take) - 1)) << shift);
+			done += take;
+		}
+	}
+
+	static uint64_t csvee_bits_get(const unsigned char *base, size_t bit, unsigned width)
+	{
+		uint64_t value = 0;
+		for (unsigned done = 0; done < width;)
+		{
+			unsigned shift = (unsigned)((bit + done) & 7);
+			unsigned take = 8 - shift < width - done ? 8 - shift : width - done;
+			value |= (uint64_t)((base[(bit + done) >> 3] >> shift) & ((1u << take) - 1)) << done;
+			done += take;
+		}
+		return value;
+	}
+
+	/* Byte order, then the shorter first. */
+	static int csvee_text_compare(const char *a, size_t a_len, const char *b, size_t b_len)
+	{
+		int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+		if (cmp)
+			return cmp;
+		return a_len < b_len ? -1 : a_len > b_len;
+	}
+
+	/* Append @p count values of @p width bits, each @p values[i] - @p base. */
+	static bool csvee_bitpack_append(CSVBuffer_t *out, const uint64_t *values, size_t count, uint64_t base, unsigned width)
+	{
+		size_t bytes = (count * width + 7) / 8;
+		if (!csvee_buffer_reserve(out, bytes))
+			return false;
+		unsigned char *packed = (unsigned char *)out->data + out->size;
+		memset(packed, 0, bytes);
+		for (size_t i = 0; width && i < count; ++i)
+			csvee_bits_put(packed, i * width, width, values[i] - base);
+		out->size += bytes;
+		return true;
+	}
+
+	/*
+	 * Read @p text as a decimal written the way csvee_decimal_format() writes
+	 * it: an optional '-', no leading zeros, a fraction only if it has
+	 * digits, never "-0", at most 18 digits in all. Anything else would
+	 * not come back byte for byte, and makes the column text.
+	 */
+	static bool csvee_decimal_parse(const char *text, size_t size, int64_t *unscaled, int *scale)
+	{
+		size_t i = 0;
+		bool negative = size && text[0] == '-';
+		i += negative;
+		size_t int_start = i;
+		while (i < size && text[i] >= '0' && text[i] <= '9')
+			++i;
+		size_t int_digits = i - int_start;
+		if (!int_digits || (int_digits > 1 && text[int_start] == '0'))
+			return false;
+		size_t frac_digits = 0;
+		if (i < size && text[i] == '.')
+		{
+			size_t frac_start = ++i;
+			while (i < size && text[i] >= '0' && text[i] <= '9')
+				++i;
+			frac_digits = i - frac_start;
+			if (!frac_digits)
+				return false;
+		}
+		if (i != size || int_digits + frac_digits > 18)
+			return false;
+
+		int64_t value = 0;
+		for (size_t j = int_start; j < size; ++j)
+			if (text[j] != '.')
+				value = value * 10 + (text[j] - '0');
+		if (negative && !value)
+			return false;
+		*unscaled = negative ? -value : value;
+		*scale = (int)frac_digits;
+		return true;
+	}
+
+	static size_t csvee_decimal_format(char *out, int64_t unscaled, int scale)
+	{
+		char digits[24];
+		size_t count = 0;
+		uint64_t magnitude = unscaled < 0 ? 0 - (uint64_t)unscaled : (uint64_t)unscaled;
+		do
+		{
+			digits[count++] = (char)('0' + magnitude % 10);
+			magnitude /= 10;
+		} while (magnitude);
+		while (count < (size_t)scale + 1)
+			digits[count++] = '0';
+
+		size_t n = 0;
+		if (unscaled < 0)
+			out[n++] = '-';
+		while (count)
+		{
+			if (count == (size_t)scale)
+				out[n++] = '.';
+			out[n++] = digits[--count];
+		}
+		out[n] = '\0';
+		return n;
+	}
+
+	/* Number chunks: whichever of bit-packing, delta and run-length encoding comes out smallest. */
+	static bool csvee_columnar_encode_numbers(CSVColumnarWriter_t *writer, const int64_t *values, size_t count, unsigned char *encoding)
+	{
+		CSVBuffer_t *packed = &writer->payload[0], *delta = &writer->payload[1], *rle = &writer->payload[2];
+		for (int i = 0; i < 3; ++i)
+			writer->payload[i].size = 0;
+		if (!count)
+		{
+			*encoding = CSVEE_ENC_RLE;
+			return true;
+		}
+
+		int64_t min = values[0], max = values[0], min_delta = INT64_MAX;
+		for (size_t i = 1; i < count; ++i)
+		{
+			min = values[i] < min ? values[i] : min;
+			max = values[i] > max ? values[i] : max;
+			int64_t d = (int64_t)((uint64_t)values[i] - (uint64_t)values[i - 1]);
+			min_delta = d < min_delta ? d : min_delta;
+		}
+		if (count == 1)
+			min_delta = 0;
+
+		const uint64_t *raw = (const uint64_t *)values;
+		unsigned char width = (unsigned char)csvee_bit_width((uint64_t)max - (uint64_t)min);
+		bool ok = csvee_buffer_put_varint(packed, csvee_zigzag(min)) && csvee_buffer_append(packed, (const char *)&width, 1) &&
+				  csvee_bitpack_append(packed, raw, count, (uint64_t)min, width);
+
+		uint64_t widest = 0;
+		for (size_t i = 1; i < count; ++i)
+		{
+			uint64_t d = raw[i] - raw[i - 1] - (uint64_t)min_delta;
+			widest = d > widest ? d : widest;
+		}
+		unsigned char delta_width = (unsigned char)csvee_bit_width(widest);
+		ok = ok && csvee_buffer_put_varint(delta, csvee_zigzag(values[0])) && csvee_buffer_put_varint(delta, csvee_zigzag(min_delta)) &&
+			 csvee_buffer_append(delta, (const char *)&delta_width, 1) && csvee_buffer_reserve(delta, ((count - 1) * delta_width + 7) / 8);
+		if (ok)
+		{
+			unsigned char *bits = (unsigned char *)delta->data + delta->size;
+			memset(bits, 0, ((count - 1) * delta_width + 7) / 8);
+			for (size_t i = 1; delta_width && i < count; ++i)
+				csvee_bits_put(bits, (i - 1) * delta_width, delta_width, raw[i] - raw[i - 1] - (uint64_t)min_delta);
+			delta->size += ((count - 1) * delta_width + 7) / 8;
+		}
+
+		for (size_t i = 0; ok && i < count;)
+		{
+			size_t run = 1;
+			while (i + run < count && values[i + run] == values[i])
+				++run;
+			ok = csvee_buffer_put_varint(rle, csvee_zigzag(values[i])) && csvee_buffer_put_varint(rle, run);
+			i += run;
+		}
+
+		size_t best = packed->size <= delta->size ? 0 : 1;
+		best = rle->size < writer->payload[best].size ? 2 : best;
+		if (best != 0)
+		{
+			CSVBuffer_t swap = writer->payload[0];
+			writer->payload[0] = writer->payload[best];
+			writer->payload[best] = swap;
+		}
+		*encoding = best == 0 ? CSVEE_ENC_BITPACK : best == 1 ? CSVEE_ENC_DELTA : CSVEE_ENC_RLE;
+		return ok;
+	}
+
+	/* Text chunks: the values as they are, or a dictionary and bit-packed indices when that is smaller. */
+	static bool csvee_columnar_encode_text(CSVColumnarWriter_t *writer, const CSVColumnChunk_t *chunk, size_t count, unsigned char *encoding)
+	{
+		CSVBuffer_t *plain = &writer->payload[0], *dict = &writer->payload[1], *indices = &writer->payload[2];
+		for (int i = 0; i < 3; ++i)
+			writer->payload[i].size = 0;
+		csvee_hash_clear(&writer->dictionary);
+
+		const size_t *ends = (const size_t *)chunk->ends.data;
+		bool ok = true;
+		size_t start = 0;
+		for (size_t i = 0; ok && i < count; start = ends[i++])
+		{
+			const char *value = chunk->text.data + start;
+			size_t size = ends[i] - start, entry;
+			bool added;
+			ok = csvee_buffer_put_varint(plain, size) && csvee_buffer_append(plain, value, size) &&
+				 csvee_hash_insert(&writer->dictionary, value, size, csvee_hash(value, size), &entry, &added);
+			uint64_t index = entry;
+			ok = ok && csvee_buffer_append(indices, (const char *)&index, sizeof(index));
+		}
+		if (!ok)
+			return false;
+
+		const CSVHashTable_t *table = &writer->dictionary;
+		unsigned char width = (unsigned char)csvee_bit_width(table->count ? table->count - 1 : 0);
+		size_t estimate = table->keys.size + table->count + (count * width + 7) / 8;
+		if (estimate >= plain->size)
+		{
+			*encoding = CSVEE_ENC_PLAIN;
+			return true;
+		}
+
+		ok = csvee_buffer_put_varint(dict, table->count);
+		for (size_t e = 0; ok && e < table->count; ++e)
+		{
+			size_t size = table->offsets[e + 1] - table->offsets[e];
+			ok = csvee_buffer_put_varint(dict, size) && csvee_buffer_append(dict, table->keys.data + table->offsets[e], size);
+		}
+		ok = ok && csvee_buffer_append(dict, (const char *)&width, 1) &&
+			 csvee_bitpack_append(dict, (const uint64_t *)indices->data, count, 0, width);
+
+		CSVBuffer_t swap = writer->payload[0];
+		writer->payload[0] = writer->payload[1];
+		writer->payload[1] = swap;
+		*encoding = CSVEE_ENC_DICT;
+		return ok;
+	}
+
+	/* Write chunk @p c of the current row group and add its footer entry. */
+	static bool csvee_columnar_write_chunk(CSVColumnarWriter_t *writer, size_t c)
+	{
+		CSVColumnChunk_t *chunk = &writer->chunks[c];
+		bool number = c == writer->ncolumns || writer->scales[c] >= 0;
+		size_t count = chunk->rows - chunk->nulls;
+		unsigned char encoding;
+		bool ok = number ? csvee_columnar_encode_numbers(writer, (const int64_t *)chunk->numbers.data, count, &encoding)
+						 : csvee_columnar_encode_text(writer, chunk, count, &encoding);
+
+		CSVBuffer_t *out = &writer->chunk;
+		out->size = 0;
+		ok = ok && csvee_buffer_append(out, (const char *)&encoding, 1) && csvee_buffer_put_varint(out, chunk->nulls) &&
+			 (!chunk->nulls || csvee_buffer_append(out, chunk->present.data, chunk->present.size)) &&
+			 csvee_buffer_append(out, writer->payload[0].data, writer->payload[0].size);
+		if (ok && fwrite(out->data, 1, out->size, writer->out) != out->size)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(IO_ERROR, "Could not write a column chunk\n");
+#endif // CSVEE_DEBUG
+			ok = false;
+		}
+
+		CSVBuffer_t *meta = &writer->groups;
+		unsigned char has_range = count > 0;
+		ok = ok && csvee_buffer_put_varint(meta, writer->offset) && csvee_buffer_put_varint(meta, out->size) &&
+			 csvee_buffer_put_varint(meta, chunk->nulls) && csvee_buffer_append(meta, (const char *)&has_range, 1);
+		writer->offset += out->size;
+		if (!ok || !has_range)
+			return ok;
+
+		if (number)
+		{
+			const int64_t *values = (const int64_t *)chunk->numbers.data;
+			int64_t min = values[0], max = values[0];
+			for (size_t i = 1; i < count; ++i)
+			{
+				min = values[i] < min ? values[i] : min;
+				max = values[i] > max ? values[i] : max;
+			}
+			return csvee_buffer_put_varint(meta, csvee_zigzag(min)) && csvee_buffer_put_varint(meta, csvee_zigzag(max));
+		}
+
+		const size_t *ends = (const size_t *)chunk->ends.data;
+		size_t min = 0, max = 0, start = 0;
+		for (size_t i = 0; i < count; start = ends[i++])
+		{
+			const char *value = chunk->text.data + start;
+			size_t size = ends[i] - start;
+			size_t min_start = min ? ends[min - 1] : 0, max_start = max ? ends[max - 1] : 0;
+			if (csvee_text_compare(value, size, chunk->text.data + min_start, ends[min] - min_start) < 0)
+				min = i;
+			if (csvee_text_compare(value, size, chunk->text.data + max_start, ends[max] - max_start) > 0)
+				max = i;
+		}
+		size_t min_start = min ? ends[min - 1] : 0, max_start = max ? ends[max - 1] : 0;
+		return csvee_buffer_put_varint(meta, ends[min] - min_start) &&
+			   csvee_buffer_append(meta, chunk->text.data + min_start, ends[min] - min_start) &&
+			   csvee_buffer_put_varint(meta, ends[max] - max_start) &&
+			   csvee_buffer_append(meta, chunk->text.data + max_start, ends[max] - max_start);
+	}
+
+	/* Add a record to the current row group, the first pass only learns the columns. */
+	static bool csvee_columnar_add(CSVColumnarWriter_t *writer, const CSVRow_t *row)
+	{
+		char scratch[64];
+		if (!writer->writing)
+		{
+			if (row->count > writer->ncolumns)
+			{
+				int *scales = (int *)realloc(writer->scales, row->count * sizeof(int));
+				if (!scales)
+					return false;
+				for (size_t c = writer->ncolumns; c < row->count; ++c)
+					scales[c] = -2;
+				writer->scales = scales;
+				writer->ncolumns = row->count;
+			}
+			if (writer->before_head)
+			{
+				writer->before_head = false;
+				writer->names_count = row->count;
+				for (size_t c = 0; c < row->count; ++c)
+				{
+					const char *name = csvee_field_text(&row->fields[c], scratch, sizeof(scratch));
+					if (!csvee_buffer_append(&writer->names, name, strlen(name) + 1))
+						return false;
+				}
+				return true;
+			}
+			for (size_t c = 0; c < row->count; ++c)
+			{
+				const char *text = csvee_field_text(&row->fields[c], scratch, sizeof(scratch));
+				size_t size = strlen(text);
+				int64_t unscaled;
+				int scale;
+				if (!size || writer->scales[c] == -1)
+					continue;
+				if (!csvee_decimal_parse(text, size, &unscaled, &scale))
+					writer->scales[c] = -1;
+				else if (writer->scales[c] == -2)
+					writer->scales[c] = scale;
+				else if (writer->scales[c] != scale)
+					writer->scales[c] = -1;
+			}
+			return true;
+		}
+
+		if (writer->before_head)
+		{
+			writer->before_head = false;
+			return true;
+		}
+		for (size_t c = 0; c <= writer->ncolumns; ++c)
+		{
+			CSVColumnChunk_t *chunk = &writer->chunks[c];
+			if (chunk->rows % 8 == 0 && !csvee_buffer_append(&chunk->present, "", 1))
+				return false;
+			chunk->rows++;
+
+			bool ok;
+			if (c == writer->ncolumns)
+			{
+				int64_t width = (int64_t)row->count;
+				ok = csvee_buffer_append(&chunk->numbers, (const char *)&width, sizeof(width));
+			}
+			else
+			{
+				const char *text = c < row->count ? csvee_field_text(&row->fields[c], scratch, sizeof(scratch)) : "";
+				size_t size = strlen(text);
+				if (!size)
+				{
+					chunk->nulls++;
+					continue;
+				}
+				int64_t unscaled;
+				int scale;
+				if (writer->scales[c] >= 0)
+					ok = csvee_decimal_parse(text, size, &unscaled, &scale) &&
+						 csvee_buffer_append(&chunk->numbers, (const char *)&unscaled, sizeof(unscaled));
+				else
+				{
+					size_t end = chunk->text.size + size;
+					ok = csvee_buffer_append(&chunk->text, text, size) &&
+						 csvee_buffer_append(&chunk->ends, (const char *)&end, sizeof(end));
+				}
+			}
+			if (!ok)
+				return false;
+			chunk->present.data[(chunk->rows - 1) >> 3] |= (char)(1u << ((chunk->rows - 1) & 7));
+		}
+		return ++writer->rows < writer->group_rows || csvee_columnar_flush(writer);
+	}
+
+	/* Write the current row group out, one chunk per column and one of record widths. */
+	static bool csvee_columnar_flush(CSVColumnarWriter_t *writer)
+	{
+		if (!writer->rows)
+			return true;
+		bool ok = csvee_buffer_put_varint(&writer->groups, writer->rows);
+		for (size_t c = 0; ok && c <= writer->ncolumns; ++c)
+			ok = csvee_columnar_write_chunk(writer, c);
+		for (size_t c = 0; c <= writer->ncolumns; ++c)
+		{
+			CSVColumnChunk_t *chunk = &writer->chunks[c];
+			chunk->numbers.size = chunk->text.size = chunk->ends.size = chunk->present.size = 0;
+			chunk->rows = chunk->nulls = 0;
+		}
+		writer->rows = 0;
+		writer->ngroups++;
+		return ok;
+	}
+
+	/* Write the footer: the columns, then where each chunk is and its zone map. */
+	static bool csvee_columnar_finish(CSVColumnarWriter_t *writer)
+	{
+		if (!csvee_columnar_flush(writer))
+			return false;
+		CSVBuffer_t footer;
+		memset(&footer, 0, sizeof(footer));
+		unsigned char header = writer->header && !writer->before_head; /* an empty input has no header */
+		bool ok = csvee_buffer_append(&footer, (const char *)&header, 1) &&
+				  (!header || csvee_buffer_put_varint(&footer, writer->names_count)) &&
+				  csvee_buffer_put_varint(&footer, writer->ncolumns);
+		const char *name = writer->names.data;
+		for (size_t c = 0; ok && c < writer->ncolumns; ++c)
+		{
+			size_t size = c < writer->names_count ? strlen(name) : 0;
+			ok = csvee_buffer_put_varint(&footer, csvee_zigzag(writer->scales[c])) && csvee_buffer_put_varint(&footer, size) &&
+				 csvee_buffer_append(&footer, name, size);
+			name += c < writer->names_count ? size + 1 : 0;
+		}
+		ok = ok && csvee_buffer_put_varint(&footer, writer->ngroups) &&
+			 csvee_buffer_append(&footer, writer->groups.data, writer->groups.size);
+
+		unsigned char trailer[8] = {(unsigned char)footer.size, (unsigned char)(footer.size >> 8),
+									(unsigned char)(footer.size >> 16), (unsigned char)(footer.size >> 24), 'C', 'S', 'V', 'C'};
+		ok = ok && footer.size <= UINT32_MAX && fwrite(footer.data, 1, footer.size, writer->out) == footer.size &&
+			 fwrite(trailer, 1, sizeof(trailer), writer->out) == sizeof(trailer);
+		csvee_buffer_free(&footer);
+		return ok;
+	}
+
+	static void csvee_columnar_writer_free(CSVColumnarWriter_t *writer)
+	{
+		for (size_t c = 0; writer->chunks && c <= writer->ncolumns; ++c)
+		{
+			csvee_buffer_free(&writer->chunks[c].numbers);
+			csvee_buffer_free(&writer->chunks[c].text);
+			csvee_buffer_free(&writer->chunks[c].ends);
+			csvee_buffer_free(&writer->chunks[c].present);
+		}
+		free(writer->chunks);
+		free(writer->scales);
+		csvee_buffer_free(&writer->names);
+		csvee_buffer_free(&writer->groups);
+		csvee_hash_free(&writer->dictionary);
+		for (int i = 0; i < 3; ++i)
+			csvee_buffer_free(&writer->payload[i]);
+		csvee_buffer_free(&writer->chunk);
+		memset(writer, 0, sizeof(*writer));
+	}
+
+	/* Open @p path and read its footer. */
+	static bool csvee_columnar_open(CSVColumnarFile_t *file, const char *path)
+	{
+		memset(file, 0, sizeof(*file));
+		file->file = fopen(path, "rb");
+		if (!file->file)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(NULL_FILE, "Could not open file %s\n", path);
+#endif // CSVEE_DEBUG
+			return false;
+		}
+
+		csvee_stat_t st;
+		unsigned char magic[5], trailer[8];
+		bool ok = CSVEE_FSTAT(file->file, &st) == 0 && (uint64_t)st.st_size >= sizeof(magic) + sizeof(trailer) &&
+				  fread(magic, 1, sizeof(magic), file->file) == sizeof(magic) && memcmp(magic, "CSVC\x01", 5) == 0 &&
+				  CSVEE_FSEEK64(file->file, (uint64_t)st.st_size - sizeof(trailer)) == 0 &&
+				  fread(trailer, 1, sizeof(trailer), file->file) == sizeof(trailer) && memcmp(trailer + 4, "CSVC", 4) == 0;
+		uint64_t size = ok ? (uint64_t)trailer[0] | (uint64_t)trailer[1] << 8 | (uint64_t)trailer[2] << 16 | (uint64_t)trailer[3] << 24 : 0;
+		ok = ok && size <= (uint64_t)st.st_size - sizeof(magic) - sizeof(trailer) &&
+			 csvee_buffer_reserve(&file->footer, (size_t)size) &&
+			 CSVEE_FSEEK64(file->file, (uint64_t)st.st_size - sizeof(trailer) - size) == 0 &&
+			 fread(file->footer.data, 1, (size_t)size, file->file) == size;
+		if (!ok)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FILE, "%s is not a columnar file\n", path);
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		file->footer.size = (size_t)size;
+		/* column chunks lie between the magic and the footer */
+		uint64_t data_end = (uint64_t)st.st_size - sizeof(trailer) - size;
+
+		const unsigned char *cursor = (const unsigned char *)file->footer.data, *end = cursor + size;
+		uint64_t names_count = 0, ncolumns = 0, ngroups = 0, value = 0;
+		file->header = cursor < end && *cursor++;
+		ok = (!file->header || csvee_get_varint(&cursor, end, &names_count)) &&
+			 csvee_get_varint(&cursor, end, &ncolumns) && ncolumns <= size && names_count <= ncolumns;
+		file->ncolumns = ok ? (size_t)ncolumns : 0;
+		file->scales = ok ? (int *)calloc(file->ncolumns + 1, sizeof(int)) : NULL;
+		ok = ok && file->scales;
+		for (size_t c = 0; ok && c < file->ncolumns; ++c)
+		{
+			ok = csvee_get_varint(&cursor, end, &value) && csvee_get_varint(&cursor, end, &size) && size <= (uint64_t)(end - cursor);
+			int64_t scale = ok ? csvee_unzigzag(value) : 0;
+			ok = ok && scale >= -1 && scale <= 18;
+			file->scales[c] = (int)scale;
+			if (ok && c < names_count)
+				ok = csvee_buffer_append(&file->names, (const char *)cursor, (size_t)size) && csvee_buffer_append(&file->names, "", 1);
+			cursor += ok ? size : 0;
+		}
+		file->names_count = (size_t)names_count;
+		file->names_at = ok ? (const char **)calloc(file->names_count + 1, sizeof(const char *)) : NULL;
+		ok = ok && file->names_at;
+		for (size_t c = 0, at = 0; ok && c < file->names_count; at += strlen(file->names.data + at) + 1)
+			file->names_at[c++] = file->names.data + at;
+
+		ok = ok && csvee_get_varint(&cursor, end, &ngroups) && ngroups <= (uint64_t)(end - cursor);
+		file->ngroups = ok ? (size_t)ngroups : 0;
+		file->group_rows = ok ? (uint64_t *)calloc(file->ngroups + 1, sizeof(uint64_t)) : NULL;
+		file->chunks = ok ? (CSVChunkMeta_t *)calloc(file->ngroups * (file->ncolumns + 1) + 1, sizeof(CSVChunkMeta_t)) : NULL;
+		ok = ok && file->group_rows && file->chunks;
+		for (size_t g = 0; ok && g < file->ngroups; ++g)
+		{
+			uint64_t rows = 0;
+			ok = csvee_get_varint(&cursor, end, &rows) && rows <= CSVEE_COLUMNAR_MAX_GROUP_ROWS;
+			file->group_rows[g] = ok ? rows : 0;
+			for (size_t c = 0; ok && c <= file->ncolumns; ++c)
+			{
+				CSVChunkMeta_t *meta = &file->chunks[g * (file->ncolumns + 1) + c];
+				ok = csvee_get_varint(&cursor, end, &meta->offset) && csvee_get_varint(&cursor, end, &meta->size) &&
+					 csvee_get_varint(&cursor, end, &meta->nulls) && cursor < end && meta->offset >= sizeof(magic) &&
+					 meta->offset <= data_end && meta->size <= data_end - meta->offset && meta->nulls <= rows;
+				meta->has_range = ok && *cursor++;
+				/* every record has a width: no nulls, and a range when the group has rows */
+				if (ok && c == file->ncolumns)
+					ok = !meta->nulls && meta->has_range == (rows > 0);
+				if (!ok || !meta->has_range)
+					continue;
+				if (c == file->ncolumns || file->scales[c] >= 0)
+				{
+					uint64_t min = 0, max = 0;
+					ok = csvee_get_varint(&cursor, end, &min) && csvee_get_varint(&cursor, end, &max);
+					if (ok)
+					{
+						meta->min = csvee_unzigzag(min);
+						meta->max = csvee_unzigzag(max);
+					}
+					/* the first pass made every record at most ncolumns wide */
+					if (ok && c == file->ncolumns)
+						ok = meta->min >= 0 && meta->min <= meta->max && (uint64_t)meta->max <= ncolumns;
+					continue;
+				}
+				ok = csvee_get_varint(&cursor, end, &size) && size <= (uint64_t)(end - cursor);
+				meta->min_text = (const char *)cursor;
+				meta->min_len = (size_t)size;
+				cursor += ok ? size : 0;
+				ok = ok && csvee_get_varint(&cursor, end, &size) && size <= (uint64_t)(end - cursor);
+				meta->max_text = (const char *)cursor;
+				meta->max_len = (size_t)size;
+				cursor += ok ? size : 0;
+			}
+		}
+		if (!ok)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(PARSE_ERROR, "Corrupt footer in %s\n", path);
+#endif // CSVEE_DEBUG
+		}
+		return ok;
+	}
+
+	static bool csvee_columnar_unpack(const unsigned char **cursor, const unsigned char *end, size_t count, unsigned *width)
+	{
+		if (*cursor >= end || **cursor > 64)
+			return false;
+		*width = *(*cursor)++;
+		return (count * *width + 7) / 8 <= (size_t)(end - *cursor);
+	}
+
+	/* Read chunk @p column of row group @p group into @p view. */
+	static bool csvee_columnar_decode(const CSVColumnarFile_t *file, size_t group, size_t column, CSVChunkView_t *view)
+	{
+		const CSVChunkMeta_t *meta = &file->chunks[group * (file->ncolumns + 1) + column];
+		uint64_t rows = file->group_rows[group];
+		view->raw.size = view->numbers.size = view->slices.size = 0;
+		view->present = NULL;
+		view->next = 0;
+		bool ok = meta->size <= SIZE_MAX && meta->nulls <= rows && csvee_buffer_reserve(&view->raw, (size_t)meta->size) &&
+				  CSVEE_FSEEK64(file->file, meta->offset) == 0 &&
+				  fread(view->raw.data, 1, (size_t)meta->size, file->file) == meta->size;
+		if (!ok)
+			return false;
+		view->raw.size = (size_t)meta->size;
+
+		const unsigned char *cursor = (const unsigned char *)view->raw.data, *end = cursor + view->raw.size;
+		uint64_t nulls, value, count = rows - meta->nulls;
+		unsigned char encoding = cursor < end ? *cursor++ : 0xff;
+		ok = csvee_get_varint(&cursor, end, &nulls) && nulls == meta->nulls;
+		if (ok && nulls)
+		{
+			ok = (rows + 7) / 8 <= (uint64_t)(end - cursor);
+			view->present = cursor;
+			/* the bitmap must agree with the null count, rows index the values by it */
+			uint64_t present = 0;
+			for (uint64_t r = 0; ok && r < rows; ++r)
+				present += (cursor[r >> 3] >> (r & 7)) & 1;
+			ok = ok && present == count;
+			cursor += ok ? (rows + 7) / 8 : 0;
+		}
+
+		bool number = column == file->ncolumns || file->scales[column] >= 0;
+		ok = ok && count <= SIZE_MAX / sizeof(CSVSlice_t);
+		CSVBuffer_t *out = number ? &view->numbers : &view->slices;
+		ok = ok && csvee_buffer_reserve(out, (size_t)count * (number ? sizeof(int64_t) : sizeof(CSVSlice_t)));
+		int64_t *numbers = (int64_t *)view->numbers.data;
+		CSVSlice_t *slices = (CSVSlice_t *)view->slices.data;
+		unsigned width;
+		switch (ok ? encoding : 0xff)
+		{
+		case CSVEE_ENC_BITPACK:
+			ok = number && csvee_get_varint(&cursor, end, &value) && csvee_columnar_unpack(&cursor, end, (size_t)count, &width);
+			for (size_t i = 0; ok && i < count; ++i)
+				numbers[i] = (int64_t)((uint64_t)csvee_unzigzag(value) + csvee_bits_get(cursor, i * width, width));
+			break;
+		case CSVEE_ENC_DELTA:
+		{
+			uint64_t min_delta;
+			ok = number && count && csvee_get_varint(&cursor, end, &value) && csvee_get_varint(&cursor, end, &min_delta) &&
+				 csvee_columnar_unpack(&cursor, end, (size_t)count - 1, &width);
+			uint64_t current = (uint64_t)csvee_unzigzag(value);
+			for (size_t i = 0; ok && i < count; ++i)
+			{
+				if (i)
+					current += (uint64_t)csvee_unzigzag(min_delta) + csvee_bits_get(cursor, (i - 1) * width, width);
+				numbers[i] = (int64_t)current;
+			}
+			break;
+		}
+		case CSVEE_ENC_RLE:
+			ok = number;
+			for (size_t i = 0; ok && i < count;)
+			{
+				uint64_t run;
+				ok = csvee_get_varint(&cursor, end, &value) && csvee_get_varint(&cursor, end, &run) && run && run <= count - i;
+				for (; ok && run; --run)
+					numbers[i++] = csvee_unzigzag(value);
+			}
+			break;
+		case CSVEE_ENC_PLAIN:
+			ok = !number;
+			for (size_t i = 0; ok && i < count; ++i)
+			{
+				ok = csvee_get_varint(&cursor, end, &value) && value <= (uint64_t)(end - cursor);
+				slices[i].data = (const char *)cursor;
+				slices[i].size = (size_t)value;
+				cursor += ok ? value : 0;
+			}
+			break;
+		case CSVEE_ENC_DICT:
+		{
+			uint64_t entries;
+			ok = !number && csvee_get_varint(&cursor, end, &entries) && entries <= (uint64_t)(end - cursor);
+			const unsigned char *dictionary = cursor;
+			for (uint64_t e = 0; ok && e < entries; ++e)
+			{
+				ok = csvee_get_varint(&cursor, end, &value) && value <= (uint64_t)(end - cursor);
+				cursor += ok ? value : 0;
+			}
+			ok = ok && csvee_columnar_unpack(&cursor, end, (size_t)count, &width);
+			/* resolve indices against the entries in one walk of the dictionary, kept in the slices as we go */
+			CSVSlice_t *entry = ok ? (CSVSlice_t *)malloc((size_t)(entries + 1) * sizeof(CSVSlice_t)) : NULL;
+			ok = ok && entry;
+			const unsigned char *walk = dictionary;
+			for (uint64_t e = 0; ok && e < entries; ++e)
+			{
+				csvee_get_varint(&walk, end, &value);
+				entry[e].data = (const char *)walk;
+				entry[e].size = (size_t)value;
+				walk += value;
+			}
+			for (size_t i = 0; ok && i < count; ++i)
+			{
+				uint64_t index = csvee_bits_get(cursor, i * width, width);
+				ok = index < entries;
+				if (ok)
+					slices[i] = entry[index];
+			}
+			free(entry);
+			break;
+		}
+		default:
+			ok = false;
+		}
+		if (!ok)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(PARSE_ERROR, "Corrupt column chunk\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		/* record widths decide how many fields a row gets, keep them inside the footer range */
+		for (size_t i = 0; ok && column == file->ncolumns && i < count; ++i)
+			ok = numbers[i] >= meta->min && numbers[i] <= meta->max;
+		if (!ok)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(PARSE_ERROR, "Record width out of range\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		out->size = (size_t)count * (number ? sizeof(int64_t) : sizeof(CSVSlice_t));
+		return true;
+	}
+
+	static void csvee_columnar_close(CSVColumnarFile_t *file)
+	{
+		if (file->file)
+			fclose(file->file);
+		csvee_buffer_free(&file->footer);
+		csvee_buffer_free(&file->names);
+		free(file->names_at);
+		free(file->scales);
+		free(file->group_rows);
+		free(file->chunks);
+		memset(file, 0, sizeof(*file));
+	}
+
+#ifdef __cplusplus
+};
+#endif // __cplusplus
+
+//-----------------------------------------------------------------------------
+// [SECTION] C++ Only Classes
 //-----------------------------------------------------------------------------
 
-#ifdef __cplusplus
+#ifdef __cplusplus
+
+//-----------------------------------------------------------------------------
+// [SECTION] Declarations
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// [SECTION] Definations
+//-----------------------------------------------------------------------------
+
+#endif //__cplusplus
+
+#pragma endregion
+
+#pragma region Csvee
+
+//-----------------------------------------------------------------------------
+// [SECTION] C Only Functions
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+	void csvee_dialect_init(CSVDialect_t *dialect, char *name, char delimeter, char quotechar, bool skipwhitespace, bool doublequote, CSVQuote_t quoting, char lineterminator)
+	{
+		if (dialect == NULL)
+			return;
+
+		/* copy/own the name and lineterminator so free() is safe later */
+		if (name)
+		{
+			dialect->name = strdup(name);
+		}
+		else
+		{
+			dialect->name = NULL;
+		}
+
+		dialect->quoting = quoting;
+		dialect->delimiter = delimeter;
+		dialect->quotechar = quotechar;
+		dialect->doublequote = doublequote;
+		dialect->skipwhitespace = skipwhitespace;
+		dialect->lineterminator = lineterminator;
+	};
+
+	void csvee_dialect_free(CSVDialect_t *dialect)
+	{
+		if (!dialect)
+			return;
+		if (dialect->name)
+			free(dialect->name);
+		free(dialect);
+	};
+
+	void csvee_init(Csvee_t *csvee, CSVDialect_t *dialect)
+	{
+		if (csvee == NULL)
+			return;
+		csvee->dialect = dialect;
+		csvee->rows = NULL;
+		csvee->count = 0;
+		csvee->capacity = 1;
+		memset(&csvee->stats, 0, sizeof(csvee->stats));
+		csvee->memory_budget = 0;
+		csvee->spill = NULL;
+		csvee->lazy = NULL;
+		csvee->compact = NULL;
+		csvee->share = NULL;
+		csvee->tombstones = NULL;
+		csvee->tombstones_len = 0;
+		csvee->deleted = 0;
+	};
+
+	void csvee_free(Csvee_t *csvee)
+	{
+		if (!csvee)
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < csvee->count; i++)
+		{
+			if (!csvee_compact_owns(csvee, &csvee->rows[i]) && csvee_share_owns(csvee, i))
+				csvee_row_free(&csvee->rows[i]);
+		}
+
+		csvee_share_free(csvee);
+		free(csvee->tombstones);
+		csvee_dialect_free(csvee->dialect);
+		csvee_spill_free(csvee->spill);
+		csvee_lazy_free(csvee->lazy);
+		csvee_compact_free(csvee->compact);
+		free(csvee->rows);
+		csvee->count = 0;
+		csvee->capacity = 0;
+		free(csvee);
+	};
+
+	void csvee_parser_init(CSVParser_t *parser, const CSVDialect_t *dialect, CSVRowCallback_t on_row, void *user)
+	{
+		memset(parser, 0, sizeof(*parser));
+		parser->dialect = dialect;
+		parser->on_row = on_row;
+		parser->user = user;
+		parser->state = CSVEE_PARSE_FIELD_START;
+	}
+
+	void csvee_parser_free(CSVParser_t *parser)
+	{
+		if (!parser)
+			return;
+		free(parser->text);
+		free(parser->ends);
+		memset(parser, 0, sizeof(*parser));
+	}
+
+	static bool csvee_parser_append(CSVParser_t *parser, const char *data, size_t size)
+	{
+		if (parser->text_len + size > parser->text_cap)
+		{
+			size_t capacity = parser->text_cap ? parser->text_cap : MAX_LINE_LENGTH;
+			while (capacity < parser->text_len + size)
+				capacity *= 2;
+			char *text = (char *)realloc(parser->text, capacity);
+			if (!text)
+				return false;
+			parser->text = text;
+			parser->text_cap = capacity;
+		}
+		memcpy(parser->text + parser->text_len, data, size);
+		parser->text_len += size;
+		return true;
+	}
+
+	static bool csvee_parser_end_field(CSVParser_t *parser)
+	{
+		if (parser->ends_len >= parser->ends_cap)
+		{
+			size_t capacity = parser->ends_cap ? parser->ends_cap * 2 : 16;
+			size_t *ends = (size_t *)realloc(parser->ends, capacity * sizeof(size_t));
+			if (!ends)
+				return false;
+			parser->ends = ends;
+			parser->ends_cap = capacity;
+		}
+		parser->ends[parser->ends_len++] = parser->text_len;
+		parser->stats.fields++;
+		parser->stats.quoted_fields += parser->quoted;
+		parser->quoted = false;
+		parser->state = CSVEE_PARSE_FIELD_START;
+		return true;
+	}
+
+	/* Materialize the buffered row into an exactly sized CSVRow_t and hand it over. */
+	static bool csvee_parser_end_row(CSVParser_t *parser)
+	{
+		/* blank lines produce no row */
+		if (parser->ends_len == 0 && parser->text_len == 0 && !parser->quoted)
+		{
+			parser->state = CSVEE_PARSE_FIELD_START;
+			return true;
+		}
+
+		if (!csvee_parser_end_field(parser))
+			return false;
+
+		if (parser->on_record)
+		{
+			parser->stats.rows++;
+			bool ok = parser->on_record(parser->user, parser->text, parser->ends, parser->ends_len);
+			parser->text_len = 0;
+			parser->ends_len = 0;
+			return ok;
+		}
+
+		/* offset by one so sampled rows never line up with the rows array doubling */
+		bool sample = (parser->stats.rows + CSVEE_STAT_SAMPLE - 1) % CSVEE_STAT_SAMPLE == 0;
+		uint64_t start_ns = sample ? csvee_now_ns() : 0;
+
+		size_t n = parser->ends_len;
+		CSVRow_t row;
+		row.fields = (CSVField_t *)malloc(n * sizeof(CSVField_t));
+		row.capacity = n;
+		row.count = 0;
+		if (!row.fields)
+			return false;
+
+		size_t start = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			CSVField_t field = csvee_create_field_n(parser->text + start, parser->ends[i] - start);
+			if (!field.value._string)
+			{
+				csvee_row_free(&row);
+				return false;
+			}
+			row.fields[row.count++] = field;
+			start = parser->ends[i];
+		}
+
+		parser->stats.rows++;
+		parser->stats.allocations += n + 1;
+		parser->stats.bytes_allocated += n * sizeof(CSVField_t) + parser->text_len + n;
+		parser->text_len = 0;
+		parser->ends_len = 0;
+
+		bool ok = parser->on_row(parser->user, &row);
+		if (sample)
+		{
+			parser->sampled_ns += csvee_now_ns() - start_ns;
+			parser->sampled_rows++;
+		}
+		return ok;
+	}
+
+	static bool csvee_parser_scan(CSVParser_t *parser, const char *data, size_t size)
+	{
+		const char delim = parser->dialect->delimiter;
+		const char quote = parser->dialect->quotechar;
+		const bool doublequote = parser->dialect->doublequote;
+		const bool skipwhitespace = parser->dialect->skipwhitespace;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			char ch = data[i];
+
+			if (parser->skip_lf)
+			{
+				parser->skip_lf = false;
+				if (ch == '\n')
+					continue;
+			}
+
+			switch (parser->state)
+			{
+			case CSVEE_PARSE_FIELD_START:
+				if (ch == quote)
+				{
+					parser->quoted = true;
+					parser->state = CSVEE_PARSE_QUOTED;
+					break;
+				}
+				if (skipwhitespace && (ch == ' ' || ch == '\t') && ch != delim)
+					break;
+				parser->state = CSVEE_PARSE_UNQUOTED;
+				/* fall through */
+
+			case CSVEE_PARSE_UNQUOTED:
+				if (ch == delim)
+				{
+					if (!csvee_parser_end_field(parser))
+						return false;
+				}
+				else if (ch == '\n' || ch == '\r')
+				{
+					parser->skip_lf = ch == '\r';
+					parser->row_end = parser->stats.bytes_scanned + i + 1;
+					if (!csvee_parser_end_row(parser))
+						return false;
+				}
+				else
+				{
+					/* copy the whole run up to the next delimiter or line end at once */
+					size_t start = i;
+					while (i + 1 < size && data[i + 1] != delim && data[i + 1] != '\n' && data[i + 1] != '\r')
+						++i;
+					if (!csvee_parser_append(parser, data + start, i - start + 1))
+						return false;
+				}
+				break;
+
+			case CSVEE_PARSE_QUOTED:
+				if (ch == quote)
+				{
+					parser->state = CSVEE_PARSE_QUOTE_IN_QUOTED;
+				}
+				else if (ch == '\\' && !doublequote)
+				{
+					parser->state = CSVEE_PARSE_ESCAPE;
+				}
+				else
+				{
+					size_t start = i;
+					while (i + 1 < size && data[i + 1] != quote && (doublequote || data[i + 1] != '\\'))
+						++i;
+					if (!csvee_parser_append(parser, data + start, i - start + 1))
+						return false;
+				}
+				break;
+
+			case CSVEE_PARSE_ESCAPE:
+				if (!csvee_parser_append(parser, &ch, 1))
+					return false;
+				parser->stats.escaped_quotes += ch == quote;
+				parser->state = CSVEE_PARSE_QUOTED;
+				break;
+
+			case CSVEE_PARSE_QUOTE_IN_QUOTED:
+				if (ch == quote && doublequote)
+				{
+					if (!csvee_parser_append(parser, &ch, 1))
+						return false;
+					parser->stats.escaped_quotes++;
+					parser->state = CSVEE_PARSE_QUOTED;
+				}
+				else if (ch == delim)
+				{
+					if (!csvee_parser_end_field(parser))
+						return false;
+				}
+				else if (ch == '\n' || ch == '\r')
+				{
+					parser->skip_lf = ch == '\r';
+					parser->row_end = parser->stats.bytes_scanned + i + 1;
+					if (!csvee_parser_end_row(parser))
+						return false;
+				}
+				else
+				{
+					/* stray bytes after a closing quote are kept verbatim */
+					if (!csvee_parser_append(parser, &ch, 1))
+						return false;
+					parser->state = CSVEE_PARSE_UNQUOTED;
+				}
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool csvee_parser_feed(CSVParser_t *parser, const char *data, size_t size)
+	{
+		uint64_t start_ns = csvee_now_ns();
+		bool ok = csvee_parser_scan(parser, data, size);
+		parser->stats.bytes_scanned += size;
+		parser->stats.tokenize_ns += csvee_now_ns() - start_ns;
+		return ok;
+	}
+
+	/* Flush a final row that was not terminated by a newline and settle the phase times. */
+	bool csvee_parser_finish(CSVParser_t *parser)
+	{
+		uint64_t start_ns = csvee_now_ns();
+		parser->skip_lf = false;
+		parser->row_end = parser->stats.bytes_scanned;
+		bool ok = csvee_parser_end_row(parser);
+		parser->stats.tokenize_ns += csvee_now_ns() - start_ns;
+
+		if (parser->sampled_rows)
+		{
+			uint64_t estimate = (uint64_t)((double)parser->sampled_ns * (double)parser->stats.rows / (double)parser->sampled_rows);
+			if (estimate > parser->stats.tokenize_ns)
+				estimate = parser->stats.tokenize_ns;
+			parser->stats.materialize_ns = estimate;
+			parser->stats.tokenize_ns -= estimate;
+			parser->sampled_ns = 0;
+			parser->sampled_rows = 0;
+		}
+		return ok;
+	}
+
+	/* Add @p size bytes at @p data to the field, handing out what came before if they do not follow it. */
+	static inline bool csvee_piece_add(CSVPiece_t *piece, const char *data, size_t size)
+	{
+		if (piece->size && piece->data + piece->size != data)
+		{
+			if (!piece->on_field(piece->user, piece->data, piece->size, true))
+				return false;
+			piece->split = true;
+			piece->size = 0;
+		}
+		if (!piece->size)
+			piece->data = data;
+		piece->size += size;
+		return true;
+	}
+
+	static inline bool csvee_piece_end(CSVPiece_t *piece, const char *at)
+	{
+		bool ok = piece->on_field(piece->user, piece->size ? piece->data : at, piece->size, false);
+		piece->size = 0;
+		piece->split = false;
+		piece->fields++;
+		return ok;
+	}
+
+	/*
+	 * Tokenize @p buf as csvee_parser_feed() and csvee_parser_finish() would,
+	 * but hand each field to @p on_field as it is found and signal the end of
+	 * each row with @p on_row_end, without building rows or allocating
+	 * anything. Fields point into @p buf, so only a field with escaped quotes
+	 * is split, around each escape.
+	 */
+	bool csvee_parse_cb(const char *buf, size_t len, const CSVDialect_t *dialect, CSVFieldCallback_t on_field, CSVRowEndCallback_t on_row_end, void *user)
+	{
+		if ((!buf && len) || !dialect || !on_field || !on_row_end)
+			return false;
+
+		const char delim = dialect->delimiter;
+		const char quote = dialect->quotechar;
+		const bool doublequote = dialect->doublequote;
+		const bool skipwhitespace = dialect->skipwhitespace;
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		uint64_t start_ns = csvee_now_ns();
+
+		CSVPiece_t piece = {on_field, user, NULL, 0, false, 0};
+		int state = CSVEE_PARSE_FIELD_START;
+		bool quoted = false, ok = true;
+		size_t i = 0;
+		for (; ok && i <= len; ++i)
+		{
+			/* the end of the buffer ends the last row */
+			bool end = i == len;
+			char ch = end ? '\n' : buf[i];
+
+			if (state == CSVEE_PARSE_QUOTED && !end)
+			{
+				if (ch == quote)
+					state = CSVEE_PARSE_QUOTE_IN_QUOTED;
+				else if (ch == '\\' && !doublequote)
+					state = CSVEE_PARSE_ESCAPE;
+				else
+				{
+					size_t start = i;
+					while (i + 1 < len && buf[i + 1] != quote && (doublequote || buf[i + 1] != '\\'))
+						++i;
+					ok = csvee_piece_add(&piece, buf + start, i - start + 1);
+				}
+				continue;
+			}
+			if (state == CSVEE_PARSE_ESCAPE && !end)
+			{
+				ok = csvee_piece_add(&piece, buf + i, 1);
+				op.escaped_quotes += ch == quote;
+				state = CSVEE_PARSE_QUOTED;
+				continue;
+			}
+			if (state == CSVEE_PARSE_QUOTE_IN_QUOTED && ch == quote && doublequote)
+			{
+				ok = csvee_piece_add(&piece, buf + i, 1);
+				op.escaped_quotes++;
+				state = CSVEE_PARSE_QUOTED;
+				continue;
+			}
+			if (state == CSVEE_PARSE_FIELD_START && !end)
+			{
+				if (ch == quote)
+				{
+					quoted = true;
+					state = CSVEE_PARSE_QUOTED;
+					continue;
+				}
+				if (skipwhitespace && (ch == ' ' || ch == '\t') && ch != delim)
+					continue;
+			}
+
+			/* unquoted content, after a closing quote, or a field or row ending */
+			if (ch == delim)
+			{
+				op.quoted_fields += quoted;
+				quoted = false;
+				ok = csvee_piece_end(&piece, buf + i);
+				state = CSVEE_PARSE_FIELD_START;
+			}
+			else if (ch == '\n' || ch == '\r')
+			{
+				/* blank lines produce no row, as in csvee_parser_end_row() */
+				if (piece.fields || piece.size || piece.split || quoted)
+				{
+					op.quoted_fields += quoted;
+					ok = csvee_piece_end(&piece, buf + i) && on_row_end(user);
+					op.fields += piece.fields;
+					op.rows++;
+				}
+				piece.fields = 0;
+				quoted = false;
+				state = CSVEE_PARSE_FIELD_START;
+				if (ch == '\r' && i + 1 < len && buf[i + 1] == '\n')
+					++i;
+			}
+			else
+			{
+				/* the whole run up to the next delimiter or line end at once */
+				size_t start = i;
+				while (i + 1 < len && buf[i + 1] != delim && buf[i + 1] != '\n' && buf[i + 1] != '\r')
+					++i;
+				ok = csvee_piece_add(&piece, buf + start, i - start + 1);
+				state = CSVEE_PARSE_UNQUOTED;
+			}
+		}
+
+		op.bytes_scanned = i < len ? i : len;
+		op.tokenize_ns = csvee_now_ns() - start_ns;
+		csvee_stats_publish(&op);
+		return ok;
+	}
+
+	CSVCodec_t csvee_detect_codec(const unsigned char *magic, size_t size)
+	{
+		if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+			return CSVEE_CODEC_GZIP;
+		if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+			return CSVEE_CODEC_ZSTD;
+		return CSVEE_CODEC_NONE;
+	}
+
+	bool csvee_codec_supported(CSVCodec_t codec)
+	{
+		switch (codec)
+		{
+		case CSVEE_CODEC_NONE:
+			return true;
+#ifdef CSVEE_WITH_ZLIB
+		case CSVEE_CODEC_GZIP:
+			return true;
+#endif
+#ifdef CSVEE_WITH_ZSTD
+		case CSVEE_CODEC_ZSTD:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	/* Fold a finished parse into the table's counters and the global ones. */
+	static void csvee_read_stats(Csvee_t *csvee, const CSVStat_t *parsed)
+	{
+		CSVStat_t op = *parsed;
+
+		/* growth of the rows array was counted on the table while parsing */
+		op.allocations += csvee->stats.allocations;
+		op.bytes_allocated += csvee->stats.bytes_allocated;
+		op.footprint = sizeof(Csvee_t) + sizeof(CSVDialect_t) + op.bytes_allocated;
+		op.peak_footprint = op.footprint;
+		if (csvee->spill)
+		{
+			op.footprint = sizeof(Csvee_t) + sizeof(CSVDialect_t) + csvee_spill_usage(csvee);
+			op.peak_footprint = sizeof(Csvee_t) + sizeof(CSVDialect_t) + csvee->spill->peak_bytes;
+		}
+		csvee_stats_publish(&op);
+
+		/* spill traffic was published as it happened */
+		op.spill_evictions = csvee->stats.spill_evictions;
+		op.spill_bytes = csvee->stats.spill_bytes;
+		op.spill_loads = csvee->stats.spill_loads;
+		csvee->stats = op;
+	}
+
+	/* Choose the delimiter based on extension, ignoring a compression suffix. */
+	static char csvee_filename_delimiter(const char *filename)
+	{
+		size_t fnlen = strlen(filename);
+		if (fnlen >= 3 && strcasecmp(filename + fnlen - 3, ".gz") == 0)
+			fnlen -= 3;
+		else if (fnlen >= 4 && strcasecmp(filename + fnlen - 4, ".zst") == 0)
+			fnlen -= 4;
+		if (fnlen >= 4 && (strncasecmp(filename + fnlen - 4, ".tsv", 4) == 0 || strncasecmp(filename + fnlen - 4, ".txt", 4) == 0))
+			return '\t';
+		return CSVEE_SEPERATOR;
+	}
+
+	Csvee_t *csvee_read_from_file(const char *filename)
+	{
+		return csvee_read_from_file_opts(filename, NULL);
+	}
+
+	/* Open @p filename for reading and sniff its compression. */
+	static FILE *csvee_open_input(const char *filename, CSVCodec_t *codec)
+	{
+		FILE *file = fopen(filename, "rb");
+		if (!file)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(NULL_FILE, "Could not open file %s\n", filename);
+#endif // CSVEE_DEBUG
+			return NULL;
+		}
+
+		unsigned char magic[4];
+		size_t got = fread(magic, 1, sizeof(magic), file);
+		*codec = csvee_detect_codec(magic, got);
+		if (!csvee_codec_supported(*codec) || fseek(file, 0, SEEK_SET) != 0)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FILE, "%s is compressed but csvee was built without support for it\n", filename);
+#endif // CSVEE_DEBUG
+			fclose(file);
+			return NULL;
+		}
+		return file;
+	}
+
+	/* Read the rest of @p file into @p out, decompressing it on the way. */
+	static bool csvee_read_all(FILE *file, CSVCodec_t codec, CSVBuffer_t *out)
+	{
+		CSVInflate_t decoder;
+		if (codec != CSVEE_CODEC_NONE && !csvee_inflate_init(&decoder, file, codec))
+			return false;
+
+		csvee_stat_t st;
+		bool ok = true;
+		if (codec == CSVEE_CODEC_NONE && CSVEE_FSTAT(file, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size < SIZE_MAX)
+			ok = csvee_buffer_reserve(out, (size_t)st.st_size + 1);
+
+		while (ok && (ok = csvee_buffer_reserve(out, CSVEE_READ_BUFFER_SIZE)))
+		{
+			size_t n = codec == CSVEE_CODEC_NONE ? fread(out->data + out->size, 1, CSVEE_READ_BUFFER_SIZE, file)
+												 : csvee_inflate_read(&decoder, out->data + out->size, CSVEE_READ_BUFFER_SIZE);
+			if (n == 0)
+				break;
+			out->size += n;
+		}
+
+		ok = ok && !ferror(file);
+		if (codec != CSVEE_CODEC_NONE)
+		{
+			ok = ok && !decoder.failed;
+			csvee_inflate_end(&decoder);
+		}
+		return ok;
+	}
+
+	Csvee_t *csvee_read_from_file_opts(const char *filename, const CSVReadOptions_t *options)
+	{
+		if (!filename)
+			return NULL;
+
+		Csvee_t *csvee = csvee_new(csvee_filename_delimiter(filename));
+		if (!csvee)
+			return NULL;
+
+		if (options && options->memory_budget && !options->lazy &&
+			!csvee_set_memory_budget(csvee, options->memory_budget, options->spill_dir))
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(IO_ERROR, "Could not create a spill file\n");
+#endif // CSVEE_DEBUG
+			csvee_free(csvee);
+			return NULL;
+		}
+
+		CSVCodec_t codec;
+		FILE *file = csvee_open_input(filename, &codec);
+		if (!file)
+		{
+			csvee_free(csvee);
+			return NULL;
+		}
+
+		if (options && options->lazy)
+		{
+			CSVBuffer_t input = {NULL, 0, 0};
+			bool ok = csvee_read_all(file, codec, &input);
+			fclose(file);
+			if (!ok)
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(IO_ERROR, "Could not read %s\n", filename);
+#endif // CSVEE_DEBUG
+				csvee_buffer_free(&input);
+			}
+			if (!ok || !csvee_lazy_attach(csvee, input.data, input.size))
+			{
+				csvee_free(csvee);
+				return NULL;
+			}
+			return csvee;
+		}
+
+		CSVParser_t parser;
+		csvee_parser_init(&parser, csvee->dialect, csvee_append_row_cb, csvee);
+		if (options && options->compact && !csvee->spill)
+		{
+			csvee->compact = (CSVCompact_t *)calloc(1, sizeof(CSVCompact_t));
+			parser.on_record = csvee_compact_record;
+		}
+
+		bool ok = (!parser.on_record || csvee->compact) &&
+				  (codec == CSVEE_CODEC_NONE ? csvee_read_plain(file, &parser)
+											 : csvee_read_compressed(file, codec, &parser));
+		ok = ok && csvee_parser_finish(&parser);
+		if (csvee->compact)
+			csvee_compact_finish(csvee);
+
+		csvee_read_stats(csvee, &parser.stats);
+		csvee_parser_free(&parser);
+		fclose(file);
+
+		if (!ok)
+		{
+			csvee_free(csvee);
+			return NULL;
+		}
+		return csvee;
+	}
+
+	/* Parse CSV content from a memory buffer (string). Returns allocated Csvee_t* or NULL on error. */
+	Csvee_t *csvee_read_from_string(const char *data)
+	{
+		if (!data)
+			return NULL;
+
+		Csvee_t *csvee = csvee_new(CSVEE_SEPERATOR);
+		if (!csvee)
+			return NULL;
+
+		CSVParser_t parser;
+		csvee_parser_init(&parser, csvee->dialect, csvee_append_row_cb, csvee);
+		bool ok = csvee_parser_feed(&parser, data, strlen(data)) && csvee_parser_finish(&parser);
+		csvee_read_stats(csvee, &parser.stats);
+		csvee_parser_free(&parser);
+
+		if (!ok)
+		{
+			csvee_free(csvee);
+			return NULL;
+		}
+		return csvee;
+	}
+
+	/* Wait for a dispatched batch and take over its run. */
+	static void csvee_sort_collect(CSVSortJob_t *job, CSVSortBatch_t *batch)
+	{
+		if (!batch->busy)
+			return;
+#ifndef CSVEE_NO_THREADS
+		if (job->nbatches > 1)
+			csvee_thread_join(batch->thread);
+#endif
+		batch->busy = false;
+		job->runs[batch->run_index] = batch->run;
+		if (!batch->ok)
+			job->failed = true;
+		batch->run = NULL;
+	}
+
+	/* Hand the batch being filled to a worker (or sort it here) and move on to the next one. */
+	static bool csvee_sort_dispatch(CSVSortJob_t *job)
+	{
+		if (job->run_count == job->run_cap)
+		{
+			size_t capacity = job->run_cap ? job->run_cap * 2 : 16;
+			FILE **runs = (FILE **)realloc(job->runs, capacity * sizeof(FILE *));
+			if (!runs)
+				return false;
+			job->runs = runs;
+			job->run_cap = capacity;
+		}
+
+		CSVSortBatch_t *batch = &job->batches[job->current];
+		batch->run_index = job->run_count;
+		job->runs[job->run_count++] = NULL;
+		batch->busy = true;
+
+#ifndef CSVEE_NO_THREADS
+		if (job->nbatches > 1 && !csvee_thread_create(&batch->thread, csvee_sort_batch_run, batch))
+			return false;
+		if (job->nbatches == 1)
+#endif
+		{
+			csvee_sort_batch_run(batch);
+			csvee_sort_collect(job, batch);
+		}
+
+		job->current = (job->current + 1) % job->nbatches;
+		CSVSortBatch_t *next = &job->batches[job->current];
+		csvee_sort_collect(job, next);
+		next->data.size = 0;
+		next->count = 0;
+		return !job->failed;
+	}
+
+	static bool csvee_sort_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVSortJob_t *job = (CSVSortJob_t *)user;
+		char lineterm = job->dialect->lineterminator;
+		bool ok;
+
+		if (job->header && !job->have_header)
+		{
+			job->have_header = true;
+			ok = csvee_format_row(&job->header_line, row, job->dialect, lineterm, NULL);
+			csvee_row_free(row);
+			return ok;
+		}
+
+		CSVSortBatch_t *batch = &job->batches[job->current];
+		if (batch->count == batch->capacity)
+		{
+			size_t capacity = batch->capacity ? batch->capacity * 2 : 1024;
+			CSVSortItem_t *items = (CSVSortItem_t *)realloc(batch->items, capacity * sizeof(CSVSortItem_t));
+			if (!items)
+			{
+				csvee_row_free(row);
+				return false;
+			}
+			batch->items = items;
+			batch->capacity = capacity;
+		}
+
+		CSVSortItem_t *item = &batch->items[batch->count];
+		item->offset = batch->data.size;
+		ok = csvee_sort_key(&batch->data, job->keys, job->nkeys, row);
+		item->key_len = (uint32_t)(batch->data.size - item->offset);
+		ok = ok && csvee_format_row(&batch->data, row, job->dialect, lineterm, NULL);
+		item->line_len = (uint32_t)(batch->data.size - item->offset - item->key_len);
+		item->prefix = csvee_sort_prefix(batch->data.data + item->offset, item->key_len);
+		csvee_row_free(row);
+		if (!ok)
+			return false;
+		batch->count++;
+
+		/* the sort needs a second item array, count it against the limit too */
+		if (batch->data.size + 2 * batch->count * sizeof(CSVSortItem_t) >= job->batch_limit)
+			return csvee_sort_dispatch(job);
+		return true;
+	}
+
+	/*
+	 * Sort the records of @p in by @p keys into @p out. The input is cut
+	 * into batches of about @p mem_limit / @p nthreads bytes, which are
+	 * sorted on @p nthreads threads and written to temporary run files
+	 * while parsing continues; the runs are then merged into @p out. With
+	 * @p header the first record stays first. The sort is stable, and
+	 * gzip/zstd input and output work as for csvee_read_from_file() and
+	 * csvee_write_to_file().
+	 */
+	bool csvee_sort_file(const char *in, const char *out, const CSVSortKey_t *keys, size_t nkeys, bool header, size_t mem_limit, size_t nthreads)
+	{
+		if (!in || !out || (!keys && nkeys))
+			return false;
+		if (!mem_limit)
+			mem_limit = CSVEE_SORT_MEMORY;
+#ifdef CSVEE_NO_THREADS
+		nthreads = 1;
+#endif
+		if (!nthreads)
+			nthreads = 1;
+
+		CSVCodec_t codec;
+		FILE *input = csvee_open_input(in, &codec);
+		if (!input)
+			return false;
+
+		CSVDialect_t in_dialect, out_dialect;
+		csvee_dialect_init(&in_dialect, NULL, csvee_filename_delimiter(in), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+		csvee_dialect_init(&out_dialect, NULL, csvee_filename_delimiter(out), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+		CSVSortJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.keys = keys;
+		job.nkeys = nkeys;
+		job.dialect = &out_dialect;
+		job.header = header;
+		job.nbatches = nthreads;
+		job.batch_limit = mem_limit / nthreads / 2; /* buffers grow by doubling */
+		job.batches = (CSVSortBatch_t *)calloc(nthreads, sizeof(CSVSortBatch_t));
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+
+		CSVParser_t parser;
+		csvee_parser_init(&parser, &in_dialect, csvee_sort_row_cb, &job);
+		bool ok = job.batches != NULL;
+		if (ok)
+		{
+			ok = codec == CSVEE_CODEC_NONE ? csvee_read_plain(input, &parser)
+										   : csvee_read_compressed(input, codec, &parser);
+			ok = ok && csvee_parser_finish(&parser);
+		}
+		csvee_stats_merge(&op, &parser.stats);
+		csvee_parser_free(&parser);
+		fclose(input);
+
+		bool in_memory = ok && job.run_count == 0;
+		if (ok && !in_memory && job.batches[job.current].count)
+			ok = csvee_sort_dispatch(&job);
+		for (size_t b = 0; job.batches && b < job.nbatches; ++b)
+			csvee_sort_collect(&job, &job.batches[b]);
+		ok = ok && !job.failed;
+
+		CSVWriteOptions_t options = csvee_write_options_for(out);
+		CSVSink_t sink;
+		ok = ok && csvee_sink_open(&sink, out, &options, &op);
+		bool opened = ok;
+		if (ok && job.header_line.size)
+			ok = csvee_buffer_append(&sink.block, job.header_line.data, job.header_line.size);
+
+		if (ok && in_memory)
+		{
+			/* everything fit in one batch: no run files needed */
+			CSVSortBatch_t *batch = &job.batches[job.current];
+			CSVSortItem_t *tmp = (CSVSortItem_t *)malloc(batch->count * sizeof(CSVSortItem_t) + 1);
+			ok = tmp != NULL;
+			if (ok)
+				csvee_sort_items(batch->items, tmp, batch->count, batch->data.data);
+			for (size_t i = 0; ok && i < batch->count; ++i)
+			{
+				const CSVSortItem_t *item = &batch->items[i];
+				ok = csvee_buffer_append(&sink.block, batch->data.data + item->offset + item->key_len, item->line_len);
+				if (ok && sink.block.size >= sink.block_size)
+					ok = csvee_sink_flush(&sink);
+			}
+			free(tmp);
+		}
+		else if (ok)
+		{
+			/* too many runs to keep open at once: merge them in groups first */
+			while (ok && job.run_count > CSVEE_SORT_FANOUT)
+			{
+				size_t merged = 0, first = 0;
+				for (; ok && first < job.run_count; first += CSVEE_SORT_FANOUT)
+				{
+					size_t k = job.run_count - first < CSVEE_SORT_FANOUT ? job.run_count - first : CSVEE_SORT_FANOUT;
+					FILE *run = csvee_spill_open(NULL);
+					ok = run && csvee_sort_merge(job.runs + first, k, run, NULL) &&
+						 fflush(run) == 0 && fseek(run, 0, SEEK_SET) == 0;
+					for (size_t r = first; r < first + k; ++r)
+					{
+						fclose(job.runs[r]);
+						job.runs[r] = NULL;
+					}
+					job.runs[merged++] = run;
+				}
+				/* a failed pass stops early: close the runs it never reached */
+				for (size_t r = first; r < job.run_count; ++r)
+					if (job.runs[r])
+					{
+						fclose(job.runs[r]);
+						job.runs[r] = NULL;
+					}
+				job.run_count = merged;
+			}
+			ok = ok && csvee_sort_merge(job.runs, job.run_count, NULL, &sink);
+		}
+
+		if (opened)
+			ok = csvee_sink_close(&sink, ok);
+		csvee_stats_publish(&op);
+
+		for (size_t r = 0; r < job.run_count; ++r)
+			if (job.runs[r])
+				fclose(job.runs[r]);
+		free(job.runs);
+		for (size_t b = 0; job.batches && b < job.nbatches; ++b)
+		{
+			csvee_buffer_free(&job.batches[b].data);
+			free(job.batches[b].items);
+		}
+		free(job.batches);
+		csvee_buffer_free(&job.header_line);
+		return ok;
+	}
+
+	/* csvee_sort() phase one: build the keys of a slice and measure what they share with the first one. */
+	static void csvee_sort_part_keys(void *arg)
+	{
+		CSVSortPart_t *part = (CSVSortPart_t *)arg;
+		part->shared = part->ref_len;
+		part->ok = true;
+		for (size_t r = part->first; r < part->end && part->ok; ++r)
+		{
+			CSVSortItem_t *item = &part->items[r];
+			item->offset = part->data.size;
+			item->row = r;
+			part->ok = csvee_sort_key(&part->data, part->keys, part->nkeys, &part->rows[r]);
+			item->key_len = (uint32_t)(part->data.size - item->offset);
+
+			const char *key = part->data.data + item->offset;
+			size_t n = 0;
+			while (n < part->shared && n < item->key_len && key[n] == part->ref[n])
+				++n;
+			part->shared = n;
+		}
+	}
+
+	/* Phase two: drop the shared bytes, then radix sort the slice. */
+	static void csvee_sort_part_sort(void *arg)
+	{
+		CSVSortPart_t *part = (CSVSortPart_t *)arg;
+		CSVSortItem_t *items = part->items + part->first;
+		size_t count = part->end - part->first;
+		for (size_t i = 0; i < count; ++i)
+		{
+			items[i].offset += part->base + part->shared;
+			items[i].key_len -= (uint32_t)part->shared;
+			items[i].prefix = csvee_sort_prefix(part->keys_data + items[i].offset, items[i].key_len);
+		}
+		csvee_sort_radix(items, part->tmp + part->first, count, part->keys_data);
+	}
+
+	/* Phase three: merge two sorted neighbours from items into tmp. */
+	static void csvee_sort_part_merge(void *arg)
+	{
+		CSVSortPart_t *part = (CSVSortPart_t *)arg;
+		const CSVSortItem_t *src = part->items;
+		size_t i = part->first, j = part->mid, o = part->first;
+		while (i < part->mid && j < part->end)
+			part->tmp[o++] = csvee_sort_item_cmp(&src[j], &src[i], part->keys_data) < 0 ? src[j++] : src[i++];
+		while (i < part->mid)
+			part->tmp[o++] = src[i++];
+		while (j < part->end)
+			part->tmp[o++] = src[j++];
+	}
+
+	/* Run @p fn on every part, each but the first on a thread of its own. */
+	static void csvee_sort_each(CSVSortPart_t *parts, size_t count, void (*fn)(void *arg))
+	{
+#ifndef CSVEE_NO_THREADS
+		bool *started = (bool *)calloc(count, sizeof(bool));
+		for (size_t p = 1; started && p < count; ++p)
+			started[p] = csvee_thread_create(&parts[p].thread, fn, &parts[p]);
+		for (size_t p = 0; p < count; ++p)
+			if (!started || !started[p])
+				fn(&parts[p]);
+		for (size_t p = 1; started && p < count; ++p)
+			if (started[p])
+				csvee_thread_join(parts[p].thread);
+		free(started);
+#else
+		for (size_t p = 0; p < count; ++p)
+			fn(&parts[p]);
+#endif
+	}
+
+	/*
+	 * Sort the rows of @p csvee in place by @p keys, see CSVSortKey_t. The
+	 * table is cut into one slice per core (at least CSVEE_SORT_GRAIN rows
+	 * each); every slice builds the binary keys of its rows and radix sorts
+	 * them on the first eight bytes the keys do not all share, then the
+	 * slices are merged pairwise. The sort is stable. Every row takes part,
+	 * a header row included. Tables with a memory budget are not sorted,
+	 * use csvee_sort_file() for them.
+	 */
+	bool csvee_sort(Csvee_t *csvee, const CSVSortKey_t *keys, size_t nkeys)
+	{
+		if (!csvee || (!keys && nkeys))
+			return false;
+		if (csvee->spill)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(UNKNOWN, "Cannot sort a table with a memory budget in place\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		if (!csvee_purge(csvee) || !csvee_lazy_settle(csvee) || !csvee_share_detach(csvee))
+			return false;
+		size_t count = csvee->count;
+		if (count < 2 || nkeys == 0)
+			return true;
+
+		size_t nparts = 1;
+#ifndef CSVEE_NO_THREADS
+		nparts = csvee_cpu_count();
+		if (nparts > count / CSVEE_SORT_GRAIN)
+			nparts = count / CSVEE_SORT_GRAIN ? count / CSVEE_SORT_GRAIN : 1;
+#endif
+
+		CSVSortItem_t *items = (CSVSortItem_t *)malloc(count * sizeof(CSVSortItem_t));
+		CSVSortItem_t *tmp = (CSVSortItem_t *)malloc(count * sizeof(CSVSortItem_t));
+		CSVSortPart_t *parts = (CSVSortPart_t *)calloc(nparts, sizeof(CSVSortPart_t));
+		size_t *bounds = (size_t *)malloc((nparts + 1) * sizeof(size_t));
+		CSVBuffer_t ref = {NULL, 0, 0}, data = {NULL, 0, 0};
+		CSVRow_t *rows = NULL;
+		bool ok = items && tmp && parts && bounds && csvee_sort_key(&ref, keys, nkeys, &csvee->rows[0]);
+
+		for (size_t p = 0; ok && p < nparts; ++p)
+		{
+			parts[p].rows = csvee->rows;
+			parts[p].keys = keys;
+			parts[p].nkeys = nkeys;
+			parts[p].first = count / nparts * p;
+			parts[p].end = p + 1 < nparts ? count / nparts * (p + 1) : count;
+			parts[p].ref = ref.data;
+			parts[p].ref_len = ref.size;
+			parts[p].items = items;
+			parts[p].tmp = tmp;
+			bounds[p] = parts[p].first;
+		}
+		if (ok)
+		{
+			bounds[nparts] = count;
+			csvee_sort_each(parts, nparts, csvee_sort_part_keys);
+		}
+
+		/* gather the keys in one block, as the merges compare across slices */
+		size_t shared = ref.size;
+		for (size_t p = 0; ok && p < nparts; ++p)
+		{
+			ok = parts[p].ok && csvee_buffer_reserve(&data, parts[p].data.size + 1);
+			if (!ok)
+				break;
+			parts[p].base = data.size;
+			memcpy(data.data + data.size, parts[p].data.data, parts[p].data.size);
+			data.size += parts[p].data.size;
+			csvee_buffer_free(&parts[p].data);
+			if (parts[p].shared < shared)
+				shared = parts[p].shared;
+		}
+
+		if (ok)
+		{
+			for (size_t p = 0; p < nparts; ++p)
+			{
+				parts[p].keys_data = data.data;
+				parts[p].shared = shared;
+			}
+			csvee_sort_each(parts, nparts, csvee_sort_part_sort);
+
+			/* merge neighbouring slices until one is left */
+			for (size_t slices = nparts; slices > 1;)
+			{
+				size_t merges = (slices + 1) / 2;
+				for (size_t m = 0; m < merges; ++m)
+				{
+					parts[m].items = items;
+					parts[m].tmp = tmp;
+					parts[m].first = bounds[2 * m];
+					parts[m].mid = bounds[2 * m + 1 < slices ? 2 * m + 1 : slices];
+					parts[m].end = bounds[2 * m + 2 < slices ? 2 * m + 2 : slices];
+					bounds[m] = parts[m].first;
+				}
+				bounds[merges] = count;
+				csvee_sort_each(parts, merges, csvee_sort_part_merge);
+				CSVSortItem_t *swap = items;
+				items = tmp;
+				tmp = swap;
+				slices = merges;
+			}
+
+			rows = (CSVRow_t *)malloc(csvee->capacity * sizeof(CSVRow_t));
+			ok = rows != NULL;
+		}
+
+		if (ok)
+		{
+			for (size_t r = 0; r < count; ++r)
+				rows[r] = csvee->rows[items[r].row];
+			free(csvee->rows);
+			csvee->rows = rows;
+		}
+#ifdef CSVEE_DEBUG
+		else
+			csvee_error(OUT_OF_MEMORY, "Not enough memory to sort %zu rows\n", count);
+#endif // CSVEE_DEBUG
+
+		for (size_t p = 0; parts && p < nparts; ++p)
+			csvee_buffer_free(&parts[p].data);
+		csvee_buffer_free(&data);
+		csvee_buffer_free(&ref);
+		free(bounds);
+		free(parts);
+		free(tmp);
+		free(items);
+		return ok;
+	}
+
+	/* Spill @p table to the partition files once it outgrows its share of the memory limit. */
+	static bool csvee_group_limit(CSVGroupJob_t *job, CSVGroupTable_t *table)
+	{
+		return csvee_group_bytes(table) <= job->table_limit || csvee_group_spill(job, table);
+	}
+
+#ifndef CSVEE_NO_THREADS
+	/* Aggregation thread: folds the batches published to its ring into its own table. */
+	static void csvee_group_worker(void *arg)
+	{
+		CSVGroupWorker_t *worker = (CSVGroupWorker_t *)arg;
+		CSVGroupJob_t *job = worker->job;
+		CSVRing_t *ring = &worker->ring;
+		for (;;)
+		{
+			csvee_mutex_lock(&ring->lock);
+			while (ring->filled == 0 && !ring->done)
+				csvee_cond_wait(&ring->not_empty, &ring->lock);
+			if (ring->filled == 0)
+			{
+				csvee_mutex_unlock(&ring->lock);
+				return;
+			}
+			size_t slot = ring->head;
+			csvee_mutex_unlock(&ring->lock);
+
+			CSVBuffer_t *batch = &ring->slots[slot];
+			bool ok = csvee_group_consume(&worker->table, job->aggregates, batch->data, batch->size) &&
+					  csvee_group_limit(job, &worker->table);
+
+			csvee_mutex_lock(&ring->lock);
+			batch->size = 0;
+			ring->head = (ring->head + 1) % CSVEE_RING_SIZE;
+			ring->filled--;
+			if (!ok)
+			{
+				worker->ok = false;
+				ring->cancelled = true;
+			}
+			csvee_cond_signal(&ring->not_full);
+			csvee_mutex_unlock(&ring->lock);
+
+			if (!ok)
+				return;
+		}
+	}
+#endif // CSVEE_NO_THREADS
+
+	/* Hand the collected row records to the next worker, round robin. */
+	static bool csvee_group_dispatch(CSVGroupJob_t *job)
+	{
+		CSVGroupWorker_t *worker = &job->workers[job->next];
+		job->next = (job->next + 1) % job->nworkers;
+#ifndef CSVEE_NO_THREADS
+		if (worker->threaded)
+			return csvee_ring_publish(&worker->ring, &job->batch);
+#endif
+		worker->ok = worker->ok && csvee_group_consume(&worker->table, job->aggregates, job->batch.data, job->batch.size) &&
+					 csvee_group_limit(job, &worker->table);
+		job->batch.size = 0;
+		return worker->ok;
+	}
+
+	/* Reduce a record to its group key and the fields the aggregates read. */
+	static bool csvee_group_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVGroupJob_t *job = (CSVGroupJob_t *)user;
+		if (job->header && !job->have_names)
+		{
+			job->have_names = true;
+			job->names = *row;
+			return true;
+		}
+
+		CSVBuffer_t *batch = &job->batch;
+		job->key.size = 0;
+		bool ok = csvee_sort_key(&job->key, job->keys, job->nkeys, row) && csvee_buffer_put_varint(batch, job->key.size) &&
+				  csvee_buffer_append(batch, job->key.data, job->key.size);
+
+		char scratch[64];
+		for (size_t a = 0; ok && a < job->naggregates; ++a)
+		{
+			if (job->aggregates[a].op == CSVEE_AGG_COUNT)
+				continue;
+			size_t c = job->aggregates[a].column;
+			const char *text = c < row->count ? csvee_field_text(&row->fields[c], scratch, sizeof(scratch)) : "";
+			size_t len = strlen(text);
+			ok = csvee_buffer_put_varint(batch, len) && csvee_buffer_append(batch, text, len);
+		}
+		csvee_row_free(row);
+
+		if (ok && batch->size >= CSVEE_READ_BUFFER_SIZE)
+			ok = csvee_group_dispatch(job);
+		return ok;
+	}
+
+	/* Header of the result: the group column names, then "sum(price)" and the like. */
+	static bool csvee_group_header(CSVGroupJob_t *job, const size_t *columns, size_t ncolumns, CSVSink_t *sink, const CSVDialect_t *dialect)
+	{
+		static const char *const ops[] = {"count", "sum", "min", "max", "mean", "count_distinct"};
+		const CSVRow_t *names = &job->names;
+		size_t count = ncolumns + job->naggregates;
+		CSVField_t *fields = (CSVField_t *)malloc(count * sizeof(CSVField_t) + 1);
+		CSVBuffer_t text = {NULL, 0, 0};
+		bool ok = fields != NULL;
+
+		/* the names go in one buffer first, its address is only final at the end */
+		size_t *starts = (size_t *)malloc(count * sizeof(size_t) + 1);
+		ok = ok && starts;
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			size_t c = i < ncolumns ? columns[i] : job->aggregates[i - ncolumns].column;
+			const char *name = c < names->count && names->fields[c].value._string ? names->fields[c].value._string : "";
+			starts[i] = text.size;
+			if (i < ncolumns)
+				ok = csvee_buffer_append(&text, name, strlen(name) + 1);
+			else
+			{
+				const char *op = ops[job->aggregates[i - ncolumns].op];
+				ok = csvee_buffer_append(&text, op, strlen(op));
+				if (ok && job->aggregates[i - ncolumns].op != CSVEE_AGG_COUNT)
+					ok = csvee_buffer_append(&text, "(", 1) && csvee_buffer_append(&text, name, strlen(name)) &&
+						 csvee_buffer_append(&text, ")", 1);
+				ok = ok && csvee_buffer_append(&text, "", 1);
+			}
+		}
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			fields[i].type = CSVEE_STRING;
+			fields[i].value._string = text.data + starts[i];
+		}
+
+		CSVRow_t row = {fields, count, count};
+		ok = ok && csvee_format_row(&sink->block, &row, dialect, dialect->lineterminator, NULL);
+		free(starts);
+		free(fields);
+		csvee_buffer_free(&text);
+		return ok;
+	}
+
+	/*
+	 * Group the records of @p in by @p columns and write one line per
+	 * group to @p out: the group columns, then @p aggregates. Parsing runs
+	 * on the calling thread, which hands batches of records round robin to
+	 * @p nthreads threads, each keeping its own hash table; the tables are
+	 * merged at the end. When the tables outgrow @p mem_limit their groups
+	 * are moved to CSVEE_GROUP_PARTITIONS files by hash of the key, and
+	 * each partition is then aggregated on its own.
+	 *
+	 * Groups come out ordered by key, within each partition when the input
+	 * was partitioned. With @p header the first record names the output
+	 * columns. COUNT counts records, SUM, MIN, MAX and MEAN skip fields
+	 * that are not numbers (and stay empty if a group has none), and
+	 * COUNT_DISTINCT counts distinct non-empty values exactly.
+	 */
+	bool csvee_group_file(const char *in, const char *out, const size_t *columns, size_t ncolumns, const CSVAggregate_t *aggregates, size_t naggregates, bool header, size_t mem_limit, size_t nthreads)
+	{
+		if (!in || !out || (!columns && ncolumns) || (!aggregates && naggregates))
+			return false;
+		if (!mem_limit)
+			mem_limit = CSVEE_GROUP_MEMORY;
+#ifdef CSVEE_NO_THREADS
+		nthreads = 1;
+#endif
+		if (!nthreads)
+			nthreads = 1;
+
+		CSVCodec_t codec;
+		FILE *input = csvee_open_input(in, &codec);
+		if (!input)
+			return false;
+
+		CSVDialect_t in_dialect, out_dialect;
+		csvee_dialect_init(&in_dialect, NULL, csvee_filename_delimiter(in), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+		csvee_dialect_init(&out_dialect, NULL, csvee_filename_delimiter(out), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+		CSVGroupJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.aggregates = aggregates;
+		job.naggregates = naggregates;
+		job.nkeys = ncolumns;
+		job.header = header;
+		job.nworkers = nthreads;
+		job.table_limit = mem_limit / nthreads;
+		job.keys = (CSVSortKey_t *)malloc(ncolumns * sizeof(CSVSortKey_t) + 1);
+		job.workers = (CSVGroupWorker_t *)calloc(nthreads, sizeof(CSVGroupWorker_t));
+		bool ok = job.keys && job.workers;
+		for (size_t c = 0; ok && c < ncolumns; ++c)
+		{
+			job.keys[c].column = columns[c];
+			job.keys[c].type = CSVEE_SORT_TEXT;
+			job.keys[c].order = CSVEE_SORT_ASC;
+		}
+
+#ifndef CSVEE_NO_THREADS
+		csvee_mutex_init(&job.lock);
+#endif
+		for (size_t w = 0; ok && w < nthreads; ++w)
+		{
+			CSVGroupWorker_t *worker = &job.workers[w];
+			worker->job = &job;
+			worker->table.naggregates = naggregates;
+			worker->ok = true;
+#ifndef CSVEE_NO_THREADS
+			if (nthreads > 1)
+			{
+				csvee_mutex_init(&worker->ring.lock);
+				csvee_cond_init(&worker->ring.not_empty);
+				csvee_cond_init(&worker->ring.not_full);
+				worker->threaded = csvee_thread_create(&worker->thread, csvee_group_worker, worker);
+			}
+#endif
+		}
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+
+		CSVParser_t parser;
+		csvee_parser_init(&parser, &in_dialect, csvee_group_row_cb, &job);
+		if (ok)
+		{
+			ok = codec == CSVEE_CODEC_NONE ? csvee_read_plain(input, &parser)
+										   : csvee_read_compressed(input, codec, &parser);
+			ok = ok && csvee_parser_finish(&parser);
+		}
+		csvee_stats_merge(&op, &parser.stats);
+		csvee_parser_free(&parser);
+		fclose(input);
+
+		/* stop the workers; whatever is left is folded in here */
+		for (size_t w = 0; job.workers && w < nthreads; ++w)
+		{
+			CSVGroupWorker_t *worker = &job.workers[w];
+#ifndef CSVEE_NO_THREADS
+			if (nthreads > 1)
+			{
+				if (worker->threaded)
+				{
+					csvee_mutex_lock(&worker->ring.lock);
+					worker->ring.done = true;
+					csvee_cond_signal(&worker->ring.not_empty);
+					csvee_mutex_unlock(&worker->ring.lock);
+					csvee_thread_join(worker->thread);
+					worker->threaded = false;
+				}
+				csvee_mutex_destroy(&worker->ring.lock);
+				csvee_cond_destroy(&worker->ring.not_empty);
+				csvee_cond_destroy(&worker->ring.not_full);
+				for (size_t i = 0; i < CSVEE_RING_SIZE; ++i)
+					csvee_buffer_free(&worker->ring.slots[i]);
+			}
+#endif
+			ok = ok && worker->ok;
+		}
+		if (ok && job.batch.size)
+			ok = csvee_group_dispatch(&job);
+
+		/* one table if everything fit, otherwise every group goes to the partitions */
+		for (size_t w = 1; ok && w < nthreads; ++w)
+		{
+			ok = job.spilled ? csvee_group_spill(&job, &job.workers[w].table)
+							 : csvee_group_absorb(&job.workers[0].table, &job.workers[w].table, aggregates);
+			csvee_group_free(&job.workers[w].table);
+		}
+		if (ok && job.spilled)
+			ok = csvee_group_spill(&job, &job.workers[0].table);
+
+		CSVWriteOptions_t options = csvee_write_options_for(out);
+		CSVSink_t sink;
+		ok = ok && csvee_sink_open(&sink, out, &options, &op);
+		bool opened = ok;
+		if (ok && job.have_names)
+			ok = csvee_group_header(&job, columns, ncolumns, &sink, &out_dialect);
+
+		if (ok && !job.spilled)
+			ok = csvee_group_emit(&job.workers[0].table, aggregates, ncolumns, &sink, &out_dialect);
+		for (size_t p = 0; ok && job.spilled && p < CSVEE_GROUP_PARTITIONS; ++p)
+		{
+			FILE *part = job.partitions[p];
+			if (!part)
+				continue;
+			ok = fflush(part) == 0 && fseek(part, 0, SEEK_SET) == 0 &&
+				 csvee_group_load(&job.workers[0].table, aggregates, part) &&
+				 csvee_group_emit(&job.workers[0].table, aggregates, ncolumns, &sink, &out_dialect);
+			csvee_group_clear(&job.workers[0].table);
+		}
+
+		if (opened)
+			ok = csvee_sink_close(&sink, ok);
+		csvee_stats_publish(&op);
+
+		for (size_t p = 0; p < CSVEE_GROUP_PARTITIONS; ++p)
+			if (job.partitions[p])
+				fclose(job.partitions[p]);
+		for (size_t w = 0; job.workers && w < nthreads; ++w)
+			csvee_group_free(&job.workers[w].table);
+#ifndef CSVEE_NO_THREADS
+		csvee_mutex_destroy(&job.lock);
+#endif
+		if (job.have_names)
+			csvee_row_free(&job.names);
+		csvee_buffer_free(&job.batch);
+		csvee_buffer_free(&job.key);
+		csvee_buffer_free(&job.spill);
+		free(job.workers);
+		free(job.keys);
+		return ok;
+	}
+
+	/* Append a partition record (key, then fields) for @p key to side @p side. */
+	static bool csvee_join_spill(CSVJoinJob_t *job, int side, const char *key, size_t key_len, const char *fields, size_t size)
+	{
+		CSVBuffer_t *record = &job->record;
+		record->size = 0;
+		if (!csvee_buffer_put_varint(record, key_len) || !csvee_buffer_append(record, key, key_len) ||
+			!csvee_buffer_put_varint(record, size) || !csvee_buffer_append(record, fields, size))
+			return false;
+		size_t p = (size_t)(csvee_hash(key, key_len) % CSVEE_JOIN_PARTITIONS);
+		FILE **file = &job->partitions[side][p];
+		if (!*file && !(*file = csvee_spill_open(NULL)))
+			return false;
+		return fwrite(record->data, 1, record->size, *file) == record->size;
+	}
+
+	/* The build side outgrew the memory limit: move it to the partition files. */
+	static bool csvee_join_partition(CSVJoinJob_t *job)
+	{
+		CSVJoinTable_t *table = &job->table;
+		const CSVHashTable_t *keys = &table->keys;
+		bool ok = true;
+		job->partitioned = true;
+		for (size_t id = 0; ok && id < keys->count; ++id)
+		{
+			const char *key = keys->keys.data + keys->offsets[id];
+			size_t key_len = keys->offsets[id + 1] - keys->offsets[id];
+			for (size_t r = table->first[id]; ok && r != SIZE_MAX; r = table->next[r])
+				ok = csvee_join_spill(job, 0, key, key_len, table->fields.data + table->offsets[r], table->offsets[r + 1] - table->offsets[r]);
+		}
+		csvee_join_clear(table);
+		return ok;
+	}
+
+	/* Move the joined lines of the oldest outstanding batch to the sink. */
+	static bool csvee_join_drain(CSVJoinJob_t *job)
+	{
+		CSVSink_t *sink = job->sink;
+		bool ok = true;
+#ifndef CSVEE_NO_THREADS
+		CSVJoinWorker_t *worker = &job->workers[job->written % job->nworkers];
+		ok = csvee_ring_take(&worker->output, &job->drained) &&
+			 csvee_buffer_append(&sink->block, job->drained.data, job->drained.size);
+#endif
+		job->written++;
+		if (ok && sink->block.size >= sink->block_size)
+			ok = csvee_sink_flush(sink);
+		return ok;
+	}
+
+	/* Probe the collected batch, on the next worker or right here. */
+	static bool csvee_join_dispatch(CSVJoinJob_t *job)
+	{
+#ifndef CSVEE_NO_THREADS
+		if (job->nworkers > 1)
+		{
+			/* a worker never has more than a ring's worth of batches in flight, so nobody blocks for good */
+			while (job->dispatched - job->written >= job->nworkers * (CSVEE_RING_SIZE - 1))
+				if (!csvee_join_drain(job))
+					return false;
+			CSVJoinWorker_t *worker = &job->workers[job->dispatched % job->nworkers];
+			job->dispatched++;
+			return csvee_ring_publish(&worker->input, &job->batch);
+		}
+#endif
+		CSVSink_t *sink = job->sink;
+		bool ok = csvee_join_probe(job, job->batch.data, job->batch.size, &sink->block);
+		job->batch.size = 0;
+		if (ok && sink->block.size >= sink->block_size)
+			ok = csvee_sink_flush(sink);
+		return ok;
+	}
+
+	/* Wait for every batch handed out to be written. */
+	static bool csvee_join_settle(CSVJoinJob_t *job)
+	{
+		bool ok = !job->batch.size || csvee_join_dispatch(job);
+		while (ok && job->written < job->dispatched)
+			ok = csvee_join_drain(job);
+		return ok;
+	}
+
+#ifndef CSVEE_NO_THREADS
+	/* Probe thread: batches from the input ring, joined lines to the output ring. */
+	static void csvee_join_worker(void *arg)
+	{
+		CSVJoinWorker_t *worker = (CSVJoinWorker_t *)arg;
+		while (csvee_ring_take(&worker->input, &worker->batch))
+		{
+			worker->lines.size = 0;
+			bool ok = csvee_join_probe(worker->job, worker->batch.data, worker->batch.size, &worker->lines) &&
+					  csvee_ring_publish(&worker->output, &worker->lines);
+			if (!ok)
+			{
+				csvee_mutex_lock(&worker->output.lock);
+				worker->output.cancelled = true;
+				csvee_cond_signal(&worker->output.not_empty);
+				csvee_mutex_unlock(&worker->output.lock);
+				return;
+			}
+		}
+	}
+#endif // CSVEE_NO_THREADS
+
+	/* Format @p row without its line terminator. */
+	static bool csvee_join_format(CSVBuffer_t *out, const CSVRow_t *row, const CSVDialect_t *dialect)
+	{
+		out->size = 0;
+		if (!csvee_format_row(out, row, dialect, dialect->lineterminator, NULL))
+			return false;
+		if (out->size)
+			out->size--;
+		return true;
+	}
+
+	/* Header line: left names, then right names unless the join keeps left records only. */
+	static bool csvee_join_header(CSVJoinJob_t *job)
+	{
+		job->header_written = true;
+		return csvee_join_line(job, &job->sink->block, job->names[0].data, job->names[0].size, job->names[1].data, job->names[1].size,
+							   job->type == CSVEE_JOIN_INNER || job->type == CSVEE_JOIN_LEFT);
+	}
+
+	/* Empty right fields to pad unmatched LEFT records with, once the width of the right input is known. */
+	static bool csvee_join_pad(CSVJoinJob_t *job)
+	{
+		job->padding.size = 0;
+		for (size_t c = 1; c < job->right_columns; ++c)
+			if (!csvee_buffer_append(&job->padding, &job->dialect->delimiter, 1))
+				return false;
+		return true;
+	}
+
+	/* Take the header of a side, or the key and formatted fields of a record; *record tells which. */
+	static bool csvee_join_record(CSVJoinJob_t *job, CSVRow_t *row, int side, bool *record)
+	{
+		if (side == 1 && row->count > job->right_columns)
+			job->right_columns = row->count;
+		*record = !job->header || job->have_names[side];
+		if (!*record)
+		{
+			job->have_names[side] = true;
+			return csvee_join_format(&job->names[side], row, job->dialect);
+		}
+
+		char scratch[64];
+		size_t c = job->key_columns[side];
+		const char *key = c < row->count ? csvee_field_text(&row->fields[c], scratch, sizeof(scratch)) : "";
+		job->key.size = 0;
+		return csvee_buffer_append(&job->key, key, strlen(key)) && csvee_join_format(&job->line, row, job->dialect);
+	}
+
+	static bool csvee_join_build_cb(void *user, CSVRow_t *row)
+	{
+		CSVJoinJob_t *job = (CSVJoinJob_t *)user;
+		bool record;
+		bool ok = csvee_join_record(job, row, job->build_left ? 0 : 1, &record);
+		csvee_row_free(row);
+		if (!ok || !record)
+			return ok;
+		if (job->partitioned)
+			return csvee_join_spill(job, 0, job->key.data, job->key.size, job->line.data, job->line.size);
+		return csvee_join_add(&job->table, job->key.data, job->key.size, job->line.data, job->line.size) &&
+			   (csvee_join_bytes(&job->table) <= job->mem_limit || csvee_join_partition(job));
+	}
+
+	/* Queue a probe record, handing the batch out once it is full. */
+	static bool csvee_join_probe_put(CSVJoinJob_t *job, const char *key, size_t key_len, const char *fields, size_t size)
+	{
+		CSVBuffer_t *batch = &job->batch;
+		if (!csvee_buffer_put_varint(batch, key_len) || !csvee_buffer_append(batch, key, key_len) ||
+			!csvee_buffer_put_varint(batch, size) || !csvee_buffer_append(batch, fields, size))
+			return false;
+		return batch->size < CSVEE_READ_BUFFER_SIZE || csvee_join_dispatch(job);
+	}
+
+	static bool csvee_join_probe_cb(void *user, CSVRow_t *row)
+	{
+		CSVJoinJob_t *job = (CSVJoinJob_t *)user;
+		bool record;
+		bool ok = csvee_join_record(job, row, job->build_left ? 1 : 0, &record);
+		csvee_row_free(row);
+		if (!ok)
+			return false;
+		if (!record)
+			return csvee_join_header(job); /* nothing was written yet */
+		if (job->partitioned)
+			return csvee_join_spill(job, 1, job->key.data, job->key.size, job->line.data, job->line.size);
+		return csvee_join_probe_put(job, job->key.data, job->key.size, job->line.data, job->line.size);
+	}
+
+	/* Next record of a partition file into @p record: the key, then the fields from *key_len on. */
+	static bool csvee_join_read(FILE *file, CSVBuffer_t *record, size_t *key_len, bool *done)
+	{
+		int c = getc(file);
+		if (c == EOF)
+			return *done = !ferror(file);
+		ungetc(c, file);
+
+		uint64_t size;
+		record->size = 0;
+		if (!csvee_sort_read_varint(file, &size) || !csvee_buffer_reserve(record, (size_t)size) ||
+			fread(record->data, 1, (size_t)size, file) != size)
+			return false;
+		record->size = *key_len = (size_t)size;
+		if (!csvee_sort_read_varint(file, &size) || !csvee_buffer_reserve(record, (size_t)size) ||
+			fread(record->data + record->size, 1, (size_t)size, file) != size)
+			return false;
+		record->size += (size_t)size;
+		return true;
+	}
+
+	/* Parse @p filename into @p on_row, or @p on_record if set, adding the parse counters to @p stats. */
+	static bool csvee_parse_file(const char *filename, CSVRowCallback_t on_row, CSVRecordCallback_t on_record, void *user, CSVStat_t *stats)
+	{
+		CSVCodec_t codec;
+		FILE *input = csvee_open_input(filename, &codec);
+		if (!input)
+			return false;
+
+		CSVDialect_t dialect;
+		csvee_dialect_init(&dialect, NULL, csvee_filename_delimiter(filename), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+		CSVParser_t parser;
+		csvee_parser_init(&parser, &dialect, on_row, user);
+		parser.on_record = on_record;
+		bool ok = codec == CSVEE_CODEC_NONE ? csvee_read_plain(input, &parser)
+											: csvee_read_compressed(input, codec, &parser);
+		ok = ok && csvee_parser_finish(&parser);
+		csvee_stats_merge(stats, &parser.stats);
+		csvee_parser_free(&parser);
+		fclose(input);
+		return ok;
+	}
+
+	static bool csvee_parse_path(const char *filename, CSVRowCallback_t on_row, void *user, CSVStat_t *stats)
+	{
+		return csvee_parse_file(filename, on_row, NULL, user, stats);
+	}
+
+	/*
+	 * Join the records of @p left and @p right whose @p left_key and
+	 * @p right_key fields are equal, writing the result to @p out: left
+	 * fields then right fields for INNER and LEFT, left fields only for
+	 * SEMI and ANTI. The smaller file (by size on disk) is loaded into a
+	 * hash table of interned keys; the other is streamed through it,
+	 * probed on @p nthreads threads, with the output kept in probe order.
+	 * If the build side outgrows @p mem_limit (default CSVEE_JOIN_MEMORY)
+	 * both inputs are split into CSVEE_JOIN_PARTITIONS files by key hash
+	 * and joined a partition at a time (grace hash join), which changes
+	 * the order of the output. With @p header the first record of each
+	 * input names its columns and the output starts with both headers.
+	 */
+	bool csvee_join(const char *left, const char *right, size_t left_key, size_t right_key, CSVJoinType_t type, const char *out, bool header, size_t mem_limit, size_t nthreads)
+	{
+		if (!left || !right || !out)
+			return false;
+		if (!mem_limit)
+			mem_limit = CSVEE_JOIN_MEMORY;
+#ifdef CSVEE_NO_THREADS
+		nthreads = 1;
+#endif
+		if (!nthreads)
+			nthreads = 1;
+
+		csvee_stat_t left_st, right_st;
+		bool sized = CSVEE_STAT(left, &left_st) == 0 && CSVEE_STAT(right, &right_st) == 0;
+
+		CSVDialect_t dialect;
+		csvee_dialect_init(&dialect, NULL, csvee_filename_delimiter(out), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+		CSVJoinJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.type = type;
+		job.build_left = sized && left_st.st_size < right_st.st_size;
+		job.key_columns[0] = left_key;
+		job.key_columns[1] = right_key;
+		job.dialect = &dialect;
+		job.header = header;
+		job.mem_limit = mem_limit;
+		job.nworkers = nthreads;
+		job.workers = (CSVJoinWorker_t *)calloc(nthreads, sizeof(CSVJoinWorker_t));
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		bool ok = job.workers && csvee_parse_path(job.build_left ? left : right, csvee_join_build_cb, &job, &op);
+		ok = ok && (job.build_left || csvee_join_pad(&job));
+
+		CSVWriteOptions_t options = csvee_write_options_for(out);
+		CSVSink_t sink;
+		ok = ok && csvee_sink_open(&sink, out, &options, &op);
+		bool opened = ok;
+		job.sink = &sink;
+
+#ifndef CSVEE_NO_THREADS
+		for (size_t w = 0; ok && nthreads > 1 && w < nthreads; ++w)
+		{
+			CSVJoinWorker_t *worker = &job.workers[w];
+			worker->job = &job;
+			CSVRing_t *rings[2] = {&worker->input, &worker->output};
+			for (int r = 0; r < 2; ++r)
+			{
+				csvee_mutex_init(&rings[r]->lock);
+				csvee_cond_init(&rings[r]->not_empty);
+				csvee_cond_init(&rings[r]->not_full);
+			}
+			ok = worker->threaded = csvee_thread_create(&worker->thread, csvee_join_worker, worker);
+		}
+#endif
+
+		ok = ok && csvee_parse_path(job.build_left ? right : left, csvee_join_probe_cb, &job, &op);
+		if (ok && header && !job.header_written)
+			ok = csvee_join_header(&job);
+		ok = ok && csvee_join_settle(&job) && (!job.build_left || csvee_join_pad(&job));
+		ok = ok && (job.partitioned || csvee_join_leftovers(&job));
+
+		/* grace hash join: the matching partitions of both sides, one pair at a time */
+		CSVBuffer_t record = {NULL, 0, 0};
+		for (size_t p = 0; ok && job.partitioned && p < CSVEE_JOIN_PARTITIONS; ++p)
+		{
+			csvee_join_clear(&job.table);
+			for (int side = 0; ok && side < 2; ++side)
+			{
+				FILE *file = job.partitions[side][p];
+				if (!file)
+					continue;
+				ok = fflush(file) == 0 && fseek(file, 0, SEEK_SET) == 0;
+				bool done = false;
+				size_t key_len;
+				while (ok && !done)
+				{
+					ok = csvee_join_read(file, &record, &key_len, &done);
+					if (ok && !done)
+						ok = side == 0 ? csvee_join_add(&job.table, record.data, key_len, record.data + key_len, record.size - key_len)
+									   : csvee_join_probe_put(&job, record.data, key_len, record.data + key_len, record.size - key_len);
+				}
+			}
+			ok = ok && csvee_join_settle(&job) && csvee_join_leftovers(&job);
+		}
+		csvee_buffer_free(&record);
+
+#ifndef CSVEE_NO_THREADS
+		for (size_t w = 0; nthreads > 1 && job.workers && w < nthreads; ++w)
+		{
+			CSVJoinWorker_t *worker = &job.workers[w];
+			if (!worker->job)
+				continue;
+			CSVRing_t *rings[2] = {&worker->input, &worker->output};
+			for (int r = 0; r < 2; ++r)
+			{
+				csvee_mutex_lock(&rings[r]->lock);
+				rings[r]->done = true;
+				rings[r]->cancelled = rings[r]->cancelled || !ok;
+				csvee_cond_broadcast(&rings[r]->not_empty);
+				csvee_cond_broadcast(&rings[r]->not_full);
+				csvee_mutex_unlock(&rings[r]->lock);
+			}
+			if (worker->threaded)
+				csvee_thread_join(worker->thread);
+			for (int r = 0; r < 2; ++r)
+			{
+				csvee_mutex_destroy(&rings[r]->lock);
+				csvee_cond_destroy(&rings[r]->not_empty);
+				csvee_cond_destroy(&rings[r]->not_full);
+				for (size_t i = 0; i < CSVEE_RING_SIZE; ++i)
+					csvee_buffer_free(&rings[r]->slots[i]);
+			}
+			csvee_buffer_free(&worker->batch);
+			csvee_buffer_free(&worker->lines);
+		}
+#endif
+
+		if (opened)
+			ok = csvee_sink_close(&sink, ok);
+		csvee_stats_publish(&op);
+
+		for (int side = 0; side < 2; ++side)
+		{
+			for (size_t p = 0; p < CSVEE_JOIN_PARTITIONS; ++p)
+				if (job.partitions[side][p])
+					fclose(job.partitions[side][p]);
+			csvee_buffer_free(&job.names[side]);
+		}
+		csvee_join_free(&job.table);
+		csvee_buffer_free(&job.padding);
+		csvee_buffer_free(&job.record);
+		csvee_buffer_free(&job.key);
+		csvee_buffer_free(&job.line);
+		csvee_buffer_free(&job.batch);
+		csvee_buffer_free(&job.drained);
+		free(job.workers);
+		return ok;
+	}
+
+	/* Room for the KEEP_LAST record number of key @p id. */
+	static bool csvee_dedup_grow(CSVDedupJob_t *job, size_t id)
+	{
+		if (id < job->last_cap)
+			return true;
+		size_t capacity = job->last_cap ? job->last_cap * 2 : 64;
+		size_t *last = (size_t *)realloc(job->last, capacity * sizeof(size_t));
+		if (!last)
+			return false;
+		job->last = last;
+		job->last_cap = capacity;
+		return true;
+	}
+
+	static size_t csvee_dedup_bytes(const CSVDedupJob_t *job)
+	{
+		return csvee_hash_bytes(&job->seen) + (job->keep == CSVEE_KEEP_LAST ? job->seen.count * sizeof(size_t) : 0);
+	}
+
+	/*
+	 * Partition record: varint length and key, varint record number + 1
+	 * (0 for a key seen before partitioning), varint length and line.
+	 */
+	static bool csvee_dedup_spill(CSVDedupJob_t *job, const char *key, size_t key_len, size_t number, const char *line, size_t size)
+	{
+		CSVBuffer_t *record = &job->record;
+		record->size = 0;
+		if (!csvee_buffer_put_varint(record, key_len) || !csvee_buffer_append(record, key, key_len) ||
+			!csvee_buffer_put_varint(record, number) || !csvee_buffer_put_varint(record, size) ||
+			!csvee_buffer_append(record, line, size))
+			return false;
+		size_t p = (size_t)(csvee_hash(key, key_len) % CSVEE_DEDUP_PARTITIONS);
+		FILE **file = &job->partitions[p];
+		if (!*file && !(*file = csvee_spill_open(NULL)))
+			return false;
+		return fwrite(record->data, 1, record->size, *file) == record->size;
+	}
+
+	/* Out of memory: KEEP_FIRST carries the keys seen so far over to the partitions, KEEP_LAST partitions its second pass. */
+	static bool csvee_dedup_partition(CSVDedupJob_t *job)
+	{
+		const CSVHashTable_t *seen = &job->seen;
+		bool ok = true;
+		job->partitioned = true;
+		for (size_t id = 0; ok && job->keep == CSVEE_KEEP_FIRST && id < seen->count; ++id)
+			ok = csvee_dedup_spill(job, seen->keys.data + seen->offsets[id], seen->offsets[id + 1] - seen->offsets[id], 0, NULL, 0);
+		csvee_hash_clear(&job->seen);
+		return ok;
+	}
+
+	static bool csvee_dedup_write(CSVDedupJob_t *job, const char *line, size_t size)
+	{
+		CSVSink_t *sink = job->sink;
+		return csvee_buffer_append(&sink->block, line, size) &&
+			   (sink->block.size < sink->block_size || csvee_sink_flush(sink));
+	}
+
+	static bool csvee_dedup_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVDedupJob_t *job = (CSVDedupJob_t *)user;
+		const CSVDialect_t *dialect = job->dialect;
+		bool ok = true;
+		if (job->before_head)
+		{
+			job->before_head = false;
+			if (job->writing)
+				ok = csvee_format_row(&job->sink->block, row, dialect, dialect->lineterminator, NULL);
+			csvee_row_free(row);
+			return ok;
+		}
+		size_t number = job->seq++;
+		if (job->partitioned && !job->writing)
+		{
+			csvee_row_free(row); /* the second pass partitions every record */
+			return true;
+		}
+
+		char scratch[64];
+		CSVBuffer_t *key = &job->key;
+		key->size = 0;
+		for (size_t k = 0; ok && k < job->ncolumns; ++k)
+		{
+			size_t c = job->columns[k];
+			const char *text = c < row->count ? csvee_field_text(&row->fields[c], scratch, sizeof(scratch)) : "";
+			size_t size = strlen(text);
+			ok = csvee_buffer_put_varint(key, size) && csvee_buffer_append(key, text, size);
+		}
+		job->line.size = 0;
+		ok = ok && csvee_format_row(&job->line, row, dialect, dialect->lineterminator, NULL);
+		csvee_row_free(row);
+		if (!ok)
+			return false;
+		if (job->partitioned)
+			return csvee_dedup_spill(job, key->data, key->size, number + 1, job->line.data, job->line.size);
+
+		size_t id;
+		bool added = false;
+		uint64_t hash = csvee_hash(key->data, key->size);
+		if (job->keep == CSVEE_KEEP_FIRST)
+			ok = csvee_hash_insert(&job->seen, key->data, key->size, hash, &id, &added) &&
+				 (!added || csvee_dedup_write(job, job->line.data, job->line.size));
+		else if (!job->writing)
+		{
+			ok = csvee_hash_insert(&job->seen, key->data, key->size, hash, &id, &added) && csvee_dedup_grow(job, id);
+			if (ok)
+				job->last[id] = number;
+		}
+		else if (csvee_hash_find(&job->seen, key->data, key->size, hash, &id) && job->last[id] == number)
+			ok = csvee_dedup_write(job, job->line.data, job->line.size);
+
+		if (ok && added && csvee_dedup_bytes(job) > job->mem_limit)
+			ok = csvee_dedup_partition(job);
+		return ok;
+	}
+
+	/* Next partition record; @p key_len, @p number and @p line locate its parts in job->record. */
+	static bool csvee_dedup_read(CSVDedupJob_t *job, FILE *file, size_t *key_len, uint64_t *number, size_t *line, bool *done)
+	{
+		CSVBuffer_t *record = &job->record;
+		int c = getc(file);
+		if (c == EOF)
+			return *done = !ferror(file);
+		ungetc(c, file);
+
+		uint64_t size;
+		record->size = 0;
+		if (!csvee_sort_read_varint(file, &size) || !csvee_buffer_reserve(record, (size_t)size) ||
+			fread(record->data, 1, (size_t)size, file) != size)
+			return false;
+		record->size = *key_len = (size_t)size;
+		if (!csvee_sort_read_varint(file, number) || !csvee_sort_read_varint(file, &size) ||
+			!csvee_buffer_reserve(record, (size_t)size) || fread(record->data + record->size, 1, (size_t)size, file) != size)
+			return false;
+		*line = record->size;
+		record->size += (size_t)size;
+		return true;
+	}
+
+	/* Deduplicate one partition on its own: its keys fit in memory now. */
+	static bool csvee_dedup_partition_run(CSVDedupJob_t *job, FILE *file)
+	{
+		const CSVBuffer_t *record = &job->record;
+		bool ok = fflush(file) == 0;
+		csvee_hash_clear(&job->seen);
+		/* KEEP_LAST reads the partition twice, finding the last records first */
+		for (int pass = job->keep == CSVEE_KEEP_LAST ? 0 : 1; ok && pass < 2; ++pass)
+		{
+			ok = fseek(file, 0, SEEK_SET) == 0;
+			bool done = false;
+			while (ok)
+			{
+				size_t key_len, line, id;
+				uint64_t number;
+				bool added;
+				ok = csvee_dedup_read(job, file, &key_len, &number, &line, &done);
+				if (!ok || done)
+					break;
+				uint64_t hash = csvee_hash(record->data, key_len);
+				if (job->keep == CSVEE_KEEP_FIRST)
+					ok = csvee_hash_insert(&job->seen, record->data, key_len, hash, &id, &added) &&
+						 (!added || !number || csvee_dedup_write(job, record->data + line, record->size - line));
+				else if (pass == 0)
+				{
+					ok = csvee_hash_insert(&job->seen, record->data, key_len, hash, &id, &added) && csvee_dedup_grow(job, id);
+					if (ok)
+						job->last[id] = (size_t)number;
+				}
+				else if (csvee_hash_find(&job->seen, record->data, key_len, hash, &id) && job->last[id] == number)
+					ok = csvee_dedup_write(job, record->data + line, record->size - line);
+			}
+		}
+		return ok;
+	}
+
+	/*
+	 * Copy @p in to @p out keeping one record per distinct value of the
+	 * @p columns: the first of them, written as soon as it is read, or the
+	 * last (@p keep), which takes a second pass over the input. Keys are
+	 * kept in a hash table of 64-bit hashes that compares the key bytes on
+	 * a hash match. Once the keys take more than @p mem_limit (default
+	 * CSVEE_DEDUP_MEMORY), the rest of the records go to
+	 * CSVEE_DEDUP_PARTITIONS temporary files by key hash, each deduplicated
+	 * on its own at the end, so the output is no longer in input order.
+	 * With @p header the first record is copied as is.
+	 */
+	bool csvee_dedup_file(const char *in, const char *out, const size_t *columns, size_t ncolumns, CSVDedupKeep_t keep, bool header, size_t mem_limit)
+	{
+		if (!in || !out || !columns || !ncolumns)
+			return false;
+		if (!mem_limit)
+			mem_limit = CSVEE_DEDUP_MEMORY;
+
+		CSVDialect_t dialect;
+		csvee_dialect_init(&dialect, NULL, csvee_filename_delimiter(out), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+		CSVDedupJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.columns = columns;
+		job.ncolumns = ncolumns;
+		job.keep = keep;
+		job.dialect = &dialect;
+		job.header = header;
+		job.mem_limit = mem_limit;
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		CSVWriteOptions_t options = csvee_write_options_for(out);
+		CSVSink_t sink;
+		bool ok = csvee_sink_open(&sink, out, &options, &op);
+		bool opened = ok;
+		job.sink = &sink;
+
+		/* KEEP_LAST first finds the number of the last record of each key */
+		for (int pass = keep == CSVEE_KEEP_LAST ? 0 : 1; ok && pass < 2; ++pass)
+		{
+			job.writing = pass == 1;
+			job.before_head = header;
+			job.seq = 0;
+			ok = csvee_parse_path(in, csvee_dedup_row_cb, &job, &op);
+		}
+		for (size_t p = 0; ok && p < CSVEE_DEDUP_PARTITIONS; ++p)
+			if (job.partitions[p])
+				ok = csvee_dedup_partition_run(&job, job.partitions[p]);
+
+		if (opened)
+			ok = csvee_sink_close(&sink, ok);
+		csvee_stats_publish(&op);
+
+		for (size_t p = 0; p < CSVEE_DEDUP_PARTITIONS; ++p)
+			if (job.partitions[p])
+				fclose(job.partitions[p]);
+		csvee_hash_free(&job.seen);
+		free(job.last);
+		csvee_buffer_free(&job.key);
+		csvee_buffer_free(&job.line);
+		csvee_buffer_free(&job.record);
+		return ok;
+	}
+
+#ifndef CSVEE_NO_THREADS
+	/* Profiling thread: folds the batches published to its ring into its own profile. */
+	static void csvee_profile_worker(void *arg)
+	{
+		CSVProfileWorker_t *worker = (CSVProfileWorker_t *)arg;
+		while (csvee_ring_take(&worker->ring, &worker->batch))
+		{
+			if (!csvee_profile_consume(&worker->profile, worker->batch.data, worker->batch.size))
+			{
+				csvee_mutex_lock(&worker->ring.lock);
+				worker->ok = false;
+				worker->ring.cancelled = true;
+				csvee_cond_signal(&worker->ring.not_full);
+				csvee_mutex_unlock(&worker->ring.lock);
+				return;
+			}
+		}
+	}
+#endif // CSVEE_NO_THREADS
+
+	/* Hand the collected records to the next worker, round robin. */
+	static bool csvee_profile_dispatch(CSVProfileJob_t *job)
+	{
+		CSVProfileWorker_t *worker = &job->workers[job->next];
+		job->next = (job->next + 1) % job->nworkers;
+#ifndef CSVEE_NO_THREADS
+		if (worker->threaded)
+			return csvee_ring_publish(&worker->ring, &job->batch);
+#endif
+		worker->ok = worker->ok && csvee_profile_consume(&worker->profile, job->batch.data, job->batch.size);
+		job->batch.size = 0;
+		return worker->ok;
+	}
+
+	static bool csvee_profile_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVProfileJob_t *job = (CSVProfileJob_t *)user;
+		if (job->header && !job->have_names)
+		{
+			job->have_names = true;
+			job->names = *row;
+			return true;
+		}
+
+		char scratch[64];
+		CSVBuffer_t *batch = &job->batch;
+		bool ok = csvee_buffer_put_varint(batch, row->count);
+		for (size_t c = 0; ok && c < row->count; ++c)
+		{
+			const char *text = csvee_field_text(&row->fields[c], scratch, sizeof(scratch));
+			size_t len = strlen(text);
+			ok = csvee_buffer_put_varint(batch, len) && csvee_buffer_append(batch, text, len);
+		}
+		csvee_row_free(row);
+
+		if (ok && batch->size >= CSVEE_READ_BUFFER_SIZE)
+			ok = csvee_profile_dispatch(job);
+		return ok;
+	}
+
+	/*
+	 * Profile every column of @p path in one pass: inferred type, nulls,
+	 * min, max, mean and variance of the numbers, a HyperLogLog distinct
+	 * count, t-digest quantiles and the most frequent values from a
+	 * count-min sketch. Parsing runs on the calling thread, which hands
+	 * batches of records round robin to options->nthreads threads, each
+	 * building its own profile; the profiles are merged at the end, the
+	 * same way csvee_profile_merge() combines the profiles of several
+	 * files. @p options may be NULL for the defaults.
+	 */
+	bool csvee_profile(const char *path, const CSVProfileOptions_t *options, CSVProfile_t *profile)
+	{
+		if (!path || !profile)
+			return false;
+		CSVProfileOptions_t defaults;
+		memset(&defaults, 0, sizeof(defaults));
+		if (!options)
+			options = &defaults;
+		size_t nthreads = options->nthreads ? options->nthreads : 1;
+#ifdef CSVEE_NO_THREADS
+		nthreads = 1;
+#endif
+		csvee_profile_init(profile, options->top_k, options->compression);
+
+		CSVProfileJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.header = options->header;
+		job.nworkers = nthreads;
+		job.workers = (CSVProfileWorker_t *)calloc(nthreads, sizeof(CSVProfileWorker_t));
+		bool ok = job.workers != NULL;
+		for (size_t w = 0; ok && w < nthreads; ++w)
+		{
+			CSVProfileWorker_t *worker = &job.workers[w];
+			csvee_profile_init(&worker->profile, options->top_k, options->compression);
+			worker->ok = true;
+#ifndef CSVEE_NO_THREADS
+			if (nthreads > 1)
+			{
+				csvee_mutex_init(&worker->ring.lock);
+				csvee_cond_init(&worker->ring.not_empty);
+				csvee_cond_init(&worker->ring.not_full);
+				worker->threaded = csvee_thread_create(&worker->thread, csvee_profile_worker, worker);
+			}
+#endif
+		}
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		ok = ok && csvee_parse_path(path, csvee_profile_row_cb, &job, &op);
+		csvee_stats_publish(&op);
+
+		/* stop the workers; the last batch is folded in here */
+		for (size_t w = 0; job.workers && w < nthreads; ++w)
+		{
+			CSVProfileWorker_t *worker = &job.workers[w];
+#ifndef CSVEE_NO_THREADS
+			if (nthreads > 1)
+			{
+				if (worker->threaded)
+				{
+					csvee_mutex_lock(&worker->ring.lock);
+					worker->ring.done = true;
+					worker->ring.cancelled = worker->ring.cancelled || !ok;
+					csvee_cond_signal(&worker->ring.not_empty);
+					csvee_mutex_unlock(&worker->ring.lock);
+					csvee_thread_join(worker->thread);
+					worker->threaded = false;
+				}
+				csvee_mutex_destroy(&worker->ring.lock);
+				csvee_cond_destroy(&worker->ring.not_empty);
+				csvee_cond_destroy(&worker->ring.not_full);
+				for (size_t i = 0; i < CSVEE_RING_SIZE; ++i)
+					csvee_buffer_free(&worker->ring.slots[i]);
+			}
+#endif
+			ok = ok && worker->ok;
+		}
+		if (ok && job.batch.size)
+			ok = csvee_profile_dispatch(&job);
+
+		for (size_t w = 0; job.workers && w < nthreads; ++w)
+		{
+			ok = ok && csvee_profile_merge(profile, &job.workers[w].profile);
+			csvee_profile_free(&job.workers[w].profile);
+			csvee_buffer_free(&job.workers[w].batch);
+		}
+
+		/* the header may name columns no record reached */
+		ok = ok && (!job.have_names || csvee_profile_widen(profile, job.names.count));
+		for (size_t c = 0; ok && job.have_names && c < job.names.count; ++c)
+		{
+			const char *name = job.names.fields[c].value._string;
+			ok = !name || (profile->columns[c].name = strdup(name)) != NULL;
+		}
+
+		if (job.have_names)
+			csvee_row_free(&job.names);
+		csvee_buffer_free(&job.batch);
+		free(job.workers);
+		if (!ok)
+			csvee_profile_free(profile);
+		return ok;
+	}
+
+	/*
+	 * Add @p other to @p profile, column by column, as if the records
+	 * of both had been profiled together. Both must have been built with
+	 * the same top_k; the counts of frequent values stay estimates.
+	 */
+	bool csvee_profile_merge(CSVProfile_t *profile, const CSVProfile_t *other)
+	{
+		if (!profile || !other || !csvee_profile_widen(profile, other->count))
+			return false;
+
+		for (size_t c = 0; c < profile->count; ++c)
+		{
+			CSVColumnProfile_t *into = &profile->columns[c];
+			if (c >= other->count)
+			{
+				into->count += other->rows;
+				into->nulls += other->rows;
+				continue;
+			}
+			const CSVColumnProfile_t *from = &other->columns[c];
+			CSVSketch_t *sketch = into->sketch;
+			const CSVSketch_t *more = from->sketch;
+
+			/* Chan et al. for the mean and the squared differences */
+			uint64_t a = into->integers + into->doubles, b = from->integers + from->doubles;
+			if (b)
+			{
+				double n = (double)(a + b), delta = from->mean - into->mean;
+				into->min = a && into->min < from->min ? into->min : from->min;
+				into->max = a && into->max > from->max ? into->max : from->max;
+				into->mean += delta * (double)b / n;
+				into->m2 += from->m2 + delta * delta * (double)a * (double)b / n;
+			}
+			into->count += from->count;
+			into->nulls += from->nulls;
+			into->integers += from->integers;
+			into->doubles += from->doubles;
+			into->bools += from->bools;
+			into->strings += from->strings;
+			if (!into->name && from->name && !(into->name = strdup(from->name)))
+				return false;
+
+			for (size_t i = 0; i < sizeof(sketch->hll); ++i)
+				if (more->hll[i] > sketch->hll[i])
+					sketch->hll[i] = more->hll[i];
+			for (size_t d = 0; d < CSVEE_PROFILE_CMS_DEPTH; ++d)
+				for (size_t i = 0; i < CSVEE_PROFILE_CMS_WIDTH; ++i)
+					sketch->cms[d][i] += more->cms[d][i];
+			for (size_t i = 0; i < more->centroid_count; ++i)
+				if (!csvee_digest_add(sketch, more->centroids[i].mean, more->centroids[i].weight))
+					return false;
+			/* candidates of both sides, re-estimated and cut back to top_k by csvee_profile_finish() */
+			for (size_t i = 0; i < from->top_count; ++i)
+			{
+				const char *value = from->top[i].value;
+				size_t size = strlen(value);
+				if (csvee_profile_top_find(into, value, size) == SIZE_MAX && !csvee_profile_top_append(into, value, size, 0))
+					return false;
+			}
+		}
+		profile->rows += other->rows;
+		csvee_profile_finish(profile);
+		return true;
+	}
+
+	/* Sample variance of the numbers of @p column, 0 with fewer than two. */
+	double csvee_profile_variance(const CSVColumnProfile_t *column)
+	{
+		uint64_t n = column ? column->integers + column->doubles : 0;
+		return n > 1 ? column->m2 / (double)(n - 1) : 0.0;
+	}
+
+	/* HyperLogLog estimate of the distinct non-empty values of @p column. */
+	double csvee_profile_distinct(const CSVColumnProfile_t *column)
+	{
+		if (!column || !column->sketch)
+			return 0.0;
+		const double m = (double)(1 << CSVEE_PROFILE_HLL_BITS);
+		double sum = 0.0;
+		size_t zeros = 0;
+		for (size_t i = 0; i < sizeof(column->sketch->hll); ++i)
+		{
+			uint8_t rank = column->sketch->hll[i];
+			sum += 1.0 / (double)((uint64_t)1 << rank);
+			zeros += rank == 0;
+		}
+		double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+		/* linear counting is the better estimate while many registers are empty */
+		if (estimate <= 2.5 * m && zeros)
+			estimate = m * csvee_log(m / (double)zeros);
+		return estimate;
+	}
+
+	/* Value below which a fraction @p q of the numbers of @p column fall, from its t-digest; 0 without numbers. */
+	double csvee_profile_quantile(const CSVColumnProfile_t *column, double q)
+	{
+		if (!column || !column->sketch || !column->sketch->centroid_count)
+			return 0.0;
+		const CSVSketch_t *sketch = column->sketch;
+		const CSVCentroid_t *c = sketch->centroids;
+		size_t n = sketch->merged ? sketch->merged : sketch->centroid_count;
+		q = q < 0.0 ? 0.0 : q > 1.0 ? 1.0 : q;
+
+		double total = 0.0;
+		for (size_t i = 0; i < n; ++i)
+			total += c[i].weight;
+		double target = q * total, below = 0.0;
+		/* interpolate between centroid centers, and towards min and max at the ends */
+		for (size_t i = 0; i < n; ++i)
+		{
+			double center = below + c[i].weight / 2.0;
+			if (target < center)
+			{
+				if (i == 0)
+					return column->min + (c[0].mean - column->min) * (target / center);
+				double previous = below - c[i - 1].weight / 2.0;
+				return c[i - 1].mean + (c[i].mean - c[i - 1].mean) * (target - previous) / (center - previous);
+			}
+			below += c[i].weight;
+		}
+		double last = total - c[n - 1].weight / 2.0;
+		return c[n - 1].mean + (column->max - c[n - 1].mean) * (target - last) / (total - last);
+	}
+
+	void csvee_profile_free(CSVProfile_t *profile)
+	{
+		if (!profile)
+			return;
+		for (size_t c = 0; c < profile->count; ++c)
+		{
+			CSVColumnProfile_t *column = &profile->columns[c];
+			for (size_t i = 0; i < column->top_count; ++i)
+				free(column->top[i].value);
+			free(column->top);
+			free(column->name);
+			if (column->sketch)
+				free(column->sketch->centroids);
+			free(column->sketch);
+		}
+		free(profile->columns);
+		profile->columns = NULL;
+		profile->count = 0;
+		profile->rows = 0;
+	}
+
+	/*
+	 * Export the rows of @p csvee as Arrow arrays through the C data
+	 * interface: @p schema is a struct with one field per column and
+	 * @p array the matching struct array, the way a record batch is
+	 * passed. A column is int64 when every non-empty field is an integer,
+	 * double when they are all numbers, boolean for true/false and utf8
+	 * otherwise; empty and missing fields are nulls. With @p header the
+	 * first row names the fields instead of f0, f1, ... The consumer owns
+	 * both and calls their release callbacks; nothing is linked from Arrow.
+	 */
+	bool csvee_export_arrow(const Csvee_t *csvee, bool header, struct ArrowSchema *schema, struct ArrowArray *array)
+	{
+		if (!csvee || !schema || !array)
+			return false;
+		CSVArrowBuilder_t builder;
+		memset(&builder, 0, sizeof(builder));
+		bool ok = true, named = !header;
+		for (size_t r = 0; ok && r < csvee->count; ++r)
+		{
+			if (csvee_row_deleted(csvee, r))
+				continue;
+			const CSVRow_t *row = csvee->spill || csvee->lazy ? csvee_row_at((Csvee_t *)csvee, r) : &csvee->rows[r];
+			ok = row && (!named ? csvee_arrow_names(&builder, row) : csvee_arrow_add(&builder, row));
+			named = true;
+		}
+		ok = ok && csvee_arrow_finish(&builder, schema, array);
+		csvee_arrow_builder_free(&builder);
+		return ok;
+	}
+
+	static bool csvee_arrow_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVArrowBuilder_t *builder = (CSVArrowBuilder_t *)user;
+		bool ok;
+		if (builder->header && !builder->names)
+			ok = csvee_arrow_names(builder, row);
+		else
+			ok = csvee_arrow_add(builder, row);
+		csvee_row_free(row);
+		return ok;
+	}
+
+	/* Like csvee_export_arrow() straight from @p filename, without building a table on the way. */
+	bool csvee_read_arrow(const char *filename, bool header, struct ArrowSchema *schema, struct ArrowArray *array)
+	{
+		if (!filename || !schema || !array)
+			return false;
+		CSVArrowBuilder_t builder;
+		memset(&builder, 0, sizeof(builder));
+		builder.header = header;
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		bool ok = csvee_parse_path(filename, csvee_arrow_row_cb, &builder, &op);
+		csvee_stats_publish(&op);
+		ok = ok && csvee_arrow_finish(&builder, schema, array);
+		csvee_arrow_builder_free(&builder);
+		return ok;
+	}
+
+	static bool csvee_columnar_row_cb(void *user, CSVRow_t *row)
+	{
+		bool ok = csvee_columnar_add((CSVColumnarWriter_t *)user, row);
+		csvee_row_free(row);
+		return ok;
+	}
+
+	/*
+	 * Convert the CSV file @p in into a columnar file at @p out: records
+	 * are cut into row groups of @p group_rows (default
+	 * CSVEE_COLUMNAR_GROUP_ROWS, at most CSVEE_COLUMNAR_MAX_GROUP_ROWS)
+	 * and each group stores one chunk per
+	 * column, so a reader only touches the columns it asks for. A column
+	 * is a number when every non-empty field is a decimal with the same
+	 * number of places (stored unscaled as bit-packed, delta or run-length
+	 * integers, whichever is smallest), text otherwise (plain or
+	 * dictionary encoded). The footer keeps the min, max and empty count
+	 * of every chunk, which csvee_columnar_read() uses to skip groups.
+	 * The input is read twice, once to type the columns and once to write
+	 * them. With @p header the first record names the columns.
+	 */
+	bool csvee_columnar_from_csv(const char *in, const char *out, bool header, size_t group_rows)
+	{
+		if (!in || !out)
+			return false;
+		CSVColumnarWriter_t writer;
+		memset(&writer, 0, sizeof(writer));
+		writer.header = header;
+		writer.before_head = header;
+		writer.group_rows = group_rows ? group_rows : CSVEE_COLUMNAR_GROUP_ROWS;
+		writer.group_rows = writer.group_rows < CSVEE_COLUMNAR_MAX_GROUP_ROWS ? writer.group_rows : CSVEE_COLUMNAR_MAX_GROUP_ROWS;
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		bool ok = csvee_parse_path(in, csvee_columnar_row_cb, &writer, &op);
+		for (size_t c = 0; ok && c < writer.ncolumns; ++c)
+			writer.scales[c] = writer.scales[c] == -2 ? -1 : writer.scales[c];
+
+		writer.chunks = ok ? (CSVColumnChunk_t *)calloc(writer.ncolumns + 1, sizeof(CSVColumnChunk_t)) : NULL;
+		ok = writer.chunks != NULL;
+		writer.out = ok ? fopen(out, "wb") : NULL;
+		if (ok && !writer.out)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(NULL_FILE, "Could not open file %s for writing\n", out);
+#endif // CSVEE_DEBUG
+		}
+		ok = writer.out && fwrite("CSVC\x01", 1, 5, writer.out) == 5;
+		writer.offset = 5;
+		writer.writing = true;
+		writer.before_head = header;
+		ok = ok && csvee_parse_path(in, csvee_columnar_row_cb, &writer, &op) && csvee_columnar_finish(&writer);
+		csvee_stats_publish(&op);
+
+		if (writer.out && fclose(writer.out) != 0)
+			ok = false;
+		if (!ok && writer.out)
+			remove(out);
+		writer.out = NULL;
+		csvee_columnar_writer_free(&writer);
+		return ok;
+	}
+
+	/* Read @p text at @p scale places exactly, false if it is no decimal number. */
+	static bool csvee_columnar_test_init(CSVColumnarTest_t *test, const char *text, int scale)
+	{
+		size_t i = 0, size = strlen(text), digits = 0;
+		bool negative = size && (text[0] == '-' || text[0] == '+') ? text[i++] == '-' : false;
+		uint64_t magnitude = 0;
+		bool overflow = false, point = false;
+		int places = 0;
+		test->fraction = false;
+		for (; i < size; ++i)
+		{
+			if (text[i] == '.' && !point)
+			{
+				point = true;
+				continue;
+			}
+			if (text[i] < '0' || text[i] > '9')
+				return false;
+			++digits;
+			if (point && places == scale)
+			{
+				test->fraction = test->fraction || text[i] != '0';
+				continue;
+			}
+			places += point;
+			overflow = overflow || magnitude > (UINT64_MAX - 9) / 10;
+			magnitude = overflow ? magnitude : magnitude * 10 + (uint64_t)(text[i] - '0');
+		}
+		if (!digits)
+			return false;
+		for (; places < scale; ++places)
+		{
+			overflow = overflow || magnitude > UINT64_MAX / 10;
+			magnitude *= 10;
+		}
+
+		test->bound = 0;
+		if (overflow || magnitude > (uint64_t)INT64_MAX)
+			test->bound = negative ? -1 : 1;
+		else if (negative && test->fraction)
+			test->unscaled = -(int64_t)magnitude - 1;
+		else
+			test->unscaled = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+		return true;
+	}
+
+	/* Order of a value against the predicate: <0, 0 or >0. */
+	static int csvee_columnar_test_compare(const CSVColumnarTest_t *test, int64_t number, const char *text, size_t size)
+	{
+		if (!test->number)
+			return csvee_text_compare(text, size, test->predicate->value, test->size);
+		if (test->bound)
+			return -test->bound;
+		if (number < test->unscaled || (number == test->unscaled && test->fraction))
+			return -1;
+		return number > test->unscaled;
+	}
+
+	static bool csvee_columnar_test_holds(CSVCompare_t op, int cmp)
+	{
+		switch (op)
+		{
+		case CSVEE_CMP_EQ:
+			return cmp == 0;
+		case CSVEE_CMP_NE:
+			return cmp != 0;
+		case CSVEE_CMP_LT:
+			return cmp < 0;
+		case CSVEE_CMP_LE:
+			return cmp <= 0;
+		case CSVEE_CMP_GT:
+			return cmp > 0;
+		case CSVEE_CMP_GE:
+			return cmp >= 0;
+		}
+		return false;
+	}
+
+	/* Whether the zone map of a chunk leaves room for a value meeting @p test. */
+	static bool csvee_columnar_test_range(const CSVColumnarTest_t *test, const CSVChunkMeta_t *meta)
+	{
+		if (!meta->has_range)
+			return false;
+		int low = csvee_columnar_test_compare(test, meta->min, meta->min_text, meta->min_len);
+		int high = csvee_columnar_test_compare(test, meta->max, meta->max_text, meta->max_len);
+		switch (test->predicate->op)
+		{
+		case CSVEE_CMP_EQ:
+			return low <= 0 && high >= 0;
+		case CSVEE_CMP_NE:
+			return low != 0 || high != 0;
+		case CSVEE_CMP_LT:
+		case CSVEE_CMP_LE:
+			return csvee_columnar_test_holds(test->predicate->op, low);
+		case CSVEE_CMP_GT:
+		case CSVEE_CMP_GE:
+			return csvee_columnar_test_holds(test->predicate->op, high);
+		}
+		return true;
+	}
+
+	/*
+	 * Read the records of the columnar file at @p path that meet every
+	 * predicate of @p query (NULL for all of them), with only the columns
+	 * it lists. Row groups whose zone maps rule a predicate out are
+	 * skipped without being read, and only the chunks of the projected
+	 * and tested columns are decoded. Without a projection the records
+	 * come back as they were in the CSV file, empty and missing fields
+	 * included. A file with a header gets its names as the first row.
+	 */
+	Csvee_t *csvee_columnar_read(const char *path, const CSVColumnarQuery_t *query)
+	{
+		if (!path)
+			return NULL;
+		CSVColumnarQuery_t all;
+		memset(&all, 0, sizeof(all));
+		query = query ? query : &all;
+
+		CSVColumnarFile_t file;
+		if (!csvee_columnar_open(&file, path))
+		{
+			csvee_columnar_close(&file);
+			return NULL;
+		}
+		size_t ncolumns = file.ncolumns;
+		bool projected = query->columns != NULL;
+		bool ok = true;
+		for (size_t i = 0; ok && projected && i < query->ncolumns; ++i)
+			ok = query->columns[i] < ncolumns;
+		for (size_t i = 0; ok && i < query->npredicates; ++i)
+			ok = query->predicates[i].column < ncolumns && query->predicates[i].value;
+		if (!ok)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FIELD, "Column out of range in a query of %s\n", path);
+#endif // CSVEE_DEBUG
+			csvee_columnar_close(&file);
+			return NULL;
+		}
+
+		CSVColumnarTest_t *tests = (CSVColumnarTest_t *)calloc(query->npredicates + 1, sizeof(CSVColumnarTest_t));
+		CSVChunkView_t *views = (CSVChunkView_t *)calloc(ncolumns + 1, sizeof(CSVChunkView_t));
+		size_t *cursor = (size_t *)calloc(ncolumns + 1, sizeof(size_t));
+		bool *needed = (bool *)calloc(ncolumns + 1, sizeof(bool));
+		Csvee_t *csvee = csvee_new(CSVEE_SEPERATOR);
+		ok = tests && views && cursor && needed && csvee;
+		for (size_t i = 0; ok && i < query->npredicates; ++i)
+		{
+			const CSVPredicate_t *predicate = &query->predicates[i];
+			tests[i].predicate = predicate;
+			tests[i].number = file.scales[predicate->column] >= 0;
+			tests[i].size = strlen(predicate->value);
+			needed[predicate->column] = true;
+			if (tests[i].number && !csvee_columnar_test_init(&tests[i], predicate->value, file.scales[predicate->column]))
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(WRONG_CAST, "%s is not a number, column %zu is\n", predicate->value, predicate->column);
+#endif // CSVEE_DEBUG
+				ok = false;
+			}
+		}
+		for (size_t c = 0; ok && c <= ncolumns; ++c)
+			needed[c] = needed[c] || !projected;
+		for (size_t i = 0; ok && projected && i < query->ncolumns; ++i)
+			needed[query->columns[i]] = true;
+
+		size_t width = projected ? query->ncolumns : 0;
+		if (ok && file.header)
+		{
+			CSVRow_t row;
+			memset(&row, 0, sizeof(row));
+			for (size_t i = 0; ok && i < (projected ? width : file.names_count); ++i)
+			{
+				size_t c = projected ? query->columns[i] : i;
+				ok = csvee_row_push_field(&row, csvee_create_field(c < file.names_count ? file.names_at[c] : ""));
+			}
+			ok = ok && csvee_push_row(csvee, &row);
+			csvee_row_free(&row);
+		}
+
+		char number[32];
+		for (size_t g = 0; ok && g < file.ngroups; ++g)
+		{
+			bool skip = false;
+			for (size_t i = 0; !skip && i < query->npredicates; ++i)
+				skip = !csvee_columnar_test_range(&tests[i], &file.chunks[g * (ncolumns + 1) + tests[i].predicate->column]);
+			if (skip || !file.group_rows[g])
+				continue;
+			for (size_t c = 0; ok && c <= ncolumns; ++c)
+				ok = !needed[c] || csvee_columnar_decode(&file, g, c, &views[c]);
+
+			for (uint64_t r = 0; ok && r < file.group_rows[g]; ++r)
+			{
+				for (size_t c = 0; c <= ncolumns; ++c)
+				{
+					const CSVChunkView_t *view = &views[c];
+					bool present = needed[c] && (!view->present || (view->present[r >> 3] >> (r & 7)) & 1);
+					cursor[c] = present ? views[c].next++ : SIZE_MAX;
+				}
+
+				bool match = true;
+				for (size_t i = 0; match && i < query->npredicates; ++i)
+				{
+					size_t c = tests[i].predicate->column, at = cursor[c];
+					if (at == SIZE_MAX)
+						match = false;
+					else if (tests[i].number)
+						match = csvee_columnar_test_holds(tests[i].predicate->op,
+														  csvee_columnar_test_compare(&tests[i], ((const int64_t *)views[c].numbers.data)[at], NULL, 0));
+					else
+					{
+						const CSVSlice_t *slice = &((const CSVSlice_t *)views[c].slices.data)[at];
+						match = csvee_columnar_test_holds(tests[i].predicate->op,
+														  csvee_columnar_test_compare(&tests[i], 0, slice->data, slice->size));
+					}
+				}
+				if (!match)
+					continue;
+
+				CSVRow_t row;
+				memset(&row, 0, sizeof(row));
+				size_t count = projected ? width : (size_t)((const int64_t *)views[ncolumns].numbers.data)[cursor[ncolumns]];
+				for (size_t i = 0; ok && i < count; ++i)
+				{
+					size_t c = projected ? query->columns[i] : i, at = c < ncolumns ? cursor[c] : SIZE_MAX;
+					if (at == SIZE_MAX)
+						ok = csvee_row_push_field(&row, csvee_create_field_n("", 0));
+					else if (file.scales[c] >= 0)
+					{
+						size_t size = csvee_decimal_format(number, ((const int64_t *)views[c].numbers.data)[at], file.scales[c]);
+						ok = csvee_row_push_field(&row, csvee_create_field_n(number, size));
+					}
+					else
+					{
+						const CSVSlice_t *slice = &((const CSVSlice_t *)views[c].slices.data)[at];
+						ok = csvee_row_push_field(&row, csvee_create_field_n(slice->data, slice->size));
+					}
+				}
+				ok = ok && csvee_push_row(csvee, &row);
+				csvee_row_free(&row);
+			}
+		}
+
+		for (size_t c = 0; views && c <= ncolumns; ++c)
+		{
+			csvee_buffer_free(&views[c].raw);
+			csvee_buffer_free(&views[c].numbers);
+			csvee_buffer_free(&views[c].slices);
+		}
+		free(views);
+		free(cursor);
+		free(needed);
+		free(tests);
+		csvee_columnar_close(&file);
+		if (!ok && csvee)
+		{
+			csvee_free(csvee);
+			csvee = NULL;
+		}
+		return csvee;
+	}
+
+	static bool csvee_typed_int64(const char *text, size_t size, int64_t *value)
+	{
+		size_t i = size && (text[0] == '-' || text[0] == '+');
+		bool negative = i && text[0] == '-';
+		uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX, magnitude = 0;
+		if (i == size)
+			return false;
+		for (; i < size; ++i)
+		{
+			unsigned digit = (unsigned)(text[i] - '0');
+			if (digit > 9 || magnitude > (limit - digit) / 10)
+				return false;
+			magnitude = magnitude * 10 + digit;
+		}
+		*value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+		return true;
+	}
+
+	static bool csvee_typed_bool(const char *text, size_t size, bool *value)
+	{
+		if ((size == 4 && strncasecmp(text, "true", 4) == 0) || (size == 1 && text[0] == '1'))
+			*value = true;
+		else if ((size == 5 && strncasecmp(text, "false", 5) == 0) || (size == 1 && text[0] == '0'))
+			*value = false;
+		else
+			return false;
+		return true;
+	}
+
+	/* YYYY-MM-DD as days since 1970-01-01, proleptic Gregorian. */
+	static bool csvee_typed_date(const char *text, size_t size, int32_t *value)
+	{
+		if (size != 10 || text[4] != '-' || text[7] != '-')
+			return false;
+		int parts[3] = {0, 0, 0};
+		static const int starts[3] = {0, 5, 8}, lengths[3] = {4, 2, 2};
+		for (int p = 0; p < 3; ++p)
+			for (int i = starts[p]; i < starts[p] + lengths[p]; ++i)
+			{
+				if (text[i] < '0' || text[i] > '9')
+					return false;
+				parts[p] = parts[p] * 10 + (text[i] - '0');
+			}
+		int year = parts[0], month = parts[1], day = parts[2];
+		static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+		bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+		if (month < 1 || month > 12 || day < 1 || day > month_days[month - 1] + (month == 2 && leap))
+			return false;
+
+		/* days from civil, counting years from March so the leap day comes last */
+		year -= month <= 2;
+		int era = (year >= 0 ? year : year - 399) / 400;
+		int year_of_era = year - era * 400;
+		int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+		int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+		*value = era * 146097 + day_of_era - 719468;
+		return true;
+	}
+
+	static bool csvee_typed_null(const CSVSchema_t *schema, const char *text, size_t size)
+	{
+		if (!schema->null_tokens)
+			return size == 0;
+		for (size_t i = 0; i < schema->null_count; ++i)
+			if (strlen(schema->null_tokens[i]) == size && memcmp(schema->null_tokens[i], text, size) == 0)
+				return true;
+		return false;
+	}
+
+	static size_t csvee_typed_width(CSVColumnType_t type)
+	{
+		switch (type)
+		{
+		case CSVEE_TYPE_INT64:
+			return sizeof(int64_t);
+		case CSVEE_TYPE_DOUBLE:
+			return sizeof(double);
+		case CSVEE_TYPE_BOOL:
+			return sizeof(bool);
+		case CSVEE_TYPE_DATE:
+			return sizeof(int32_t);
+		default:
+			return 0;
+		}
+	}
+
+	/* Make room for @p capacity rows in every column. */
+	static bool csvee_typed_reserve(CSVTypedTable_t *table, size_t capacity)
+	{
+		for (size_t c = 0; c < table->count; ++c)
+		{
+			CSVTypedColumn_t *column = &table->columns[c];
+			if (column->type == CSVEE_TYPE_SKIP)
+				continue;
+			uint8_t *valid = (uint8_t *)realloc(column->valid, (capacity + 7) / 8);
+			if (!valid)
+				return false;
+			memset(valid + (table->capacity + 7) / 8, 0, (capacity + 7) / 8 - (table->capacity + 7) / 8);
+			column->valid = valid;
+			if (column->type == CSVEE_TYPE_STRING)
+			{
+				size_t *offsets = (size_t *)realloc(column->offsets, (capacity + 1) * sizeof(size_t));
+				if (!offsets)
+					return false;
+				offsets[0] = 0;
+				column->offsets = offsets;
+				continue;
+			}
+			void *values = realloc(column->values, capacity * csvee_typed_width(column->type));
+			if (!values)
+				return false;
+			column->values = values;
+		}
+		table->capacity = capacity;
+		return true;
+	}
+
+	/* Find the columns of @p schema declared by name in a header record; the first one missing is left in @p missing. */
+	static bool csvee_typed_match(const CSVSchema_t *schema, size_t *sources, const char *text, const size_t *ends, size_t count, size_t *missing)
+	{
+		for (size_t c = 0; c < schema->count; ++c)
+		{
+			const CSVSchemaColumn_t *declared = &schema->columns[c];
+			for (size_t f = 0; declared->name && f < count && sources[c] == SIZE_MAX; ++f)
+			{
+				size_t start = f ? ends[f - 1] : 0;
+				if (strlen(declared->name) == ends[f] - start && memcmp(declared->name, text + start, ends[f] - start) == 0)
+					sources[c] = f;
+			}
+			if (sources[c] == SIZE_MAX)
+			{
+				*missing = c;
+#ifdef CSVEE_DEBUG
+				csvee_error(INVALID_FIELD, "No column named %s in the header\n", declared->name);
+#endif // CSVEE_DEBUG
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/* Find the columns declared by name in the header record. */
+	static bool csvee_typed_header(CSVTypedJob_t *job, const char *text, const size_t *ends, size_t count)
+	{
+		CSVTypedTable_t *table = job->table;
+		if (!csvee_typed_match(job->schema, job->sources, text, ends, count, &table->error_column))
+		{
+			table->error_row = job->record;
+			return false;
+		}
+		for (size_t c = 0; c < table->count; ++c)
+		{
+			size_t f = job->sources[c];
+			if (!job->schema->columns[c].name && f < count)
+			{
+				size_t start = f ? ends[f - 1] : 0;
+				CSVField_t name = csvee_create_field_n(text + start, ends[f] - start);
+				if (!name.value._string)
+					return false;
+				table->columns[c].name = name.value._string;
+			}
+		}
+		return true;
+	}
+
+	/* Convert @p text into the int64_t, double, bool or int32_t (date) at @p value. */
+	static bool csvee_typed_convert(CSVColumnType_t type, const char *text, size_t size, void *value)
+	{
+		switch (type)
+		{
+		case CSVEE_TYPE_INT64:
+			return csvee_typed_int64(text, size, (int64_t *)value);
+		case CSVEE_TYPE_DOUBLE:
+			return csvee_decimal_number(text, size, (double *)value);
+		case CSVEE_TYPE_BOOL:
+			return csvee_typed_bool(text, size, (bool *)value);
+		case CSVEE_TYPE_DATE:
+			return csvee_typed_date(text, size, (int32_t *)value);
+		default:
+			return false;
+		}
+	}
+
+	/* CSVRecordCallback_t of csvee_read_typed(): convert each declared field in place. */
+	static bool csvee_typed_record(void *user, const char *text, const size_t *ends, size_t count)
+	{
+		CSVTypedJob_t *job = (CSVTypedJob_t *)user;
+		CSVTypedTable_t *table = job->table;
+		const CSVSchema_t *schema = job->schema;
+		if (++job->record == 1 && schema->header)
+			return csvee_typed_header(job, text, ends, count);
+		if (table->rows == table->capacity && !csvee_typed_reserve(table, table->capacity * 2))
+			return false;
+
+		size_t r = table->rows;
+		for (size_t c = 0; c < table->count; ++c)
+		{
+			CSVTypedColumn_t *column = &table->columns[c];
+			if (column->type == CSVEE_TYPE_SKIP)
+				continue;
+			size_t f = job->sources[c];
+			size_t start = f < count && f ? ends[f - 1] : 0;
+			const char *field = text + start;
+			size_t size = f < count ? ends[f] - start : 0;
+			if (f >= count || csvee_typed_null(schema, field, size))
+			{
+				column->nulls++;
+				if (column->type == CSVEE_TYPE_STRING)
+					column->offsets[r + 1] = column->offsets[r];
+				else
+					memset((char *)column->values + r * csvee_typed_width(column->type), 0, csvee_typed_width(column->type));
+				continue;
+			}
+
+			bool ok = true;
+			if (column->type == CSVEE_TYPE_STRING)
+			{
+				if (!csvee_buffer_append(&job->text[c], field, size))
+					return false;
+				column->offsets[r + 1] = job->text[c].size;
+			}
+			else
+				ok = csvee_typed_convert(column->type, field, size, (char *)column->values + r * csvee_typed_width(column->type));
+			if (!ok)
+			{
+				static const char *const names[] = {"int64", "double", "bool", "string", "date"};
+				table->error_row = job->record;
+				table->error_column = c;
+#ifdef CSVEE_DEBUG
+				csvee_error(WRONG_CAST, "Record %zu, column %zu: \"%.*s\" is not a %s\n", job->record, c, (int)size, field, names[column->type]);
+#else
+				(void)names;
+#endif // CSVEE_DEBUG
+				return false;
+			}
+			column->valid[r >> 3] |= (uint8_t)(1u << (r & 7));
+		}
+		table->rows++;
+		return true;
+	}
+
+	/*
+	 * Load the columns declared by @p schema from @p filename, converting
+	 * each field straight from the tokenizer's buffer into the typed
+	 * arrays of @p table: no CSVField_t is built and no column type is
+	 * inferred. Fields that are missing or equal to a null token are
+	 * nulls. The first field that does not convert stops the load and is
+	 * left in table->error_row and table->error_column. @p table must be
+	 * released with csvee_typed_free() either way.
+	 */
+	bool csvee_read_typed(const char *filename, const CSVSchema_t *schema, CSVTypedTable_t *table)
+	{
+		if (!table)
+			return false;
+		memset(table, 0, sizeof(*table));
+		if (!filename || !schema || (schema->count && !schema->columns))
+			return false;
+
+		table->columns = (CSVTypedColumn_t *)calloc(schema->count + 1, sizeof(CSVTypedColumn_t));
+		if (!table->columns)
+			return false;
+		table->count = schema->count;
+
+		CSVTypedJob_t job;
+		memset(&job, 0, sizeof(job));
+		job.schema = schema;
+		job.table = table;
+		job.sources = (size_t *)malloc((schema->count + 1) * sizeof(size_t));
+		job.text = (CSVBuffer_t *)calloc(schema->count + 1, sizeof(CSVBuffer_t));
+		bool ok = job.sources && job.text;
+		for (size_t c = 0; ok && c < schema->count; ++c)
+		{
+			const CSVSchemaColumn_t *declared = &schema->columns[c];
+			table->columns[c].type = declared->type;
+			job.sources[c] = declared->name ? SIZE_MAX : declared->index;
+			if (declared->name)
+			{
+				CSVField_t name = csvee_create_field(declared->name);
+				table->columns[c].name = name.value._string;
+				ok = name.value._string != NULL;
+			}
+			if (declared->name && !schema->header)
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(INVALID_FIELD, "Column %s is declared by name but the file has no header\n", declared->name);
+#endif // CSVEE_DEBUG
+				ok = false;
+			}
+		}
+
+		size_t capacity = schema->rows_hint;
+		csvee_stat_t st;
+		if (!capacity && CSVEE_STAT(filename, &st) == 0)
+			capacity = (size_t)st.st_size / 32 < ((size_t)1 << 20) ? (size_t)st.st_size / 32 : (size_t)1 << 20;
+		capacity = capacity < 1024 ? 1024 : capacity;
+		ok = ok && csvee_typed_reserve(table, capacity);
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		ok = ok && csvee_parse_file(filename, NULL, csvee_typed_record, &job, &op);
+		csvee_stats_publish(&op);
+
+		for (size_t c = 0; job.text && c < schema->count; ++c)
+			table->columns[c].text = job.text[c].data;
+		free(job.text);
+		free(job.sources);
+		return ok;
+	}
+
+	void csvee_typed_free(CSVTypedTable_t *table)
+	{
+		if (!table)
+			return;
+		for (size_t c = 0; table->columns && c < table->count; ++c)
+		{
+			CSVTypedColumn_t *column = &table->columns[c];
+			free(column->name);
+			free(column->values);
+			free(column->text);
+			free(column->offsets);
+			free(column->valid);
+		}
+		free(table->columns);
+		memset(table, 0, sizeof(*table));
+	}
+
+	void csvee_batch_free(CSVBatch_t *batch)
+	{
+		if (!batch)
+			return;
+		for (size_t c = 0; batch->columns && c < batch->count; ++c)
+		{
+			CSVBatchColumn_t *column = &batch->columns[c];
+			free(column->values);
+			free((void *)column->strings);
+			free(column->lengths);
+			free(column->valid);
+			free(column->text);
+		}
+		free(batch->columns);
+		memset(batch, 0, sizeof(*batch));
+	}
+
+	/* Lay @p batch out for the columns of @p stream with room for @p capacity rows, keeping what it already holds. */
+	static bool csvee_batch_reserve(CSVStream_t *stream, CSVBatch_t *batch, size_t capacity)
+	{
+		const CSVSchema_t *schema = stream->schema;
+		bool same = batch->columns && batch->count == schema->count;
+		for (size_t c = 0; same && c < schema->count; ++c)
+			same = batch->columns[c].type == schema->columns[c].type;
+		if (!same)
+		{
+			csvee_batch_free(batch);
+			batch->columns = (CSVBatchColumn_t *)calloc(schema->count + 1, sizeof(CSVBatchColumn_t));
+			if (!batch->columns)
+				return false;
+			batch->count = schema->count;
+			for (size_t c = 0; c < schema->count; ++c)
+				batch->columns[c].type = schema->columns[c].type;
+		}
+		for (size_t c = 0; c < schema->count; ++c)
+			batch->columns[c].name = schema->columns[c].name ? schema->columns[c].name : stream->names[c];
+		if (capacity <= batch->capacity)
+			return true;
+
+		for (size_t c = 0; c < batch->count; ++c)
+		{
+			CSVBatchColumn_t *column = &batch->columns[c];
+			if (column->type == CSVEE_TYPE_SKIP)
+				continue;
+			uint8_t *valid = (uint8_t *)realloc(column->valid, (capacity + 7) / 8);
+			if (!valid)
+				return false;
+			column->valid = valid;
+			if (column->type == CSVEE_TYPE_STRING)
+			{
+				const char **strings = (const char **)realloc((void *)column->strings, capacity * sizeof(const char *));
+				if (strings)
+					column->strings = strings;
+				size_t *lengths = (size_t *)realloc(column->lengths, capacity * sizeof(size_t));
+				if (lengths)
+					column->lengths = lengths;
+				if (!strings || !lengths)
+					return false;
+				continue;
+			}
+			void *values = realloc(column->values, capacity * csvee_typed_width(column->type));
+			if (!values)
+				return false;
+			column->values = values;
+		}
+		batch->capacity = capacity;
+		return true;
+	}
+
+	/* Convert one record into the next row of the batch being filled. */
+	static bool csvee_batch_row(CSVStream_t *stream, const char *text, const size_t *ends, size_t count)
+	{
+		CSVBatch_t *batch = stream->batch;
+		const CSVSchema_t *schema = stream->schema;
+		size_t r = batch->rows;
+		for (size_t c = 0; c < batch->count; ++c)
+		{
+			CSVBatchColumn_t *column = &batch->columns[c];
+			if (column->type == CSVEE_TYPE_SKIP)
+				continue;
+			size_t f = stream->sources[c];
+			size_t start = f < count && f ? ends[f - 1] : 0;
+			const char *field = text + start;
+			size_t size = f < count ? ends[f] - start : 0;
+			bool null = f >= count || csvee_typed_null(schema, field, size);
+			if (column->type == CSVEE_TYPE_STRING)
+			{
+				/* pointers are set once the batch is full, the text may still move */
+				size = null ? 0 : size;
+				if (column->text_size + size > column->text_capacity)
+				{
+					size_t capacity = column->text_capacity ? column->text_capacity : CSVEE_READ_BUFFER_SIZE;
+					while (capacity < column->text_size + size)
+						capacity *= 2;
+					char *grown = (char *)realloc(column->text, capacity);
+					if (!grown)
+						return false;
+					column->text = grown;
+					column->text_capacity = capacity;
+				}
+				if (size)
+					memcpy(column->text + column->text_size, field, size);
+				column->text_size += size;
+				column->lengths[r] = size;
+			}
+			else if (null)
+				memset((char *)column->values + r * csvee_typed_width(column->type), 0, csvee_typed_width(column->type));
+			else if (!csvee_typed_convert(column->type, field, size, (char *)column->values + r * csvee_typed_width(column->type)))
+			{
+				batch->error_row = stream->record;
+				batch->error_column = c;
+#ifdef CSVEE_DEBUG
+				csvee_error(WRONG_CAST, "Record %zu, column %zu: \"%.*s\" does not convert\n", stream->record, c, (int)size, field);
+#endif // CSVEE_DEBUG
+				return false;
+			}
+			if (null)
+				column->nulls++;
+			else
+				column->valid[r >> 3] |= (uint8_t)(1u << (r & 7));
+		}
+		batch->rows++;
+		return true;
+	}
+
+	/* CSVRecordCallback_t of a stream: fill the batch, then keep what does not fit for the next one. */
+	static bool csvee_stream_record(void *user, const char *text, const size_t *ends, size_t count)
+	{
+		CSVStream_t *stream = (CSVStream_t *)user;
+		const CSVSchema_t *schema = stream->schema;
+		if (stream->record == 0 && schema->header)
+		{
+			stream->record++;
+			stream->batch->first_record = 2;
+			if (!csvee_typed_match(schema, stream->sources, text, ends, count, &stream->batch->error_column))
+			{
+				stream->batch->error_row = 1;
+				return false;
+			}
+			for (size_t c = 0; c < schema->count; ++c)
+			{
+				size_t f = stream->sources[c];
+				if (!schema->columns[c].name && f < count && !stream->names[c])
+				{
+					size_t start = f ? ends[f - 1] : 0;
+					stream->names[c] = csvee_create_field_n(text + start, ends[f] - start).value._string;
+					if (!stream->names[c])
+						return false;
+					stream->batch->columns[c].name = stream->names[c];
+				}
+			}
+			return true;
+		}
+
+		if (stream->batch->rows < stream->max_rows)
+		{
+			stream->record++;
+			return csvee_batch_row(stream, text, ends, count);
+		}
+		size_t head[2] = {stream->carry_text.size, count};
+		return csvee_buffer_append(&stream->carry_ends, (const char *)head, sizeof(head)) &&
+			   csvee_buffer_append(&stream->carry_ends, (const char *)ends, count * sizeof(size_t)) &&
+			   csvee_buffer_append(&stream->carry_text, text, count ? ends[count - 1] : 0);
+	}
+
+	/*
+	 * Open @p filename (compressed or not) for csvee_next_batch(), which
+	 * loads the columns declared by @p schema as csvee_read_typed() does but
+	 * a batch of rows at a time. @p schema must outlive the stream.
+	 */
+	CSVStream_t *csvee_stream_open(const char *filename, const CSVSchema_t *schema)
+	{
+		if (!filename || !schema || (schema->count && !schema->columns))
+			return NULL;
+		for (size_t c = 0; c < schema->count; ++c)
+			if (schema->columns[c].name && !schema->header)
+			{
+#ifdef CSVEE_DEBUG
+				csvee_error(INVALID_FIELD, "Column %s is declared by name but the file has no header\n", schema->columns[c].name);
+#endif // CSVEE_DEBUG
+				return NULL;
+			}
+
+		CSVStream_t *stream = (CSVStream_t *)calloc(1, sizeof(CSVStream_t));
+		if (!stream)
+			return NULL;
+		stream->schema = schema;
+		stream->sources = (size_t *)malloc((schema->count + 1) * sizeof(size_t));
+		stream->names = (char **)calloc(schema->count + 1, sizeof(char *));
+		stream->chunk = (char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		stream->file = csvee_open_input(filename, &stream->codec);
+		bool ok = stream->sources && stream->names && stream->chunk && stream->file;
+		if (ok && stream->codec != CSVEE_CODEC_NONE)
+			ok = csvee_inflate_init(&stream->decoder, stream->file, stream->codec);
+		if (!ok)
+		{
+			stream->codec = CSVEE_CODEC_NONE;
+			csvee_stream_close(stream);
+			return NULL;
+		}
+		for (size_t c = 0; c < schema->count; ++c)
+			stream->sources[c] = schema->columns[c].name ? SIZE_MAX : schema->columns[c].index;
+
+		csvee_dialect_init(&stream->dialect, NULL, csvee_filename_delimiter(filename), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+		csvee_parser_init(&stream->parser, &stream->dialect, NULL, stream);
+		stream->parser.on_record = csvee_stream_record;
+		return stream;
+	}
+
+	/*
+	 * Fill @p batch with up to @p max_rows records of @p stream, reusing
+	 * its arrays, which only grow. Nulls are zero (empty for strings) with
+	 * their valid bit clear. Returns false on a read error or a field that
+	 * does not convert (left in error_row and error_column); at the end of
+	 * the file it returns true with no rows. @p batch starts zeroed and is
+	 * released with csvee_batch_free().
+	 */
+	bool csvee_next_batch(CSVStream_t *stream, CSVBatch_t *batch, size_t max_rows)
+	{
+		if (!stream || !batch || !max_rows || stream->failed)
+			return false;
+		if (!csvee_batch_reserve(stream, batch, max_rows))
+		{
+			stream->failed = true;
+			return false;
+		}
+
+		batch->rows = 0;
+		batch->first_record = stream->record + 1;
+		batch->error_row = batch->error_column = 0;
+		for (size_t c = 0; c < batch->count; ++c)
+		{
+			CSVBatchColumn_t *column = &batch->columns[c];
+			column->nulls = column->text_size = 0;
+			if (column->valid)
+				memset(column->valid, 0, (max_rows + 7) / 8);
+		}
+		stream->batch = batch;
+		stream->max_rows = max_rows;
+
+		bool ok = true;
+		while (ok && batch->rows < max_rows && stream->carry_at < stream->carry_ends.size)
+		{
+			const size_t *head = (const size_t *)(stream->carry_ends.data + stream->carry_at);
+			stream->record++;
+			ok = csvee_batch_row(stream, stream->carry_text.data + head[0], head + 2, head[1]);
+			stream->carry_at += (2 + head[1]) * sizeof(size_t);
+		}
+		if (stream->carry_at == stream->carry_ends.size)
+			stream->carry_at = stream->carry_ends.size = stream->carry_text.size = 0;
+
+		while (ok && batch->rows < max_rows && !stream->eof)
+		{
+			uint64_t start_ns = csvee_now_ns();
+			size_t n = stream->codec == CSVEE_CODEC_NONE ? fread(stream->chunk, 1, CSVEE_READ_BUFFER_SIZE, stream->file)
+														 : csvee_inflate_read(&stream->decoder, stream->chunk, CSVEE_READ_BUFFER_SIZE);
+			stream->parser.stats.io_ns += csvee_now_ns() - start_ns;
+			if (n == 0)
+			{
+				stream->eof = true;
+				ok = !ferror(stream->file) && !(stream->codec != CSVEE_CODEC_NONE && stream->decoder.failed) &&
+					 csvee_parser_finish(&stream->parser);
+			}
+			else
+				ok = csvee_parser_feed(&stream->parser, stream->chunk, n);
+		}
+
+		for (size_t c = 0; c < batch->count; ++c)
+		{
+			CSVBatchColumn_t *column = &batch->columns[c];
+			const char *at = column->text;
+			for (size_t r = 0; column->type == CSVEE_TYPE_STRING && r < batch->rows; ++r)
+			{
+				column->strings[r] = at;
+				at += column->lengths[r];
+			}
+		}
+		stream->batch = NULL;
+		stream->failed = !ok;
+		return ok;
+	}
+
+	void csvee_stream_close(CSVStream_t *stream)
+	{
+		if (!stream)
+			return;
+		if (stream->file)
+		{
+			csvee_stats_publish(&stream->parser.stats);
+			csvee_parser_free(&stream->parser);
+			if (stream->codec != CSVEE_CODEC_NONE)
+				csvee_inflate_end(&stream->decoder);
+			fclose(stream->file);
+		}
+		for (size_t c = 0; stream->names && c < stream->schema->count; ++c)
+			free(stream->names[c]);
+		free(stream->names);
+		free(stream->sources);
+		free(stream->chunk);
+		csvee_buffer_free(&stream->carry_text);
+		csvee_buffer_free(&stream->carry_ends);
+		free(stream);
+	}
+
+	/*
+	 * Make @p csvee, which must be empty, a lazy table over @p text, taking
+	 * ownership of it (malloc'ed, freed on failure too). Only the row
+	 * boundaries are found now, by the same scan as csvee_info(); each row is
+	 * tokenized and unescaped the first time csvee_row_at() reaches it, and
+	 * the text is released once the last row has been built.
+	 */
+	bool csvee_lazy_attach(Csvee_t *csvee, char *text, size_t size)
+	{
+		if (!csvee || csvee->count || csvee->lazy || csvee->spill)
+		{
+			free(text);
+			return false;
+		}
+
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		uint64_t start_ns = csvee_now_ns();
+
+		CSVBuffer_t spans = {NULL, 0, 0};
+		CSVScan_t scan;
+		csvee_scan_init(&scan, csvee->dialect);
+		scan.spans = &spans;
+		csvee_scan_feed(&scan, text, size);
+		csvee_scan_finish(&scan);
+
+		CSVLazy_t *lazy = (CSVLazy_t *)calloc(1, sizeof(CSVLazy_t));
+		CSVRow_t *rows = (CSVRow_t *)calloc(scan.rows ? scan.rows : 1, sizeof(CSVRow_t));
+		if (!lazy || !rows || scan.failed)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(OUT_OF_MEMORY, "Could not index %zu rows\n", scan.rows);
+#endif // CSVEE_DEBUG
+			free(lazy);
+			free(rows);
+			csvee_buffer_free(&spans);
+			free(text);
+			return false;
+		}
+
+		free(csvee->rows);
+		csvee->rows = rows;
+		csvee->capacity = scan.rows ? scan.rows : 1;
+		csvee->count = scan.rows;
+
+		lazy->text = text;
+		lazy->size = size;
+		lazy->spans = (uint64_t *)spans.data;
+		lazy->count = lazy->pending = scan.rows;
+		csvee_parser_init(&lazy->parser, csvee->dialect, csvee_lazy_row_cb, NULL);
+		if (lazy->pending)
+			csvee->lazy = lazy;
+		else
+			csvee_lazy_free(lazy);
+
+		op.rows = scan.rows;
+		op.bytes_scanned = size;
+		op.tokenize_ns = csvee_now_ns() - start_ns;
+		op.allocations = 3;
+		op.bytes_allocated = size + spans.capacity + csvee->capacity * sizeof(CSVRow_t);
+		csvee_read_stats(csvee, &op);
+		return true;
+	}
+
+	bool csvee_row_deleted(const Csvee_t *csvee, size_t index)
+	{
+		return csvee->tombstones && index / 64 < csvee->tombstones_len && (csvee->tombstones[index / 64] >> (index % 64) & 1);
+	}
+
+	/* Row @p index (0-based) ready to be changed in place: built, private to this version and owning its fields. */
+	static CSVRow_t *csvee_row_for_write(Csvee_t *csvee, size_t index)
+	{
+		if (csvee->spill)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(UNKNOWN, "Cannot change the rows of a table with a memory budget\n");
+#endif // CSVEE_DEBUG
+			return NULL;
+		}
+		if (index >= csvee->count || csvee_row_deleted(csvee, index) ||
+			!csvee_share_unshare(csvee, index / CSVEE_SHARE_BLOCK_ROWS))
+			return NULL;
+
+		CSVRow_t *row = csvee_row_at(csvee, index);
+		if (row && csvee_compact_owns(csvee, row))
+		{
+			CSVRow_t own;
+			if (!csvee_row_copy(&own, row))
+				return NULL;
+			*row = own;
+		}
+		return row;
+	}
 
-//-----------------------------------------------------------------------------
-// [SECTION] Declarations
-//-----------------------------------------------------------------------------
+	/* Store @p value in @p field, reusing its text when the new value fits. */
+	static bool csvee_field_assign(CSVField_t *field, const char *value)
+	{
+		size_t size = strlen(value);
+		char *text = field->type == CSVEE_STRING ? field->value._string : NULL;
+		if (!text || strlen(text) < size)
+		{
+			text = (char *)realloc(text, size + 1);
+			if (!text)
+				return false;
+			field->type = CSVEE_STRING;
+			field->value._string = text;
+		}
+		memcpy(text, value, size + 1);
+		return true;
+	}
 
-//-----------------------------------------------------------------------------
-// [SECTION] Definations
-//-----------------------------------------------------------------------------
+	/* Make room for @p count fields in @p row; new ones are empty strings. */
+	static bool csvee_row_resize(CSVRow_t *row, size_t count)
+	{
+		if (count > row->capacity)
+		{
+			size_t capacity = row->capacity * 2 > count ? row->capacity * 2 : count;
+			CSVField_t *fields = (CSVField_t *)realloc(row->fields, capacity * sizeof(CSVField_t));
+			if (!fields)
+				return false;
+			row->fields = fields;
+			row->capacity = capacity;
+		}
+		for (; row->count < count; ++row->count)
+		{
+			row->fields[row->count].type = CSVEE_STRING;
+			row->fields[row->count].value._string = NULL;
+			if (!csvee_field_assign(&row->fields[row->count], ""))
+				return false;
+		}
+		return true;
+	}
 
-#endif //__cplusplus
+	/* Append a row of @p count strings, given as the variadic arguments. */
+	bool csvee_add_row(Csvee_t *csvee, size_t count, ...)
+	{
+		if (!csvee || count == 0)
+			return false;
+		CSVRow_t row = csvee_create_row(count);
+		if (!row.fields)
+			return false;
+		row.count = 0;
 
-#pragma endregion
+		va_list args;
+		va_start(args, count);
+		bool ok = true;
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			const char *value = va_arg(args, const char *);
+			row.fields[i] = csvee_create_field(value ? value : "");
+			ok = row.fields[i].value._string != NULL;
+			row.count += ok;
+		}
+		va_end(args);
 
-#pragma region Csvee
+		if (!ok || !csvee_push_row(csvee, &row))
+		{
+			csvee_row_free(&row);
+			return false;
+		}
+		return true;
+	}
 
-//-----------------------------------------------------------------------------
-// [SECTION] C Only Functions
-//-----------------------------------------------------------------------------
+	/*
+	 * Append @p count rows in one go, taking over their fields. The rows
+	 * array grows at most once. On failure the rows not appended yet keep
+	 * their fields.
+	 */
+	bool csvee_add_rows(Csvee_t *csvee, CSVRow_t *rows, size_t count)
+	{
+		if (!csvee || (!rows && count))
+			return false;
+		if (csvee->count + count > csvee->capacity || !csvee->rows)
+		{
+			size_t capacity = csvee->rows && csvee->capacity * 2 > csvee->count + count ? csvee->capacity * 2 : csvee->count + count;
+			capacity = capacity < 16 ? 16 : capacity;
+			CSVRow_t *grown = (CSVRow_t *)realloc(csvee->rows, capacity * sizeof(CSVRow_t));
+			if (!grown)
+				return false;
+			csvee->stats.allocations++;
+			csvee->stats.bytes_allocated += (capacity - (csvee->rows ? csvee->capacity : 0)) * sizeof(CSVRow_t);
+			csvee->rows = grown;
+			csvee->capacity = capacity;
+		}
+		for (size_t i = 0; i < count; ++i)
+			if (!csvee_push_row(csvee, &rows[i]))
+				return false;
+		return true;
+	}
 
-#ifdef __cplusplus
-extern "C"
-{
-#endif // __cplusplus
+	/* Replace row @p row (from 1) with @p count strings, reusing its fields and their text where they fit. */
+	bool csvee_update_row(Csvee_t *csvee, size_t row, size_t count, ...)
+	{
+		if (!csvee || row == 0)
+			return false;
+		CSVRow_t *target = csvee_row_for_write(csvee, row - 1);
+		if (!target)
+			return false;
 
-	void csvee_dialect_init(CSVDialect_t *dialect, char *name, char delimeter, char quotechar, bool skipwhitespace, bool doublequote, CSVQuote_t quoting, char lineterminator)
+		while (target->count > count)
+			csvee_field_free(&target->fields[--target->count]);
+		bool ok = csvee_row_resize(target, count);
+
+		va_list args;
+		va_start(args, count);
+		for (size_t i = 0; ok && i < count; ++i)
+		{
+			const char *value = va_arg(args, const char *);
+			ok = csvee_field_assign(&target->fields[i], value ? value : "");
+		}
+		va_end(args);
+		return ok;
+	}
+
+	/* Set field @p col of row @p row (both from 1) in place; a shorter row is padded with empty fields. */
+	bool csvee_update_field(Csvee_t *csvee, size_t row, size_t col, const char *value)
 	{
-		if (dialect == NULL)
-			return;
+		if (!csvee || row == 0 || col == 0 || !value)
+			return false;
+		CSVRow_t *target = csvee_row_for_write(csvee, row - 1);
+		return target && csvee_row_resize(target, col) && csvee_field_assign(&target->fields[col - 1], value);
+	}
 
-		/* copy/own the name and lineterminator so free() is safe later */
-		if (name)
+	/*
+	 * Delete row @p row (from 1) in O(1): its fields are freed and it is
+	 * marked as a tombstone, which the writers, iterators and Arrow export
+	 * skip. Row numbers stay put until csvee_purge() or csvee_sort()
+	 * compacts the table; only the caller knows when no row number is
+	 * held any more.
+	 */
+	bool csvee_delete_row(Csvee_t *csvee, size_t row)
+	{
+		if (!csvee || row == 0 || row > csvee->count || csvee_row_deleted(csvee, row - 1))
+			return false;
+		size_t index = row - 1;
+		if (csvee->spill)
 		{
-			dialect->name = strdup(name);
+#ifdef CSVEE_DEBUG
+			csvee_error(UNKNOWN, "Cannot change the rows of a table with a memory budget\n");
+#endif // CSVEE_DEBUG
+			return false;
 		}
-		else
+
+		if (index / 64 >= csvee->tombstones_len)
 		{
-			dialect->name = NULL;
+			size_t len = (csvee->count + 63) / 64;
+			uint64_t *tombstones = (uint64_t *)realloc(csvee->tombstones, len * sizeof(uint64_t));
+			if (!tombstones)
+				return false;
+			memset(tombstones + csvee->tombstones_len, 0, (len - csvee->tombstones_len) * sizeof(uint64_t));
+			csvee->tombstones = tombstones;
+			csvee->tombstones_len = len;
+		}
+		if (!csvee_share_unshare(csvee, index / CSVEE_SHARE_BLOCK_ROWS))
+			return false;
+
+		CSVRow_t *target = &csvee->rows[index];
+		CSVLazy_t *lazy = csvee->lazy;
+		if (lazy && index < lazy->count && !target->fields && --lazy->pending == 0)
+		{
+			csvee_lazy_free(lazy);
+			csvee->lazy = NULL;
 		}
+		if (!csvee_compact_owns(csvee, target))
+			csvee_row_free(target);
+		target->fields = NULL;
+		target->capacity = target->count = 0;
 
-		dialect->quoting = quoting;
-		dialect->delimiter = delimeter;
-		dialect->quotechar = quotechar;
-		dialect->doublequote = doublequote;
-		dialect->skipwhitespace = skipwhitespace;
-		dialect->lineterminator = lineterminator;
-	};
+		csvee->tombstones[index / 64] |= (uint64_t)1 << (index % 64);
+		csvee->deleted++;
+		return true;
+	}
 
-	void csvee_dialect_free(CSVDialect_t *dialect)
+	/* Drop the deleted rows for good, closing the gaps: the rows after them move up. */
+	bool csvee_purge(Csvee_t *csvee)
 	{
-		if (!dialect)
+		if (!csvee)
+			return false;
+		if (!csvee->deleted)
+			return true;
+		/* rows change places: spans and shared blocks would no longer line up */
+		if (!csvee_lazy_settle(csvee) || !csvee_share_detach(csvee))
+			return false;
+
+		size_t kept = 0;
+		for (size_t r = 0; r < csvee->count; ++r)
+			if (!csvee_row_deleted(csvee, r))
+				csvee->rows[kept++] = csvee->rows[r];
+		csvee->count = kept;
+
+		free(csvee->tombstones);
+		csvee->tombstones = NULL;
+		csvee->tombstones_len = 0;
+		csvee->deleted = 0;
+		return true;
+	}
+
+	/* A table readers may share: lazy rows are built now, spilled or compact rows cannot be shared. */
+	static bool csvee_versions_ready(Csvee_t *csvee)
+	{
+		if (csvee->spill || csvee->compact)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(UNKNOWN, "Cannot publish a table with a memory budget or a compact layout\n");
+#endif // CSVEE_DEBUG
+			return false;
+		}
+		return csvee_lazy_settle(csvee);
+	}
+
+	/* Free the retired versions no reader slot protects any more. */
+	static void csvee_versions_reclaim(CSVVersions_t *versions)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < versions->retired_count; ++i)
+		{
+			Csvee_t *old = versions->retired[i];
+			bool held = false;
+			for (size_t s = 0; s < CSVEE_VERSION_READERS && !held; ++s)
+				held = CSVEE_ATOMIC_LOAD_PTR(&versions->hazards[s]) == old;
+			if (held)
+				versions->retired[kept++] = old;
+			else
+				csvee_free(old);
+		}
+		versions->retired_count = kept;
+	}
+
+	/*
+	 * Make @p csvee, taken over, the first version of a table that reader
+	 * threads use through csvee_versions_acquire() while one writer thread
+	 * prepares the next version with csvee_versions_edit() or builds a new
+	 * one from scratch, and swaps it in with csvee_versions_publish().
+	 */
+	CSVVersions_t *csvee_versions_new(Csvee_t *csvee)
+	{
+		if (!csvee || !csvee_versions_ready(csvee))
+			return NULL;
+		CSVVersions_t *versions = (CSVVersions_t *)calloc(1, sizeof(CSVVersions_t));
+		if (!versions)
+			return NULL;
+		versions->current = csvee;
+		return versions;
+	}
+
+	/*
+	 * The published version, which stays valid and unchanged until it is
+	 * handed back with csvee_versions_release(). Lock-free: the snapshot is
+	 * announced in a free hazard slot and kept if it is still the published
+	 * one afterwards; the writer frees no version a slot names. NULL when all
+	 * CSVEE_VERSION_READERS slots are taken.
+	 */
+	const Csvee_t *csvee_versions_acquire(CSVVersions_t *versions)
+	{
+		if (!versions)
+			return NULL;
+		for (size_t s = 0; s < CSVEE_VERSION_READERS; ++s)
+		{
+			Csvee_t *current = (Csvee_t *)CSVEE_ATOMIC_LOAD_PTR(&versions->current);
+			Csvee_t *expected = NULL;
+			if (!CSVEE_ATOMIC_CAS_PTR(&versions->hazards[s], expected, current))
+				continue;
+
+			/* the slot is ours: move it along until the version it names is still published */
+			for (;;)
+			{
+				Csvee_t *now = (Csvee_t *)CSVEE_ATOMIC_LOAD_PTR(&versions->current);
+				if (now == current)
+					return current;
+				current = now;
+				CSVEE_ATOMIC_STORE_PTR(&versions->hazards[s], current);
+			}
+		}
+#ifdef CSVEE_DEBUG
+		csvee_error(UNKNOWN, "All %d snapshot slots are in use\n", CSVEE_VERSION_READERS);
+#endif // CSVEE_DEBUG
+		return NULL;
+	}
+
+	/* Hand back a snapshot from csvee_versions_acquire(); the writer may free it from now on. */
+	void csvee_versions_release(CSVVersions_t *versions, const Csvee_t *snapshot)
+	{
+		if (!versions || !snapshot)
 			return;
-		if (dialect->name)
-			free(dialect->name);
-		free(dialect);
-	};
+		for (size_t s = 0; s < CSVEE_VERSION_READERS; ++s)
+		{
+			Csvee_t *expected = (Csvee_t *)snapshot;
+			if (CSVEE_ATOMIC_CAS_PTR(&versions->hazards[s], expected, (Csvee_t *)NULL))
+				return;
+		}
+	}
 
-	void csvee_init(Csvee_t *csvee, CSVDialect_t *dialect)
+	/*
+	 * A draft of the next version for the writer. It shares every block of
+	 * CSVEE_SHARE_BLOCK_ROWS rows with the published version; a block is
+	 * copied the first time the draft changes it, through
+	 * csvee_versions_row() or by appending with csvee_push_row(). Publish
+	 * the draft or csvee_free() it.
+	 */
+	Csvee_t *csvee_versions_edit(CSVVersions_t *versions)
 	{
-		if (csvee == NULL)
+		if (!versions)
+			return NULL;
+		Csvee_t *current = versions->current; /* only the writer stores it */
+		if (!csvee_share_init(current))
+			return NULL;
+
+		Csvee_t *draft = csvee_new(current->dialect->delimiter);
+		if (!draft)
+			return NULL;
+		CSVDialect_t *dialect = draft->dialect;
+		free(dialect->name);
+		*dialect = *current->dialect;
+		dialect->name = current->dialect->name ? strdup(current->dialect->name) : NULL;
+
+		size_t capacity = current->count > 16 ? current->count : 16;
+		draft->rows = (CSVRow_t *)malloc(capacity * sizeof(CSVRow_t));
+		draft->share = (CSVShare_t *)calloc(1, sizeof(CSVShare_t));
+		CSVShareBlock_t **blocks = current->share->count ? (CSVShareBlock_t **)malloc(current->share->count * sizeof(CSVShareBlock_t *)) : NULL;
+		if (!draft->rows || !draft->share || (current->share->count && !blocks))
+		{
+			free(blocks);
+			csvee_free(draft);
+			return NULL;
+		}
+
+		if (current->tombstones)
+		{
+			draft->tombstones = (uint64_t *)malloc(current->tombstones_len * sizeof(uint64_t));
+			if (!draft->tombstones)
+			{
+				free(blocks);
+				csvee_free(draft);
+				return NULL;
+			}
+			memcpy(draft->tombstones, current->tombstones, current->tombstones_len * sizeof(uint64_t));
+			draft->tombstones_len = current->tombstones_len;
+			draft->deleted = current->deleted;
+		}
+
+		memcpy(draft->rows, current->rows, current->count * sizeof(CSVRow_t));
+		draft->capacity = capacity;
+		draft->count = current->count;
+		for (size_t b = 0; b < current->share->count; ++b)
+		{
+			blocks[b] = current->share->blocks[b];
+			blocks[b]->refs++;
+		}
+		draft->share->blocks = blocks;
+		draft->share->count = current->share->count;
+		return draft;
+	}
+
+	/* Row @p index of a draft, ready to be changed in place: its block is copied first if shared. */
+	CSVRow_t *csvee_versions_row(Csvee_t *draft, size_t index)
+	{
+		if (!draft || index >= draft->count || !csvee_share_unshare(draft, index / CSVEE_SHARE_BLOCK_ROWS))
+			return NULL;
+		return csvee_row_at(draft, index);
+	}
+
+	/*
+	 * Row @p index (0-based) of a snapshot from csvee_versions_acquire(),
+	 * for reading only; NULL past the end or for a deleted row. Published
+	 * tables are never spilled and have every lazy row built, so this
+	 * changes nothing and any number of readers may call it at once.
+	 */
+	const CSVRow_t *csvee_versions_read(const Csvee_t *snapshot, size_t index)
+	{
+		if (!snapshot || index >= snapshot->count || csvee_row_deleted(snapshot, index))
+			return NULL;
+		return &snapshot->rows[index];
+	}
+
+	/*
+	 * Make @p next, taken over, the version new snapshots see. Readers
+	 * holding the previous one keep it; it is freed by a later publish (or
+	 * csvee_versions_free()) once none does. One writer thread at a time.
+	 */
+	bool csvee_versions_publish(CSVVersions_t *versions, Csvee_t *next)
+	{
+		if (!versions || !next || next == versions->current || !csvee_versions_ready(next))
+			return false;
+
+		if (versions->retired_count == versions->retired_cap)
+		{
+			size_t capacity = versions->retired_cap ? versions->retired_cap * 2 : 8;
+			Csvee_t **retired = (Csvee_t **)realloc(versions->retired, capacity * sizeof(Csvee_t *));
+			if (!retired)
+				return false;
+			versions->retired = retired;
+			versions->retired_cap = capacity;
+		}
+
+		Csvee_t *old = (Csvee_t *)CSVEE_ATOMIC_SWAP_PTR(&versions->current, next);
+		versions->retired[versions->retired_count++] = old;
+		csvee_versions_reclaim(versions);
+		return true;
+	}
+
+	/* Free every version. No reader may hold a snapshot any more. */
+	void csvee_versions_free(CSVVersions_t *versions)
+	{
+		if (!versions)
 			return;
-		csvee->dialect = dialect;
-		csvee->rows = NULL;
-		csvee->count = 0;
-		csvee->capacity = 1;
-	};
+		for (size_t i = 0; i < versions->retired_count; ++i)
+			csvee_free(versions->retired[i]);
+		csvee_free(versions->current);
+		free(versions->retired);
+		free(versions);
+	}
 
-	void csvee_free(Csvee_t *csvee)
+	/*
+	 * Bound the memory held by the rows of @p csvee. Whole blocks of
+	 * CSVEE_SPILL_BLOCK_ROWS rows, least recently used first, are moved to an
+	 * anonymous file in @p spill_dir and read back when accessed. 0 lifts the
+	 * limit and pages everything back in. Rows of a lazy table are all built
+	 * first.
+	 */
+	bool csvee_set_memory_budget(Csvee_t *csvee, size_t bytes, const char *spill_dir)
 	{
 		if (!csvee)
+			return false;
+
+		if (bytes && csvee->compact)
 		{
-			return;
+#ifdef CSVEE_DEBUG
+			csvee_error(UNKNOWN, "Cannot spill the rows of a compact table\n");
+#endif // CSVEE_DEBUG
+			return false;
 		}
 
-		for (size_t i = 0; i < csvee->count; i++)
+		CSVSpill_t *spill = csvee->spill;
+		if (bytes && !spill && (!csvee_purge(csvee) || !csvee_lazy_settle(csvee) || !csvee_share_detach(csvee)))
+			return false;
+		if (bytes == 0)
+		{
+			csvee->memory_budget = 0;
+			for (size_t b = 0; spill && b < spill->block_count; ++b)
+				if (!spill->blocks[b].resident && !csvee_spill_load(csvee, b))
+					return false;
+			csvee_spill_free(spill);
+			csvee->spill = NULL;
+			return true;
+		}
+
+		if (!spill)
+		{
+			spill = (CSVSpill_t *)calloc(1, sizeof(CSVSpill_t));
+			if (!spill)
+				return false;
+			spill->file = csvee_spill_open(spill_dir);
+			if (!spill->file)
+			{
+				free(spill);
+				return false;
+			}
+			spill->lru_head = spill->lru_tail = spill->hot = SIZE_MAX;
+
+			/* account for the rows already loaded, as if they were pushed now */
+			size_t count = csvee->count;
+			csvee->spill = spill;
+			csvee->memory_budget = 0;
+			for (csvee->count = 1; csvee->count <= count; ++csvee->count)
+				if (!csvee_spill_track(csvee))
+				{
+					csvee->count = count;
+					csvee->spill = NULL;
+					csvee_spill_free(spill);
+					return false;
+				}
+			csvee->count = count;
+		}
+
+		csvee->memory_budget = bytes;
+		return csvee_spill_enforce(csvee, SIZE_MAX);
+	}
+
+	/* Keep the first record as info->header, pointers and text in one block, and stop the parse. */
+	static bool csvee_info_header_cb(void *user, CSVRow_t *row)
+	{
+		CSVInfo_t *info = (CSVInfo_t *)user;
+		size_t size = row->count * sizeof(char *);
+		for (size_t c = 0; c < row->count; ++c)
+			size += strlen(row->fields[c].value._string ? row->fields[c].value._string : "") + 1;
+
+		info->header = (char **)malloc(size ? size : 1);
+		if (info->header)
+		{
+			char *text = (char *)(info->header + row->count);
+			for (size_t c = 0; c < row->count; ++c)
+			{
+				const char *name = row->fields[c].value._string ? row->fields[c].value._string : "";
+				size_t len = strlen(name) + 1;
+				memcpy(text, name, len);
+				info->header[c] = text;
+				text += len;
+			}
+			info->header_count = row->count;
+		}
+
+		for (size_t c = 0; c < row->count; ++c)
+			csvee_field_free(&row->fields[c]);
+		free(row->fields);
+		return false;
+	}
+
+	bool csvee_info(const char *filename, CSVInfo_t *info)
+	{
+		if (!filename || !info)
+			return false;
+		memset(info, 0, sizeof(*info));
+
+		FILE *file = fopen(filename, "rb");
+		if (!file)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(NULL_FILE, "Could not open file %s\n", filename);
+#endif // CSVEE_DEBUG
+			return false;
+		}
+
+		unsigned char magic[4];
+		size_t got = fread(magic, 1, sizeof(magic), file);
+		info->codec = csvee_detect_codec(magic, got);
+		bool ok = csvee_codec_supported(info->codec) && fseek(file, 0, SEEK_END) == 0;
+		long file_bytes = ok ? ftell(file) : -1;
+		if (!ok || file_bytes < 0 || fseek(file, 0, SEEK_SET) != 0)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(INVALID_FILE, "%s is compressed but csvee was built without support for it\n", filename);
+#endif // CSVEE_DEBUG
+			fclose(file);
+			return false;
+		}
+		info->file_bytes = (uint64_t)file_bytes;
+		info->delimiter = csvee_filename_delimiter(filename);
+
+		CSVDialect_t dialect;
+		csvee_dialect_init(&dialect, NULL, info->delimiter, '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+		CSVInflate_t decoder;
+		memset(&decoder, 0, sizeof(decoder));
+		char *buffer = (char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		if (!buffer || (info->codec != CSVEE_CODEC_NONE && !csvee_inflate_init(&decoder, file, info->codec)))
+		{
+			free(buffer);
+			fclose(file);
+			return false;
+		}
+
+		/* the tokenizer only runs until the header is complete, the scan covers everything */
+		CSVParser_t parser;
+		csvee_parser_init(&parser, &dialect, csvee_info_header_cb, info);
+		bool parsing = true;
+
+		CSVScan_t scan;
+		csvee_scan_init(&scan, &dialect);
+
+		for (;;)
+		{
+			size_t n = info->codec == CSVEE_CODEC_NONE ? fread(buffer, 1, CSVEE_READ_BUFFER_SIZE, file)
+													   : csvee_inflate_read(&decoder, buffer, CSVEE_READ_BUFFER_SIZE);
+			if (n == 0)
+				break;
+			if (parsing)
+				parsing = csvee_parser_feed(&parser, buffer, n);
+			csvee_scan_feed(&scan, buffer, n);
+		}
+		if (parsing)
+			parsing = csvee_parser_finish(&parser);
+		csvee_scan_finish(&scan);
+
+		ok = !ferror(file);
+		if (info->codec != CSVEE_CODEC_NONE)
+		{
+			ok = ok && !decoder.failed;
+			csvee_inflate_end(&decoder);
+		}
+		if (!parsing && !info->header)
+		{
+#ifdef CSVEE_DEBUG
+			csvee_error(OUT_OF_MEMORY, "Could not store the header of %s\n", filename);
+#endif // CSVEE_DEBUG
+			ok = false;
+		}
+		else if (!ok)
 		{
-			csvee_row_free(&csvee->rows[i]);
+#ifdef CSVEE_DEBUG
+			csvee_error(IO_ERROR, "Could not read %s\n", filename);
+#endif // CSVEE_DEBUG
 		}
+		csvee_parser_free(&parser);
+		free(buffer);
+		fclose(file);
 
-		csvee_dialect_free(csvee->dialect);
-		free(csvee->rows);
-		csvee->count = 0;
-		csvee->capacity = 0;
-		free(csvee);
-	};
+		info->rows = scan.rows;
+		info->min_columns = scan.min_columns;
+		info->max_columns = scan.max_columns;
+		info->bytes = scan.offset;
+		info->quoted_newlines = scan.quoted_newlines;
+		info->unterminated_quote = scan.in_quotes;
+
+		size_t kinds = (scan.lf != 0) + (scan.crlf != 0) + (scan.cr != 0);
+		if (kinds > 1)
+			info->line_ending = CSVEE_EOL_MIXED;
+		else if (scan.crlf)
+			info->line_ending = CSVEE_EOL_CRLF;
+		else if (scan.cr)
+			info->line_ending = CSVEE_EOL_CR;
+		else if (scan.lf)
+			info->line_ending = CSVEE_EOL_LF;
+
+		if (!ok)
+			csvee_info_free(info);
+		return ok;
+	}
 
-	Csvee_t *csvee_read_from_file(const char *filename)
+	void csvee_info_free(CSVInfo_t *info)
 	{
-		if (!filename)
-			return NULL;
+		if (!info)
+			return;
+		free(info->header);
+		info->header = NULL;
+		info->header_count = 0;
+	}
 
-		/* allocate csvee and dialect */
-		Csvee_t *csvee = (Csvee_t *)malloc(sizeof(Csvee_t));
-		if (!csvee)
-			return NULL;
+	static bool csvee_follow_row_cb(void *user, CSVRow_t *row)
+	{
+		CSVFollow_t *follow = (CSVFollow_t *)user;
+		if (!follow->on_row(follow->user, row))
+			follow->stopped = true;
+		return !follow->stopped;
+	}
 
-		CSVDialect_t *dialect = (CSVDialect_t *)malloc(sizeof(CSVDialect_t));
-		if (!dialect)
+	/* (Re)start parsing @p follow->file at @p offset, watching it for changes where supported. */
+	static void csvee_follow_restart(CSVFollow_t *follow, uint64_t offset)
+	{
+		csvee_stats_publish(&follow->parser.stats);
+		csvee_parser_free(&follow->parser);
+		csvee_parser_init(&follow->parser, &follow->dialect, csvee_follow_row_cb, follow);
+		follow->origin = follow->offset = offset;
+
+#if defined(__linux__)
+		if (follow->watch >= 0)
 		{
-			free(csvee);
-			return NULL;
+			if (follow->watch_id >= 0)
+				inotify_rm_watch(follow->watch, follow->watch_id);
+			follow->watch_id = inotify_add_watch(follow->watch, follow->filename,
+												 IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
 		}
+#endif
+	}
 
-		/* choose delimiter based on extension */
-		char del = CSVEE_SEPERATOR;
-		size_t fnlen = strlen(filename);
-		if (fnlen >= 4 && strcasecmp(filename + fnlen - 4, ".tsv") == 0)
-			del = '\t';
-		else if (fnlen >= 4 && strcasecmp(filename + fnlen - 4, ".txt") == 0)
-			del = '\t';
-
-		csvee_dialect_init(dialect, "excel", del, '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
-		csvee_init(csvee, dialect);
-
-		FILE *file = fopen(filename, "rb");
-		if (!file)
+	/*
+	 * Start following @p filename from byte @p offset: 0 for the whole file,
+	 * or a value from csvee_follow_offset() to resume. Rows are handed to
+	 * @p on_row as csvee_follow_poll() finds them.
+	 */
+	bool csvee_follow_open(CSVFollow_t *follow, const char *filename, uint64_t offset, CSVRowCallback_t on_row, void *user)
+	{
+		if (!follow || !filename || !on_row)
+			return false;
+		memset(follow, 0, sizeof(*follow));
+		follow->watch = follow->watch_id = -1;
+		follow->poll_ms = CSVEE_FOLLOW_POLL_MS;
+		follow->on_row = on_row;
+		follow->user = user;
+
+		follow->filename = strdup(filename);
+		follow->buffer = (char *)malloc(CSVEE_READ_BUFFER_SIZE);
+		follow->file = fopen(filename, "rb");
+		if (!follow->filename || !follow->buffer || !follow->file)
 		{
 #ifdef CSVEE_DEBUG
 			csvee_error(NULL_FILE, "Could not open file %s\n", filename);
 #endif // CSVEE_DEBUG
-			csvee_free(csvee);
-			return NULL;
+			csvee_follow_close(follow);
+			return false;
 		}
 
-		char line[MAX_LINE_LENGTH];
-		size_t col_capacity = 8;
+		csvee_dialect_init(&follow->dialect, NULL, csvee_filename_delimiter(filename), '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
+#if defined(__linux__)
+		follow->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+		csvee_follow_restart(follow, offset);
+		return true;
+	}
 
-		csvee->rows = (CSVRow_t *)malloc(csvee->count * sizeof(CSVRow_t));
-		if (!csvee->rows)
-		{
-			fclose(file);
-			csvee_free(csvee);
-			return NULL;
-		}
+	/* Parse everything appended since the last call. False on a read or allocation failure. */
+	bool csvee_follow_poll(CSVFollow_t *follow)
+	{
+		if (!follow || !follow->file)
+			return false;
+		follow->stopped = false;
 
-		while (fgets(line, sizeof(line), file))
+		for (;;)
 		{
-			if (csvee->count >= csvee->count)
-			{
-				csvee->count *= 2;
-				csvee->rows = (CSVRow_t *)realloc(csvee->rows, csvee->count * sizeof(CSVRow_t));
-			}
+			/* a file shorter than what was read has been truncated: start over */
+			csvee_stat_t st;
+			bool have_st = CSVEE_FSTAT(follow->file, &st) == 0;
+			if (have_st && (uint64_t)st.st_size < follow->offset)
+				csvee_follow_restart(follow, 0);
 
-			CSVRow_t row = csvee_create_row(col_capacity);
-			char field[MAX_FIELD_LENGTH];
-			size_t field_index = 0;
-			size_t col_count = 0;
-			bool in_quotes = false;
+			if (CSVEE_FSEEK64(follow->file, follow->offset) != 0)
+				return false;
 
-			size_t len = strlen(line);
-			for (size_t i = 0; i < len; ++i)
+			for (;;)
 			{
-				char ch = line[i];
-				if (ch == csvee->dialect->quotechar && (i == 0 || line[i - 1] != '\\'))
-				{
-					in_quotes = !in_quotes;
-				}
-				else if (ch == csvee->dialect->delimiter && !in_quotes)
-				{
-					field[field_index] = '\0';
-					row.fields[col_count] = csvee_create_field(field);
-					col_count++;
-					field_index = 0;
+				size_t n = fread(follow->buffer, 1, CSVEE_READ_BUFFER_SIZE, follow->file);
+				if (n == 0)
+					break;
 
-					if (col_count >= col_capacity)
-					{
-						col_capacity *= 2;
-						row.fields = (CSVField_t *)realloc(row.fields, col_capacity * sizeof(CSVField_t));
-					}
-				}
-				else if (ch == '\r' || ch == '\n')
-				{
-					continue;
-				}
-				else
+				uint64_t fed = follow->parser.stats.bytes_scanned;
+				if (!csvee_parser_feed(&follow->parser, follow->buffer, n))
 				{
-					if (field_index + 1 < sizeof(field))
-						field[field_index++] = ch;
+					if (!follow->stopped)
+						return false;
+
+					/* leave the bytes after the row the callback stopped at for the next poll */
+					uint64_t used = follow->parser.row_end - fed;
+					follow->parser.stats.bytes_scanned = fed + used;
+					follow->offset += used;
+					return true;
 				}
+				follow->offset += n;
 			}
-			field[field_index] = '\0';
-			row.fields[col_count] = csvee_create_field(field);
-			col_count++;
-
-			row.count = col_count;
-			csvee->rows[csvee->count] = row;
-			csvee->count++;
+			if (ferror(follow->file))
+				return false;
+			clearerr(follow->file);
+
+#if !CSVEE_PLATFORM_IS(WINDOWS)
+			/* at the end of a file that was rotated away: continue with its replacement */
+			csvee_stat_t now;
+			if (!have_st || CSVEE_STAT(follow->filename, &now) != 0 || (now.st_ino == st.st_ino && now.st_dev == st.st_dev))
+				return true;
+			FILE *file = fopen(follow->filename, "rb");
+			if (!file)
+				return true;
+			fclose(follow->file);
+			follow->file = file;
+			csvee_follow_restart(follow, 0);
+#else
+			return true;
+#endif
 		}
-
-		fclose(file);
-		return csvee;
 	}
 
-	/* Parse CSV content from a memory buffer (string). Returns allocated Csvee_t* or NULL on error. */
-	Csvee_t *csvee_read_from_string(const char *data)
+	/*
+	 * Block until the file changes or @p timeout_ms passes. Without inotify
+	 * this just sleeps and reports a possible change.
+	 */
+	bool csvee_follow_wait(CSVFollow_t *follow, unsigned timeout_ms)
 	{
-		if (!data)
-			return NULL;
-
-		Csvee_t *csvee = (Csvee_t *)malloc(sizeof(Csvee_t));
-		if (!csvee)
-			return NULL;
+		if (!follow)
+			return false;
 
-		CSVDialect_t *dialect = (CSVDialect_t *)malloc(sizeof(CSVDialect_t));
-		if (!dialect)
+#if defined(__linux__)
+		if (follow->watch >= 0)
 		{
-			free(csvee);
-			return NULL;
+			struct pollfd pfd;
+			pfd.fd = follow->watch;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, (int)timeout_ms) <= 0)
+				return false;
+
+			char events[4096];
+			while (read(follow->watch, events, sizeof(events)) > 0)
+				;
+			return true;
 		}
+#endif
 
-		csvee_dialect_init(dialect, "excel", CSVEE_SEPERATOR, '"', true, true, CSVEE_QUOTE_MINIMAL, '\n');
-		csvee_init(csvee, dialect);
+#if CSVEE_PLATFORM_IS(WINDOWS)
+		Sleep(timeout_ms);
+#else
+		struct timespec ts;
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+		nanosleep(&ts, NULL);
+#endif
+		return true;
+	}
 
-		size_t len = strlen(data);
-		const char *ptr = data;
-		size_t col_capacity = 8;
+	/* Poll and wait until the callback returns false or csvee_follow_stop() is called. */
+	bool csvee_follow_run(CSVFollow_t *follow)
+	{
+		if (!follow)
+			return false;
 
-		csvee->rows = (CSVRow_t *)malloc(csvee->count * sizeof(CSVRow_t));
-		if (!csvee->rows)
+		while (!follow->stopped && !CSVEE_ATOMIC_LOAD(&follow->stop_requested))
 		{
-			csvee_dialect_free(dialect);
-			free(csvee);
-			return NULL;
+			if (!csvee_follow_poll(follow))
+				return false;
+			if (!follow->stopped)
+				csvee_follow_wait(follow, follow->poll_ms);
 		}
+		return true;
+	}
 
-		char field[MAX_FIELD_LENGTH];
-		size_t field_index = 0;
-		size_t col_count = 0;
-		CSVRow_t row = csvee_create_row(col_capacity);
-		bool in_quotes = false;
+	/* Ask csvee_follow_run() to return; safe to call from another thread. */
+	void csvee_follow_stop(CSVFollow_t *follow)
+	{
+		if (follow)
+			CSVEE_ATOMIC_STORE(&follow->stop_requested, (uint64_t)1);
+	}
 
-		for (size_t i = 0; i < len; ++i)
-		{
-			char ch = ptr[i];
-			if (ch == dialect->quotechar && (i == 0 || ptr[i - 1] != '\\'))
-			{
-				in_quotes = !in_quotes;
-			}
-			else if (ch == dialect->delimiter && !in_quotes)
-			{
-				field[field_index] = '\0';
-				row.fields[col_count] = csvee_create_field(field);
-				col_count++;
-				field_index = 0;
+	/* Deliver a last row that has no line terminator (yet). */
+	bool csvee_follow_flush(CSVFollow_t *follow)
+	{
+		if (!follow || !follow->file)
+			return false;
+		return csvee_parser_finish(&follow->parser) || follow->stopped;
+	}
 
-				if (col_count >= col_capacity)
-				{
-					col_capacity *= 2;
-					row.fields = (CSVField_t *)realloc(row.fields, col_capacity * sizeof(CSVField_t));
-				}
-			}
-			else if (ch == '\r' || ch == '\n')
-			{
-				/* end of row */
-				if (field_index > 0 || col_count > 0 || in_quotes)
-				{
-					field[field_index] = '\0';
-					row.fields[col_count] = csvee_create_field(field);
-					col_count++;
-					row.count = col_count;
-					if (csvee->count >= csvee->count)
-					{
-						csvee->count *= 2;
-						csvee->rows = (CSVRow_t *)realloc(csvee->rows, csvee->count * sizeof(CSVRow_t));
-					}
-					csvee->rows[csvee->count] = row;
-					csvee->count++;
-					/* prepare new row */
-					col_capacity = 8;
-					row = csvee_create_row(col_capacity);
-					field_index = 0;
-					col_count = 0;
-					in_quotes = false;
-				}
-				/* skip multiple newlines */
-				while (i + 1 < len && (ptr[i + 1] == '\r' || ptr[i + 1] == '\n'))
-					++i;
-			}
-			else
-			{
-				if (field_index + 1 < sizeof(field))
-					field[field_index++] = ch;
-			}
-		}
+	/* File offset just past the last row delivered, where a later csvee_follow_open() can resume. */
+	uint64_t csvee_follow_offset(const CSVFollow_t *follow)
+	{
+		if (!follow)
+			return 0;
+		return follow->origin + follow->parser.row_end;
+	}
 
-		/* final field/row if not terminated with newline */
-		if (field_index > 0 || col_count > 0)
-		{
-			field[field_index] = '\0';
-			row.fields[col_count] = csvee_create_field(field);
-			col_count++;
-			row.count = col_count;
-			if (csvee->count >= csvee->count)
-			{
-				csvee->count *= 2;
-				csvee->rows = (CSVRow_t *)realloc(csvee->rows, csvee->count * sizeof(CSVRow_t));
-			}
-			csvee->rows[csvee->count] = row;
-			csvee->count++;
-		}
+	void csvee_follow_close(CSVFollow_t *follow)
+	{
+		if (!follow)
+			return;
 
-		return csvee;
+		csvee_stats_publish(&follow->parser.stats);
+		csvee_parser_free(&follow->parser);
+#if defined(__linux__)
+		if (follow->watch >= 0)
+			close(follow->watch);
+#endif
+		if (follow->file)
+			fclose(follow->file);
+		free(follow->buffer);
+		free(follow->filename);
+		memset(follow, 0, sizeof(*follow));
+		follow->watch = follow->watch_id = -1;
+	}
+
+	/*
+	 * Row @p index for a writer. Only a spilled row or a lazy one not built
+	 * yet goes through csvee_row_at(), which pages or builds it; rows in
+	 * memory, such as every row of a published snapshot, are only read.
+	 */
+	static const CSVRow_t *csvee_row_read(const Csvee_t *csvee, size_t index)
+	{
+		if (index >= csvee->count)
+			return NULL;
+		if (csvee->spill || (csvee->lazy && !csvee->rows[index].fields))
+			return csvee_row_at((Csvee_t *)csvee, index);
+		return &csvee->rows[index];
 	}
 
 	bool csvee_write_to_file(const Csvee_t *csvee, const char *filename)
@@ -1788,79 +12386,41 @@ extern "C"
 		if (!csvee || !filename)
 			return false;
 
-		FILE *file = fopen(filename, "wb");
-		if (!file)
-		{
-#ifdef CSVEE_DEBUG
-			csvee_error(NULL_FILE, "Could not open file %s for writing\n", filename);
-#endif // CSVEE_DEBUG
-			return false;
-		}
-
-		char delim = csvee->dialect ? csvee->dialect->delimiter : CSVEE_SEPERATOR;
-		char quote = csvee->dialect ? csvee->dialect->quotechar : '"';
-		bool doublequote = csvee->dialect ? csvee->dialect->doublequote : true;
-		char lineterm = csvee->dialect ? csvee->dialect->lineterminator : '\n';
+		/* pick the codec from the extension, mirroring csvee_read_from_file */
+		CSVWriteOptions_t options = csvee_write_options_for(filename);
+		return csvee_write_to_file_opts(csvee, filename, &options);
+	}
 
-		for (size_t r = 0; r < csvee->count; ++r)
-		{
-			const CSVRow_t *row = &csvee->rows[r];
-			for (size_t c = 0; c < row->count; ++c)
-			{
-				CSVField_t field = row->fields[c];
-				char *s = csvee_field_to_string(&field);
-				bool need_quote = false;
-				if (s)
-				{
-					for (char *p = s; *p; ++p)
-					{
-						if (*p == delim || *p == quote || *p == '\n' || *p == '\r')
-						{
-							need_quote = true;
-							break;
-						}
-					}
-				}
+	bool csvee_write_to_file_opts(const Csvee_t *csvee, const char *filename, const CSVWriteOptions_t *options)
+	{
+		if (!csvee || !filename)
+			return false;
 
-				if (need_quote)
-					fputc(quote, file);
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
 
-				if (s)
-				{
-					if (need_quote && doublequote)
-					{
-						/* write with doubled quotes */
-						for (char *p = s; *p; ++p)
-						{
-							if (*p == quote)
-							{
-								fputc(quote, file);
-								fputc(quote, file);
-							}
-							else
-							{
-								fputc(*p, file);
-							}
-						}
-					}
-					else if (s)
-					{
-						fputs(s, file);
-					}
-					free(s);
-				}
+		CSVSink_t sink;
+		if (!csvee_sink_open(&sink, filename, options, &op))
+			return false;
 
-				if (need_quote)
-					fputc(quote, file);
+		char lineterm = csvee->dialect ? csvee->dialect->lineterminator : '\n';
+		bool ok = true;
 
-				if (c + 1 < row->count)
-					fputc(delim, file);
-			}
-			fputc(lineterm, file);
+		uint64_t start_ns = csvee_now_ns();
+		for (size_t r = 0; r < csvee->count && ok; ++r)
+		{
+			if (csvee_row_deleted(csvee, r))
+				continue;
+			const CSVRow_t *row = csvee_row_read(csvee, r);
+			ok = row && csvee_format_row(&sink.block, row, csvee->dialect, lineterm, &op);
+			if (ok && sink.block.size >= sink.block_size)
+				ok = csvee_sink_flush(&sink);
 		}
+		op.convert_ns = csvee_now_ns() - start_ns - op.io_ns - sink.waited_ns;
 
-		fclose(file);
-		return true;
+		ok = csvee_sink_close(&sink, ok);
+		csvee_stats_publish(&op);
+		return ok;
 	}
 
 	/* Serialize Csvee_t to a newly allocated string (caller must free). */
@@ -1869,205 +12429,189 @@ extern "C"
 		if (!csvee || !buffer || !count)
 			return;
 
-		size_t cap = 1024;
-		char *out = (char *)malloc(cap);
-		if (!out)
-			return;
-		size_t used = 0;
-
-		char delim = csvee->dialect ? csvee->dialect->delimiter : CSVEE_SEPERATOR;
-		char quote = csvee->dialect ? csvee->dialect->quotechar : '"';
-		bool doublequote = csvee->dialect ? csvee->dialect->doublequote : true;
+		CSVStat_t op;
+		memset(&op, 0, sizeof(op));
+		uint64_t start_ns = csvee_now_ns();
 
+		CSVBuffer_t out = {NULL, 0, 0};
 		for (size_t r = 0; r < csvee->count; ++r)
 		{
-			const CSVRow_t *row = &csvee->rows[r];
-			for (size_t c = 0; c < row->count; ++c)
-			{
-				CSVField_t field = row->fields[c];
-				char *s = csvee_field_to_string(&field);
-				bool need_quote = false;
-				if (s)
-				{
-					for (char *p = s; *p; ++p)
-					{
-						if (*p == delim || *p == quote || *p == '\n' || *p == '\r')
-						{
-							need_quote = true;
-							break;
-						}
-					}
-				}
-
-				if (need_quote)
-				{
-					if (used + 1 >= cap)
-					{
-						cap *= 2;
-						out = (char *)realloc(out, cap);
-					}
-					out[used++] = quote;
-				}
-
-				if (s)
-				{
-					for (char *p = s; *p; ++p)
-					{
-						if (need_quote && doublequote && *p == quote)
-						{
-							if (used + 2 >= cap)
-							{
-								cap *= 2;
-								out = (char *)realloc(out, cap);
-							}
-							out[used++] = quote;
-							out[used++] = quote;
-						}
-						else
-						{
-							if (used + 1 >= cap)
-							{
-								cap *= 2;
-								out = (char *)realloc(out, cap);
-							}
-							out[used++] = *p;
-						}
-					}
-					free(s);
-				}
-
-				if (need_quote)
-				{
-					if (used + 1 >= cap)
-					{
-						cap *= 2;
-						out = (char *)realloc(out, cap);
-					}
-					out[used++] = quote;
-				}
-
-				if (c + 1 < row->count)
-				{
-					if (used + 1 >= cap)
-					{
-						cap *= 2;
-						out = (char *)realloc(out, cap);
-					}
-					out[used++] = delim;
-				}
-			}
-			if (used + 1 >= cap)
+			if (csvee_row_deleted(csvee, r))
+				continue;
+			const CSVRow_t *row = csvee_row_read(csvee, r);
+			if (!row || !csvee_format_row(&out, row, csvee->dialect, '\n', &op))
 			{
-				cap *= 2;
-				out = (char *)realloc(out, cap);
+				csvee_buffer_free(&out);
+				return;
 			}
-			out[used++] = '\n';
 		}
 
-		if (used + 1 >= cap)
+		op.convert_ns = csvee_now_ns() - start_ns;
+		op.bytes_written = out.size;
+		csvee_stats_publish(&op);
+
+		if (!csvee_buffer_append(&out, "", 1))
 		{
-			cap = used + 1;
-			out = (char *)realloc(out, cap);
+			csvee_buffer_free(&out);
+			return;
 		}
-		out[used] = '\0';
-		*buffer = out;
-		*count = used;
+		*buffer = out.data;
+		*count = out.size - 1;
 	}
 
-	CsvIterator_t *csvee_csvee_iter_begin(const Csvee_t *csvee)
+	const CSVStat_t *csvee_get_stats(const Csvee_t *csvee)
 	{
-		CsvIterator_t *iter = (CsvIterator_t *)malloc(sizeof(CsvIterator_t));
-		if (!iter)
-			return NULL;
-		if (csvee == NULL || csvee->count == 0)
-		{
-			iter->ptr = NULL;
-		}
-		else
-		{
-			iter->ptr = &csvee->rows[0];
-		}
+		return csvee ? &csvee->stats : NULL;
+	}
+
+	void csvee_get_global_stats(CSVStat_t *stats)
+	{
+		if (!stats)
+			return;
+		const uint64_t *from = (const uint64_t *)&csvee_global_stat;
+		uint64_t *to = (uint64_t *)stats;
+		for (size_t i = 0; i < sizeof(CSVStat_t) / sizeof(uint64_t); ++i)
+			to[i] = CSVEE_ATOMIC_LOAD(&from[i]);
+	}
+
+	void csvee_reset_global_stats(void)
+	{
+		uint64_t *to = (uint64_t *)&csvee_global_stat;
+		for (size_t i = 0; i < sizeof(CSVStat_t) / sizeof(uint64_t); ++i)
+			CSVEE_ATOMIC_STORE(&to[i], (uint64_t)0);
+	}
+
+	/* Iterators are plain values; keep them on the stack, there is nothing to free. */
+	CsvIterator_t csvee_csvee_iter_begin(Csvee_t *csvee)
+	{
+		CsvIterator_t iter = {NULL, csvee};
+		size_t first = 0;
+		while (csvee && first < csvee->count && csvee_row_deleted(csvee, first))
+			++first;
+		if (csvee && first < csvee->count)
+			iter.ptr = &csvee->rows[first];
 		return iter;
 	};
 
-	CsvIterator_t *csvee_csvee_iter_end(const Csvee_t *csvee)
+	CsvIterator_t csvee_csvee_iter_end(Csvee_t *csvee)
 	{
-		(void)csvee;
-		CsvIterator_t *iter = (CsvIterator_t *)malloc(sizeof(CsvIterator_t));
-		if (!iter)
-			return NULL;
-		iter->ptr = NULL;
+		CsvIterator_t iter = {NULL, csvee};
 		return iter;
 	};
 
 	void csvee_csvee_iter_next(CsvIterator_t *csvee_iter)
 	{
-		if (csvee_iter == NULL)
+		if (csvee_iter == NULL || csvee_iter->ptr == NULL)
 			return;
-		if (csvee_iter->ptr != NULL)
-			csvee_iter->ptr++;
+		/* step over deleted rows; past the last row the iterator equals the end one */
+		const Csvee_t *csvee = csvee_iter->csvee;
+		size_t index = (size_t)(csvee_iter->ptr - csvee->rows) + 1;
+		while (index < csvee->count && csvee_row_deleted(csvee, index))
+			++index;
+		csvee_iter->ptr = index < csvee->count ? &csvee->rows[index] : NULL;
 	};
 
-	const CSVRow_t *csvee_csvee_iter_peek(CsvIterator_t *csvee_iter)
+	const CSVRow_t *csvee_csvee_iter_peek(const CsvIterator_t *csvee_iter)
 	{
 		if (csvee_iter == NULL || csvee_iter->ptr == NULL)
 			return NULL;
+		if (csvee_iter->csvee && (csvee_iter->csvee->spill || csvee_iter->csvee->lazy))
+			return csvee_row_at(csvee_iter->csvee, (size_t)(csvee_iter->ptr - csvee_iter->csvee->rows));
 		return csvee_iter->ptr;
 	};
 
-	bool csvee_csvee_iter_equal(CsvIterator_t *begin_iter, CsvIterator_t *end_iter)
+	bool csvee_csvee_iter_equal(const CsvIterator_t *begin_iter, const CsvIterator_t *end_iter)
 	{
 		return (begin_iter->ptr == end_iter->ptr);
 	};
 
-	RowIterator_t *csvee_row_iter_begin(const CSVRow_t *row)
+	RowIterator_t csvee_row_iter_begin(const CSVRow_t *row)
 	{
-		RowIterator_t *iter = (RowIterator_t *)malloc(sizeof(RowIterator_t));
-		if (!iter)
-			return NULL;
-		if (row == NULL || row->count == 0)
-		{
-			iter->ptr = NULL;
-		}
-		else
+		RowIterator_t iter = {NULL, NULL};
+		if (row != NULL && row->count != 0)
 		{
-			iter->ptr = &row->fields[0];
+			iter.ptr = &row->fields[0];
+			iter.end = &row->fields[row->count];
 		}
 		return iter;
 	};
 
-	RowIterator_t *csvee_row_iter_end(const CSVRow_t *row)
+	RowIterator_t csvee_row_iter_end(const CSVRow_t *row)
 	{
 		(void)row;
-		RowIterator_t *iter = (RowIterator_t *)malloc(sizeof(RowIterator_t));
-		if (!iter)
-			return NULL;
-		iter->ptr = NULL;
+		RowIterator_t iter = {NULL, NULL};
 		return iter;
 	};
 
 	void csvee_row_iter_next(RowIterator_t *row_iter)
 	{
-		if (row_iter == NULL)
-		{
+		if (row_iter == NULL || row_iter->ptr == NULL)
 			return;
-		}
-		if (row_iter->ptr != NULL)
-			row_iter->ptr++;
+		/* past the last field the iterator equals the end one */
+		if (++row_iter->ptr == row_iter->end)
+			row_iter->ptr = NULL;
 	};
 
-	const CSVField_t *csvee_row_iter_peek(RowIterator_t *row_iter)
+	const CSVField_t *csvee_row_iter_peek(const RowIterator_t *row_iter)
 	{
 		if (row_iter == NULL || row_iter->ptr == NULL)
 			return NULL;
 		return row_iter->ptr;
 	};
 
-	bool csvee_row_iter_equal(RowIterator_t *begin_iter, RowIterator_t *end_iter)
+	bool csvee_row_iter_equal(const RowIterator_t *begin_iter, const RowIterator_t *end_iter)
 	{
 		return (begin_iter->ptr == end_iter->ptr);
 	};
 
+	/*
+	 * Up to @p n adjacent rows from 0-based @p first, clamped to the end of the
+	 * table. Deleted rows are in the span with no fields. A table with a memory
+	 * budget only keeps one spill block resident for the span, and a lazy table
+	 * builds the rows first, so the span may be shorter than asked for; call
+	 * again from first + count for the rest.
+	 */
+	CSVRowSpan_t csvee_rows_span(Csvee_t *csvee, size_t first, size_t n)
+	{
+		CSVRowSpan_t span = {NULL, 0};
+		if (!csvee || first >= csvee->count)
+			return span;
+		if (n > csvee->count - first)
+			n = csvee->count - first;
+		if (csvee->spill)
+		{
+			size_t left = CSVEE_SPILL_BLOCK_ROWS - first % CSVEE_SPILL_BLOCK_ROWS;
+			if (n > left)
+				n = left;
+		}
+		if (csvee->spill || csvee->lazy)
+		{
+			/* page the block in, then build the lazy rows it covers */
+			for (size_t r = first; r < first + n; ++r)
+				if (!csvee_row_at(csvee, r))
+				{
+					if (r == first)
+						return span;
+					n = r - first;
+					break;
+				}
+		}
+		span.rows = &csvee->rows[first];
+		span.count = n;
+		return span;
+	}
+
+	CSVFieldSpan_t csvee_fields_span(const CSVRow_t *row)
+	{
+		CSVFieldSpan_t span = {NULL, 0};
+		if (row && row->count)
+		{
+			span.fields = row->fields;
+			span.count = row->count;
+		}
+		return span;
+	}
+
 	char *csvee_row_to_string(CSVRow_t *row) {};
 
 	char *csvee_field_to_string(CSVField_t *field)
@@ -2140,6 +12684,10 @@ extern "C"
 			CASEFY_ERROR(VALUE_NULL);
 
 			CASEFY_ERROR(WRONG_CAST);
+
+			CASEFY_ERROR(IO_ERROR);
+			CASEFY_ERROR(PARSE_ERROR);
+			CASEFY_ERROR(OUT_OF_MEMORY);
 		}
 		return "";
 	};
@@ -2157,21 +12705,17 @@ extern "C"
 namespace csvee
 {
 
-	CSVDialect::CSVDialect(CSVDialect *dialect) {
+	CSVDialect::CSVDialect(CSVDialect *dialect)
+		: m_Dialect(dialect->m_Dialect) {};
 
-	};
-
-	CSVDialect::CSVDialect(CSVDialect &dialect) {
-
-	};
+	CSVDialect::CSVDialect(CSVDialect &dialect)
+		: m_Dialect(dialect.m_Dialect) {};
 
-	CSVDialect::CSVDialect(CSVDialect_t dialect) {
+	CSVDialect::CSVDialect(CSVDialect_t dialect)
+		: m_Dialect(dialect) {};
 
-	};
-
-	CSVDialect::CSVDialect(CSVDialect_t *dialect) {
-
-	};
+	CSVDialect::CSVDialect(CSVDialect_t *dialect)
+		: m_Dialect(*dialect) {};
 
 	CSVDialect::CSVDialect(char *name, char delimiter, char quotechar, char lineterminator, bool doublequote, bool skipwhitespace, CSVQuote_t quoting)
 	{
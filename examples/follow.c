@@ -0,0 +1,59 @@
+#define CSVEE_IMPLEMENTATION
+#include "../csvee.h"
+#include <stdio.h>
+
+static bool print_row(void *user, CSVRow_t *row)
+{
+    size_t *seen = (size_t *)user;
+    for (size_t c = 0; c < row->count; ++c)
+        printf("%s%s", c ? " | " : "", row->fields[c].value._string);
+    printf("\n");
+    fflush(stdout);
+
+    csvee_row_free(row);
+    ++*seen;
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    const char *fname = argc > 1 ? argv[1] : "../csv/example.csv";
+    size_t seen = 0;
+
+    CSVFollow_t follow;
+    if (!csvee_follow_open(&follow, fname, 0, print_row, &seen))
+    {
+        fprintf(stderr, "failed to open %s\n", fname);
+        return 1;
+    }
+
+    // Prints the existing rows, then every row appended later (Ctrl-C to quit)
+    bool ok = csvee_follow_run(&follow);
+
+    csvee_follow_close(&follow);
+    return ok ? 0 : 1;
+}
+
+/**
+ * LICENSE: Public Domain (www.unlicense.org)
+ *
+ * Copyright (c) 2025 Sackey Ezekiel Etrue
+ *
+ * This is free and unencumbered software released into the public domain.
+ * Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+ * software, either in source code form or as a compiled binary, for any purpose,
+ * commercial or non-commercial, and by any means.
+ * In jurisdictions that recognize copyright laws, the author or authors of this
+ * software dedicate any and all copyright interest in the software to the public
+ * domain. We make this dedication for the benefit of the public at large and to
+ * the detriment of our heirs and successors. We intend this dedication to be an
+ * overt act of relinquishment in perpetuity of all present and future rights to
+ * this software under copyright law.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
\ No newline at end of file
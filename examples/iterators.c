@@ -13,12 +13,14 @@ int main(int argc, char const *argv[])
         return 1;
     }
 
-    for (CsvIterator_t *ci = csvee_csvee_iter_begin(csv); ci != csvee_csvee_iter_end(csv); csvee_csvee_iter_next(ci))
+    CsvIterator_t end = csvee_csvee_iter_end(csv);
+    for (CsvIterator_t ci = csvee_csvee_iter_begin(csv); !csvee_csvee_iter_equal(&ci, &end); csvee_csvee_iter_next(&ci))
     {
-        CSVRow_t *row = csvee_csvee_iter_peek(ci);
-        for (RowIterator_t *ri = csvee_row_iter_begin(row); ri != csvee_row_iter_end(row); csvee_row_iter_next(ri))
+        const CSVRow_t *row = csvee_csvee_iter_peek(&ci);
+        RowIterator_t row_end = csvee_row_iter_end(row);
+        for (RowIterator_t ri = csvee_row_iter_begin(row); !csvee_row_iter_equal(&ri, &row_end); csvee_row_iter_next(&ri))
         {
-            char *s = csvee_field_to_string(csvee_row_iter_peek(ri));
+            char *s = csvee_field_to_string((CSVField_t *)csvee_row_iter_peek(&ri));
             if (s)
             {
                 printf("%s\n", s);
@@ -27,6 +29,19 @@ int main(int argc, char const *argv[])
         }
     }
 
+    /* the same walk over spans, no iterator state at all */
+    size_t fields = 0;
+    for (CSVRowSpan_t span = csvee_rows_span(csv, 0, SIZE_MAX); span.count; span = csvee_rows_span(csv, (size_t)(span.rows - csv->rows) + span.count, SIZE_MAX))
+    {
+        for (size_t r = 0; r < span.count; ++r)
+        {
+            CSVFieldSpan_t row = csvee_fields_span(&span.rows[r]);
+            for (size_t c = 0; c < row.count; ++c)
+                fields += row.fields[c].type == CSVEE_STRING;
+        }
+    }
+    printf("%zu string fields\n", fields);
+
     csvee_free(csv);
     return 0;
 }
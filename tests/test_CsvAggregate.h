@@ -0,0 +1,113 @@
+#include <assert.h>
+
+#define TEST_SALES "name,region,amount\nann,east,10\nbob,west,5\ncid,east,2.5\ndan,west,x\neve,north,7\nann,east,1\n"
+
+static void test_aggregate_input(const char *path, const char *text)
+{
+    Csvee_t *input = csvee_read_from_string(text);
+    assert(input != NULL);
+    assert(csvee_write_to_file(input, path));
+    csvee_free(input);
+}
+
+static void test_aggregate_expect(const char *path, const char *expected)
+{
+    Csvee_t *output = csvee_read_from_file(path);
+    assert(output != NULL);
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(output, &text, &size);
+    assert(strcmp(text, expected) == 0);
+    free(text);
+    csvee_free(output);
+}
+
+void test_group_file()
+{
+    test_aggregate_input("test_group_in.csv", TEST_SALES);
+
+    size_t by[] = {1};
+    CSVAggregate_t aggs[] = {
+        {0, CSVEE_AGG_COUNT},
+        {2, CSVEE_AGG_SUM},
+        {2, CSVEE_AGG_MIN},
+        {2, CSVEE_AGG_MEAN},
+        {0, CSVEE_AGG_COUNT_DISTINCT},
+    };
+    assert(csvee_group_file("test_group_in.csv", "test_group_out.csv", by, 1, aggs, 5, true, 0, 2));
+    test_aggregate_expect("test_group_out.csv",
+                          "region,count,sum(amount),min(amount),mean(amount),count_distinct(name)\n"
+                          "east,3,13.5,1,4.5,2\n"
+                          "north,1,7,7,7,1\n"
+                          "west,2,5,5,5,2\n");
+
+    /* a tiny memory limit partitions the groups, the totals stay the same */
+    assert(csvee_group_file("test_group_in.csv", "test_group_out.csv", by, 1, aggs, 2, true, 1, 1));
+    Csvee_t *output = csvee_read_from_file("test_group_out.csv");
+    assert(output != NULL && output->count == 4);
+    csvee_free(output);
+
+    remove("test_group_in.csv");
+    remove("test_group_out.csv");
+};
+
+void test_join_file()
+{
+    test_aggregate_input("test_join_left.csv", TEST_SALES);
+    test_aggregate_input("test_join_right.csv", "region,manager\neast,Ed\nwest,Wu\nsouth,Sy\n");
+
+    assert(csvee_join("test_join_left.csv", "test_join_right.csv", 1, 0, CSVEE_JOIN_INNER, "test_join_out.csv", true, 0, 2));
+    test_aggregate_expect("test_join_out.csv",
+                          "name,region,amount,region,manager\n"
+                          "ann,east,10,east,Ed\nbob,west,5,west,Wu\ncid,east,2.5,east,Ed\ndan,west,x,west,Wu\nann,east,1,east,Ed\n");
+
+    assert(csvee_join("test_join_left.csv", "test_join_right.csv", 1, 0, CSVEE_JOIN_LEFT, "test_join_out.csv", true, 0, 1));
+    test_aggregate_expect("test_join_out.csv",
+                          "name,region,amount,region,manager\n"
+                          "ann,east,10,east,Ed\nbob,west,5,west,Wu\ncid,east,2.5,east,Ed\ndan,west,x,west,Wu\neve,north,7,,\nann,east,1,east,Ed\n");
+
+    assert(csvee_join("test_join_left.csv", "test_join_right.csv", 1, 0, CSVEE_JOIN_SEMI, "test_join_out.csv", true, 0, 2));
+    test_aggregate_expect("test_join_out.csv", "name,region,amount\nann,east,10\nbob,west,5\ncid,east,2.5\ndan,west,x\nann,east,1\n");
+
+    assert(csvee_join("test_join_left.csv", "test_join_right.csv", 1, 0, CSVEE_JOIN_ANTI, "test_join_out.csv", true, 0, 2));
+    test_aggregate_expect("test_join_out.csv", "name,region,amount\neve,north,7\n");
+
+    /* a build side over the memory limit goes through partitions */
+    assert(csvee_join("test_join_left.csv", "test_join_right.csv", 1, 0, CSVEE_JOIN_INNER, "test_join_out.csv", true, 1, 1));
+    Csvee_t *output = csvee_read_from_file("test_join_out.csv");
+    assert(output != NULL && output->count == 6);
+    csvee_free(output);
+
+    remove("test_join_left.csv");
+    remove("test_join_right.csv");
+    remove("test_join_out.csv");
+};
+
+void test_dedup_file()
+{
+    test_aggregate_input("test_dedup_in.csv", TEST_SALES);
+
+    size_t key[] = {0};
+    assert(csvee_dedup_file("test_dedup_in.csv", "test_dedup_out.csv", key, 1, CSVEE_KEEP_FIRST, true, 0));
+    test_aggregate_expect("test_dedup_out.csv", "name,region,amount\nann,east,10\nbob,west,5\ncid,east,2.5\ndan,west,x\neve,north,7\n");
+
+    assert(csvee_dedup_file("test_dedup_in.csv", "test_dedup_out.csv", key, 1, CSVEE_KEEP_LAST, true, 0));
+    test_aggregate_expect("test_dedup_out.csv", "name,region,amount\nbob,west,5\ncid,east,2.5\ndan,west,x\neve,north,7\nann,east,1\n");
+
+    /* a key of two columns; without a header the first record is just another one */
+    size_t pair[] = {1, 0};
+    assert(csvee_dedup_file("test_dedup_in.csv", "test_dedup_out.csv", pair, 2, CSVEE_KEEP_FIRST, false, 0));
+    test_aggregate_expect("test_dedup_out.csv", "name,region,amount\nann,east,10\nbob,west,5\ncid,east,2.5\ndan,west,x\neve,north,7\n");
+
+    remove("test_dedup_in.csv");
+    remove("test_dedup_out.csv");
+};
+
+void test_aggregate()
+{
+    test_group_file();
+    test_join_file();
+    test_dedup_file();
+
+    printf("All Aggregate Test Passed\n");
+};
@@ -0,0 +1,68 @@
+#include <assert.h>
+
+#define TEST_ARROW "id,price,flag,name\n1,2.5,true,ann\n2,,false,\n3,4,TRUE,\"c, d\"\n"
+
+void test_arrow_export()
+{
+    Csvee_t *table = csvee_read_from_string(TEST_ARROW);
+    assert(table != NULL);
+
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    assert(csvee_export_arrow(table, true, &schema, &array));
+    csvee_free(table);
+
+    /* a struct array with one child per column, the layout of a record batch */
+    assert(strcmp(schema.format, "+s") == 0);
+    assert(schema.n_children == 4 && array.n_children == 4);
+    assert(array.length == 3);
+    assert(strcmp(schema.children[0]->name, "id") == 0);
+    assert(strcmp(schema.children[0]->format, "l") == 0);
+    assert(strcmp(schema.children[1]->format, "g") == 0);
+    assert(strcmp(schema.children[2]->format, "b") == 0);
+    assert(strcmp(schema.children[3]->format, "u") == 0);
+
+    const int64_t *ids = (const int64_t *)array.children[0]->buffers[1];
+    assert(ids[0] == 1 && ids[2] == 3);
+
+    const struct ArrowArray *price = array.children[1];
+    assert(price->null_count == 1);
+    assert(((const double *)price->buffers[1])[2] == 4.0);
+
+    const struct ArrowArray *name = array.children[3];
+    const int32_t *offsets = (const int32_t *)name->buffers[1];
+    const char *data = (const char *)name->buffers[2];
+    assert(name->null_count == 1);
+    assert(offsets[3] - offsets[2] == 4 && strncmp(data + offsets[2], "c, d", 4) == 0);
+
+    array.release(&array);
+    schema.release(&schema);
+    assert(array.release == NULL && schema.release == NULL);
+};
+
+void test_arrow_read()
+{
+    Csvee_t *table = csvee_read_from_string(TEST_ARROW);
+    assert(csvee_write_to_file(table, "test_arrow.csv"));
+    csvee_free(table);
+
+    /* without a header every record is data, so no column is a number */
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    assert(csvee_read_arrow("test_arrow.csv", false, &schema, &array));
+    assert(array.length == 4);
+    assert(strcmp(schema.children[0]->format, "u") == 0);
+    array.release(&array);
+    schema.release(&schema);
+
+    assert(!csvee_read_arrow("test_arrow_missing.csv", true, &schema, &array));
+    remove("test_arrow.csv");
+};
+
+void test_arrow()
+{
+    test_arrow_export();
+    test_arrow_read();
+
+    printf("All Arrow Test Passed\n");
+};
@@ -0,0 +1,126 @@
+#include <assert.h>
+
+#define TEST_TRADES "id,symbol,price,note\n1,ABC,10.50,\n2,XYZ,9.25,\"big, late\"\n3,ABC,,split\n4,QQQ,100.00,\n5,XYZ,7.75,\"said \"\"hi\"\"\"\n"
+
+/* TEST_TRADES in the columnar format, two records per row group so the last group is a short one. */
+static void test_columnar_file(const char *path)
+{
+    Csvee_t *input = csvee_read_from_string(TEST_TRADES);
+    assert(input != NULL);
+    assert(csvee_write_to_file(input, "test_columnar_in.csv"));
+    csvee_free(input);
+
+    assert(csvee_columnar_from_csv("test_columnar_in.csv", path, true, 2));
+    remove("test_columnar_in.csv");
+}
+
+static char *test_columnar_text(const Csvee_t *table)
+{
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    assert(text != NULL);
+    return text;
+}
+
+void test_columnar_round_trip()
+{
+    test_columnar_file("test_columnar.csvc");
+
+    Csvee_t *table = csvee_columnar_read("test_columnar.csvc", NULL);
+    assert(table != NULL);
+    assert(table->count == 6);
+    char *text = test_columnar_text(table);
+    assert(strcmp(text, TEST_TRADES) == 0);
+    free(text);
+    csvee_free(table);
+
+    remove("test_columnar.csvc");
+};
+
+void test_columnar_query()
+{
+    test_columnar_file("test_columnar.csvc");
+
+    /* numbers compare as numbers, and an empty price never matches */
+    size_t columns[] = {1, 0};
+    CSVPredicate_t where[] = {{2, CSVEE_CMP_GE, "9.25"}};
+    CSVColumnarQuery_t query = {columns, 2, where, 1};
+    Csvee_t *table = csvee_columnar_read("test_columnar.csvc", &query);
+    assert(table != NULL);
+    char *text = test_columnar_text(table);
+    assert(strcmp(text, "symbol,id\nABC,1\nXYZ,2\nQQQ,4\n") == 0);
+    free(text);
+    csvee_free(table);
+
+    CSVPredicate_t both[] = {{1, CSVEE_CMP_EQ, "XYZ"}, {2, CSVEE_CMP_LT, "9"}};
+    CSVColumnarQuery_t narrow = {NULL, 0, both, 2};
+    table = csvee_columnar_read("test_columnar.csvc", &narrow);
+    assert(table != NULL);
+    text = test_columnar_text(table);
+    assert(strcmp(text, "id,symbol,price,note\n5,XYZ,7.75,\"said \"\"hi\"\"\"\n") == 0);
+    free(text);
+    csvee_free(table);
+
+    remove("test_columnar.csvc");
+};
+
+void test_columnar_damaged()
+{
+    test_columnar_file("test_columnar.csvc");
+
+    FILE *file = fopen("test_columnar.csvc", "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *bytes = (unsigned char *)malloc((size_t)size);
+    assert(bytes != NULL);
+    assert(fread(bytes, 1, (size_t)size, file) == (size_t)size);
+    fclose(file);
+
+    /* every truncation fails cleanly instead of reading past the file */
+    for (long cut = 0; cut < size; ++cut)
+    {
+        file = fopen("test_columnar_bad.csvc", "wb");
+        assert(file != NULL);
+        fwrite(bytes, 1, (size_t)cut, file);
+        fclose(file);
+        assert(csvee_columnar_read("test_columnar_bad.csvc", NULL) == NULL);
+    }
+
+    /* and so does any single flipped byte in the footer or a chunk header */
+    unsigned state = 1;
+    for (int round = 0; round < 200; ++round)
+    {
+        state = state * 1103515245u + 12345u;
+        long at = (long)((state >> 8) % (unsigned)size);
+        bytes[at] ^= (unsigned char)(1 + (state >> 24) % 255);
+        file = fopen("test_columnar_bad.csvc", "wb");
+        assert(file != NULL);
+        fwrite(bytes, 1, (size_t)size, file);
+        fclose(file);
+        Csvee_t *table = csvee_columnar_read("test_columnar_bad.csvc", NULL);
+        if (table)
+            csvee_free(table);
+        bytes[at] ^= (unsigned char)(1 + (state >> 24) % 255);
+    }
+    free(bytes);
+
+    Csvee_t *input = csvee_read_from_string(TEST_TRADES);
+    assert(csvee_write_to_file(input, "test_columnar_bad.csvc"));
+    csvee_free(input);
+    assert(csvee_columnar_read("test_columnar_bad.csvc", NULL) == NULL);
+
+    remove("test_columnar_bad.csvc");
+    remove("test_columnar.csvc");
+};
+
+void test_columnar()
+{
+    test_columnar_round_trip();
+    test_columnar_query();
+    test_columnar_damaged();
+
+    printf("All Columnar Test Passed\n");
+};
@@ -1,54 +1,52 @@
-#include "../csvee.h"
 #include <assert.h>
 
-// void csvee_print_field(const CsvField *field);
-
 void test_field_intailization()
 {
-    CsvField field = csvee_create_field("hello");
-    assert(field.value != NULL);
-    assert(strcmp(field.value, "hello") == 0);
-
-    csvee_free_field(&field);
-    // assert(field.value == NULL); //
+    CSVField_t field = csvee_create_field("hello");
+    assert(field.type == CSVEE_STRING);
+    assert(field.value._string != NULL);
+    assert(strcmp(field.value._string, "hello") == 0);
+
+    csvee_field_free(&field);
+    assert(field.value._string == NULL);
+    assert(field.type == CSVEE_NULL);
+
+    CSVField_t part = csvee_create_field_n("Sackey Ezekiel", 6);
+    assert(strcmp(part.value._string, "Sackey") == 0);
+    csvee_field_free(&part);
 };
 
 void test_field_convention()
 {
-    CsvField fname = csvee_create_field("Sackey Ezekiel");
-    CsvField fage = csvee_create_field("20");
-    CsvField fweight = csvee_create_field("63.5");
-    CsvField fis_student = csvee_create_field("1");
+    CSVField_t fname = csvee_create_field("Sackey Ezekiel");
+    CSVField_t fage = csvee_create_field("20");
 
-    char *name = csv_field_to_string(&fname);
+    char *name = csvee_field_to_string(&fname);
     assert(name != NULL);
     assert(strcmp(name, "Sackey Ezekiel") == 0);
 
-    int age = csv_field_to_integer(&fage);
-    assert(age == 20);
+    char *age = csvee_field_to_string(&fage);
+    assert(strcmp(age, "20") == 0);
 
-    double weight = csv_field_to_double(&fweight);
-    assert(weight == 63.5);
-
-    int is_student = csv_field_to_boolean(&fis_student);
-    assert(is_student == 1);
+    free(name);
+    free(age);
+    csvee_field_free(&fname);
+    csvee_field_free(&fage);
 };
 
 void test_field_operators()
 {
-    CsvField name = csvee_create_field("Sackey");
-    CsvField name2 = csvee_create_field("Ezekiel");
-    assert(!csvee_field_equal(&name, &name2));
-
-    CsvField name3 = csvee_create_field("Sackey");
-    assert(csvee_field_equal(&name, &name3));
+    CSVField_t name = csvee_create_field("Sackey");
+    CSVField_t name2 = csvee_create_field("Ezekiel");
+    CSVField_t name3 = csvee_create_field("Sackey");
 
-    CsvField age = csvee_create_field("20");
-    CsvField age2 = csvee_create_field("1");
-    assert(!csvee_field_equal(&age, &age2));
+    assert(strcmp(name.value._string, name2.value._string) != 0);
+    assert(strcmp(name.value._string, name3.value._string) == 0);
+    assert(name.value._string != name3.value._string);
 
-    CsvField age3 = csvee_create_field("20");
-    assert(csvee_field_equal(&age, &age3));
+    csvee_field_free(&name);
+    csvee_field_free(&name2);
+    csvee_field_free(&name3);
 };
 
 void test_field()
@@ -1,113 +1,184 @@
-#include "../csvee.h"
 #include <assert.h>
 
-// Csvee csvee_create_csv();
-// Csvee csvee_copy_csv(const Csvee *file);
-// void csvee_print_csv(const Csvee *file);
-// void csvee_free_csv(Csvee *file);
-
 void test_file_intailization()
 {
-    // Create a CSV file with 5 rows
-    Csvee file = csvee_create_csv();
-    assert(file.rows != NULL);
-    assert(file.count == 0);
-    assert(file.size == 5);
-
-    csvee_free_csv(&file);
-    // assert(file.rows == NULL); //
-    assert(file.count == 0);
-    assert(file.size == 0);
+    Csvee_t *file = csvee_new(',');
+    assert(file != NULL);
+    assert(file->count == 0);
+    assert(file->dialect->delimiter == ',');
+    csvee_free(file);
+
+    file = csvee_read_from_string("Name,Age\nSackey,20\n");
+    assert(file != NULL);
+    assert(file->count == 2);
+    assert(strcmp(file->rows[1].fields[0].value._string, "Sackey") == 0);
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(file, &text, &size);
+    assert(size == strlen("Name,Age\nSackey,20\n"));
+    assert(strcmp(text, "Name,Age\nSackey,20\n") == 0);
+
+    free(text);
+    csvee_free(file);
 };
 
-void test_file_row_operations()
+void test_file_read_write()
 {
-    Csvee file = csvee_create_csv();
-
-    // Create the first row with 3 fields
-    file.rows[0] = csvee_create_row(3);
-    file.rows[0].fields[0] = csvee_create_field("Name");
-    file.rows[0].fields[1] = csvee_create_field("Age");
-    file.rows[0].fields[2] = csvee_create_field("Occupation");
-    file.count++;
-
-    assert(file.rows[0].fields[0].value != NULL);
-    assert(strcmp(file.rows[0].fields[0].value, "Name") == 0);
-
-    assert(file.rows[0].fields[1].value != NULL);
-    assert(strcmp(file.rows[0].fields[1].value, "Age") == 0);
-
-    assert(file.rows[0].fields[2].value != NULL);
-    assert(strcmp(file.rows[0].fields[2].value, "Occupation") == 0);
-
-    csvee_add_row(&file, 3, "Sackey", "20", "Software Engineer");
-    // assert(csvee_row_exist(&file, 2));
-
-    assert(file.rows[1].fields[0].value != NULL);
-    assert(strcmp(file.rows[1].fields[0].value, "Sackey") == 0);
-
-    assert(file.rows[1].fields[1].value != NULL);
-    assert(strcmp(file.rows[1].fields[1].value, "20") == 0);
-
-    assert(file.rows[1].fields[2].value != NULL);
-    assert(strcmp(file.rows[1].fields[2].value, "Software Engineer") == 0);
-
-    csvee_update_row(&file, 2, 3, "Ezekiel", "19", "Computer Scientist");
-
-    assert(strcmp(file.rows[1].fields[0].value, "Ezekiel") == 0);
-    assert(strcmp(file.rows[1].fields[1].value, "19") == 0);
-    assert(strcmp(file.rows[1].fields[2].value, "Computer Scientist") == 0);
-
-    // csvee_delete_row(&file, 2);//
-    // assert(file.rows[1].fields[0].value == NULL);
-    // assert(file.rows[1].fields[1].value == NULL);
-    // assert(file.rows[1].fields[2].value == NULL);
-
-    assert(csvee_row_exist(&file, 1));
-    // assert(!csvee_row_exist(&file, 2));
-
-    // CsvRow csvee_get_row(Csvee *csvee, size_t row);
-    // void csvee_print_row(const CsvRow *row);
+    Csvee_t *file = csvee_read_from_string("Name,Note\nSackey,\"a, \"\"b\"\"\"\nEzekiel,\n");
+    assert(file != NULL);
+    assert(csvee_write_to_file(file, "test_file.csv"));
+    csvee_free(file);
+
+    file = csvee_read_from_file("test_file.csv");
+    assert(file != NULL);
+    assert(file->count == 3);
+
+    CSVRow_t row = csvee_get_row(file, 2);
+    assert(row.count == 2);
+    assert(strcmp(row.fields[1].value._string, "a, \"b\"") == 0);
+    csvee_row_free(&row);
+
+    row = csvee_get_row(file, 3);
+    assert(row.count == 2);
+    assert(strcmp(row.fields[1].value._string, "") == 0);
+    csvee_row_free(&row);
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(file, &text, &size);
+    assert(strcmp(text, "Name,Note\nSackey,\"a, \"\"b\"\"\"\nEzekiel,\n") == 0);
+    free(text);
+    csvee_free(file);
+
+    assert(csvee_read_from_file("test_missing.csv") == NULL);
+    remove("test_file.csv");
+};
 
-    csvee_free_csv(&file);
+void test_file_row_operations()
+{
+    Csvee_t *file = csvee_new(',');
+
+    assert(csvee_add_row(file, 3, "Name", "Age", "Occupation"));
+    assert(strcmp(file->rows[0].fields[0].value._string, "Name") == 0);
+    assert(strcmp(file->rows[0].fields[1].value._string, "Age") == 0);
+    assert(strcmp(file->rows[0].fields[2].value._string, "Occupation") == 0);
+
+    assert(csvee_add_row(file, 3, "Sackey", "20", "Software Engineer"));
+    assert(file->count == 2);
+
+    CSVRow_t row = csvee_get_row(file, 2);
+    assert(row.count == 3);
+    assert(strcmp(row.fields[0].value._string, "Sackey") == 0);
+    assert(strcmp(row.fields[2].value._string, "Software Engineer") == 0);
+    csvee_row_free(&row);
+
+    assert(csvee_update_row(file, 2, 3, "Ezekiel", "19", "Computer Scientist"));
+    assert(strcmp(file->rows[1].fields[0].value._string, "Ezekiel") == 0);
+    assert(strcmp(file->rows[1].fields[1].value._string, "19") == 0);
+    assert(strcmp(file->rows[1].fields[2].value._string, "Computer Scientist") == 0);
+    assert(!csvee_update_row(file, 3, 1, "missing"));
+
+    assert(csvee_delete_row(file, 2));
+    assert(csvee_row_deleted(file, 1));
+    assert(!csvee_row_deleted(file, 0));
+    assert(!csvee_delete_row(file, 2));
+    assert(file->count == 2);
+
+    csvee_free(file);
 };
 
 void test_file_field_operations()
 {
-    Csvee file = csvee_create_csv();
+    Csvee_t *file = csvee_new(',');
+    assert(csvee_add_row(file, 3, "Name", "Age", "Occupation"));
 
-    // Create the first row with 3 fields
-    file.rows[0] = csvee_create_row(3);
-    file.rows[0].fields[0] = csvee_create_field("Name");
-    file.rows[0].fields[1] = csvee_create_field("Age");
-    file.rows[0].fields[2] = csvee_create_field("Occupation");
-    file.count++;
+    assert(csvee_update_field(file, 1, 3, "Major"));
+    assert(strcmp(file->rows[0].fields[2].value._string, "Major") == 0);
 
-    assert(file.rows[0].fields[0].value != NULL);
-    assert(strcmp(file.rows[0].fields[0].value, "Name") == 0);
+    /* a field past the end pads the row with empty ones */
+    assert(csvee_update_field(file, 1, 5, "Year"));
+    assert(file->rows[0].count == 5);
+    assert(strcmp(file->rows[0].fields[3].value._string, "") == 0);
+    assert(strcmp(file->rows[0].fields[4].value._string, "Year") == 0);
 
-    assert(file.rows[0].fields[1].value != NULL);
-    assert(strcmp(file.rows[0].fields[1].value, "Age") == 0);
+    assert(!csvee_update_field(file, 2, 1, "missing"));
+    assert(!csvee_update_field(file, 1, 0, "missing"));
 
-    assert(file.rows[0].fields[2].value != NULL);
-    assert(strcmp(file.rows[0].fields[2].value, "Occupation") == 0);
-
-    csvee_update_field(&file, 1, 3, "Major");
-    assert(strcmp(file.rows[0].fields[2].value, "Major") == 0);
-
-    assert(csvee_field_exist(&file, 1, 1));
-    assert(!csvee_field_exist(&file, 1, 5));
+    csvee_free(file);
+};
 
-    csvee_delete_field(&file, 1, 3);
-    assert(!csvee_field_exist(&file, 1, 3));
+void test_file_purge()
+{
+    Csvee_t *file = csvee_new(',');
+    CSVRow_t rows[5];
+    char value[8];
+    for (size_t r = 0; r < 5; ++r)
+    {
+        rows[r] = csvee_create_row(1);
+        snprintf(value, sizeof(value), "%zu", r + 1);
+        rows[r].fields[0] = csvee_create_field(value);
+    }
+    assert(csvee_add_rows(file, rows, 5));
+    assert(file->count == 5);
+
+    /* row numbers stay put until the purge */
+    assert(csvee_delete_row(file, 2));
+    assert(csvee_delete_row(file, 4));
+    CSVRow_t row = csvee_get_row(file, 5);
+    assert(strcmp(row.fields[0].value._string, "5") == 0);
+    csvee_row_free(&row);
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(file, &text, &size);
+    assert(strcmp(text, "1\n3\n5\n") == 0);
+    free(text);
+
+    assert(csvee_purge(file));
+    assert(file->count == 3);
+    assert(!csvee_row_deleted(file, 1));
+    row = csvee_get_row(file, 3);
+    assert(strcmp(row.fields[0].value._string, "5") == 0);
+    csvee_row_free(&row);
+
+    csvee_free(file);
+};
 
-    csvee_free_csv(&file);
+void test_file_iterators()
+{
+    Csvee_t *file = csvee_read_from_string("a,1\nb,2\nc,3\nd,4\n");
+    assert(csvee_delete_row(file, 2));
+
+    /* a deleted row has no fields, the iterators skip it */
+    size_t seen = 0;
+    CsvIterator_t end = csvee_csvee_iter_end(file);
+    for (CsvIterator_t it = csvee_csvee_iter_begin(file); !csvee_csvee_iter_equal(&it, &end); csvee_csvee_iter_next(&it))
+    {
+        const CSVRow_t *row = csvee_csvee_iter_peek(&it);
+        assert(row->count == 2);
+        assert(strcmp(row->fields[0].value._string, "b") != 0);
+        ++seen;
+    }
+    assert(seen == 3);
+
+    CSVRowSpan_t span = csvee_rows_span(file, 1, 2);
+    assert(span.count == 2);
+    assert(span.rows == &file->rows[1]);
+    assert(csvee_fields_span(&span.rows[0]).count == 0);
+    assert(csvee_fields_span(&span.rows[1]).count == 2);
+    assert(csvee_rows_span(file, 4, 1).count == 0);
+
+    csvee_free(file);
 };
 
 void test_file()
 {
     test_file_intailization();
+    test_file_read_write();
     test_file_row_operations();
     test_file_field_operations();
+    test_file_purge();
+    test_file_iterators();
     printf("All File Test Passed\n");
 };
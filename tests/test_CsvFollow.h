@@ -0,0 +1,70 @@
+#include <assert.h>
+
+typedef struct TestFollow
+{
+    char first[64]; /* first field of every row, joined with '|' */
+    size_t rows;
+} TestFollow;
+
+static bool test_follow_row(void *user, CSVRow_t *row)
+{
+    TestFollow *seen = (TestFollow *)user;
+    assert(strlen(seen->first) + strlen(row->fields[0].value._string) + 2 < sizeof(seen->first));
+    strcat(seen->first, row->fields[0].value._string);
+    strcat(seen->first, "|");
+    seen->rows++;
+    csvee_row_free(row);
+    return true;
+}
+
+static void test_follow_append(const char *path, const char *text)
+{
+    FILE *file = fopen(path, "ab");
+    assert(file != NULL);
+    fputs(text, file);
+    fclose(file);
+}
+
+void test_follow_poll()
+{
+    remove("test_follow.csv");
+    test_follow_append("test_follow.csv", "a,1\nb,\"half");
+
+    TestFollow seen;
+    memset(&seen, 0, sizeof(seen));
+    CSVFollow_t follow;
+    assert(csvee_follow_open(&follow, "test_follow.csv", 0, test_follow_row, &seen));
+    assert(csvee_follow_poll(&follow));
+    assert(strcmp(seen.first, "a|") == 0);
+    assert(csvee_follow_offset(&follow) == 4);
+
+    /* the open quote and the half line are completed by the next write */
+    test_follow_append("test_follow.csv", " done\"\nc,3\n");
+    assert(csvee_follow_poll(&follow));
+    assert(strcmp(seen.first, "a|b|c|") == 0);
+    uint64_t offset = csvee_follow_offset(&follow);
+    csvee_follow_close(&follow);
+
+    /* resuming at the offset reads only what came after */
+    test_follow_append("test_follow.csv", "d,4\n");
+    memset(&seen, 0, sizeof(seen));
+    assert(csvee_follow_open(&follow, "test_follow.csv", offset, test_follow_row, &seen));
+    assert(csvee_follow_poll(&follow));
+    assert(strcmp(seen.first, "d|") == 0);
+
+    /* a file replaced by a shorter one is read again from the start */
+    remove("test_follow.csv");
+    test_follow_append("test_follow.csv", "e,5\n");
+    assert(csvee_follow_poll(&follow));
+    assert(strcmp(seen.first, "d|e|") == 0);
+    csvee_follow_close(&follow);
+
+    remove("test_follow.csv");
+};
+
+void test_follow()
+{
+    test_follow_poll();
+
+    printf("All Follow Test Passed\n");
+};
@@ -0,0 +1,57 @@
+#include <assert.h>
+
+void test_info_shape()
+{
+    const char *text = "name,note\r\nann,\"two\r\nlines\"\r\nbob\r\n";
+    FILE *file = fopen("test_info.csv", "wb");
+    assert(file != NULL);
+    fputs(text, file);
+    fclose(file);
+
+    CSVInfo_t info;
+    assert(csvee_info("test_info.csv", &info));
+    assert(info.rows == 3);
+    assert(info.min_columns == 1);
+    assert(info.max_columns == 2);
+    assert(info.header_count == 2);
+    assert(strcmp(info.header[0], "name") == 0);
+    assert(strcmp(info.header[1], "note") == 0);
+    assert(info.bytes == strlen(text));
+    assert(info.file_bytes == strlen(text));
+    assert(info.codec == CSVEE_CODEC_NONE);
+    assert(info.delimiter == ',');
+    assert(info.line_ending == CSVEE_EOL_CRLF);
+    assert(info.quoted_newlines);
+    assert(!info.unterminated_quote);
+    csvee_info_free(&info);
+
+    remove("test_info.csv");
+    assert(!csvee_info("test_info.csv", &info));
+};
+
+void test_info_open_quote()
+{
+    /* longer than one SIMD block, with the quote left open past it */
+    FILE *file = fopen("test_info.csv", "wb");
+    assert(file != NULL);
+    fputs("id,text\n1,plain\n2,\"a quoted field that is never closed,\nand spans lines\n", file);
+    fclose(file);
+
+    CSVInfo_t info;
+    assert(csvee_info("test_info.csv", &info));
+    assert(info.rows == 3);
+    assert(info.unterminated_quote);
+    assert(info.quoted_newlines);
+    assert(info.line_ending == CSVEE_EOL_LF);
+    csvee_info_free(&info);
+
+    remove("test_info.csv");
+};
+
+void test_info()
+{
+    test_info_shape();
+    test_info_open_quote();
+
+    printf("All Info Test Passed\n");
+};
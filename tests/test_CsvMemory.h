@@ -0,0 +1,127 @@
+#include <assert.h>
+
+#define TEST_MEMORY_ROWS (3 * CSVEE_SPILL_BLOCK_ROWS + 5)
+
+/* A file of TEST_MEMORY_ROWS records; returns what writing it from a plain read gives. */
+static char *test_memory_file(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    assert(file != NULL);
+    for (int i = 0; i < TEST_MEMORY_ROWS; ++i)
+        fprintf(file, "%d,row %d,\"quoted, %d\"\n", i, i * 3, i % 7);
+    fclose(file);
+
+    Csvee_t *table = csvee_read_from_file(path);
+    assert(table != NULL);
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    csvee_free(table);
+    return text;
+}
+
+static void test_memory_same(const Csvee_t *table, const char *expected)
+{
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    assert(text != NULL);
+    assert(strcmp(text, expected) == 0);
+    free(text);
+}
+
+void test_memory_spill()
+{
+    char *expected = test_memory_file("test_memory.csv");
+
+    CSVReadOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.memory_budget = 64 * 1024;
+    Csvee_t *table = csvee_read_from_file_opts("test_memory.csv", &options);
+    assert(table != NULL);
+    assert(table->spill != NULL);
+    assert(table->count == TEST_MEMORY_ROWS);
+    assert(csvee_get_stats(table)->spill_evictions > 0);
+
+    /* rows from far apart blocks, both kept while the other is paged in */
+    CSVRow_t first = csvee_get_row(table, 2);
+    CSVRow_t last = csvee_get_row(table, TEST_MEMORY_ROWS);
+    test_memory_same(table, expected);
+    assert(strcmp(first.fields[1].value._string, "row 3") == 0);
+    assert(atoi(last.fields[0].value._string) == TEST_MEMORY_ROWS - 1);
+    assert(csvee_get_stats(table)->spill_loads > 0);
+    csvee_row_free(&first);
+    csvee_row_free(&last);
+
+    /* lifting the budget pages every block back in */
+    assert(csvee_set_memory_budget(table, 0, NULL));
+    assert(table->spill == NULL);
+    test_memory_same(table, expected);
+
+    csvee_free(table);
+    free(expected);
+    remove("test_memory.csv");
+};
+
+void test_memory_lazy()
+{
+    char *expected = test_memory_file("test_memory.csv");
+
+    CSVReadOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.lazy = true;
+    Csvee_t *table = csvee_read_from_file_opts("test_memory.csv", &options);
+    assert(table != NULL);
+    assert(table->lazy != NULL);
+    assert(table->count == TEST_MEMORY_ROWS);
+    assert(table->rows[1000].fields == NULL);
+
+    CSVRow_t row = csvee_get_row(table, 1001);
+    assert(strcmp(row.fields[2].value._string, "quoted, 6") == 0);
+    csvee_row_free(&row);
+    assert(table->rows[1000].fields != NULL);
+    assert(table->rows[999].fields == NULL);
+
+    /* writing builds the rest, after which the input is let go */
+    test_memory_same(table, expected);
+    assert(table->lazy == NULL);
+
+    csvee_free(table);
+    free(expected);
+    remove("test_memory.csv");
+};
+
+void test_memory_compact()
+{
+    char *expected = test_memory_file("test_memory.csv");
+
+    CSVReadOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.compact = true;
+    Csvee_t *table = csvee_read_from_file_opts("test_memory.csv", &options);
+    assert(table != NULL);
+    assert(table->compact != NULL);
+    assert(table->count == TEST_MEMORY_ROWS);
+    assert(table->rows[1].fields == table->rows[0].fields + table->rows[0].count);
+    test_memory_same(table, expected);
+
+    /* rows of the block and rows appended later live side by side */
+    assert(csvee_update_field(table, 1, 2, "changed"));
+    assert(csvee_add_row(table, 3, "a", "b", "c"));
+    assert(strcmp(table->rows[0].fields[1].value._string, "changed") == 0);
+    assert(table->count == TEST_MEMORY_ROWS + 1);
+    assert(!csvee_set_memory_budget(table, 1024, NULL));
+
+    csvee_free(table);
+    free(expected);
+    remove("test_memory.csv");
+};
+
+void test_memory()
+{
+    test_memory_spill();
+    test_memory_lazy();
+    test_memory_compact();
+
+    printf("All Memory Test Passed\n");
+};
@@ -0,0 +1,155 @@
+#include <assert.h>
+
+typedef struct TestRows
+{
+    Csvee_t *csvee;
+    size_t rows;
+    size_t stop_after; /* rows to take before stopping, 0 for all */
+} TestRows;
+
+static bool test_parser_row(void *user, CSVRow_t *row)
+{
+    TestRows *rows = (TestRows *)user;
+    rows->rows++;
+    if (rows->rows == rows->stop_after)
+    {
+        csvee_row_free(row);
+        return false;
+    }
+    return csvee_push_row(rows->csvee, row);
+}
+
+void test_parser_feed()
+{
+    CSVDialect_t dialect;
+    csvee_dialect_init(&dialect, NULL, ',', '"', false, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+    /* one byte at a time: fields, quotes and line ends split across calls */
+    const char *text = "a,\"b\"\"c\",d\r\n\n1,,\"x,\ny\"\nlast";
+    TestRows rows;
+    memset(&rows, 0, sizeof(rows));
+    rows.csvee = csvee_read_from_string("");
+    assert(rows.csvee != NULL);
+
+    CSVParser_t parser;
+    csvee_parser_init(&parser, &dialect, test_parser_row, &rows);
+    for (size_t i = 0; i < strlen(text); ++i)
+        assert(csvee_parser_feed(&parser, text + i, 1));
+    assert(rows.rows == 2);
+    assert(csvee_parser_finish(&parser));
+    csvee_parser_free(&parser);
+
+    /* the blank line makes no row */
+    assert(rows.rows == 3);
+    char *out = NULL;
+    size_t size = 0;
+    csvee_write_to_string(rows.csvee, &out, &size);
+    assert(strcmp(out, "a,\"b\"\"c\",d\n1,,\"x,\ny\"\nlast\n") == 0);
+    free(out);
+    csvee_free(rows.csvee);
+
+    /* a callback returning false stops the parse */
+    memset(&rows, 0, sizeof(rows));
+    rows.csvee = csvee_read_from_string("");
+    rows.stop_after = 1;
+    csvee_parser_init(&parser, &dialect, test_parser_row, &rows);
+    assert(!csvee_parser_feed(&parser, text, strlen(text)));
+    csvee_parser_free(&parser);
+    assert(rows.csvee->count == 0);
+    csvee_free(rows.csvee);
+};
+
+void test_parser_codec()
+{
+    const unsigned char gzip[] = {0x1f, 0x8b, 0x08, 0x00};
+    const unsigned char zstd[] = {0x28, 0xb5, 0x2f, 0xfd};
+    assert(csvee_detect_codec(gzip, sizeof(gzip)) == CSVEE_CODEC_GZIP);
+    assert(csvee_detect_codec(zstd, sizeof(zstd)) == CSVEE_CODEC_ZSTD);
+    assert(csvee_detect_codec(zstd, 2) == CSVEE_CODEC_NONE);
+    assert(csvee_detect_codec((const unsigned char *)"a,b\n", 4) == CSVEE_CODEC_NONE);
+    assert(csvee_codec_supported(CSVEE_CODEC_NONE));
+
+#ifndef CSVEE_WITH_ZLIB
+    /* compressed input this build cannot decompress is refused, not read as text */
+    FILE *file = fopen("test_parser.csv.gz", "wb");
+    assert(file != NULL);
+    fwrite(gzip, 1, sizeof(gzip), file);
+    fclose(file);
+    assert(!csvee_codec_supported(CSVEE_CODEC_GZIP));
+    assert(csvee_read_from_file("test_parser.csv.gz") == NULL);
+    remove("test_parser.csv.gz");
+#endif
+};
+
+typedef struct TestParse
+{
+    char text[256]; /* fields joined with '|', rows ended with ';' */
+    size_t size;
+    size_t pieces; /* calls with more set */
+    size_t stop_after; /* rows to take before stopping, 0 for all */
+    size_t rows;
+} TestParse;
+
+static bool test_parse_field(void *user, const char *data, size_t size, bool more)
+{
+    TestParse *parse = (TestParse *)user;
+    assert(parse->size + size + 1 < sizeof(parse->text));
+    memcpy(parse->text + parse->size, data, size);
+    parse->size += size;
+    if (more)
+        parse->pieces++;
+    else
+        parse->text[parse->size++] = '|';
+    parse->text[parse->size] = '\0';
+    return true;
+}
+
+static bool test_parse_row_end(void *user)
+{
+    TestParse *parse = (TestParse *)user;
+    parse->text[parse->size++] = ';';
+    parse->text[parse->size] = '\0';
+    return ++parse->rows != parse->stop_after;
+}
+
+void test_parse_fields()
+{
+    CSVDialect_t dialect;
+    csvee_dialect_init(&dialect, NULL, ',', '"', false, true, CSVEE_QUOTE_MINIMAL, '\n');
+
+    const char *text = "a,\"b\"\"c\",d\n1,,\"x,y\"\r\nlast";
+    TestParse parse;
+    memset(&parse, 0, sizeof(parse));
+    assert(csvee_parse_cb(text, strlen(text), &dialect, test_parse_field, test_parse_row_end, &parse));
+    assert(strcmp(parse.text, "a|b\"c|d|;1||x,y|;last|;") == 0);
+    assert(parse.rows == 3);
+    /* the escaped quote splits its field */
+    assert(parse.pieces > 0);
+
+    /* a callback returning false stops the parse */
+    memset(&parse, 0, sizeof(parse));
+    parse.stop_after = 1;
+    assert(!csvee_parse_cb(text, strlen(text), &dialect, test_parse_field, test_parse_row_end, &parse));
+    assert(strcmp(parse.text, "a|b\"c|d|;") == 0);
+};
+
+void test_parse_dialect()
+{
+    CSVDialect_t dialect;
+    csvee_dialect_init(&dialect, NULL, ';', '\'', false, true, CSVEE_QUOTE_MINIMAL, '\n');
+    const char *text = "k;'v;w'\n'it''s';2\n";
+    TestParse parse;
+    memset(&parse, 0, sizeof(parse));
+    assert(csvee_parse_cb(text, strlen(text), &dialect, test_parse_field, test_parse_row_end, &parse));
+    assert(strcmp(parse.text, "k|v;w|;it's|2|;") == 0);
+};
+
+void test_parser()
+{
+    test_parser_feed();
+    test_parser_codec();
+    test_parse_fields();
+    test_parse_dialect();
+
+    printf("All Parser Test Passed\n");
+};
@@ -0,0 +1,84 @@
+#include <assert.h>
+
+#define TEST_PROFILE "id,price,name,flag\n1,2.5,ann,true\n2,,bob,false\n3,4.5,ann,TRUE\n4,1e1,ann,x\n"
+
+static void test_profile_input(const char *path)
+{
+    Csvee_t *input = csvee_read_from_string(TEST_PROFILE);
+    assert(input != NULL);
+    assert(csvee_write_to_file(input, path));
+    csvee_free(input);
+}
+
+void test_profile_columns()
+{
+    test_profile_input("test_profile.csv");
+
+    CSVProfileOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.header = true;
+    options.nthreads = 2;
+
+    CSVProfile_t profile;
+    assert(csvee_profile("test_profile.csv", &options, &profile));
+    assert(profile.count == 4);
+    assert(profile.rows == 4);
+
+    const CSVColumnProfile_t *id = &profile.columns[0];
+    assert(strcmp(id->name, "id") == 0);
+    assert(id->type == CSVEE_INTEGER);
+    assert(id->count == 4 && id->nulls == 0);
+    assert(id->min == 1 && id->max == 4 && id->mean == 2.5);
+    assert(csvee_profile_variance(id) > 1.66 && csvee_profile_variance(id) < 1.67);
+    assert(csvee_profile_quantile(id, 0.0) == 1 && csvee_profile_quantile(id, 1.0) == 4);
+
+    const CSVColumnProfile_t *price = &profile.columns[1];
+    assert(price->type == CSVEE_DOUBLE);
+    assert(price->nulls == 1);
+    assert(price->max == 10);
+
+    const CSVColumnProfile_t *name = &profile.columns[2];
+    assert(name->type == CSVEE_STRING);
+    assert(name->top_count == 2);
+    assert(strcmp(name->top[0].value, "ann") == 0 && name->top[0].count >= 3);
+    assert(csvee_profile_distinct(name) > 1.9 && csvee_profile_distinct(name) < 2.1);
+
+    /* one value that is not a bool makes the column text */
+    assert(profile.columns[3].bools == 3);
+    assert(profile.columns[3].type == CSVEE_STRING);
+
+    csvee_profile_free(&profile);
+    remove("test_profile.csv");
+};
+
+void test_profile_merge()
+{
+    test_profile_input("test_profile.csv");
+
+    CSVProfileOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.header = true;
+
+    CSVProfile_t profile, other;
+    assert(csvee_profile("test_profile.csv", &options, &profile));
+    assert(csvee_profile("test_profile.csv", &options, &other));
+    assert(csvee_profile_merge(&profile, &other));
+
+    assert(profile.rows == 8);
+    assert(profile.columns[0].count == 8);
+    assert(profile.columns[0].mean == 2.5);
+    assert(profile.columns[1].nulls == 2);
+    assert(csvee_profile_distinct(&profile.columns[2]) < 2.1);
+
+    csvee_profile_free(&other);
+    csvee_profile_free(&profile);
+    remove("test_profile.csv");
+};
+
+void test_profile()
+{
+    test_profile_columns();
+    test_profile_merge();
+
+    printf("All Profile Test Passed\n");
+};
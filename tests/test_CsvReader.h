@@ -0,0 +1,55 @@
+#include <assert.h>
+#ifdef __cplusplus
+#include <sstream>
+
+struct TestReaderTrade
+{
+    int64_t id;
+    double price;
+    std::string symbol;
+    std::optional<int> quantity;
+};
+CSVEE_BIND(TestReaderTrade, &TestReaderTrade::id, &TestReaderTrade::price, &TestReaderTrade::symbol, &TestReaderTrade::quantity);
+
+void test_reader_bind()
+{
+    std::istringstream input("id,price,symbol,quantity\n1,2.5,\"A,B\",10\n2,3.75,XYZ,\n");
+    csvee::CSVReader<std::istringstream> reader(input);
+    std::vector<TestReaderTrade> trades = reader.ReadAll<TestReaderTrade>(true);
+
+    assert(trades.size() == 2);
+    assert(trades[0].id == 1 && trades[0].price == 2.5);
+    assert(trades[0].symbol == "A,B");
+    assert(trades[0].quantity && *trades[0].quantity == 10);
+    assert(trades[1].symbol == "XYZ");
+    assert(!trades[1].quantity);
+};
+
+void test_reader_errors()
+{
+    /* record and column are both counted from 1, the header included */
+    std::istringstream input("id,price,symbol,quantity\n1,2.5,A,10\n2,cheap,B,1\n");
+    csvee::CSVReader<std::istringstream> reader(input);
+    size_t seen = 0;
+    try
+    {
+        reader.ForEach<TestReaderTrade>([&](TestReaderTrade &)
+                                        { ++seen; }, true);
+        assert(false);
+    }
+    catch (const csvee::CsveeError &error)
+    {
+        assert(error.GetErrType() == WRONG_CAST);
+        assert(std::string(error.what()).find("record 3, column 2") != std::string::npos);
+    }
+    assert(seen == 1);
+};
+
+void test_reader()
+{
+    test_reader_bind();
+    test_reader_errors();
+
+    printf("All Reader Test Passed\n");
+};
+#endif
@@ -1,48 +1,68 @@
-#include "../csvee.h"
 #include <assert.h>
 
 
 void test_row_intailization()
 {
-    CsvRow row1 = csvee_create_row(3);
+    CSVRow_t row1 = csvee_create_row(3);
     row1.fields[0] = csvee_create_field("Name");
     row1.fields[1] = csvee_create_field("Age");
     row1.fields[2] = csvee_create_field("Occupation");
 
-    assert(row1.fields[0].value != NULL);
-    assert(row1.fields[1].value != NULL);
-    assert(row1.fields[2].value != NULL);
+    assert(row1.count == 3);
+    assert(strcmp(row1.fields[0].value._string, "Name") == 0);
+    assert(strcmp(row1.fields[1].value._string, "Age") == 0);
+    assert(strcmp(row1.fields[2].value._string, "Occupation") == 0);
 
-    assert(strcmp(row1.fields[0].value, "Name") == 0);
-    assert(strcmp(row1.fields[1].value, "Age") == 0);
-    assert(strcmp(row1.fields[2].value, "Occupation") == 0);
-
-    csvee_free_row(&row1);
-
-    // assert(row1.fields == NULL);//
+    csvee_row_free(&row1);
     assert(row1.count == 0);
 };
 
 void test_row_operators()
 {
-    CsvRow row1 = csvee_create_row(3);
-    row1.fields[0] = csvee_create_field("Name");
-    row1.fields[1] = csvee_create_field("Age");
-    row1.fields[2] = csvee_create_field("Occupation");
-
-    CsvRow row2 = csvee_create_row(3);
-    row2.fields[0] = csvee_create_field("Ezekiel");
-    row2.fields[1] = csvee_create_field("20");
-    row2.fields[2] = csvee_create_field("Software Engineer");
+    Csvee_t *file = csvee_read_from_string("Name,Age,Occupation\nEzekiel,20,Software Engineer\n");
+    CSVRow_t row1 = csvee_get_row(file, 1);
+    CSVRow_t row2 = csvee_get_row(file, 2);
 
     assert(row1.count == row2.count);
-    assert(!csvee_row_equal(&row1, &row2));
+    assert(strcmp(row1.fields[2].value._string, row2.fields[2].value._string) != 0);
+    assert(strcmp(row2.fields[2].value._string, "Software Engineer") == 0);
+    csvee_row_free(&row1);
+    csvee_row_free(&row2);
+
+    /* rows are counted from 1, there is nothing past the end */
+    CSVRow_t none = csvee_get_row(file, 3);
+    assert(none.count == 0);
+    csvee_row_free(&none);
+
+    csvee_free(file);
+};
+
+void test_row_iterators()
+{
+    CSVRow_t row = csvee_create_row(3);
+    row.fields[0] = csvee_create_field("Ezekiel");
+    row.fields[1] = csvee_create_field("20");
+    row.fields[2] = csvee_create_field("Software Engineer");
+
+    CSVFieldSpan_t span = csvee_fields_span(&row);
+    assert(span.count == 3);
+    assert(span.fields == row.fields);
+
+    /* iterators are values, nothing to free */
+    size_t seen = 0;
+    RowIterator_t end = csvee_row_iter_end(&row);
+    for (RowIterator_t it = csvee_row_iter_begin(&row); !csvee_row_iter_equal(&it, &end); csvee_row_iter_next(&it))
+        assert(csvee_row_iter_peek(&it) == &row.fields[seen++]);
+    assert(seen == 3);
+
+    csvee_row_free(&row);
 };
 
 void test_row()
 {
     test_row_intailization();
     test_row_operators();
+    test_row_iterators();
 
     printf("All Row Test Passed\n");
 };
@@ -0,0 +1,131 @@
+#include <assert.h>
+
+#define TEST_SORT "name,amount\nann,10\nbob,\ncid,x\ndan,2.5\neve,10\n"
+
+static void test_sort_expect(const char *path, const char *expected)
+{
+    Csvee_t *sorted = csvee_read_from_file(path);
+    assert(sorted != NULL);
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(sorted, &text, &size);
+    assert(strcmp(text, expected) == 0);
+    free(text);
+    csvee_free(sorted);
+}
+
+void test_sort_file_keys()
+{
+    Csvee_t *input = csvee_read_from_string(TEST_SORT);
+    assert(csvee_write_to_file(input, "test_sort_in.csv"));
+    csvee_free(input);
+
+    /* empty first, text that is not a number last, ties keep their order */
+    CSVSortKey_t by_amount = {1, CSVEE_SORT_DOUBLE, CSVEE_SORT_ASC};
+    assert(csvee_sort_file("test_sort_in.csv", "test_sort_out.csv", &by_amount, 1, true, 0, 2));
+    test_sort_expect("test_sort_out.csv", "name,amount\nbob,\ndan,2.5\nann,10\neve,10\ncid,x\n");
+
+    CSVSortKey_t keys[] = {
+        {1, CSVEE_SORT_DOUBLE, CSVEE_SORT_DESC},
+        {0, CSVEE_SORT_TEXT, CSVEE_SORT_DESC},
+    };
+    /* without a header the first record is sorted too; text compares with text */
+    assert(csvee_sort_file("test_sort_in.csv", "test_sort_out.csv", keys, 2, false, 0, 1));
+    test_sort_expect("test_sort_out.csv", "cid,x\nname,amount\neve,10\nann,10\ndan,2.5\nbob,\n");
+
+    assert(!csvee_sort_file("test_sort_missing.csv", "test_sort_out.csv", keys, 2, false, 0, 1));
+
+    remove("test_sort_in.csv");
+    remove("test_sort_out.csv");
+};
+
+void test_sort_file_runs()
+{
+    /* a small memory limit spreads the records over many run files */
+    FILE *file = fopen("test_sort_in.csv", "wb");
+    assert(file != NULL);
+    for (int i = 0; i < 5000; ++i)
+        fprintf(file, "%d,%d\n", (i * 7919) % 97, i);
+    fclose(file);
+
+    CSVSortKey_t by_key = {0, CSVEE_SORT_INTEGER, CSVEE_SORT_ASC};
+    assert(csvee_sort_file("test_sort_in.csv", "test_sort_out.csv", &by_key, 1, false, 4096, 2));
+
+    Csvee_t *sorted = csvee_read_from_file("test_sort_out.csv");
+    assert(sorted != NULL && sorted->count == 5000);
+    for (size_t r = 1; r < sorted->count; ++r)
+    {
+        int key = atoi(sorted->rows[r].fields[0].value._string);
+        int prev = atoi(sorted->rows[r - 1].fields[0].value._string);
+        assert(prev <= key);
+        if (prev == key)
+            assert(atoi(sorted->rows[r - 1].fields[1].value._string) < atoi(sorted->rows[r].fields[1].value._string));
+    }
+    csvee_free(sorted);
+
+    remove("test_sort_in.csv");
+    remove("test_sort_out.csv");
+};
+
+void test_sort_table()
+{
+    Csvee_t *table = csvee_read_from_string("3,c\n1,a\n10,j\n2,b\n");
+    CSVSortKey_t by_number = {0, CSVEE_SORT_INTEGER, CSVEE_SORT_ASC};
+    assert(csvee_sort(table, &by_number, 1));
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    assert(strcmp(text, "1,a\n2,b\n3,c\n10,j\n") == 0);
+    free(text);
+
+    CSVSortKey_t by_text = {0, CSVEE_SORT_TEXT, CSVEE_SORT_ASC};
+    assert(csvee_sort(table, &by_text, 1));
+    csvee_write_to_string(table, &text, &size);
+    assert(strcmp(text, "1,a\n10,j\n2,b\n3,c\n") == 0);
+    free(text);
+
+    csvee_free(table);
+};
+
+void test_sort_table_large()
+{
+    /* enough rows for every core to take a slice, with keys that tie on their first bytes */
+    Csvee_t *table = csvee_read_from_string("");
+    CSVRow_t row;
+    char key[32];
+    for (int i = 0; i < 20000; ++i)
+    {
+        row = csvee_create_row(2);
+        snprintf(key, sizeof(key), "%d", (i * 7919) % 10007 - 5000);
+        row.fields[0] = csvee_create_field(key);
+        snprintf(key, sizeof(key), "%d", i);
+        row.fields[1] = csvee_create_field(key);
+        assert(csvee_push_row(table, &row));
+    }
+
+    CSVSortKey_t keys[] = {
+        {0, CSVEE_SORT_INTEGER, CSVEE_SORT_DESC},
+        {1, CSVEE_SORT_INTEGER, CSVEE_SORT_ASC},
+    };
+    assert(csvee_sort(table, keys, 2));
+    for (size_t r = 1; r < table->count; ++r)
+    {
+        int prev = atoi(table->rows[r - 1].fields[0].value._string);
+        int next = atoi(table->rows[r].fields[0].value._string);
+        assert(prev >= next);
+        if (prev == next)
+            assert(atoi(table->rows[r - 1].fields[1].value._string) < atoi(table->rows[r].fields[1].value._string));
+    }
+    csvee_free(table);
+};
+
+void test_sort()
+{
+    test_sort_file_keys();
+    test_sort_file_runs();
+    test_sort_table();
+    test_sort_table_large();
+
+    printf("All Sort Test Passed\n");
+};
@@ -0,0 +1,55 @@
+#include <assert.h>
+
+void test_stats_read()
+{
+    const char *text = "a,\"b\"\"c\"\n1,\"x,y\"\n";
+    Csvee_t *table = csvee_read_from_string(text);
+    assert(table != NULL);
+
+    const CSVStat_t *stats = csvee_get_stats(table);
+    assert(stats->bytes_scanned == strlen(text));
+    assert(stats->rows == 2);
+    assert(stats->fields == 4);
+    assert(stats->quoted_fields == 2);
+    assert(stats->escaped_quotes == 1);
+    assert(stats->footprint > 0);
+    assert(stats->peak_footprint >= stats->footprint);
+
+    csvee_free(table);
+};
+
+void test_stats_global()
+{
+    Csvee_t *table = csvee_read_from_string("a,b\n1,\"x,y\"\n");
+    assert(table != NULL);
+    CSVStat_t before = *csvee_get_stats(table);
+
+    /* writes count process wide only; the table is left as it was */
+    csvee_reset_global_stats();
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    assert(memcmp(&before, csvee_get_stats(table), sizeof(before)) == 0);
+
+    CSVStat_t global;
+    csvee_get_global_stats(&global);
+    assert(global.bytes_written == size);
+    assert(global.rows == 2);
+    assert(global.fields == 4);
+    assert(global.quoted_fields == 1);
+
+    csvee_reset_global_stats();
+    csvee_get_global_stats(&global);
+    assert(global.rows == 0 && global.bytes_written == 0);
+
+    free(text);
+    csvee_free(table);
+};
+
+void test_stats()
+{
+    test_stats_read();
+    test_stats_global();
+
+    printf("All Stats Test Passed\n");
+};
@@ -0,0 +1,175 @@
+#include <assert.h>
+
+#define TEST_VERSION_ROWS (CSVEE_SHARE_BLOCK_ROWS + 100)
+#define TEST_VERSION_COUNT 60
+#define TEST_VERSION_READERS 4
+
+typedef struct TestVersionReader
+{
+    CSVVersions_t *versions;
+    uint64_t *done;
+    size_t snapshots;
+} TestVersionReader;
+
+/* Every row of a version carries its number: a snapshot mixing two versions would show. */
+static void test_versions_check(const Csvee_t *snap)
+{
+    const CSVRow_t *first = csvee_versions_read(snap, 0);
+    assert(first != NULL && first->count == 2);
+    const char *version = first->fields[1].value._string;
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(snap, &text, &size);
+    assert(text != NULL);
+
+    size_t rows = 0;
+    for (char *line = text; *line; ++rows)
+    {
+        char *end = strchr(line, '\n');
+        assert(end != NULL);
+        char *comma = strchr(line, ',');
+        assert(comma != NULL && comma < end);
+        assert((size_t)(end - comma - 1) == strlen(version));
+        assert(strncmp(comma + 1, version, strlen(version)) == 0);
+        line = end + 1;
+    }
+    assert(rows == snap->count);
+    free(text);
+}
+
+static void test_versions_reader(void *arg)
+{
+    TestVersionReader *reader = (TestVersionReader *)arg;
+    while (!CSVEE_ATOMIC_LOAD(reader->done))
+    {
+        const Csvee_t *snap = csvee_versions_acquire(reader->versions);
+        assert(snap != NULL);
+        test_versions_check(snap);
+        csvee_versions_release(reader->versions, snap);
+        reader->snapshots++;
+    }
+}
+
+void test_versions_publish()
+{
+    Csvee_t *table = csvee_new(',');
+    CSVRow_t row;
+    char key[32];
+    for (size_t r = 0; r < TEST_VERSION_ROWS; ++r)
+    {
+        row = csvee_create_row(2);
+        snprintf(key, sizeof(key), "%zu", r);
+        row.fields[0] = csvee_create_field(key);
+        row.fields[1] = csvee_create_field("0");
+        assert(csvee_push_row(table, &row));
+    }
+    CSVVersions_t *versions = csvee_versions_new(table);
+    assert(versions != NULL);
+
+    uint64_t done = 0;
+    TestVersionReader readers[TEST_VERSION_READERS];
+    csvee_thread_t threads[TEST_VERSION_READERS];
+    for (size_t t = 0; t < TEST_VERSION_READERS; ++t)
+    {
+        readers[t].versions = versions;
+        readers[t].done = &done;
+        readers[t].snapshots = 0;
+        assert(csvee_thread_create(&threads[t], test_versions_reader, &readers[t]));
+    }
+
+    char value[32];
+    for (size_t v = 1; v <= TEST_VERSION_COUNT; ++v)
+    {
+        Csvee_t *next = csvee_versions_edit(versions);
+        assert(next != NULL);
+        snprintf(value, sizeof(value), "%zu", v);
+        for (size_t r = 0; r < TEST_VERSION_ROWS; ++r)
+        {
+            CSVRow_t *edit = csvee_versions_row(next, r);
+            assert(edit != NULL);
+            csvee_field_free(&edit->fields[1]);
+            edit->fields[1] = csvee_create_field(value);
+        }
+        assert(csvee_versions_publish(versions, next));
+    }
+
+    CSVEE_ATOMIC_STORE(&done, (uint64_t)1);
+    for (size_t t = 0; t < TEST_VERSION_READERS; ++t)
+        csvee_thread_join(threads[t]);
+
+    const Csvee_t *last = csvee_versions_acquire(versions);
+    snprintf(value, sizeof(value), "%d", TEST_VERSION_COUNT);
+    assert(strcmp(csvee_versions_read(last, TEST_VERSION_ROWS - 1)->fields[1].value._string, value) == 0);
+    csvee_versions_release(versions, last);
+    csvee_versions_free(versions);
+};
+
+void test_versions_read()
+{
+    CSVVersions_t *versions = csvee_versions_new(csvee_read_from_string("a,1\nb,1\nc,1\n"));
+    assert(versions != NULL);
+    const Csvee_t *old = csvee_versions_acquire(versions);
+
+    /* a draft shares the published rows until one is handed out */
+    Csvee_t *next = csvee_versions_edit(versions);
+    CSVRow_t *row = csvee_versions_row(next, 1);
+    assert(row != NULL && row != csvee_versions_read(old, 1));
+    csvee_field_free(&row->fields[0]);
+    row->fields[0] = csvee_create_field("B");
+    assert(csvee_versions_publish(versions, next));
+
+    /* the snapshot held across the publish keeps its row */
+    assert(strcmp(csvee_versions_read(old, 1)->fields[0].value._string, "b") == 0);
+    assert(csvee_versions_read(old, 3) == NULL);
+    csvee_versions_release(versions, old);
+
+    const Csvee_t *snap = csvee_versions_acquire(versions);
+    assert(strcmp(csvee_versions_read(snap, 1)->fields[0].value._string, "B") == 0);
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(snap, &text, &size);
+    assert(strcmp(text, "a,1\nB,1\nc,1\n") == 0);
+    free(text);
+
+    csvee_versions_release(versions, snap);
+    csvee_versions_free(versions);
+};
+
+void test_versions_delete()
+{
+    CSVVersions_t *versions = csvee_versions_new(csvee_read_from_string("a,1\nb,1\nc,1\n"));
+    assert(versions != NULL);
+    const Csvee_t *old = csvee_versions_acquire(versions);
+
+    Csvee_t *next = csvee_versions_edit(versions);
+    assert(csvee_delete_row(next, 2));
+    assert(csvee_versions_publish(versions, next));
+
+    /* the held snapshot still has the row, the new one reads it as deleted */
+    assert(strcmp(csvee_versions_read(old, 1)->fields[0].value._string, "b") == 0);
+    csvee_versions_release(versions, old);
+
+    const Csvee_t *snap = csvee_versions_acquire(versions);
+    assert(csvee_versions_read(snap, 1) == NULL);
+    assert(strcmp(csvee_versions_read(snap, 2)->fields[0].value._string, "c") == 0);
+
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(snap, &text, &size);
+    assert(strcmp(text, "a,1\nc,1\n") == 0);
+    free(text);
+
+    csvee_versions_release(versions, snap);
+    csvee_versions_free(versions);
+};
+
+void test_versions()
+{
+    test_versions_read();
+    test_versions_delete();
+    test_versions_publish();
+
+    printf("All Versions Test Passed\n");
+};
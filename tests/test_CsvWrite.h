@@ -0,0 +1,91 @@
+#include <assert.h>
+#ifdef __cplusplus
+#include <sstream>
+#endif
+
+#define TEST_WRITE "id,note\n1,\"a, b\"\n2,\n3,\"say \"\"hi\"\"\"\n"
+
+void test_write_blocks()
+{
+    Csvee_t *table = csvee_read_from_string(TEST_WRITE);
+    assert(table != NULL);
+
+    /* blocks far smaller than a row still make the same file */
+    CSVWriteOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.codec = CSVEE_CODEC_NONE;
+    options.block_size = 3;
+    assert(csvee_write_to_file_opts(table, "test_write.csv", &options));
+    csvee_free(table);
+
+    table = csvee_read_from_file("test_write.csv");
+    assert(table != NULL);
+    char *text = NULL;
+    size_t size = 0;
+    csvee_write_to_string(table, &text, &size);
+    assert(strcmp(text, TEST_WRITE) == 0);
+    free(text);
+    csvee_free(table);
+
+    remove("test_write.csv");
+};
+
+void test_write_codec()
+{
+    Csvee_t *table = csvee_read_from_string(TEST_WRITE);
+    assert(table != NULL);
+
+#ifndef CSVEE_WITH_ZLIB
+    /* a codec this build lacks fails instead of writing plain text */
+    CSVWriteOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.codec = CSVEE_CODEC_GZIP;
+    assert(!csvee_write_to_file_opts(table, "test_write.csv", &options));
+    assert(!csvee_write_to_file(table, "test_write.csv.gz"));
+#else
+    /* the extension picks the codec, the reader finds it again */
+    assert(csvee_write_to_file(table, "test_write.csv.gz"));
+    Csvee_t *back = csvee_read_from_file("test_write.csv.gz");
+    assert(back != NULL && back->count == table->count);
+    csvee_free(back);
+#endif
+
+    csvee_free(table);
+    remove("test_write.csv");
+    remove("test_write.csv.gz");
+};
+
+#ifdef __cplusplus
+struct TestWriteTrade
+{
+    int64_t id;
+    double price;
+    std::string symbol;
+    std::optional<int> quantity;
+};
+CSVEE_BIND(TestWriteTrade, &TestWriteTrade::id, &TestWriteTrade::price, &TestWriteTrade::symbol, &TestWriteTrade::quantity);
+
+void test_write_cpp()
+{
+    std::ostringstream out;
+    {
+        csvee::CSVWriter<std::ostringstream> writer(out);
+        writer.WriteFields("id", "price", "symbol", "quantity");
+        writer << TestWriteTrade{1, 2.5, "A,B", 10};
+        writer.WriteRow(std::make_tuple(2, 3.75, "say \"hi\"", std::optional<int>()));
+        writer << std::vector<std::string>{"3", "", "", "7"};
+    }
+    assert(out.str() == "id,price,symbol,quantity\n1,2.5,\"A,B\",10\n2,3.75,\"say \"\"hi\"\"\",\n3,,,7\n");
+};
+#endif
+
+void test_write()
+{
+    test_write_blocks();
+    test_write_codec();
+#ifdef __cplusplus
+    test_write_cpp();
+#endif
+
+    printf("All Write Test Passed\n");
+};
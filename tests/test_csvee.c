@@ -1,14 +1,56 @@
+#define _DEFAULT_SOURCE /* mkdtemp */
 #define CSVEE_SEPERATOR ','
+#define CSVEE_IMPLEMENTATION
 
 #include "../csvee.h"
+#include <assert.h>
+#include <unistd.h>
 #include "test_CsvField.h"
 #include "test_CsvRow.h"
 #include "test_CsvFile.h"
+#include "test_CsvParser.h"
+#include "test_CsvWrite.h"
+#include "test_CsvStats.h"
+#include "test_CsvInfo.h"
+#include "test_CsvMemory.h"
+#include "test_CsvFollow.h"
+#include "test_CsvSort.h"
+#include "test_CsvAggregate.h"
+#include "test_CsvProfile.h"
+#include "test_CsvArrow.h"
+#include "test_CsvColumnar.h"
+#include "test_CsvTyped.h"
+#include "test_CsvReader.h"
+#include "test_CsvVersions.h"
 
 int main()
 {
+    /* scratch files go to a directory of their own, removed at the end */
+    char dir[] = "/tmp/csvee_test_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    assert(chdir(dir) == 0);
+
     test_field();
     test_row();
     test_file();
+    test_parser();
+    test_write();
+    test_stats();
+    test_info();
+    test_memory();
+    test_follow();
+    test_sort();
+    test_aggregate();
+    test_profile();
+    test_arrow();
+    test_columnar();
+    test_typed();
+#ifdef __cplusplus
+    test_reader();
+#endif
+    test_versions();
+
+    assert(chdir("/") == 0);
+    assert(rmdir(dir) == 0);
     return 0;
-}
\ No newline at end of file
+}